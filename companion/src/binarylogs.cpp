@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <QFile>
+#include <QDateTime>
+#include <QVector>
+#include <QStringList>
+#include <QtEndian>
+#include "binarylogs.h"
+#include "../../radio/src/definitions.h"
+#include "../../radio/src/binary_logs.h"
+
+bool isBinaryLogFile(const QString & filename)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QByteArray magic = file.read(strlen(BINARY_LOGS_MAGIC));
+  file.close();
+  return magic == BINARY_LOGS_MAGIC;
+}
+
+// same output as the f_printf() calls in radio/src/logs.cpp
+static QString formatValue(int32_t value, uint8_t prec)
+{
+  QString sign = (value < 0 ? "-" : "");
+  if (prec == 2)
+    return QString("%1%2.%3").arg(sign).arg(abs(value / 100)).arg(abs(value % 100), 2, 10, QChar('0'));
+  else if (prec == 1)
+    return QString("%1%2.%3").arg(sign).arg(abs(value / 10)).arg(abs(value % 10));
+  else
+    return QString::number(value);
+}
+
+static QString formatGpsCoordinate(int32_t value)
+{
+  return QString("%1.%2").arg(value / 1000000).arg(abs(value % 1000000), 6, 10, QChar('0'));
+}
+
+static QString formatDateTime(uint32_t value)
+{
+  return QString("%1-%2-%3 %4:%5:%6")
+    .arg(2000 + (value >> 26), 4)
+    .arg((value >> 22) & 0x0F, 2, 10, QChar('0'))
+    .arg((value >> 17) & 0x1F, 2, 10, QChar('0'))
+    .arg((value >> 12) & 0x1F, 2, 10, QChar('0'))
+    .arg((value >> 6) & 0x3F, 2, 10, QChar('0'))
+    .arg(value & 0x3F, 2, 10, QChar('0'));
+}
+
+static QStringList formatRow(const BinaryLogsHeader & header, const QList<BinaryLogsColumn> & columns, const QVector<int32_t> & values)
+{
+  QStringList row;
+
+  if (header.flags & BINARY_LOGS_RTC) {
+    QDateTime time = QDateTime::fromTime_t(header.startTime, Qt::UTC).addMSecs(10 * ((qint64)header.startTime10ms + values[0]));
+    row << time.toString("yyyy-MM-dd") << time.toString("HH:mm:ss.zzz");
+  }
+  else {
+    row << QString::number(header.startTime + values[0]);
+  }
+
+  int index = 1;
+  foreach(const BinaryLogsColumn & column, columns) {
+    switch (column.type) {
+      case BINARY_LOGS_COLUMN_GPS:
+        if (values[index] && values[index+1])
+          row << formatGpsCoordinate(values[index]) + " " + formatGpsCoordinate(values[index+1]);
+        else
+          row << "";
+        break;
+      case BINARY_LOGS_COLUMN_DATETIME:
+        row << formatDateTime(values[index]);
+        break;
+      case BINARY_LOGS_COLUMN_HEX64:
+        row << "0x" + QString("%1%2").arg((uint32_t)values[index], 8, 16, QChar('0')).arg((uint32_t)values[index+1], 8, 16, QChar('0')).toUpper();
+        break;
+      default:
+        row << formatValue(values[index], column.prec);
+        break;
+    }
+    index += getBinaryLogsColumnWidth(column.type);
+  }
+
+  return row;
+}
+
+static bool appendCsvRow(QIODevice & csv, const QStringList & row)
+{
+  QByteArray line = row.join(',').toUtf8();
+  line.append('\n');
+  return csv.write(line) == line.size();
+}
+
+int convertBinaryLogFile(const QString & filename, QIODevice & csv)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return -1;
+  }
+
+  // the file is mapped, as the CSV logs in CsvLog
+  QByteArray buffer;
+  qint64 size = file.size();
+  const uchar * ptr = file.map(0, size);
+  if (!ptr) {
+    // some file systems don't support mapping
+    buffer = file.readAll();
+    ptr = (const uchar *)buffer.constData();
+    size = buffer.size();
+  }
+  const uchar * end = ptr + size;
+  BinaryLogsHeader header;
+  QList<BinaryLogsColumn> columns;
+  QStringList firstLabels;
+  QVector<int32_t> values;
+  bool sameColumns = false;   // the current session has the columns of the first one
+  bool keyframe = false;      // a keyframe has been read in the current session
+  int errors = 0;
+
+  while (ptr < end) {
+    uint8_t type = *ptr;
+
+    if (type == 0) {
+      // padding before a new session
+      ptr++;
+      continue;
+    }
+
+    if (type == BINARY_LOGS_MAGIC[0]) {
+      if (end - ptr < (int)sizeof(header) || memcmp(ptr, BINARY_LOGS_MAGIC, sizeof(header.magic))) {
+        return -1;
+      }
+      memcpy(&header, ptr, sizeof(header));
+      if (header.version != BINARY_LOGS_VERSION || end - ptr < (int)(sizeof(header) + header.columnsCount * sizeof(BinaryLogsColumn))) {
+        return -1;
+      }
+
+      QStringList labels;
+      if (header.flags & BINARY_LOGS_RTC)
+        labels << "Date" << "Time";
+      else
+        labels << "Time";
+
+      columns.clear();
+      int valuesCount = 1;
+      const uchar * columnPtr = ptr + sizeof(header);
+      for (int i=0; i<header.columnsCount; i++) {
+        BinaryLogsColumn column;
+        memcpy(&column, columnPtr, sizeof(column));
+        columnPtr += sizeof(column);
+        columns.append(column);
+        labels << QString::fromLatin1(column.label, strnlen(column.label, BINARY_LOGS_LABEL_LEN));
+        valuesCount += getBinaryLogsColumnWidth(column.type);
+      }
+
+      if (firstLabels.isEmpty()) {
+        firstLabels = labels;
+        if (!appendCsvRow(csv, labels)) {
+          return -1;
+        }
+      }
+      sameColumns = (labels == firstLabels);
+      values.fill(0, valuesCount);
+      keyframe = false;
+      ptr += header.headerSectors * BINARY_LOGS_SECTOR_SIZE;
+      continue;
+    }
+
+    if (columns.isEmpty()) {
+      return -1;
+    }
+
+    int count = values.size();
+    if (type == BINARY_LOGS_KEYFRAME) {
+      if (end - ptr < 1 + count * 4)
+        break;
+      for (int i=0; i<count; i++) {
+        values[i] = qFromLittleEndian<qint32>(ptr + 1 + i * 4);
+      }
+      ptr += 1 + count * 4;
+      keyframe = true;
+    }
+    else if (type == BINARY_LOGS_DELTA) {
+      if (end - ptr < 1 + count * 2)
+        break;
+      for (int i=0; i<count; i++) {
+        values[i] += qFromLittleEndian<qint16>(ptr + 1 + i * 2);
+      }
+      ptr += 1 + count * 2;
+    }
+    else {
+      // corrupted file, the records length is unknown from here
+      errors++;
+      break;
+    }
+
+    if (keyframe && sameColumns) {
+      if (!appendCsvRow(csv, formatRow(header, columns, values))) {
+        return -1;
+      }
+    }
+    else {
+      errors++;
+    }
+  }
+
+  return errors;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _BINARYLOGS_H_
+#define _BINARYLOGS_H_
+
+#include <QString>
+#include <QIODevice>
+
+// Logs written by radios built with the BINARY_LOGS option
+bool isBinaryLogFile(const QString & filename);
+
+// Converts a binary log to the CSV log the radio would have written, the rows
+// are written to csv as they are decoded.
+// Returns the number of invalid records, -1 on error
+int convertBinaryLogFile(const QString & filename, QIODevice & csv);
+
+#endif // _BINARYLOGS_H_
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "csvlog.h"
+#include "binarylogs.h"
+
+CsvLog::CsvLog():
+  convertedFile(NULL),
+  data(NULL),
+  size(0),
+  lines(0),
+  errors(0)
+{
+}
+
+CsvLog::~CsvLog()
+{
+  close();
+}
+
+bool CsvLog::open(const QString & filename)
+{
+  close();
+
+  QString path = filename;
+  int conversionErrors = 0;
+  if (isBinaryLogFile(filename)) {
+    convertedFile = new QTemporaryFile();
+    if (!convertedFile->open()) {
+      close();
+      return false;
+    }
+    conversionErrors = convertBinaryLogFile(filename, *convertedFile);
+    convertedFile->close();
+    if (conversionErrors < 0) {
+      close();
+      return false;
+    }
+    path = convertedFile->fileName();
+  }
+
+  file.setFileName(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    close();
+    return false;
+  }
+  size = file.size();
+  data = (const char *)file.map(0, size);
+  if (!data) {
+    // some file systems don't support mapping
+    buffer = file.readAll();
+    file.close();
+    data = buffer.constData();
+    size = buffer.size();
+  }
+
+  if (!index()) {
+    close();
+    return false;
+  }
+
+  // the binary log records which weren't converted
+  errors += conversionErrors;
+
+  return true;
+}
+
+void CsvLog::close()
+{
+  if (file.isOpen()) {
+    if (data && buffer.isEmpty())
+      file.unmap((uchar *)data);
+    file.close();
+  }
+  delete convertedFile;
+  convertedFile = NULL;
+  buffer.clear();
+  data = NULL;
+  size = 0;
+  labels.clear();
+  rows.clear();
+  columns.clear();
+  times.clear();
+  lines = 0;
+  errors = 0;
+}
+
+// end of the line starting at ptr, without the trailing spaces
+const char * CsvLog::rowEnd(const char * ptr) const
+{
+  const char * end = data + size;
+  const char * eol = (const char *)memchr(ptr, '\n', end - ptr);
+  if (!eol)
+    eol = end;
+  while (eol > ptr && isspace((unsigned char)eol[-1]))
+    eol--;
+  return eol;
+}
+
+bool CsvLog::index()
+{
+  const char * end = data + size;
+  const char * eol = rowEnd(data);
+
+  QByteArray header = QByteArray::fromRawData(data, eol - data);
+  if (!header.startsWith("Date,Time")) {
+    return false;
+  }
+  labels = QString::fromUtf8(header.constData(), header.size()).split(',');
+
+  int fieldsCount = labels.count();
+  const char * ptr = (const char *)memchr(data, '\n', size);
+  if (!ptr) {
+    return false;
+  }
+  ptr++;
+
+  while (ptr < end) {
+    const char * next = (const char *)memchr(ptr, '\n', end - ptr);
+    if (!next)
+      next = end;
+    int fields = 1;
+    for (const char * c = ptr; c < next; c++) {
+      if (*c == ',')
+        fields++;
+    }
+    if (fields == fieldsCount)
+      rows.append(ptr - data);
+    else
+      errors++;
+    lines++;
+    ptr = next + 1;
+  }
+
+  return !rows.isEmpty();
+}
+
+const char * CsvLog::findField(int row, int column, const char ** end) const
+{
+  const char * ptr = data + rows.at(row);
+  const char * eol = rowEnd(ptr);
+
+  for (int i=0; i<column; i++) {
+    ptr = (const char *)memchr(ptr, ',', eol - ptr) + 1;
+  }
+
+  *end = (const char *)memchr(ptr, ',', eol - ptr);
+  if (!*end)
+    *end = eol;
+  return ptr;
+}
+
+QString CsvLog::field(int row, int column) const
+{
+  const char * end;
+  const char * ptr = findField(row, column, &end);
+  return QString::fromUtf8(ptr, end - ptr);
+}
+
+QStringList CsvLog::row(int row) const
+{
+  const char * ptr = data + rows.at(row);
+  const char * eol = rowEnd(ptr);
+  return QString::fromUtf8(ptr, eol - ptr).split(',');
+}
+
+// same results as QString::toDouble(), 0 when the field isn't a number
+static double parseDouble(const char * ptr, const char * end)
+{
+  char value[64];
+  int len = end - ptr;
+
+  if (len <= 0 || len >= (int)sizeof(value))
+    return 0;
+
+  for (int i=0; i<len; i++) {
+    char c = ptr[i];
+    if (!((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E' || c == ' '))
+      return 0;
+    value[i] = c;
+  }
+  value[len] = '\0';
+
+  char * last;
+  double result = strtod(value, &last);
+  while (*last == ' ')
+    last++;
+  return (last == value || *last != '\0') ? 0 : result;
+}
+
+QVector<double> CsvLog::column(int column)
+{
+  QHash<int, QVector<double> >::const_iterator it = columns.constFind(column);
+  if (it != columns.constEnd()) {
+    return it.value();
+  }
+
+  int count = rows.count();
+  QVector<double> values(count);
+  for (int i=0; i<count; i++) {
+    const char * end;
+    const char * ptr = findField(i, column, &end);
+    values[i] = parseDouble(ptr, end);
+  }
+
+  columns.insert(column, values);
+  return values;
+}
+
+void CsvLog::retainColumns(const QList<int> & kept)
+{
+  QHash<int, QVector<double> >::iterator it = columns.begin();
+  while (it != columns.end()) {
+    if (kept.contains(it.key()))
+      ++it;
+    else
+      it = columns.erase(it);
+  }
+}
+
+// a new session starts after 61s without records
+QList<int> CsvLog::sessions()
+{
+  QVector<double> times = timestamps();
+  QList<int> result;
+  for (int i=0; i<times.count(); i++) {
+    if (i == 0 || !(times.at(i) - times.at(i-1) < 61)) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+static bool parseNumber(const char * ptr, int len, int & result)
+{
+  result = 0;
+  for (int i=0; i<len; i++) {
+    if (ptr[i] < '0' || ptr[i] > '9')
+      return false;
+    result = result * 10 + ptr[i] - '0';
+  }
+  return true;
+}
+
+QVector<double> CsvLog::timestamps()
+{
+  if (!times.isEmpty() || rows.isEmpty()) {
+    return times;
+  }
+
+  // the conversion to local time is done once per hour of log
+  int lastHour = -1;
+  double hourTime = 0;
+
+  int count = rows.count();
+  times.resize(count);
+  for (int i=0; i<count; i++) {
+    const char * dateEnd, * timeEnd;
+    const char * date = findField(i, 0, &dateEnd);
+    const char * time = findField(i, 1, &timeEnd);
+    int year, month, day, hour, min, sec;
+
+    if (dateEnd - date != 10 || timeEnd - time < 8 ||
+        !parseNumber(date, 4, year) || date[4] != '-' || !parseNumber(date+5, 2, month) || date[7] != '-' || !parseNumber(date+8, 2, day) ||
+        !parseNumber(time, 2, hour) || time[2] != ':' || !parseNumber(time+3, 2, min) || time[5] != ':' || !parseNumber(time+6, 2, sec)) {
+      times[i] = NAN;
+      continue;
+    }
+
+    int key = ((year * 16 + month) * 32 + day) * 32 + hour;
+    if (key != lastHour) {
+      QDateTime dateTime(QDate(year, month, day), QTime(hour, 0, 0));
+      hourTime = dateTime.isValid() ? (double)dateTime.toTime_t() : NAN;
+      lastHour = key;
+    }
+
+    double value = hourTime + min * 60 + sec;
+    if (timeEnd - time > 9 && time[8] == '.') {
+      value += parseDouble(time + 8, timeEnd);
+    }
+    times[i] = value;
+  }
+
+  return times;
+}
+
+CsvLogModel::CsvLogModel(QObject * parent):
+  QAbstractTableModel(parent),
+  log(NULL)
+{
+}
+
+void CsvLogModel::setLog(CsvLog * log)
+{
+  beginResetModel();
+  this->log = log;
+  endResetModel();
+}
+
+int CsvLogModel::rowCount(const QModelIndex & parent) const
+{
+  return (log && !parent.isValid()) ? log->rowCount() : 0;
+}
+
+int CsvLogModel::columnCount(const QModelIndex & parent) const
+{
+  return (log && !parent.isValid()) ? log->columnCount() : 0;
+}
+
+QVariant CsvLogModel::data(const QModelIndex & index, int role) const
+{
+  if (!log || !index.isValid() || role != Qt::DisplayRole)
+    return QVariant();
+  return log->field(index.row(), index.column());
+}
+
+QVariant CsvLogModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (log && orientation == Qt::Horizontal && role == Qt::DisplayRole && section < log->columnCount())
+    return log->header().at(section);
+  return QAbstractTableModel::headerData(section, orientation, role);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _CSVLOG_H_
+#define _CSVLOG_H_
+
+#include <QtCore>
+
+// A telemetry log (CSV or binary), opened without loading it in memory:
+// the file is mapped and only the offsets of the valid rows are kept. The
+// binary logs are converted to a temporary CSV file first.
+// Fields are read on demand and the numeric columns are parsed the first
+// time they are plotted.
+class CsvLog
+{
+  public:
+    CsvLog();
+    ~CsvLog();
+
+    bool open(const QString & filename);
+    void close();
+
+    const QStringList & header() const { return labels; }
+    int columnCount() const { return labels.count(); }
+    int rowCount() const { return rows.count(); }
+    int linesCount() const { return lines; }
+    int errorsCount() const { return errors; }
+
+    QString field(int row, int column) const;
+    QStringList row(int row) const;
+
+    // the values of a column, as QString::toDouble() would have returned them
+    QVector<double> column(int column);
+    // the Date and Time columns, in seconds since 1970 (local time)
+    QVector<double> timestamps();
+    // frees the parsed columns not in the list
+    void retainColumns(const QList<int> & columns);
+    // the first row of each flight session
+    QList<int> sessions();
+
+  protected:
+    QFile file;
+    QTemporaryFile * convertedFile;   // the CSV conversion of a binary log
+    QByteArray buffer;          // when the file can't be mapped
+    const char * data;
+    qint64 size;
+    QStringList labels;
+    QVector<qint64> rows;       // offset of each valid row
+    QHash<int, QVector<double> > columns;
+    QVector<double> times;
+    int lines;
+    int errors;
+
+    bool index();
+    const char * rowEnd(const char * ptr) const;
+    const char * findField(int row, int column, const char ** end) const;
+};
+
+class CsvLogModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+  public:
+    CsvLogModel(QObject * parent = 0);
+
+    void setLog(CsvLog * log);
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex & index, int role) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+  protected:
+    CsvLog * log;
+};
+
+#endif // _CSVLOG_H_
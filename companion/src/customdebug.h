@@ -27,8 +27,9 @@
 #if defined(DEBUG_STORAGE_IMPORT)
   inline QDebug eepromImportDebug() { return QDebug(QtDebugMsg); }
 #else
+  // the statement is never executed, so the arguments aren't formatted for every imported field
   #undef eepromImportDebug
-  inline QNoDebug eepromImportDebug() { return QNoDebug(); }
+  #define eepromImportDebug() while (false) QNoDebug()
 #endif
 
 
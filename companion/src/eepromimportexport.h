@@ -22,71 +22,196 @@
 #define _EEPROMIMPORTEXPORT_H_
 
 #include "customdebug.h"
-#include <QBitArray>
+#include <QByteArray>
 
-class DataField {
+// Bits are packed LSB first, the same layout as the firmware bitfields
+class BitsWriter {
   public:
-    DataField(const char *name=""):
-      name(name)
+    BitsWriter():
+      accumulator(0),
+      accumulatorBits(0)
     {
     }
-    virtual const char *getName() { return name; }
-    virtual ~DataField() { }
-    virtual void ExportBits(QBitArray & output) = 0;
-    virtual void ImportBits(const QBitArray & input) = 0;
-    virtual unsigned int size() = 0;
 
-    QBitArray bytesToBits(QByteArray bytes)
+    void write(uint64_t value, unsigned int bits)
+    {
+      while (bits > 32) {
+        write32(value & 0xFFFFFFFF, 32);
+        value >>= 32;
+        bits -= 32;
+      }
+      if (bits > 0) {
+        write32(value & (((uint64_t)1 << bits) - 1), bits);
+      }
+    }
+
+    void writeBytes(const char * bytes, unsigned int count)
+    {
+      if (accumulatorBits == 0) {
+        data.append(bytes, count);
+      }
+      else {
+        for (unsigned int i=0; i<count; i++) {
+          write32((uint8_t)bytes[i], 8);
+        }
+      }
+    }
+
+    void writeZeros(unsigned int bits)
+    {
+      while (accumulatorBits != 0 && bits > 0) {
+        write32(0, 1);
+        bits--;
+      }
+      if (bits >= 8) {
+        data.append(QByteArray(bits / 8, 0));
+        bits %= 8;
+      }
+      write32(0, bits);
+    }
+
+    unsigned int count() const
+    {
+      return data.size() * 8 + accumulatorBits;
+    }
+
+    QByteArray bytes() const
+    {
+      QByteArray result = data;
+      if (accumulatorBits) {
+        result.append((char)accumulator);
+      }
+      return result;
+    }
+
+  protected:
+    QByteArray data;
+    uint64_t accumulator;
+    unsigned int accumulatorBits;
+
+    void write32(uint32_t value, unsigned int bits)
+    {
+      accumulator |= (uint64_t)value << accumulatorBits;
+      accumulatorBits += bits;
+      while (accumulatorBits >= 8) {
+        data.append((char)accumulator);
+        accumulator >>= 8;
+        accumulatorBits -= 8;
+      }
+    }
+};
+
+class BitsReader {
+  public:
+    explicit BitsReader(const QByteArray & data):
+      data((const uint8_t *)data.constData()),
+      bytesCount(data.size()),
+      offset(0)
+    {
+    }
+
+    uint64_t read(unsigned int bits)
+    {
+      uint64_t result = 0;
+      for (unsigned int shift=0; shift<bits; shift+=32) {
+        unsigned int count = (bits - shift > 32 ? 32 : bits - shift);
+        result |= (uint64_t)read32(count) << shift;
+      }
+      return result;
+    }
+
+    void readBytes(char * bytes, unsigned int count)
     {
-      QBitArray bits(bytes.count()*8);
-      // Convert from QByteArray to QBitArray
-      for (int i=0; i<bytes.count(); ++i)
-        for (int b=0; b<8; ++b)
-          bits.setBit(i*8+b, bytes.at(i)&(1<<b));
-      return bits;
+      if ((offset & 7) == 0 && offset / 8 + count <= bytesCount) {
+        memcpy(bytes, data + offset / 8, count);
+        offset += count * 8;
+      }
+      else {
+        for (unsigned int i=0; i<count; i++) {
+          bytes[i] = read32(8);
+        }
+      }
+    }
+
+    void skip(unsigned int bits)
+    {
+      offset += bits;
+    }
+
+    unsigned int position() const
+    {
+      return offset;
     }
 
-    QByteArray bitsToBytes(QBitArray bits, int offset=0)
+    void setPosition(unsigned int position)
     {
-      QByteArray bytes;
-      bytes.resize((offset+bits.count()+7)/8);
-      bytes.fill(0);
-      // Convert from QBitArray to QByteArray
-      for (int b=0; b<bits.count(); ++b)
-        bytes[(b+offset)/8] = ( bytes.at((b+offset)/8) | ((bits[b]?1:0)<<((b+offset)%8)));
-      return bytes;
+      offset = position;
     }
 
+  protected:
+    const uint8_t * data;
+    unsigned int bytesCount;
+    unsigned int offset;
+
+    uint32_t read32(unsigned int bits)
+    {
+      if (bits == 0)
+        return 0;
+      unsigned int index = offset / 8;
+      unsigned int shift = offset % 8;
+      uint64_t value = 0;
+      for (unsigned int i=0; i*8<shift+bits; i++) {
+        if (index + i < bytesCount)
+          value |= (uint64_t)data[index + i] << (i * 8);
+      }
+      offset += bits;
+      return (value >> shift) & (((uint64_t)1 << bits) - 1);
+    }
+};
+
+class DataField {
+  public:
+    DataField(const char *name=""):
+      name(name)
+    {
+    }
+    virtual const char *getName() { return name; }
+    virtual ~DataField() { }
+    virtual void ExportBits(BitsWriter & output) = 0;
+    virtual void ImportBits(BitsReader & input) = 0;
+    virtual unsigned int size() = 0;
+
     int Export(QByteArray & output)
     {
-      QBitArray result;
-      ExportBits(result);
-      output = bitsToBytes(result);
+      BitsWriter writer;
+      ExportBits(writer);
+      output = writer.bytes();
       return 0;
     }
 
     int Import(const QByteArray & input)
     {
-      QBitArray bits = bytesToBits(input);
-      if ((unsigned int)bits.size() < size()) {
+      if ((unsigned int)input.size() * 8 < size()) {
         qDebug() << QString("Error importing %1: size to small %2/%3").arg(getName()).arg(input.size()).arg(size());
         return -1;
       }
-      ImportBits(bits);
+      BitsReader reader(input);
+      ImportBits(reader);
       return 0;
     }
 
     virtual int Dump(int level=0, int offset=0)
     {
-      QBitArray bits;
-      ExportBits(bits);
-      QByteArray bytes = bitsToBytes(bits);
-      int result = (offset+bits.count()) % 8;
+      BitsWriter writer;
+      ExportBits(writer);
+      QByteArray bytes = writer.bytes();
+      int count = writer.count();
+      int result = (offset+count) % 8;
       for (int i=0; i<level; i++) printf("  ");
-      if (bits.count() % 8 == 0)
+      if (count % 8 == 0)
         printf("%s (%dbytes) ", getName(), bytes.count());
       else
-        printf("%s (%dbits) ", getName(), bits.count());
+        printf("%s (%dbits) ", getName(), count);
       for (int i=0; i<bytes.count(); i++) {
         unsigned char c = bytes[i];
         if ((i==0 && offset) || (i==bytes.count()-1 && result!=0))
@@ -140,26 +265,23 @@ class BaseUnsignedField: public DataField {
     {
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
       container value = field;
       if (value > max) value = max;
       if (value < min) value = min;
 
-      output.resize(N);
-      for (int i=0; i<N; i++) {
-        if (value & ((container)1<<i)) {
-          output.setBit(i);
-        }
+      output.write(value, N < BITS ? N : BITS);
+      if (N > BITS) {
+        output.writeZeros(N - BITS);
       }
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
-      field = 0;
-      for (int i=0; i<N; i++) {
-        if (input[i])
-          field |= ((container)1<<i);
+      field = input.read(N < BITS ? N : BITS);
+      if (N > BITS) {
+        input.skip(N - BITS);
       }
       eepromImportDebug() << QString("\timported %1<%2>: 0x%3(%4)").arg(name).arg(N).arg(field, 0, 16).arg(field);
     }
@@ -170,6 +292,7 @@ class BaseUnsignedField: public DataField {
     }
 
   protected:
+    enum { BITS = 8 * sizeof(container) };
     container & field;
     container min;
     container max;
@@ -207,17 +330,16 @@ class BoolField: public DataField {
     {
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
-      output.resize(N);
-      if (field) {
-        output.setBit(0);
-      }
+      output.write(field ? 1 : 0, 1);
+      output.writeZeros(N - 1);
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
-      field = input[0] ? true : false;
+      field = input.read(1) ? true : false;
+      input.skip(N - 1);
       eepromImportDebug() << QString("\timported %1<%2>: 0x%3(%4)").arg(name).arg(N).arg(field, 0, 16).arg(field);
     }
 
@@ -260,31 +382,21 @@ class SignedField: public DataField {
     {
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
       int value = field;
       if (value > max) value = max;
       if (value < min) value = min;
 
-      output.resize(N);
-      for (int i=0; i<N; i++) {
-        if (((unsigned int)value) & (1<<i))
-          output.setBit(i);
-      }
+      output.write((unsigned int)value, N);
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
-      unsigned int value = 0;
-      for (int i=0; i<N; i++) {
-        if (input[i])
-          value |= (1<<i);
-      }
+      unsigned int value = input.read(N);
 
-      if (input[N-1]) {
-        for (unsigned int i=N; i<8*sizeof(int); i++) {
-          value |= (1<<i);
-        }
+      if (N < 8*sizeof(int) && (value & (1u << (N-1)))) {
+        value |= ~0u << (N % (8*sizeof(int)));
       }
 
       field = (int)value;
@@ -324,31 +436,19 @@ class CharField: public DataField {
     {
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
-      output.resize(N*8);
-      int b = 0;
+      char bytes[N];
       int len = truncate ? strlen(field) : N;
       for (int i=0; i<N; i++) {
-        int idx = (i>=len ? 0 : field[i]);
-        for (int j=0; j<8; j++, b++) {
-          if (idx & (1<<j))
-            output.setBit(b);
-        }
+        bytes[i] = (i>=len ? 0 : field[i]);
       }
+      output.writeBytes(bytes, N);
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
-      unsigned int b = 0;
-      for (int i=0; i<N; i++) {
-        int8_t idx = 0;
-        for (int j=0; j<8; j++) {
-          if (input[b++])
-            idx |= (1<<j);
-        }
-        field[i] = idx;
-      }
+      input.readBytes(field, N);
       eepromImportDebug() << QString("\timported %1<%2>: '%3'").arg(name).arg(N).arg(field);
     }
 
@@ -374,30 +474,22 @@ class ZCharField: public DataField {
     {
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
-      output.resize(N*8);
-      int b = 0;
+      char bytes[N];
       int len = strlen(field);
       for (int i=0; i<N; i++) {
-        int idx = i>=len ? 0 : char2idx(field[i]);
-        for (int j=0; j<8; j++, b++) {
-          if (idx & (1<<j))
-            output.setBit(b);
-        }
+        bytes[i] = (i>=len ? 0 : char2idx(field[i]));
       }
+      output.writeBytes(bytes, N);
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
-      unsigned int b = 0;
+      char bytes[N];
+      input.readBytes(bytes, N);
       for (int i=0; i<N; i++) {
-        int8_t idx = 0;
-        for (int j=0; j<8; j++) {
-          if (input[b++])
-            idx |= (1<<j);
-        }
-        field[i] = idx2char(idx);
+        field[i] = idx2char(bytes[i]);
       }
 
       field[N] = '\0';
@@ -437,29 +529,27 @@ class StructField: public DataField {
       fields.append(field);
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
-      int offset = 0;
-      output.resize(size());
+      // the struct is padded with zeros up to its size, which is read
+      // before the export (see the telemetry screens)
+      unsigned int end = output.count() + size();
       foreach(DataField *field, fields) {
-        QBitArray bits;
-        field->ExportBits(bits);
-        for (int i=0; i<bits.size(); i++)
-          output[offset++] = bits[i];
+        field->ExportBits(output);
+      }
+      if (output.count() < end) {
+        output.writeZeros(end - output.count());
       }
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
       eepromImportDebug() << QString("\timporting %1[%2]:").arg(name).arg(fields.size());
-      int offset = 0;
       foreach(DataField *field, fields) {
-        unsigned int size = field->size();
-        QBitArray bits(size);
-        for (unsigned int i=0; i<size; i++) {
-          bits[i] = input[offset++];
-        }
-        field->ImportBits(bits);
+        // the size must be read before the import (see the telemetry screens)
+        unsigned int offset = input.position() + field->size();
+        field->ImportBits(input);
+        input.setPosition(offset);
       }
     }
 
@@ -498,13 +588,13 @@ class TransformedField: public DataField {
     {
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
       beforeExport();
       field.ExportBits(output);
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
       eepromImportDebug() << QString("\timporting TransformedField %1:").arg(field.getName());
       field.ImportBits(input);
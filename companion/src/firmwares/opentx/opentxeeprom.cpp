@@ -876,7 +876,7 @@ class FlightModeField: public TransformedField {
     virtual void beforeExport()
     {
       for (int i=0; i<CPN_MAX_STICKS+MAX_AUX_TRIMS(board); i++) {
-        if (IS_HORUS_OR_TARANIS(board) && version >= 216) {
+        if (hasTrimModes()) {
           if (phase.trimMode[i] < 0)
             trimMode[i] = TRIM_MODE_NONE;
           else
@@ -904,7 +904,7 @@ class FlightModeField: public TransformedField {
     virtual void afterImport()
     {
       for (int i=0; i<CPN_MAX_STICKS+MAX_AUX_TRIMS(board); i++) {
-        if (IS_HORUS_OR_TARANIS(board) && version >= 216) {
+        if (hasTrimModes()) {
           if (trimMode[i] == TRIM_MODE_NONE) {
             phase.trimMode[i] = -1;
           }
@@ -944,6 +944,12 @@ class FlightModeField: public TransformedField {
     }
 
   protected:
+    // the layouts above with the trim modes next to the trims
+    bool hasTrimModes() const
+    {
+      return (IS_ARM(board) && version >= 218) || (IS_TARANIS(board) && version >= 216);
+    }
+
     StructField internalField;
     FlightModeData & phase;
     int index;
@@ -1199,7 +1205,7 @@ class MixField: public TransformedField {
 
       if (mix.srcRaw.type != SOURCE_TYPE_NONE) {
         mix.destCh = _destCh + 1;
-        if (!IS_STM32(board) || version < 216) {
+        if (!hasCurveReference()) {
           if (!_curveMode)
             mix.curve = CurveReference(CurveReference::CURVE_REF_DIFF, smallGvarToC9x(_curveParam));
           else if (_curveParam > 6)
@@ -1233,6 +1239,12 @@ class MixField: public TransformedField {
     }
 
   protected:
+    // the layouts above with a CurveReferenceField
+    bool hasCurveReference() const
+    {
+      return (IS_ARM(board) && version >= 218) || (IS_TARANIS(board) && version >= 216);
+    }
+
     StructField internalField;
     MixData & mix;
     Board::Type board;
@@ -1363,11 +1375,10 @@ class InputField: public TransformedField {
     {
       _weight = smallGvarToEEPROM(expo.weight);
 
-      if (IS_HORUS_OR_TARANIS(board) && version >= 216) {
+      if (hasOffsetAndCurveReference()) {
         _offset = smallGvarToEEPROM(expo.offset);
       }
-
-      if (!IS_TARANIS(board) || version < 216) {
+      else {
         if (expo.curve.type==CurveReference::CURVE_REF_FUNC && expo.curve.value) {
           _curveMode = true;
           _curveParam = expo.curve.value;
@@ -1398,11 +1409,10 @@ class InputField: public TransformedField {
 
       expo.weight = smallGvarToC9x(_weight);
 
-      if (IS_STM32(board) && version >= 216) {
+      if (hasOffsetAndCurveReference()) {
         expo.offset = smallGvarToC9x(_offset);
       }
-
-      if (!IS_STM32(board) || version < 216) {
+      else {
         if (!_curveMode)
           expo.curve = CurveReference(CurveReference::CURVE_REF_EXPO, smallGvarToC9x(_curveParam));
         else if (_curveParam > 6)
@@ -1414,6 +1424,12 @@ class InputField: public TransformedField {
     }
 
   protected:
+    // the layouts above with an Offset field and a CurveReferenceField
+    bool hasOffsetAndCurveReference() const
+    {
+      return (IS_ARM(board) && version >= 218) || (IS_TARANIS(board) && version >= 216);
+    }
+
     StructField internalField;
     ExpoData & expo;
     Board::Type board;
@@ -1555,7 +1571,7 @@ class CurvesField: public TransformedField {
 
       for (int i=0; i<maxCurves; i++) {
         CurveData *curve = &curves[i];
-        if (IS_STM32(board) && version >= 216) {
+        if (hasCurveHeaders()) {
           offset += (curve->type == CurveData::CURVE_TYPE_CUSTOM ? curve->count * 2 - 2 : curve->count);
           if (offset > maxPoints) {
             EEPROMWarnings.push_back(::QObject::tr("OpenTX only accepts %1 points in all curves").arg(maxPoints));
@@ -1587,7 +1603,7 @@ class CurvesField: public TransformedField {
 
       for (int i=0; i<maxCurves; i++) {
         CurveData * curve = &curves[i];
-        if (!IS_STM32(board) || version < 216) {
+        if (!hasCurveHeaders()) {
           int * next = &_points[5*(i+1) + _curves[i]];
           int size = next - cur;
           if (size % 2 == 0) {
@@ -1629,6 +1645,13 @@ class CurvesField: public TransformedField {
     }
 
   protected:
+    // the layouts above with the type and the points count of each curve,
+    // instead of the curve offsets
+    bool hasCurveHeaders() const
+    {
+      return (IS_ARM(board) && version >= 218) || (IS_TARANIS(board) && version >= 216);
+    }
+
     StructField internalField;
     CurveData * curves;
     Board::Type board;
@@ -2403,7 +2426,7 @@ class AvrCustomFunctionField: public TransformedField {
       else {
         internalField.Append(new SwitchField<8>(fn.swtch, board, version));
         internalField.Append(new ConversionField< UnsignedField<7> >((unsigned int &)fn.func, &functionsConversionTable, "Function", ::QObject::tr("OpenTX on this board doesn't accept this function")));
-        internalField.Append(new BoolField<1>((bool &)fn.enabled));
+        internalField.Append(new UnsignedField<1>(fn.enabled, 0, 1, "Enabled"));
       }
       internalField.Append(new UnsignedField<8>(_param));
     }
@@ -2606,7 +2629,7 @@ class FrskyScreenField: public DataField {
       }
     }
 
-    virtual void ExportBits(QBitArray & output)
+    virtual void ExportBits(BitsWriter & output)
     {
       if (IS_ARM(board) && version >= 217) {
         if (screen.type == TELEMETRY_SCREEN_SCRIPT)
@@ -2626,7 +2649,7 @@ class FrskyScreenField: public DataField {
       }
     }
 
-    virtual void ImportBits(const QBitArray & input)
+    virtual void ImportBits(BitsReader & input)
     {
       eepromImportDebug() << QString("importing %1: type: %2").arg(name).arg(screen.type);
 
@@ -3096,7 +3119,7 @@ OpenTxModelData::OpenTxModelData(ModelData & modelData, Board::Type board, unsig
     else if (afterrelease21March2013) {
       internalField.Append(new SwitchField<8>(modelData.timers[i].mode, board, version, true));
       internalField.Append(new UnsignedField<12>(modelData.timers[i].val));
-      internalField.Append(new BoolField<1>((bool &)modelData.timers[i].countdownBeep));
+      internalField.Append(new UnsignedField<1>(modelData.timers[i].countdownBeep, 0, 1, "Countdown"));
       internalField.Append(new BoolField<1>(modelData.timers[i].minuteBeep));
       if (HAS_PERSISTENT_TIMERS(board)) {
         internalField.Append(new UnsignedField<1>(modelData.timers[i].persistent));
@@ -24,6 +24,7 @@
 #include <QtCore>
 #include <QtGui>
 #include "qcustomplot.h"
+#include "csvlog.h"
 
 #define INVALID_MIN 999999
 #define INVALID_MAX -999999
@@ -83,7 +84,8 @@ private slots:
   void yAxisChangeRanges(QCPRange range);
 
 private:
-  QList<QStringList> csvlog;
+  CsvLog csvlog;
+  CsvLogModel * logModel;
   Ui::LogsDialog *ui;
   QCPAxisRect *axisRect;
   QCPLegend *rightLegend;
@@ -102,7 +104,8 @@ private:
   QCPItemStraightLine * cursorLine;
 
   bool cvsFileParse();
-  QList<QStringList> filterGePoints(const QList<QStringList> & input);
+  QList<QStringList> filterGePoints();
+  QVector<int> getSelectedRows();
   void exportToGoogleEarth();
   QDateTime getRecordTimeStamp(int index);
   QString generateDuration(const QDateTime & start, const QDateTime & end);
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// Opens CSV and binary telemetry logs with CsvLog and checks the rows index,
+// the invalid rows, the columns parsing and the flight sessions.
+// Returns the number of failed checks.
+
+#include <QCoreApplication>
+#include <QTemporaryFile>
+#include <stdio.h>
+#include <string.h>
+#include "csvlog.h"
+#include "../../../radio/src/definitions.h"
+#include "../../../radio/src/binary_logs.h"
+
+static int errors = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      errors++; \
+    } \
+  } while (0)
+
+// gives access to the parsed columns
+class TestCsvLog: public CsvLog
+{
+  public:
+    int parsedColumnsCount() const { return columns.count(); }
+};
+
+static bool writeFile(QTemporaryFile & file, const QByteArray & content)
+{
+  if (!file.open() || file.write(content) != content.size()) {
+    printf("%s: write failed\n", qPrintable(file.fileName()));
+    errors++;
+    return false;
+  }
+  file.close();
+  return true;
+}
+
+static void testRowsIndex()
+{
+  QTemporaryFile file;
+  if (!writeFile(file, "Date,Time,RSSI,A1(V)\r\n"
+                       "2017-05-01,10:00:00.000,80,4.20\r\n"
+                       "2017-05-01,10:00:00.100,81,4.19  \r\n"
+                       "2017-05-01,10:00:00.200,,4.18\r\n"
+                       "2017-05-01,10:00:00.300,83,4.17"))
+    return;
+
+  TestCsvLog log;
+  CHECK(log.open(file.fileName()));
+  CHECK(log.columnCount() == 4);
+  CHECK(log.header().at(3) == "A1(V)");
+  CHECK(log.rowCount() == 4);
+  CHECK(log.linesCount() == 4);
+  CHECK(log.errorsCount() == 0);
+  // the end of line and the trailing spaces aren't part of the last field
+  CHECK(log.field(0, 3) == "4.20");
+  CHECK(log.field(1, 3) == "4.19");
+  CHECK(log.field(2, 2) == "");
+  CHECK(log.field(3, 3) == "4.17");
+  CHECK(log.row(1) == QStringList() << "2017-05-01" << "10:00:00.100" << "81" << "4.19");
+
+  log.close();
+  CHECK(log.rowCount() == 0);
+  CHECK(log.columnCount() == 0);
+}
+
+static void testInvalidRows()
+{
+  QTemporaryFile file;
+  if (!writeFile(file, "Date,Time,RSSI\n"
+                       "2017-05-01,10:00:00.000,80\n"
+                       "2017-05-01,10:00:00.100\n"
+                       "2017-05-01,10:00:00.200,82,1\n"
+                       "2017-05-01,10:00:00.300,83\n"))
+    return;
+
+  CsvLog log;
+  CHECK(log.open(file.fileName()));
+  CHECK(log.rowCount() == 2);
+  CHECK(log.linesCount() == 4);
+  CHECK(log.errorsCount() == 2);
+  CHECK(log.field(1, 2) == "83");
+
+  // not a log
+  QTemporaryFile other;
+  if (writeFile(other, "Time,RSSI\n10,80\n")) {
+    CHECK(!log.open(other.fileName()));
+    CHECK(log.rowCount() == 0);
+  }
+
+  // a header without rows
+  QTemporaryFile empty;
+  if (writeFile(empty, "Date,Time,RSSI\n")) {
+    CHECK(!log.open(empty.fileName()));
+  }
+}
+
+static void testColumns()
+{
+  QTemporaryFile file;
+  if (!writeFile(file, "Date,Time,Alt(m),GPS,Mode\n"
+                       "2017-05-01,10:00:00.000,12.5,45.123456 6.123456,ON\n"
+                       "2017-05-01,10:00:00.100,-3,,OFF\n"
+                       "2017-05-01,10:00:00.200, 1e2 ,45.123457 6.123457,ON\n"))
+    return;
+
+  TestCsvLog log;
+  CHECK(log.open(file.fileName()));
+  // the columns are only parsed when they are asked for
+  CHECK(log.parsedColumnsCount() == 0);
+
+  // the values QString::toDouble() returns
+  for (int column=2; column<log.columnCount(); column++) {
+    QVector<double> values = log.column(column);
+    CHECK(values.count() == log.rowCount());
+    for (int row=0; row<log.rowCount(); row++) {
+      CHECK(values.at(row) == log.field(row, column).toDouble());
+    }
+  }
+  CHECK(log.parsedColumnsCount() == 3);
+  CHECK(log.column(2).at(2) == 100);
+
+  log.retainColumns(QList<int>() << 2);
+  CHECK(log.parsedColumnsCount() == 1);
+  CHECK(log.column(2).at(0) == 12.5);
+}
+
+static void testSessions()
+{
+  QTemporaryFile file;
+  if (!writeFile(file, "Date,Time,RSSI\n"
+                       "2017-05-01,10:00:00.000,80\n"
+                       "2017-05-01,10:00:30.500,80\n"
+                       "2017-05-01,10:01:31.000,80\n"
+                       "2017-05-01,10:02:32.000,80\n"
+                       "2017-05-01,23:59:59.900,80\n"
+                       "2017-05-02,00:00:00.100,80\n"
+                       "2017-05-02,invalid,80\n"
+                       "2017-05-02,00:00:01.000,80\n"))
+    return;
+
+  CsvLog log;
+  CHECK(log.open(file.fileName()));
+  QVector<double> times = log.timestamps();
+  CHECK(times.count() == 8);
+  CHECK(times.at(1) - times.at(0) == 30.5);
+  CHECK(qAbs(times.at(5) - times.at(4) - 0.2) < 0.001);
+
+  // a break after 61s, the rows without a time are on their own
+  CHECK(log.sessions() == QList<int>() << 0 << 3 << 4 << 6 << 7);
+}
+
+static QByteArray binaryLogHeader(const char * label)
+{
+  BinaryLogsHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BINARY_LOGS_MAGIC, sizeof(header.magic));
+  header.version = BINARY_LOGS_VERSION;
+  header.flags = BINARY_LOGS_RTC;
+  header.headerSectors = 1;
+  header.columnsCount = 1;
+  header.startTime = QDateTime(QDate(2017, 5, 1), QTime(10, 0, 0), Qt::UTC).toTime_t();
+
+  BinaryLogsColumn column;
+  memset(&column, 0, sizeof(column));
+  strncpy(column.label, label, BINARY_LOGS_LABEL_LEN);
+  column.type = BINARY_LOGS_COLUMN_VALUE;
+  column.prec = 1;
+
+  QByteArray result((const char *)&header, sizeof(header));
+  result.append((const char *)&column, sizeof(column));
+  result.append(QByteArray(BINARY_LOGS_SECTOR_SIZE - result.size(), 0));
+  return result;
+}
+
+static QByteArray binaryLogRecord(char type, int32_t time, int32_t value)
+{
+  QByteArray result(1, type);
+  if (type == BINARY_LOGS_KEYFRAME) {
+    result.append((const char *)&time, 4);
+    result.append((const char *)&value, 4);
+  }
+  else {
+    int16_t deltas[2] = { (int16_t)time, (int16_t)value };
+    result.append((const char *)deltas, 4);
+  }
+  return result;
+}
+
+static void testBinaryLog()
+{
+  // a delta before the first keyframe, and a session with other columns
+  QByteArray content = binaryLogHeader("RSSI");
+  content += binaryLogRecord(BINARY_LOGS_DELTA, 10, 1);
+  content += binaryLogRecord(BINARY_LOGS_KEYFRAME, 0, 805);
+  content += binaryLogRecord(BINARY_LOGS_DELTA, 10, -5);
+  content += binaryLogRecord(BINARY_LOGS_DELTA, 10, -5);
+  content += binaryLogHeader("A1");
+  content += binaryLogRecord(BINARY_LOGS_KEYFRAME, 9000, 42);
+  content += binaryLogHeader("RSSI");
+  content += binaryLogRecord(BINARY_LOGS_KEYFRAME, 9000, 700);
+
+  QTemporaryFile file;
+  if (!writeFile(file, content))
+    return;
+
+  CsvLog log;
+  CHECK(log.open(file.fileName()));
+  CHECK(log.header() == QStringList() << "Date" << "Time" << "RSSI");
+  CHECK(log.rowCount() == 4);
+  CHECK(log.linesCount() == 4);
+  CHECK(log.errorsCount() == 2);
+  CHECK(log.field(0, 1) == "10:00:00.000");
+  CHECK(log.field(0, 2) == "80.5");
+  CHECK(log.field(2, 2) == "79.5");
+  CHECK(log.field(3, 1) == "10:01:30.000");
+  CHECK(log.column(2).at(3) == 70);
+  CHECK(log.sessions() == QList<int>() << 0 << 3);
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  testRowsIndex();
+  testInvalidRows();
+  testColumns();
+  testSessions();
+  testBinaryLog();
+
+  printf("%d errors\n", errors);
+  return errors;
+}
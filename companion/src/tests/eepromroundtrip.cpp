@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// Exports the radio settings and the models for every board and every OpenTX
+// eeprom version, imports them back and exports them again.
+//
+//   eepromroundtrip --save <directory>      writes the exports to the directory
+//   eepromroundtrip --compare <directory>   compares the exports with the ones
+//                                           found in the directory
+//
+// eepromroundtrip-legacy is built from this file on the previous QBitArray
+// encoder (tests/legacy), the exports it saves are the reference of the
+// current encoder. Both print the time spent in the exports and the imports,
+// and return the number of failed combinations.
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <stdio.h>
+#include <string.h>
+#include "appdata.h"
+#include "eeprominterface.h"
+#include "firmwares/opentx/opentxeeprom.h"
+#include "firmwares/opentx/opentxinterface.h"
+
+#define FILLED_DATA_COUNT 3
+
+static const unsigned int versions[] = { 201, 202, 203, 204, 205, 207, 208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218 };
+
+static qint64 exportTime = 0;
+static qint64 importTime = 0;
+
+// The same sequence on every platform, the legacy and current executables
+// must fill the same data
+static uint32_t seed;
+
+static int nextRandom(int min, int max)
+{
+  seed = seed * 1103515245 + 12345;
+  return min + (int)((seed >> 16) % (max - min + 1));
+}
+
+static void fillName(char * name, int length)
+{
+  for (int i=0; i<length; i++) {
+    name[i] = (i == 0 ? 'A' + nextRandom(0, 25) : " ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"[nextRandom(0, 36)]);
+  }
+  name[length] = '\0';
+}
+
+// Sticks as sources, no switches: the values are in the ranges of every board
+// and version, a random import would overflow the curves and other tables
+static void fillData(ModelData & model)
+{
+  model.used = true;
+  fillName(model.name, 10);
+
+  for (int i=0; i<CPN_MAX_TIMERS; i++) {
+    TimerData & timer = model.timers[i];
+    timer.val = nextRandom(0, 3600);
+    timer.minuteBeep = nextRandom(0, 1);
+    timer.countdownBeep = nextRandom(0, 2);
+    timer.persistent = nextRandom(0, 2);
+  }
+
+  for (int i=0; i<16; i++) {
+    MixData & mix = model.mixData[i];
+    mix.destCh = 1 + i / 2;
+    mix.srcRaw = RawSource(SOURCE_TYPE_STICK, nextRandom(0, 3));
+    mix.weight = nextRandom(-100, 100);
+    mix.sOffset = nextRandom(-100, 100);
+    mix.delayUp = nextRandom(0, 15);
+    mix.delayDown = nextRandom(0, 15);
+    mix.speedUp = nextRandom(0, 15);
+    mix.speedDown = nextRandom(0, 15);
+    mix.mltpx = MltpxValue(nextRandom(0, 2));
+    mix.carryTrim = nextRandom(0, 1);
+    fillName(mix.name, 6);
+  }
+
+  for (int i=0; i<8; i++) {
+    ExpoData & expo = model.expoData[i];
+    expo.chn = i / 2;
+    expo.mode = 3;
+    expo.srcRaw = RawSource(SOURCE_TYPE_STICK, expo.chn);
+    expo.weight = nextRandom(0, 100);
+    fillName(expo.name, 6);
+  }
+
+  for (int i=0; i<16; i++) {
+    LimitData & limit = model.limitData[i];
+    limit.min = -1000 + 10 * nextRandom(0, 50);
+    limit.max = 1000 - 10 * nextRandom(0, 50);
+    limit.offset = 10 * nextRandom(-50, 50);
+    limit.ppmCenter = nextRandom(-100, 100);
+    limit.revert = nextRandom(0, 1);
+    limit.symetrical = nextRandom(0, 1);
+    fillName(limit.name, 6);
+  }
+
+  for (int i=0; i<8; i++) {
+    LogicalSwitchData & ls = model.logicalSw[i];
+    ls.func = LS_FN_VPOS;
+    ls.val1 = RawSource(SOURCE_TYPE_STICK, nextRandom(0, 3)).toValue();
+    ls.val2 = nextRandom(-100, 100);
+  }
+
+  for (int i=0; i<4; i++) {
+    for (int j=0; j<CPN_MAX_STICKS; j++) {
+      model.flightModeData[i].trim[j] = nextRandom(-125, 125);
+    }
+    fillName(model.flightModeData[i].name, 6);
+  }
+
+  CurveData & curve = model.curves[0];
+  curve.count = 5;
+  for (int i=0; i<curve.count; i++) {
+    curve.points[i].y = nextRandom(-100, 100);
+  }
+}
+
+static void fillData(GeneralSettings & settings)
+{
+  for (int i=0; i<CPN_MAX_STICKS; i++) {
+    settings.calibMid[i] = nextRandom(-200, 200);
+    settings.calibSpanNeg[i] = nextRandom(0, 1000);
+    settings.calibSpanPos[i] = nextRandom(0, 1000);
+  }
+  settings.vBatWarn = nextRandom(60, 100);
+  settings.txVoltageCalibration = nextRandom(-100, 100);
+  settings.backlightDelay = nextRandom(0, 30);
+  settings.inactivityTimer = nextRandom(0, 60);
+  settings.stickMode = nextRandom(0, 3);
+  settings.beepVolume = nextRandom(-2, 2);
+  settings.wavVolume = nextRandom(-2, 2);
+  settings.varioVolume = nextRandom(-2, 2);
+  settings.backgroundVolume = nextRandom(-2, 2);
+  settings.minuteBeep = nextRandom(0, 1);
+  settings.preBeep = nextRandom(0, 1);
+  fillName(settings.ownerName, 8);
+}
+
+template <class T, class M>
+static QByteArray exportData(T & data, Board::Type board, unsigned int version, unsigned int variant)
+{
+  QElapsedTimer timer;
+  timer.start();
+  M manager(data, board, version, variant);
+  QByteArray result;
+  manager.Export(result);
+  exportTime += timer.nsecsElapsed();
+  return result;
+}
+
+template <class T, class M>
+static bool importData(T & data, const QByteArray & bytes, Board::Type board, unsigned int version, unsigned int variant)
+{
+  QElapsedTimer timer;
+  timer.start();
+  M manager(data, board, version, variant);
+  bool result = (manager.Import(bytes) == 0);
+  importTime += timer.nsecsElapsed();
+  return result;
+}
+
+// The data is exported, imported and exported again, twice: the exports of
+// the imported data cover the import too. The three exports are returned.
+template <class T, class M>
+static bool exportRoundTrip(const QString & name, bool filled, Board::Type board, unsigned int version, unsigned int variant, QByteArray & result)
+{
+  T data;
+  if (filled) {
+    fillData(data);
+  }
+
+  QByteArray exported = exportData<T, M>(data, board, version, variant);
+  result = exported;
+  for (int i=0; i<2; i++) {
+    T copy;
+    if (!importData<T, M>(copy, exported, board, version, variant)) {
+      printf("%s: import failed\n", qPrintable(name));
+      return false;
+    }
+    exported = exportData<T, M>(copy, board, version, variant);
+    result += exported;
+  }
+  return true;
+}
+
+static bool saveExport(const QString & path, const QByteArray & data)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+    printf("%s: write failed\n", qPrintable(path));
+    return false;
+  }
+  return true;
+}
+
+static bool compareExport(const QString & path, const QString & name, const QByteArray & data)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    printf("%s: no reference export\n", qPrintable(name));
+    return false;
+  }
+  QByteArray reference = file.readAll();
+  if (reference != data) {
+    int offset = 0;
+    while (offset < reference.size() && offset < data.size() && reference[offset] == data[offset]) {
+      offset++;
+    }
+    printf("%s: %d bytes exported, %d bytes in the reference, first difference at byte %d\n", qPrintable(name), data.size(), reference.size(), offset);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("EEPROM round trip");
+  app.setOrganizationName("OpenTX");
+  app.setOrganizationDomain("open-tx.org");
+
+  QString saveDirectory, compareDirectory;
+  if (argc == 3 && !strcmp(argv[1], "--save")) {
+    saveDirectory = argv[2];
+  }
+  else if (argc == 3 && !strcmp(argv[1], "--compare")) {
+    compareDirectory = argv[2];
+  }
+  else if (argc != 1) {
+    printf("Usage: %s [--save <directory> | --compare <directory>]\n", argv[0]);
+    return -1;
+  }
+
+  g.init();
+  registerOpenTxFirmwares();
+  seed = 0;
+
+  int errors = 0;
+  int count = 0;
+  foreach(Firmware * firmware, firmwares) {
+    current_firmware_variant = firmware;
+    Board::Type board = firmware->getBoard();
+    unsigned int variant = firmware->getVariantNumber();
+    for (unsigned int i=0; i<sizeof(versions)/sizeof(versions[0]); i++) {
+      unsigned int version = versions[i];
+      for (int pass=0; pass<=FILLED_DATA_COUNT; pass++) {
+        // the default data, then filled data
+        for (int settings=0; settings<2; settings++) {
+          QString name = QString("%1-v%2-%3-%4").arg(firmware->getId()).arg(version).arg(settings ? "settings" : "model").arg(pass);
+          QByteArray result;
+          bool ok;
+          if (settings)
+            ok = exportRoundTrip<GeneralSettings, OpenTxGeneralData>(name, pass > 0, board, version, variant, result);
+          else
+            ok = exportRoundTrip<ModelData, OpenTxModelData>(name, pass > 0, board, version, variant, result);
+          if (ok && !saveDirectory.isEmpty())
+            ok = saveExport(saveDirectory + "/" + name + ".bin", result);
+          if (ok && !compareDirectory.isEmpty())
+            ok = compareExport(compareDirectory + "/" + name + ".bin", name, result);
+          if (!ok)
+            errors++;
+          count++;
+        }
+      }
+    }
+  }
+
+  printf("%d round trips, %d errors\n", count, errors);
+  printf("  exports: %6dms\n", int(exportTime / 1000000));
+  printf("  imports: %6dms\n", int(importTime / 1000000));
+  unregisterOpenTxFirmwares();
+  return errors;
+}
@@ -20,6 +20,7 @@
 
 #include "opentx.h"
 #include <math.h>
+#include <ctype.h>
 
 extern OS_MutexID audioMutex;
 
@@ -239,37 +240,119 @@ void getSystemAudioFile(char * filename, int index)
   strcat(str, SOUNDS_EXT);
 }
 
+#define AUDIO_INDEX_MAX_FILES  256
+
+// case insensitive FNV-1a hash of a file name
+static uint32_t getAudioFileHash(const char * filename)
+{
+  uint32_t hash = 2166136261u;
+  while (*filename) {
+    hash = (hash ^ (uint8_t)toupper(*filename++)) * 16777619u;
+  }
+  return hash;
+}
+
+// The sorted hashes of the wav files of a sounds directory (a collision
+// would only make a missing file be referenced, its playback would fail)
+struct AudioIndex
+{
+  uint16_t count;
+  bool complete;       // false when the directory has more files than the index can hold
+  uint32_t hashes[AUDIO_INDEX_MAX_FILES];
+
+  void insert(uint32_t hash)
+  {
+    int i = count++;
+    while (i > 0 && hashes[i-1] > hash) {
+      hashes[i] = hashes[i-1];
+      i--;
+    }
+    hashes[i] = hash;
+  }
+
+  bool contains(const char * filename) const
+  {
+    uint32_t hash = getAudioFileHash(filename);
+    int first = 0, last = count;
+    while (first < last) {
+      int middle = (first + last) / 2;
+      if (hashes[middle] < hash)
+        first = middle + 1;
+      else
+        last = middle;
+    }
+    return first < count && hashes[first] == hash;
+  }
+
+  // path is the full path of the file, filename its name in the directory
+  bool contains(const char * path, const char * filename) const
+  {
+    if (complete)
+      return contains(filename);
+    else
+      return isFileAvailable(path, true);
+  }
+};
+
+// Only used from the menus task, too big for its stack
+static AudioIndex audioIndex;
+
+// The directory is read once, then each prompt name is generated once and
+// looked up in the index, instead of being compared with every file name.
+// A directory with more than AUDIO_INDEX_MAX_FILES wav files is not indexed,
+// the files are then looked up one by one.
+static void loadAudioIndex(const char * path, AudioIndex & index)
+{
+  FILINFO fno;
+  DIR dir;
+
+  index.count = 0;
+  index.complete = true;
+
+  FRESULT res = f_opendir(&dir, path);        /* Open the directory */
+  if (res != FR_OK) {
+    return;
+  }
+  for (;;) {
+    res = f_readdir(&dir, &fno);                   /* Read a directory item */
+    if (res != FR_OK || fno.fname[0] == 0) break;  /* Break on error or end of dir */
+    uint8_t len = strlen(fno.fname);
+
+    // Eliminates directories / non wav files
+    if (len < 5 || strcasecmp(fno.fname+len-4, SOUNDS_EXT) || (fno.fattrib & AM_DIR)) continue;
+
+    if (index.count == AUDIO_INDEX_MAX_FILES) {
+      TRACE("loadAudioIndex(): too many files in %s", path);
+      index.count = 0;
+      index.complete = false;
+      break;
+    }
+    index.insert(getAudioFileHash(fno.fname));
+  }
+  f_closedir(&dir);
+}
+
 void referenceSystemAudioFiles()
 {
   static_assert(sizeof(audioFilenames)==AU_SPECIAL_SOUND_FIRST*sizeof(char *), "Invalid audioFilenames size");
   char path[AUDIO_FILENAME_MAXLEN+1];
-  FILINFO fno;
-  DIR dir;
+  AudioIndex & index = audioIndex;
 
   sdAvailableSystemAudioFiles.reset();
 
   char * filename = strAppendSystemAudioPath(path);
   *(filename-1) = '\0';
 
-  FRESULT res = f_opendir(&dir, path);        /* Open the directory */
-  if (res == FR_OK) {
-    for (;;) {
-      res = f_readdir(&dir, &fno);                   /* Read a directory item */
-      if (res != FR_OK || fno.fname[0] == 0) break;  /* Break on error or end of dir */
-      uint8_t len = strlen(fno.fname);
-
-      // Eliminates directories / non wav files
-      if (len < 5 || strcasecmp(fno.fname+len-4, SOUNDS_EXT) || (fno.fattrib & AM_DIR)) continue;
-
-      for (int i=0; i<AU_SPECIAL_SOUND_FIRST; i++) {
-        getSystemAudioFile(path, i);
-        if (!strcasecmp(filename, fno.fname)) {
-          sdAvailableSystemAudioFiles.setBit(i);
-          break;
-        }
-      }
+  loadAudioIndex(path, index);
+  if (index.complete && index.count == 0) {
+    return;
+  }
+
+  for (int i=0; i<AU_SPECIAL_SOUND_FIRST; i++) {
+    getSystemAudioFile(path, i);
+    if (index.contains(path, filename)) {
+      sdAvailableSystemAudioFiles.setBit(i);
     }
-    f_closedir(&dir);
   }
 }
 
@@ -348,8 +431,7 @@ void getLogicalSwitchAudioFile(char * filename, int index, unsigned int event)
 void referenceModelAudioFiles()
 {
   char path[AUDIO_FILENAME_MAXLEN+1];
-  FILINFO fno;
-  DIR dir;
+  AudioIndex & index = audioIndex;
 
   sdAvailablePhaseAudioFiles.reset();
   sdAvailableSwitchAudioFiles.reset();
@@ -358,58 +440,40 @@ void referenceModelAudioFiles()
   char * filename = getModelAudioPath(path);
   *(filename-1) = '\0';
 
-  FRESULT res = f_opendir(&dir, path);        /* Open the directory */
-  if (res == FR_OK) {
-    for (;;) {
-      res = f_readdir(&dir, &fno);                   /* Read a directory item */
-      if (res != FR_OK || fno.fname[0] == 0) break;  /* Break on error or end of dir */
-      uint8_t len = strlen(fno.fname);
-      bool found = false;
-
-      // Eliminates directories / non wav files
-      if (len < 5 || strcasecmp(fno.fname+len-4, SOUNDS_EXT) || (fno.fattrib & AM_DIR)) continue;
-      TRACE("referenceModelAudioFiles(): using file: %s", fno.fname);
-
-      // Phases Audio Files <phasename>-[on|off].wav
-      for (int i=0; i<MAX_FLIGHT_MODES && !found; i++) {
-        for (int event=0; event<2; event++) {
-          getPhaseAudioFile(path, i, event);
-          // TRACE("referenceModelAudioFiles(): searching for %s in %s", filename, fno.fname);
-          if (!strcasecmp(filename, fno.fname)) {
-            sdAvailablePhaseAudioFiles.setBit(INDEX_PHASE_AUDIO_FILE(i, event));
-            found = true;
-            TRACE("\tfound: %s", filename);
-            break;
-          }
-        }
-      }
+  loadAudioIndex(path, index);
+  if (index.complete && index.count == 0) {
+    return;
+  }
 
-      // Switches Audio Files <switchname>-[up|mid|down].wav
-      for (int i=SWSRC_FIRST_SWITCH; i<=SWSRC_LAST_SWITCH+NUM_XPOTS*XPOTS_MULTIPOS_COUNT && !found; i++) {
-        getSwitchAudioFile(path, i);
-        // TRACE("referenceModelAudioFiles(): searching for %s in %s (%d)", path, fno.fname, i);
-        if (!strcasecmp(filename, fno.fname)) {
-          sdAvailableSwitchAudioFiles.setBit(i-SWSRC_FIRST_SWITCH);
-          found = true;
-          TRACE("\tfound: %s", filename);
-        }
+  // Phases Audio Files <phasename>-[on|off].wav
+  for (int i=0; i<MAX_FLIGHT_MODES; i++) {
+    for (int event=0; event<2; event++) {
+      getPhaseAudioFile(path, i, event);
+      if (index.contains(path, filename)) {
+        sdAvailablePhaseAudioFiles.setBit(INDEX_PHASE_AUDIO_FILE(i, event));
+        TRACE("\tfound: %s", filename);
       }
+    }
+  }
 
-      // Logical Switches Audio Files <switchname>-[on|off].wav
-      for (int i=0; i<MAX_LOGICAL_SWITCHES && !found; i++) {
-        for (int event=0; event<2; event++) {
-          getLogicalSwitchAudioFile(path, i, event);
-          // TRACE("referenceModelAudioFiles(): searching for %s in %s", filename, fno.fname);
-          if (!strcasecmp(filename, fno.fname)) {
-            sdAvailableLogicalSwitchAudioFiles.setBit(INDEX_LOGICAL_SWITCH_AUDIO_FILE(i, event));
-            found = true;
-            TRACE("\tfound: %s", filename);
-            break;
-          }
-        }
+  // Switches Audio Files <switchname>-[up|mid|down].wav
+  for (int i=SWSRC_FIRST_SWITCH; i<=SWSRC_LAST_SWITCH+NUM_XPOTS*XPOTS_MULTIPOS_COUNT; i++) {
+    getSwitchAudioFile(path, i);
+    if (index.contains(path, filename)) {
+      sdAvailableSwitchAudioFiles.setBit(i-SWSRC_FIRST_SWITCH);
+      TRACE("\tfound: %s", filename);
+    }
+  }
+
+  // Logical Switches Audio Files <switchname>-[on|off].wav
+  for (int i=0; i<MAX_LOGICAL_SWITCHES; i++) {
+    for (int event=0; event<2; event++) {
+      getLogicalSwitchAudioFile(path, i, event);
+      if (index.contains(path, filename)) {
+        sdAvailableLogicalSwitchAudioFiles.setBit(INDEX_LOGICAL_SWITCH_AUDIO_FILE(i, event));
+        TRACE("\tfound: %s", filename);
       }
     }
-    f_closedir(&dir);
   }
 }
 
@@ -518,9 +582,24 @@ void audioTask(void * pdata)
 }
 #endif
 
-inline void mixSample(audio_data_t * result, int sample, unsigned int fade)
+inline void mixSample(audio_mix_t * result, int sample, unsigned int fade)
 {
-  *result = limit(AUDIO_DATA_MIN, *result + ((sample >> fade) >> (16-AUDIO_BITS_PER_SAMPLE)), AUDIO_DATA_MAX);
+  *result = limit<int>(AUDIO_MIX_MIN, *result + ((sample >> fade) >> (16-AUDIO_BITS_PER_SAMPLE)), AUDIO_MIX_MAX);
+}
+
+// the silence offset and the software volume are applied in the same pass
+void writeAudioSamples(audio_data_t * data, const audio_mix_t * mix, unsigned int count)
+{
+#if defined(SOFTWARE_VOLUME)
+  int32_t volume = currentSpeakerVolume;
+  for (unsigned int i=0; i<count; i++) {
+    data[i] = (int16_t) (((mix[i] * volume) / VOLUME_LEVEL_MAX) + AUDIO_DATA_SILENCE);
+  }
+#else
+  for (unsigned int i=0; i<count; i++) {
+    data[i] = mix[i] + AUDIO_DATA_SILENCE;
+  }
+#endif
 }
 
 #if defined(SDCARD)
@@ -528,7 +607,7 @@ inline void mixSample(audio_data_t * result, int sample, unsigned int fade)
 #define RIFF_CHUNK_SIZE 12
 uint8_t wavBuffer[AUDIO_BUFFER_SIZE*2] __DMA;
 
-int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
+int WavContext::mixBuffer(audio_mix_t * mix, int volume, unsigned int fade)
 {
   FRESULT result = FR_OK;
   UINT read = 0;
@@ -588,7 +667,7 @@ int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
         fragment.clear();
       }
 
-      audio_data_t * samples = buffer->data;
+      audio_mix_t * samples = mix;
       if (state.codec == CODEC_ID_PCM_S16LE) {
         read /= 2;
         for (uint32_t i=0; i<read; i++) {
@@ -612,7 +691,7 @@ int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
         }
       }
 
-      return samples - buffer->data;
+      return samples - mix;
     }
   }
 
@@ -622,23 +701,29 @@ int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
   return 0;
 }
 #else
-int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
+int WavContext::mixBuffer(audio_mix_t * mix, int volume, unsigned int fade)
 {
   return 0;
 }
 #endif
 
 const unsigned int toneVolumes[] = { 10, 8, 6, 4, 2 };
-inline float evalVolumeRatio(int freq, int volume)
+// the samples are multiplied by the gain, instead of being divided by the volume ratio
+inline int32_t evalToneGain(int freq, int volume)
 {
-  float result = toneVolumes[2+volume];
-  if (freq < 330) {
-    result = (result * freq * freq) / (330 * 330);
+  uint32_t divider = toneVolumes[2+volume];
+  uint32_t result = ((1 << TONE_GAIN_BITS) + divider/2) / divider;
+  if (freq == 0) {
+    result = 0;
+  }
+  else if (freq < 330) {
+    divider *= freq * freq;
+    result = (((uint64_t)(330 * 330) << TONE_GAIN_BITS) + divider/2) / divider;
   }
   return result;
 }
 
-int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
+int ToneContext::mixBuffer(audio_mix_t * mix, int volume, unsigned int fade)
 {
   int duration = 0;
   int result = 0;
@@ -646,7 +731,7 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
   int remainingDuration = fragment.tone.duration - state.duration;
   if (remainingDuration > 0) {
     int points;
-    double toneIdx = state.idx;
+    uint32_t toneIdx = state.idx;
 
     if (fragment.tone.reset) {
       fragment.tone.reset = 0;
@@ -656,8 +741,8 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
 
     if (fragment.tone.freq != state.freq) {
       state.freq = fragment.tone.freq;
-      state.step = limit<double>(1, double(DIM(sineValues)*fragment.tone.freq) / AUDIO_SAMPLE_RATE, 512);
-      state.volume = evalVolumeRatio(fragment.tone.freq, volume);
+      state.step = limit<uint32_t>(1 << TONE_PHASE_BITS, (((uint64_t)fragment.tone.freq << 32) + AUDIO_SAMPLE_RATE/2) / AUDIO_SAMPLE_RATE, 512 << TONE_PHASE_BITS);
+      state.gain = evalToneGain(fragment.tone.freq, volume);
     }
 
     if (fragment.tone.freqIncr) {
@@ -683,22 +768,24 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
       points = AUDIO_BUFFER_SIZE;
     }
     else {
+      // the tone ends at the end of a sine period
       duration = remainingDuration;
       points = (duration * AUDIO_BUFFER_SIZE) / AUDIO_BUFFER_DURATION;
-      unsigned int end = toneIdx + (state.step * points);
+      unsigned int end = (toneIdx + (uint64_t)state.step * points) >> TONE_PHASE_BITS;
       if (end > DIM(sineValues))
         end -= (end % DIM(sineValues));
       else
         end = DIM(sineValues);
-      points = (double(end) - toneIdx) / state.step;
+      points = min<int>(AUDIO_BUFFER_SIZE, (((uint64_t)end << TONE_PHASE_BITS) - toneIdx) / state.step);
     }
 
+    // the phase wraps at the end of the sine table
+    int32_t gain = state.gain;
+    uint32_t step = state.step;
     for (int i=0; i<points; i++) {
-      int16_t sample = sineValues[int(toneIdx)] / state.volume;
-      mixSample(&buffer->data[i], sample, fade);
-      toneIdx += state.step;
-      if ((unsigned int)toneIdx >= DIM(sineValues))
-        toneIdx -= DIM(sineValues);
+      int32_t sample = (sineValues[toneIdx >> TONE_PHASE_BITS] * gain) / (1 << TONE_GAIN_BITS);
+      mixSample(&mix[i], limit<int32_t>(INT16_MIN, sample, INT16_MAX), fade);
+      toneIdx += step;
     }
 
     if (remainingDuration > AUDIO_BUFFER_DURATION) {
@@ -723,6 +810,8 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
   return result;
 }
 
+audio_mix_t audioMixBuffer[AUDIO_BUFFER_SIZE];
+
 void AudioQueue::wakeup()
 {
   DEBUG_TIMER_START(debugTimerAudioConsume);
@@ -735,13 +824,11 @@ void AudioQueue::wakeup()
     unsigned int fade = 0;
     int size = 0;
 
-    // write silence in the buffer
-    for (uint32_t i=0; i<AUDIO_BUFFER_SIZE; i++) {
-      buffer->data[i] = AUDIO_DATA_SILENCE; /* silence */
-    }
+    // the contexts are mixed around 0
+    memset(audioMixBuffer, 0, sizeof(audioMixBuffer));
 
     // mix the priority context (only tones)
-    result = priorityContext.mixBuffer(buffer, g_eeGeneral.beepVolume, fade);
+    result = priorityContext.mixBuffer(audioMixBuffer, g_eeGeneral.beepVolume, fade);
     if (result > 0) {
       size = result;
       fade += 1;
@@ -753,14 +840,14 @@ void AudioQueue::wakeup()
       normalContext.setFragment(fragmentsFifo.get());
       CoLeaveMutexSection(audioMutex);
     }
-    result = normalContext.mixBuffer(buffer, g_eeGeneral.beepVolume, g_eeGeneral.wavVolume, fade);
+    result = normalContext.mixBuffer(audioMixBuffer, g_eeGeneral.beepVolume, g_eeGeneral.wavVolume, fade);
     if (result > 0) {
       size = max(size, result);
       fade += 1;
     }
 
     // mix the vario context
-    result = varioContext.mixBuffer(buffer, g_eeGeneral.varioVolume, fade);
+    result = varioContext.mixBuffer(audioMixBuffer, g_eeGeneral.varioVolume, fade);
     if (result > 0) {
       size = max(size, result);
       fade += 1;
@@ -768,7 +855,7 @@ void AudioQueue::wakeup()
 
     // mix the background context
     if (isFunctionActive(FUNCTION_BACKGND_MUSIC) && !isFunctionActive(FUNCTION_BACKGND_MUSIC_PAUSE)) {
-      result = backgroundContext.mixBuffer(buffer, g_eeGeneral.backgroundVolume, fade);
+      result = backgroundContext.mixBuffer(audioMixBuffer, g_eeGeneral.backgroundVolume, fade);
       if (result > 0) {
         size = max(size, result);
       }
@@ -778,12 +865,7 @@ void AudioQueue::wakeup()
     if (size > 0) {
       // TRACE("pushing buffer %p", buffer);
       buffer->size = size;
-#if defined(SOFTWARE_VOLUME)
-      for(uint32_t i=0; i<buffer->size; ++i) {
-        int32_t tmpSample = (int32_t) ((uint32_t) (buffer->data[i]) - AUDIO_DATA_SILENCE);  // conversion from uint16_t
-        buffer->data[i] = (int16_t) (((tmpSample * currentSpeakerVolume) / VOLUME_LEVEL_MAX) + AUDIO_DATA_SILENCE);
-      }
-#endif
+      writeAudioSamples(buffer->data, audioMixBuffer, size);
       buffersFifo.audioPushBuffer();
     }
     else {
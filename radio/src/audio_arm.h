@@ -115,6 +115,13 @@ enum AudioBufferState
   #define AUDIO_BITS_PER_SAMPLE        12
 #endif
 
+// The contexts are mixed in signed samples centered on 0, with the
+// resolution of the audio buffers. They are written to the audio buffer
+// with the silence offset and the software volume in a single pass
+typedef int16_t audio_mix_t;
+#define AUDIO_MIX_MIN                  (AUDIO_DATA_MIN - AUDIO_DATA_SILENCE)
+#define AUDIO_MIX_MAX                  (AUDIO_DATA_MAX - AUDIO_DATA_SILENCE)
+
 struct AudioBuffer {
   audio_data_t data[AUDIO_BUFFER_SIZE];
   uint16_t size;
@@ -177,12 +184,18 @@ struct AudioFragment {
   void clear() { memset(this, 0, sizeof(AudioFragment)); };
 };
 
+// The tones are generated with a phase accumulator: the upper bits of the
+// phase are the index in the sine table (1024 values)
+#define TONE_PHASE_BITS                22
+#define TONE_GAIN_BITS                 14
+extern const int16_t sineValues[];
+
 class ToneContext {
   public:
 
     inline void clear() { memset(this, 0, sizeof(ToneContext)); };
     bool isFree() const { return fragment.type == FRAGMENT_EMPTY; };
-    int mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade);
+    int mixBuffer(audio_mix_t * mix, int volume, unsigned int fade);
 
     void setFragment(uint16_t freq, uint16_t duration, uint16_t pause, uint8_t repeat, int8_t freqIncr, bool reset, uint8_t id=0)
     {
@@ -193,9 +206,9 @@ class ToneContext {
     AudioFragment fragment;
 
     struct {
-      double step;
-      double idx;
-      float  volume;
+      uint32_t step;        // unit 2^-TONE_PHASE_BITS sine index
+      uint32_t idx;         // unit 2^-TONE_PHASE_BITS sine index
+      int32_t  gain;        // unit 2^-TONE_GAIN_BITS
       uint16_t freq;
       uint16_t duration;
       uint16_t pause;
@@ -208,7 +221,7 @@ class WavContext {
 
     inline void clear() { fragment.clear(); };
 
-    int mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade);
+    int mixBuffer(audio_mix_t * mix, int volume, unsigned int fade);
     bool hasId(uint8_t id) const { return fragment.id == id; };
 
     void setFragment(const char * filename, uint8_t repeat, uint8_t id)
@@ -264,10 +277,10 @@ class MixedContext {
     bool isFile() const { return fragment.type == FRAGMENT_FILE; };
     bool hasId(uint8_t id) const { return fragment.id == id; };
 
-    int mixBuffer(AudioBuffer *buffer, int toneVolume, int wavVolume, unsigned int fade)
+    int mixBuffer(audio_mix_t * mix, int toneVolume, int wavVolume, unsigned int fade)
     {
-      if (isTone()) return tone.mixBuffer(buffer, toneVolume, fade);
-      else if (isFile()) return wav.mixBuffer(buffer, wavVolume, fade);
+      if (isTone()) return tone.mixBuffer(mix, toneVolume, fade);
+      else if (isFile()) return wav.mixBuffer(mix, wavVolume, fade);
       return 0;
     }
 
@@ -501,6 +514,8 @@ class AudioQueue {
 extern uint8_t currentSpeakerVolume;
 extern AudioQueue audioQueue;
 
+void writeAudioSamples(audio_data_t * data, const audio_mix_t * mix, unsigned int count);
+
 enum {
   ID_PLAY_FROM_SD_MANAGER = 254,
   ID_PLAY_BYE = 255
@@ -622,6 +637,8 @@ void playModelName();
 #endif
 
 char * getAudioPath(char * path);
+char * strAppendSystemAudioPath(char * path);
+void getSystemAudioFile(char * filename, int index);
 
 void referenceSystemAudioFiles();
 void referenceModelAudioFiles();
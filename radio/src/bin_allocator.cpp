@@ -26,21 +26,39 @@
 
 BinAllocator_slots1 slots1;
 BinAllocator_slots2 slots2;
+BinAllocator_slots3 slots3;
+BinAllocator_slots4 slots4;
+
+uint32_t binRequestedBytes;
+uint32_t binFallbacks;
 
 #if defined(DEBUG)
 int SimulateMallocFailure = 0;    //set this to simulate allocation failure
 #endif 
 
+bool is_bin_member(void * ptr)
+{
+  return slots1.is_member(ptr) || slots2.is_member(ptr) || slots3.is_member(ptr) || slots4.is_member(ptr);
+}
+
+size_t bin_size(void * ptr)
+{
+  return slots1.size(ptr) + slots2.size(ptr) + slots3.size(ptr) + slots4.size(ptr);
+}
+
 bool bin_free(void * ptr)
 {
   //return TRUE if ours
-  return slots1.free(ptr) || slots2.free(ptr);
+  return slots1.free(ptr) || slots2.free(ptr) || slots3.free(ptr) || slots4.free(ptr);
 }
 
 void * bin_malloc(size_t size) {
-  //try to allocate from our space
+  //try to allocate from our space, smallest slots first
   void * res = slots1.malloc(size);
-  return res ? res : slots2.malloc(size);
+  if (!res) res = slots2.malloc(size);
+  if (!res) res = slots3.malloc(size);
+  if (!res) res = slots4.malloc(size);
+  return res;
 }
 
 void * bin_realloc(void * ptr, size_t size)
@@ -50,7 +68,8 @@ void * bin_realloc(void * ptr, size_t size)
     return bin_malloc(size);
   }
   else {
-    if (! (slots1.is_member(ptr) || slots2.is_member(ptr)) ) {
+    size_t slotSize = bin_size(ptr);
+    if (slotSize == 0) {
       // not our data, leave it to libc realloc
       return 0;
     }
@@ -58,12 +77,8 @@ void * bin_realloc(void * ptr, size_t size)
     //we have existing data
     // if it fits in current slot, return it
     // TODO if new size is smaller, try to relocate in smaller slot
-    if ( slots1.can_fit(ptr, size) ) {
-      // TRACE("OUR realloc %p[%lu] fits in slot1", ptr, size);
-      return ptr;
-    }
-    if ( slots2.can_fit(ptr, size) ) {
-      // TRACE("OUR realloc %p[%lu] fits in slot2", ptr, size);
+    if (size <= slotSize) {
+      // TRACE("OUR realloc %p[%lu] fits in slot", ptr, size);
       return ptr;
     }
 
@@ -79,19 +94,30 @@ void * bin_realloc(void * ptr, size_t size)
       }
     }
     //copy data
-    memcpy(res, ptr, slots1.size(ptr) + slots2.size(ptr));
+    memcpy(res, ptr, slotSize);
     bin_free(ptr);
     return res;
   }
 }
 
+void binAllocatorGetStats(BinAllocatorStats & stats)
+{
+  stats.totalBytes = slots1.capacity() * slots1.slotSize() + slots2.capacity() * slots2.slotSize() + slots3.capacity() * slots3.slotSize() + slots4.capacity() * slots4.slotSize();
+  stats.usedBytes = slots1.size() * slots1.slotSize() + slots2.size() * slots2.slotSize() + slots3.size() * slots3.slotSize() + slots4.size() * slots4.slotSize();
+  stats.highWaterBytes = slots1.highWaterMark() * slots1.slotSize() + slots2.highWaterMark() * slots2.slotSize() + slots3.highWaterMark() * slots3.slotSize() + slots4.highWaterMark() * slots4.slotSize();
+  stats.requestedBytes = binRequestedBytes;
+  stats.fallbacks = binFallbacks;
+}
 
 void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
 {
-  (void)ud; (void)osize;  /* not used */
+  (void)ud;  /* not used */
   if (nsize == 0) {
     if (ptr) {   // avoid a bunch of NULL pointer free calls
-      if (!bin_free(ptr)) {
+      if (bin_free(ptr)) {
+        binRequestedBytes -= osize;
+      }
+      else {
         // not our range, use libc allocator
         // TRACE("libc free %p", ptr);
         free(ptr);
@@ -114,11 +140,21 @@ void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
     }
 #endif // #if defined(DEBUG)
     // try our allocator, if it fails use libc allocator
+    // when ptr is NULL, osize is the Lua type of the new object
+    size_t oldSize = (ptr && is_bin_member(ptr)) ? osize : 0;
     void * res = bin_realloc(ptr, nsize);
     if (res && ptr) {
       // TRACE("OUR realloc %p[%lu] -> %p[%lu]", ptr, osize, res, nsize); 
     }
-    if (res == 0) {
+    if (res) {
+      binRequestedBytes -= oldSize;
+      if (is_bin_member(res))
+        binRequestedBytes += nsize;
+      else
+        binFallbacks++;
+    }
+    else {
+      binFallbacks++;
       res = realloc(ptr, nsize);
       // TRACE("libc realloc %p[%lu] -> %p[%lu]", ptr, osize, res, nsize);
       // if (res == 0 ){
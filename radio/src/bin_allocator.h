@@ -23,73 +23,112 @@
 
 #include "debug.h"
 
+// Fixed size slots allocator: the free slots are chained in an intrusive
+// list, so that malloc() and free() don't need to scan the slots.
 template <int SIZE_SLOT, int NUM_BINS> class BinAllocator {
 private:
-  PACK(struct Bin {
+  union Bin {
+    Bin * next;   // only valid while the slot is free
     char data[SIZE_SLOT];
-    bool Used;
-  });
-  struct Bin Bins[NUM_BINS];
-  int NoUsedBins;
+  };
+  Bin Bins[NUM_BINS];
+  Bin * FreeList;
+  uint16_t NoUsedBins;
+  uint16_t HighWaterMark;
 public:
-  BinAllocator() : NoUsedBins(0) {
-    memclear(Bins, sizeof(Bins));
+  BinAllocator() {
+    reset();
+  }
+  void reset() {
+    for (int n = 0; n < NUM_BINS-1; ++n) {
+      Bins[n].next = &Bins[n+1];
+    }
+    Bins[NUM_BINS-1].next = 0;
+    FreeList = &Bins[0];
+    NoUsedBins = 0;
+    HighWaterMark = 0;
   }
   bool free(void * ptr) {
-    for (size_t n = 0; n < NUM_BINS; ++n) {
-      if (ptr == Bins[n].data) {
-        Bins[n].Used = false;
-        --NoUsedBins;
-        // TRACE("\tBinAllocator<%d> free %lu ------", SIZE_SLOT, n);
-        return true;
-      }
+    if (!is_member(ptr)) {
+      return false;
     }
-    return false;
+    Bin * bin = &Bins[((char *)ptr - (char *)Bins) / sizeof(Bin)];
+    bin->next = FreeList;
+    FreeList = bin;
+    --NoUsedBins;
+    // TRACE("\tBinAllocator<%d> free %lu ------", SIZE_SLOT, bin - Bins);
+    return true;
   }
-  bool is_member(void * ptr) {
-    return (ptr >= Bins[0].data && ptr <= Bins[NUM_BINS-1].data);
+  bool is_member(void * ptr) const {
+    return (ptr >= (void *)Bins && ptr < (void *)&Bins[NUM_BINS]);
   }
   void * malloc(size_t size) {
     if (size > SIZE_SLOT) {
       // TRACE("BinAllocator<%d> malloc [%lu] size > SIZE_SLOT", SIZE_SLOT, size);
       return 0;
     }
-    if (NoUsedBins >= NUM_BINS) {
+    Bin * bin = FreeList;
+    if (!bin) {
       // TRACE("BinAllocator<%d> malloc [%lu] no free slots", SIZE_SLOT, size);
       return 0;
     }
-    for (size_t n = 0; n < NUM_BINS; ++n) {
-      if (!Bins[n].Used) {
-        Bins[n].Used = true;
-        ++NoUsedBins;
-        // TRACE("\tBinAllocator<%d> malloc %lu[%lu]", SIZE_SLOT, n, size);
-        return Bins[n].data;
-      }
+    FreeList = bin->next;
+    if (++NoUsedBins > HighWaterMark) {
+      HighWaterMark = NoUsedBins;
     }
-    // TRACE("BinAllocator<%d> malloc [%lu] no free slots", SIZE_SLOT , size);
-    return 0;
+    // TRACE("\tBinAllocator<%d> malloc %lu[%lu]", SIZE_SLOT, bin - Bins, size);
+    return bin->data;
   }
-  size_t size(void * ptr) {
+  size_t size(void * ptr) const {
     return is_member(ptr) ? SIZE_SLOT : 0;
   }
-  bool can_fit(void * ptr, size_t size) {
+  bool can_fit(void * ptr, size_t size) const {
     return is_member(ptr) && size <= SIZE_SLOT;  //todo is_member check is redundant
   }
-  unsigned int capacity() { return NUM_BINS; }
-  unsigned int size() { return NoUsedBins; }
+  unsigned int capacity() const { return NUM_BINS; }
+  unsigned int size() const { return NoUsedBins; }
+  unsigned int highWaterMark() const { return HighWaterMark; }
+  static size_t slotSize() { return SIZE_SLOT; }
 };
 
+// Lua objects sizes are spread between 16 and ~100 bytes (TString and
+// Udata headers, closures, tables, upvalues, ...)
 #if defined(SIMU)
-typedef BinAllocator<39,300> BinAllocator_slots1;
-typedef BinAllocator<79,100> BinAllocator_slots2;
+typedef BinAllocator<24,256> BinAllocator_slots1;
+typedef BinAllocator<48,256> BinAllocator_slots2;
+typedef BinAllocator<80,96> BinAllocator_slots3;
+typedef BinAllocator<128,48> BinAllocator_slots4;
 #else
-typedef BinAllocator<29,200> BinAllocator_slots1;
-typedef BinAllocator<91,50> BinAllocator_slots2;
+typedef BinAllocator<16,128> BinAllocator_slots1;
+typedef BinAllocator<32,128> BinAllocator_slots2;
+typedef BinAllocator<48,48> BinAllocator_slots3;
+typedef BinAllocator<96,24> BinAllocator_slots4;
 #endif
 
+struct BinAllocatorStats
+{
+  uint32_t totalBytes;      // all slots
+  uint32_t usedBytes;       // slots in use
+  uint32_t highWaterBytes;  // sum of the slots high water marks
+  uint32_t requestedBytes;  // bytes requested by Lua in the slots in use
+  uint32_t fallbacks;       // allocations which went to the libc allocator
+
+  // % of the used slots space which is lost because the slots are bigger than requested
+  unsigned int fragmentation() const {
+    return usedBytes ? 100 - (100 * requestedBytes) / usedBytes : 0;
+  }
+};
+
 #if defined(USE_BIN_ALLOCATOR)
 extern BinAllocator_slots1 slots1;
 extern BinAllocator_slots2 slots2;
+extern BinAllocator_slots3 slots3;
+extern BinAllocator_slots4 slots4;
+
+bool is_bin_member(void * ptr);
+size_t bin_size(void * ptr);
+void * bin_realloc(void * ptr, size_t size);
+void binAllocatorGetStats(BinAllocatorStats & stats);
 
 // wrapper for our BinAllocator for Lua
 void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize);
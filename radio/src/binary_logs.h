@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _BINARY_LOGS_H_
+#define _BINARY_LOGS_H_
+
+// Binary logs file format, shared with Companion
+//
+// The file starts with a BinaryLogsHeader followed by one BinaryLogsColumn per
+// CSV column, zero padded to headerSectors * 512 bytes. Then come the records:
+//  - 'K' (keyframe): int32_t values[valuesCount]
+//  - 'D' (delta):    int16_t deltas[valuesCount], relative to the previous record
+// The first value is the time (unit 10ms) since startTime, then the values
+// of each column. All numbers are little-endian.
+
+#define BINARY_LOGS_MAGIC              "OTLG"
+#define BINARY_LOGS_VERSION            1
+#define BINARY_LOGS_SECTOR_SIZE        512
+#define BINARY_LOGS_KEYFRAME_PERIOD    32   // records
+#define BINARY_LOGS_LABEL_LEN          12
+
+#define BINARY_LOGS_KEYFRAME           'K'
+#define BINARY_LOGS_DELTA              'D'
+
+// header flags
+#define BINARY_LOGS_RTC                0x01   // startTime is a date (seconds since 1970)
+
+enum BinaryLogsColumnType {
+  BINARY_LOGS_COLUMN_VALUE,     // 1 value with <prec> decimals
+  BINARY_LOGS_COLUMN_GPS,       // 2 values: latitude, longitude (unit 1e-6 degree)
+  BINARY_LOGS_COLUMN_DATETIME,  // 1 value, see BINARY_LOGS_DATETIME()
+  BINARY_LOGS_COLUMN_HEX64,     // 2 values: high and low words (logical switches)
+};
+
+#define BINARY_LOGS_DATETIME(year, month, day, hour, min, sec) \
+  (((uint32_t)((year) - 2000) << 26) | ((uint32_t)(month) << 22) | ((uint32_t)(day) << 17) | ((uint32_t)(hour) << 12) | ((uint32_t)(min) << 6) | (uint32_t)(sec))
+
+PACK(struct BinaryLogsHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t flags;
+  uint8_t headerSectors;
+  uint8_t columnsCount;
+  uint32_t startTime;       // seconds since 1970 with BINARY_LOGS_RTC, tmr10ms otherwise
+  uint8_t startTime10ms;
+});
+
+PACK(struct BinaryLogsColumn {
+  char label[BINARY_LOGS_LABEL_LEN];   // CSV header label, zero padded
+  uint8_t type;
+  uint8_t prec;
+});
+
+inline uint8_t getBinaryLogsColumnWidth(uint8_t type)
+{
+  return (type == BINARY_LOGS_COLUMN_GPS || type == BINARY_LOGS_COLUMN_HEX64) ? 2 : 1;
+}
+
+#endif // _BINARY_LOGS_H_
@@ -20,6 +20,7 @@
 
 #include "opentx.h"
 #include "diskio.h"
+#include "bin_allocator.h"
 #include <ctype.h>
 #include <malloc.h>
 #include <new>
@@ -379,6 +380,9 @@ int cliStackInfo(const char ** argv)
   serialPrint("[MENUS] %d available / %d", menusStack.available(), menusStack.size());
   serialPrint("[MIXER] %d available / %d", mixerStack.available(), mixerStack.size());
   serialPrint("[AUDIO] %d available / %d", audioStack.available(), audioStack.size());
+#if !defined(EEPROM)
+  serialPrint("[STORAGE] %d available / %d", storageStack.available(), storageStack.size());
+#endif
   serialPrint("[CLI] %d available / %d", cliStack.available(), cliStack.size());
   return 0;
 }
@@ -419,9 +423,19 @@ int cliMemoryInfo(const char ** argv)
 #if defined(LUA)
   serialPrint("\nLua:");
   serialPrint("\tScripts %d", luaGetMemUsed(lsScripts));
+  for (int i=0; i<luaScriptsCount; i++) {
+    ScriptInternalData & sid = scriptInternalData[i];
+    serialPrint("\t  #%d: last run %dus (max %dus) in %d slices, %d bytes allocated", i, (int)sid.lastRunTime, (int)sid.maxRunTime, sid.lastRunSlices, (int)sid.lastRunMemory);
+  }
 #if defined(PCBHORUS)
   serialPrint("\tWidgets %d", luaGetMemUsed(lsWidgets));
 #endif
+#if defined(USE_BIN_ALLOCATOR)
+  BinAllocatorStats stats;
+  binAllocatorGetStats(stats);
+  serialPrint("\tBins used %d/%d bytes, high water %d bytes", stats.usedBytes, stats.totalBytes, stats.highWaterBytes);
+  serialPrint("\tBins fragmentation %d%%, libc fallbacks %d", stats.fragmentation(), stats.fallbacks);
+#endif
 #endif
   return 0;
 }
@@ -807,6 +821,11 @@ int cliDisplay(const char ** argv)
     DiskCacheStats stats = diskCache.getStats();
     uint32_t hitRate = diskCache.getHitRate();
     serialPrint("Disk Cache stats: w:%u r: %u, h: %u(%0.1f%%), m: %u", stats.noWrites, (stats.noHits + stats.noMisses), stats.noHits, hitRate/10.0, stats.noMisses);
+    const char * const accessNames[DISK_CACHE_ACCESS_COUNT] = { "FS", "stream", "random" };
+    for (int i=0; i<DISK_CACHE_ACCESS_COUNT; i++) {
+      serialPrint("  %s: h: %u(%0.1f%%), m: %u", accessNames[i], stats.access[i].noHits, diskCache.getHitRate(i)/10.0, stats.access[i].noMisses);
+    }
+    serialPrint("  read ahead: %u, used: %u", stats.noReadAheads, stats.noReadAheadHits);
   }
 #endif
   else if (toLongLongInt(argv, 1, &address) > 0) {
@@ -855,6 +874,41 @@ int cliRepeat(const char ** argv)
   return 0;
 }
 
+void printMixerHistogram(const char * name, const MixerHistogram & histogram)
+{
+  serialPrintf("%-10s %5u %5u %5u ", name, histogram.last, histogram.average(), histogram.max);
+  for (int n=0; n<MIXER_HISTOGRAM_BUCKETS; n++) {
+    serialPrintf(" %5u", histogram.buckets[n]);
+  }
+  serialCrlf();
+}
+
+int cliProfiler(const char ** argv)
+{
+  if (!strcmp(argv[1], "reset")) {
+    mixerProfiler.reset();
+    return 0;
+  }
+  else if (argv[1][0] != '\0') {
+    serialPrint("%s: Invalid arguments", argv[0]);
+    return 0;
+  }
+
+  serialPrint("Mixer profile after %u runs [us]", mixerProfiler.stages[MIXER_STAGE_TOTAL].count);
+  serialPrintf("%-10s %5s %5s %5s ", "", "last", "avg", "max");
+  for (int n=0; n<MIXER_HISTOGRAM_BUCKETS-1; n++) {
+    serialPrintf(" <%-4u", MixerHistogram::bucketLimit(n));
+  }
+  serialPrintf(" >=%-3u", MixerHistogram::bucketLimit(MIXER_HISTOGRAM_BUCKETS-2));
+  serialCrlf();
+  for (int n=0; n<MIXER_STAGES_COUNT; n++) {
+    printMixerHistogram(mixerStageNames[n], mixerProfiler.stages[n]);
+  }
+  printMixerHistogram("Jitter", mixerProfiler.jitter);
+  serialPrint("Missed deadlines: %u", mixerProfiler.missedDeadlines);
+  return 0;
+}
+
 #if defined(JITTER_MEASURE)
 int cliShowJitter(const char ** argv)
 {
@@ -958,6 +1012,7 @@ const CliCommand cliCommands[] = {
   { "help", cliHelp, "[<command>]" },
   { "debugvars", cliDebugVars, "" },
   { "repeat", cliRepeat, "<interval> <command>" },
+  { "profiler", cliProfiler, "[reset]" },
 #if defined(JITTER_MEASURE)
   { "jitter", cliShowJitter, "" },
 #endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _CRC_H_
+#define _CRC_H_
+
+#include <inttypes.h>
+
+// The CRC tables are generated at compile time from the polynomial. The
+// table of the slicing-by-N variants has N slices of 256 entries: slice k
+// is the CRC of a byte followed by k null bytes, so that N bytes are
+// processed with N independent lookups. Only the tables which are used
+// end in the firmware.
+
+template <unsigned... I>
+struct CrcIndexes
+{
+  typedef CrcIndexes<I..., (sizeof...(I) + I)...> Doubled;
+  typedef CrcIndexes<I..., sizeof...(I)> Next;
+};
+
+template <bool ODD, class EVEN>
+struct CrcIndexesSelect
+{
+  typedef typename EVEN::Next Type;
+};
+
+template <class EVEN>
+struct CrcIndexesSelect<false, EVEN>
+{
+  typedef EVEN Type;
+};
+
+// 0 .. N-1, built by doubling to keep the template recursion short
+template <unsigned N>
+struct CrcMakeIndexes
+{
+  typedef typename CrcIndexesSelect<N % 2, typename CrcMakeIndexes<N / 2>::Type::Doubled>::Type Type;
+};
+
+template <>
+struct CrcMakeIndexes<0>
+{
+  typedef CrcIndexes<> Type;
+};
+
+template <typename T, unsigned SLICES>
+struct CrcTables
+{
+  T values[SLICES * 256];
+};
+
+// The CRC is always updated MSB first: crc = (crc << 8) ^ table[(crc >> (WIDTH-8)) ^ byte].
+// REFLECTED only changes how the table is generated (LSB first, with the
+// reversed polynomial), as PXX does.
+template <typename T, unsigned WIDTH, uint32_t POLY, bool REFLECTED>
+class Crc
+{
+  public:
+    typedef T type;
+
+    static constexpr uint32_t mask()
+    {
+      return WIDTH == 32 ? 0xFFFFFFFF : (1u << WIDTH) - 1;
+    }
+
+    static constexpr uint32_t msbFirst(uint32_t value, unsigned bits)
+    {
+      return bits == 0 ? value : msbFirst((value & (1u << (WIDTH - 1))) ? ((value << 1) ^ POLY) & mask() : (value << 1) & mask(), bits - 1);
+    }
+
+    static constexpr uint32_t lsbFirst(uint32_t value, unsigned bits)
+    {
+      return bits == 0 ? value : lsbFirst((value & 1) ? (value >> 1) ^ POLY : value >> 1, bits - 1);
+    }
+
+    static constexpr T byteEntry(unsigned index)
+    {
+      return T(REFLECTED ? lsbFirst(index, 8) : msbFirst(uint32_t(index) << (WIDTH - 8), 8));
+    }
+
+    static constexpr T nextSlice(uint32_t value)
+    {
+      return T(((value << 8) & mask()) ^ byteEntry((value >> (WIDTH - 8)) & 0xFF));
+    }
+
+    static constexpr T sliceEntry(unsigned slice, unsigned index)
+    {
+      return slice == 0 ? byteEntry(index) : nextSlice(sliceEntry(slice - 1, index));
+    }
+
+    template <unsigned SLICES, unsigned... I>
+    static constexpr CrcTables<T, SLICES> makeTables(CrcIndexes<I...>)
+    {
+      return {{ sliceEntry(I / 256, I % 256)... }};
+    }
+
+    template <unsigned SLICES>
+    struct Table
+    {
+      static constexpr CrcTables<T, SLICES> tables = makeTables<SLICES>(typename CrcMakeIndexes<SLICES * 256>::Type());
+    };
+
+    // one byte, for the ISRs and the frames built byte per byte
+    static inline T update(T crc, uint8_t byte)
+    {
+      return T(((uint32_t(crc) << 8) & mask()) ^ Table<1>::tables.values[((crc >> (WIDTH - 8)) ^ byte) & 0xFF]);
+    }
+
+    // a buffer, SLICES bytes at a time (1, 4 or 8)
+    template <unsigned SLICES>
+    static T compute(T crc, const uint8_t * buf, uint32_t len)
+    {
+      static_assert(SLICES == 1 || SLICES * 8 >= WIDTH, "the blocks must be at least as wide as the CRC");
+      const T * table = Table<SLICES>::tables.values;
+
+      for (; SLICES > 1 && len >= SLICES; len -= SLICES, buf += SLICES) {
+        // the CRC bytes are combined with the first bytes of the block
+        uint32_t value = uint32_t(crc) << (32 - WIDTH);
+        T result = 0;
+        for (unsigned i=0; i<SLICES; i++) {
+          result ^= table[(SLICES - 1 - i) * 256 + (uint8_t)(buf[i] ^ (value >> 24))];
+          value <<= 8;
+        }
+        crc = result;
+      }
+
+      for (; len > 0; len--) {
+        crc = T(((uint32_t(crc) << 8) & mask()) ^ table[((crc >> (WIDTH - 8)) ^ *buf++) & 0xFF]);
+      }
+
+      return crc;
+    }
+};
+
+template <typename T, unsigned WIDTH, uint32_t POLY, bool REFLECTED>
+template <unsigned SLICES>
+constexpr CrcTables<T, SLICES> Crc<T, WIDTH, POLY, REFLECTED>::Table<SLICES>::tables;
+
+// CRC16 CCITT (S.Port firmware update)
+typedef Crc<uint16_t, 16, 0x1021, false> Crc16Ccitt;
+// CRC16 of the PXX frames
+typedef Crc<uint16_t, 16, 0x8408, true> Crc16Pxx;
+// CRC8 with polynom = x^8+x^7+x^6+x^4+x^2+1 (0xD5), Crossfire frames
+typedef Crc<uint8_t, 8, 0xD5, false> Crc8Dvb;
+
+// S.Port checksum: the sum of the bytes, with the carries added back
+inline uint8_t sportChecksum(const uint8_t * ptr, uint32_t len)
+{
+  uint32_t sum = 0;
+  for (uint32_t i=0; i<len; i++) {
+    sum += ptr[i];
+  }
+  while (sum > 0xFF) {
+    sum = (sum & 0xFF) + (sum >> 8);
+  }
+  return sum;
+}
+
+#endif // _CRC_H_
@@ -43,6 +43,11 @@ void loadCurves()
     }
     curveEnd[i] = tmp;
   }
+
+  for (int i=0; i<MAX_CURVES; i++) {
+    invalidateCurve(i);
+  }
+  updateCurveLuts();
 }
 
 int8_t * curveAddress(uint8_t idx)
@@ -197,6 +202,48 @@ int32_t compute_tangent(CurveInfo * crv, int8_t * points, int i)
     return m;
 }
 
+struct HermiteSegment
+{
+  int32_t p0x, p3x;
+  int32_t p0y, p3y;
+  int32_t m0, m3;
+};
+
+static void getHermiteSegment(CurveInfo & crv, int8_t * points, int i, int32_t p0x, int32_t p3x, HermiteSegment & segment)
+{
+  segment.p0x = p0x;
+  segment.p3x = p3x;
+  segment.p0y = calc100toRESX(points[i]);
+  segment.p3y = calc100toRESX(points[i+1]);
+  segment.m0 = compute_tangent(&crv, points, i);
+  segment.m3 = compute_tangent(&crv, points, i+1);
+}
+
+static int32_t getHermiteSegmentX(CurveInfo & crv, int8_t * points, int i)
+{
+  uint8_t count = crv.points+5;
+  if (crv.type == CURVE_TYPE_CUSTOM)
+    return (i == 0 ? -RESX : (i == count-1 ? RESX : calc100toRESX(points[count+i-1])));
+  else
+    return -RESX + (i*2*RESX)/(count-1);
+}
+
+static int16_t hermiteSegmentValue(const HermiteSegment & segment, int32_t x)
+{
+  int32_t y;
+  int32_t h = segment.p3x - segment.p0x;
+  int32_t t = (h > 0 ? (MMULT * (x - segment.p0x)) / h : 0);
+  int32_t t2 = t * t / MMULT;
+  int32_t t3 = t2 * t / MMULT;
+  int32_t h00 = 2*t3 - 3*t2 + MMULT;
+  int32_t h10 = t3 - 2*t2 + t;
+  int32_t h01 = -2*t3 + 3*t2;
+  int32_t h11 = t3 - t2;
+  y = segment.p0y * h00 + h * (segment.m0 * h10 / MMULT) + segment.p3y * h01 + h * (segment.m3 * h11 / MMULT);
+  y /= MMULT;
+  return y;
+}
+
 /* The following is a hermite cubic spline.
    The basis functions can be found here:
    http://en.wikipedia.org/wiki/Cubic_Hermite_spline
@@ -207,7 +254,6 @@ int16_t hermite_spline(int16_t x, uint8_t idx)
   CurveInfo &crv = g_model.curves[idx];
   int8_t *points = curveAddress(idx);
   uint8_t count = crv.points+5;
-  bool custom = (crv.type == CURVE_TYPE_CUSTOM);
 
   if (x < -RESX)
     x = -RESX;
@@ -215,36 +261,128 @@ int16_t hermite_spline(int16_t x, uint8_t idx)
     x = RESX;
 
   for (int i=0; i<count-1; i++) {
-    int32_t p0x, p3x;
-    if (custom) {
-      p0x = (i>0 ? calc100toRESX(points[count+i-1]) : -RESX);
-      p3x = (i<count-2 ? calc100toRESX(points[count+i]) : RESX);
+    int32_t p0x = getHermiteSegmentX(crv, points, i);
+    int32_t p3x = getHermiteSegmentX(crv, points, i+1);
+    if (x >= p0x && x <= p3x) {
+      HermiteSegment segment;
+      getHermiteSegment(crv, points, i, p0x, p3x, segment);
+      return hermiteSegmentValue(segment, x);
     }
-    else {
-      p0x = -RESX + (i*2*RESX)/(count-1);
-      p3x = -RESX + ((i+1)*2*RESX)/(count-1);
+  }
+  return 0;
+}
+
+// The smooth curves are tabulated when the model is loaded, each one in a
+// table of the pool if the linear interpolation between its nodes stays
+// within CURVE_LUT_MAX_ERROR of the spline, otherwise the spline is
+// evaluated. The curve editors invalidate the table of the edited curve and
+// the menus task rebuilds it, the mixer evaluates the spline meanwhile.
+#define CURVE_LUT_DIRTY                0
+#define CURVE_LUT_EXACT                0xFF
+
+static uint8_t curveLutIndex[MAX_CURVES];   // CURVE_LUT_DIRTY, CURVE_LUT_EXACT or the table index + 1
+static int16_t curveLuts[CURVE_LUT_COUNT][CURVE_LUT_SIZE];
+
+static inline int16_t interpolateCurveLut(int16_t y0, int16_t y1, int32_t dx)
+{
+  return y0 + (int32_t(y1 - y0) * dx) / CURVE_LUT_STEP;
+}
+
+// the spline, with the tangents of all the segments computed once
+static bool computeCurveLut(uint8_t idx, int16_t * lut)
+{
+  CurveInfo & crv = g_model.curves[idx];
+  int8_t * points = curveAddress(idx);
+  uint8_t count = crv.points+5;
+  HermiteSegment segments[MAX_POINTS_PER_CURVE-1];
+
+  for (int i=0; i<count-1; i++) {
+    getHermiteSegment(crv, points, i, getHermiteSegmentX(crv, points, i), getHermiteSegmentX(crv, points, i+1), segments[i]);
+  }
+
+  int16_t values[CURVE_LUT_STEP+1];
+  for (int n=0; n<CURVE_LUT_SIZE; n++) {
+    int32_t x0 = -RESX + (n-1) * CURVE_LUT_STEP;
+    for (int dx=(n==0 ? CURVE_LUT_STEP : 0); dx<=CURVE_LUT_STEP; dx++) {
+      // the first segment which contains x, as hermite_spline() does
+      int32_t x = x0 + dx;
+      values[dx] = 0;
+      for (int i=0; i<count-1; i++) {
+        if (x >= segments[i].p0x && x <= segments[i].p3x) {
+          values[dx] = hermiteSegmentValue(segments[i], x);
+          break;
+        }
+      }
+    }
+    lut[n] = values[CURVE_LUT_STEP];
+    if (n > 0) {
+      for (int dx=1; dx<CURVE_LUT_STEP; dx++) {
+        if (abs(interpolateCurveLut(lut[n-1], lut[n], dx) - values[dx]) > CURVE_LUT_MAX_ERROR) {
+          return false;
+        }
+      }
     }
+  }
 
-    if (x >= p0x && x <= p3x) {
-      int32_t p0y = calc100toRESX(points[i]);
-      int32_t p3y = calc100toRESX(points[i+1]);
-      int32_t m0 = compute_tangent(&crv, points, i);
-      int32_t m3 = compute_tangent(&crv, points, i+1);
-      int32_t y;
-      int32_t h = p3x - p0x;
-      int32_t t = (h > 0 ? (MMULT * (x - p0x)) / h : 0);
-      int32_t t2 = t * t / MMULT;
-      int32_t t3 = t2 * t / MMULT;
-      int32_t h00 = 2*t3 - 3*t2 + MMULT;
-      int32_t h10 = t3 - 2*t2 + t;
-      int32_t h01 = -2*t3 + 3*t2;
-      int32_t h11 = t3 - t2;
-      y = p0y * h00 + h * (m0 * h10 / MMULT) + p3y * h01 + h * (m3 * h11 / MMULT);
-      y /= MMULT;
-      return y;
+  return true;
+}
+
+static void updateCurveLut(uint8_t idx)
+{
+  curveLutIndex[idx] = CURVE_LUT_EXACT;
+
+  // the linear curves are cheaper to compute than to interpolate
+  if (!g_model.curves[idx].smooth)
+    return;
+
+  for (uint8_t index=1; index<=CURVE_LUT_COUNT; index++) {
+    bool used = false;
+    for (int i=0; i<MAX_CURVES; i++) {
+      if (curveLutIndex[i] == index) {
+        used = true;
+        break;
+      }
+    }
+    if (!used) {
+      if (computeCurveLut(idx, curveLuts[index-1])) {
+        curveLutIndex[idx] = index;
+      }
+      return;
     }
   }
-  return 0;
+}
+
+void invalidateCurve(uint8_t idx)
+{
+  curveLutIndex[idx] = CURVE_LUT_DIRTY;
+}
+
+// called from the menus task, never from the mixer
+void updateCurveLuts()
+{
+  for (int i=0; i<MAX_CURVES; i++) {
+    if (curveLutIndex[i] == CURVE_LUT_DIRTY) {
+      updateCurveLut(i);
+    }
+  }
+}
+
+const int16_t * getCurveLut(uint8_t idx)
+{
+  uint8_t index = curveLutIndex[idx];
+  return (index == CURVE_LUT_DIRTY || index == CURVE_LUT_EXACT ? NULL : curveLuts[index-1]);
+}
+
+static int16_t curveLutValue(const int16_t * lut, int16_t x)
+{
+  if (x <= -RESX)
+    return lut[0];
+  else if (x >= RESX)
+    return lut[CURVE_LUT_SIZE-1];
+
+  unsigned int offset = x + RESX;
+  unsigned int n = offset / CURVE_LUT_STEP;
+  return interpolateCurveLut(lut[n], lut[n+1], offset % CURVE_LUT_STEP);
 }
 #endif
 
@@ -355,10 +493,16 @@ int applyCustomCurve(int x, uint8_t idx)
     return 0;
 
   CurveInfo & crv = g_model.curves[idx];
-  if (crv.smooth)
-    return hermite_spline(x, idx);
-  else
+  if (crv.smooth) {
+    const int16_t * lut = getCurveLut(idx);
+    if (lut)
+      return curveLutValue(lut, x);
+    else
+      return hermite_spline(x, idx);
+  }
+  else {
     return intpol(x, idx);
+  }
 }
 #else
 int applyCurve(int x, int8_t idx)
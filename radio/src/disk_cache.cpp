@@ -24,6 +24,8 @@
 #if defined(SIMU) && !defined(SIMU_DISKIO)
   #define __disk_read(...)    (RES_OK)
   #define __disk_write(...)   (RES_OK)
+  // no disk image, all the sectors may be cached
+  #define sdGetNoSectors()    (0xFFFFFFFF)
 #endif
 
 #if 0     // set to 1 to enable traces
@@ -35,6 +37,9 @@
 DiskCache diskCache;
 
 DiskCacheBlock::DiskCacheBlock():
+  refs(0),
+  pinned(false),
+  prefetched(false),
   startSector(0),
   endSector(0) 
 {
@@ -58,7 +63,9 @@ DRESULT DiskCacheBlock::fill(BYTE drv, BYTE * buff, DWORD sector, UINT count)
   }
   startSector = sector;
   endSector = sector + DISK_CACHE_BLOCK_SECTORS;
-  memcpy(buff, data, count * BLOCK_SIZE);
+  if (buff) {
+    memcpy(buff, data, count * BLOCK_SIZE);
+  }
   TRACE_DISK_CACHE("\tcache %p FILLED from read(%u, %u)", this, (uint32_t)sector, (uint32_t)count);
   return RES_OK;
 }
@@ -67,13 +74,16 @@ void DiskCacheBlock::free(DWORD sector, UINT count)
 {
   if (sector < endSector && (sector+count) > startSector) {
     TRACE_DISK_CACHE("\tINVALIDATING disk cache block %p (%u)", this, startSector);
-    endSector = 0;
+    free();
   }
 }
 
 void DiskCacheBlock::free()
 {
   endSector = 0;
+  refs = 0;
+  pinned = false;
+  prefetched = false;
 }
 
 bool DiskCacheBlock::empty() const
@@ -81,26 +91,153 @@ bool DiskCacheBlock::empty() const
   return (endSector == 0);
 }
 
+bool DiskCacheBlock::contains(DWORD sector) const
+{
+  return (sector >= startSector && sector < endSector);
+}
+
 DiskCache::DiskCache():
-  lastBlock(0)
+  clockHand(0),
+  nextStream(0),
+  nextReadAhead(0),
+  readAheadsDrive(0)
 {
-  stats.noHits = 0;
-  stats.noMisses = 0;
-  stats.noWrites = 0;
+  memclear(&stats, sizeof(stats));
+  memclear(streams, sizeof(streams));
+  memclear(readAheads, sizeof(readAheads));
   blocks = new DiskCacheBlock[DISK_CACHE_BLOCKS_NUM];
 }
 
 void DiskCache::clear()
 {
-  lastBlock = 0;
-  stats.noHits = 0;
-  stats.noMisses = 0;
-  stats.noWrites = 0;
+  clockHand = 0;
+  nextStream = 0;
+  nextReadAhead = 0;
+  memclear(&stats, sizeof(stats));
+  memclear(streams, sizeof(streams));
+  memclear(readAheads, sizeof(readAheads));
   for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
     blocks[n].free();
   }
 }
 
+static bool isFsSector(DWORD sector)
+{
+#if defined(SIMU) && !defined(SIMU_DISKIO)
+  return false;
+#else
+  const FATFS & fs = g_FATFS_Obj;
+  if (fs.fs_type == 0) {
+    return false;
+  }
+  // FATs, and the root directory on FAT12/16
+  if (sector >= fs.fatbase && sector < fs.database) {
+    return true;
+  }
+  // first cluster of the root directory on FAT32
+  if (fs.fs_type == FS_FAT32) {
+    DWORD root = fs.database + (fs.dirbase - 2) * fs.csize;
+    return (sector >= root && sector < root + fs.csize);
+  }
+  return false;
+#endif
+}
+
+uint8_t DiskCache::getAccess(DWORD sector, UINT count)
+{
+  if (isFsSector(sector)) {
+    return DISK_CACHE_ACCESS_FS;
+  }
+
+  for (int n=0; n<DISK_CACHE_STREAMS_NUM; ++n) {
+    if (streams[n] == sector) {
+      streams[n] = sector + count;
+      return DISK_CACHE_ACCESS_STREAM;
+    }
+  }
+
+  // may be the start of a new stream, it replaces the oldest one
+  streams[nextStream] = sector + count;
+  if (++nextStream >= DISK_CACHE_STREAMS_NUM) {
+    nextStream = 0;
+  }
+  return DISK_CACHE_ACCESS_RANDOM;
+}
+
+uint8_t DiskCache::getPinnedCount() const
+{
+  uint8_t result = 0;
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    if (blocks[n].pinned) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+DiskCacheBlock * DiskCache::getFreeBlock()
+{
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    if (blocks[n].empty()) {
+      TRACE_DISK_CACHE("\t\t using free block");
+      return &blocks[n];
+    }
+  }
+
+  // CLOCK: pinned blocks are skipped, referenced blocks get another chance.
+  // There are never more than DISK_CACHE_PINNED_MAX pinned blocks, so this ends.
+  while (true) {
+    DiskCacheBlock * block = &blocks[clockHand];
+    if (++clockHand >= DISK_CACHE_BLOCKS_NUM) {
+      clockHand = 0;
+    }
+    if (block->pinned) {
+      continue;
+    }
+    if (block->refs == 0) {
+      block->free();
+      return block;
+    }
+    --block->refs;
+  }
+}
+
+// The read which missed doesn't wait for the next block as well, it is read
+// in idle(). A new stream replaces the oldest pending read ahead.
+void DiskCache::queueReadAhead(BYTE drv, DWORD sector)
+{
+  for (int n=0; n<DISK_CACHE_STREAMS_NUM; ++n) {
+    if (readAheads[n] == sector) {
+      return;
+    }
+  }
+  readAheadsDrive = drv;
+  readAheads[nextReadAhead] = sector;
+  if (++nextReadAhead >= DISK_CACHE_STREAMS_NUM) {
+    nextReadAhead = 0;
+  }
+}
+
+void DiskCache::readAhead(BYTE drv, DWORD sector)
+{
+  if (sector+DISK_CACHE_BLOCK_SECTORS >= sdGetNoSectors()) {
+    return;
+  }
+
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    if (blocks[n].contains(sector)) {
+      return;
+    }
+  }
+
+  DiskCacheBlock * block = getFreeBlock();
+  if (block->fill(drv, NULL, sector, 0) == RES_OK) {
+    TRACE_DISK_CACHE("\t\t read ahead(%u)", (uint32_t)sector);
+    block->prefetched = true;
+    ++stats.noReadAheads;
+  }
+}
+
 DRESULT DiskCache::read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
 {
   // TODO: check if not caching first sectors would improve anything
@@ -121,30 +258,84 @@ DRESULT DiskCache::read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
     return __disk_read(drv, buff, sector, count);
   }
 
+  uint8_t access = getAccess(sector, count);
+
+  // streamed blocks are used once, they don't get the references which would
+  // let them evict the FAT sectors or the blocks read randomly
+  uint8_t maxRefs = (access == DISK_CACHE_ACCESS_STREAM ? 1 : DISK_CACHE_REFS_MAX);
+
   for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
-    if (blocks[n].read(buff, sector, count)) {
+    DiskCacheBlock & block = blocks[n];
+    if (block.read(buff, sector, count)) {
       ++stats.noHits;
+      ++stats.access[access].noHits;
+      if (block.refs < maxRefs) {
+        ++block.refs;
+      }
+      if (block.prefetched) {
+        block.prefetched = false;
+        ++stats.noReadAheadHits;
+      }
       return RES_OK;
     }
   }
 
   ++stats.noMisses;
+  ++stats.access[access].noMisses;
 
-  // find free block
-  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
-    if (blocks[n].empty()) {
-      TRACE_DISK_CACHE("\t\t using free block");
-      return blocks[n].fill(drv, buff, sector, count);
+  DiskCacheBlock * block = getFreeBlock();
+  DRESULT res = block->fill(drv, buff, sector, count);
+  if (res != RES_OK) {
+    return res;
+  }
+
+  if (access == DISK_CACHE_ACCESS_FS) {
+    block->refs = DISK_CACHE_REFS_MAX;
+    block->pinned = (getPinnedCount() < DISK_CACHE_PINNED_MAX);
+  }
+  else {
+    block->refs = 1;
+    if (access == DISK_CACHE_ACCESS_STREAM) {
+      // the reader will need the next block soon
+      queueReadAhead(drv, sector + DISK_CACHE_BLOCK_SECTORS);
     }
   }
 
-  // use next block (round robin)
-  // TODO: use better strategy to select which used block gets used here
-  if (++lastBlock >= DISK_CACHE_BLOCKS_NUM) {
-    lastBlock = 0;
+  return RES_OK;
+}
+
+// Called by the storage task when the other tasks are idle, with the FatFs
+// volume lock as the reads and the writes
+void DiskCache::idle()
+{
+  // the volume isn't locked when nothing is pending, a read ahead queued
+  // meanwhile waits for the next call
+  bool pending = false;
+  for (int n=0; n<DISK_CACHE_STREAMS_NUM; ++n) {
+    if (readAheads[n]) {
+      pending = true;
+    }
   }
-  
-  return blocks[lastBlock].fill(drv, buff, sector, count);
+  if (!pending) {
+    return;
+  }
+
+#if !defined(SIMU) || defined(SIMU_DISKIO)
+  if (g_FATFS_Obj.fs_type == 0 || !ff_req_grant(g_FATFS_Obj.sobj)) {
+    return;
+  }
+#endif
+
+  for (int n=0; n<DISK_CACHE_STREAMS_NUM; ++n) {
+    if (readAheads[n]) {
+      readAhead(readAheadsDrive, readAheads[n]);
+      readAheads[n] = 0;
+    }
+  }
+
+#if !defined(SIMU) || defined(SIMU_DISKIO)
+  ff_rel_grant(g_FATFS_Obj.sobj);
+#endif
 }
 
 DRESULT DiskCache::write(BYTE drv, const BYTE* buff, DWORD sector, UINT count)
@@ -168,6 +359,13 @@ int DiskCache::getHitRate() const
   return (stats.noHits * 1000) / all;
 }
 
+int DiskCache::getHitRate(uint8_t access) const
+{
+  uint32_t all = stats.access[access].noHits + stats.access[access].noMisses;
+  if (all == 0) return 0;
+  return (stats.access[access].noHits * 1000) / all;
+}
+
 DRESULT disk_read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
 {
   return diskCache.read(drv, buff, sector, count);
@@ -27,9 +27,20 @@
 // tunable parameters
 #define DISK_CACHE_BLOCKS_NUM      32   // no cache blocks
 #define DISK_CACHE_BLOCK_SECTORS   16   // no sectors
+#define DISK_CACHE_PINNED_MAX      8    // max no blocks kept for the FAT and root directory
+#define DISK_CACHE_STREAMS_NUM     4    // no sequential readers detected at the same time
+#define DISK_CACHE_REFS_MAX        3    // CLOCK reference counter saturation
 
 #define DISK_CACHE_BLOCK_SIZE   (DISK_CACHE_BLOCK_SECTORS * BLOCK_SIZE)
 
+enum DiskCacheAccess
+{
+  DISK_CACHE_ACCESS_FS,       // FAT and root directory
+  DISK_CACHE_ACCESS_STREAM,   // sequential reads (audio files, bitmaps, scripts...)
+  DISK_CACHE_ACCESS_RANDOM,
+  DISK_CACHE_ACCESS_COUNT
+};
+
 class DiskCacheBlock
 {
 public:
@@ -39,6 +50,11 @@ public:
   void free(DWORD sector, UINT count);
   void free();
   bool empty() const;
+  bool contains(DWORD sector) const;
+
+  uint8_t refs;       // CLOCK reference counter
+  bool pinned;        // FAT / root directory block, skipped by the CLOCK hand
+  bool prefetched;    // read ahead, not yet used
 
 private:
   uint8_t data[DISK_CACHE_BLOCK_SIZE];
@@ -46,11 +62,20 @@ private:
   DWORD endSector;
 };
 
+struct DiskCacheAccessStats
+{
+  uint32_t noHits;
+  uint32_t noMisses;
+};
+
 struct DiskCacheStats
 {
   uint32_t noHits;
   uint32_t noMisses;
   uint32_t noWrites;
+  uint32_t noReadAheads;
+  uint32_t noReadAheadHits;
+  DiskCacheAccessStats access[DISK_CACHE_ACCESS_COUNT];
 };
 
 class DiskCache
@@ -61,12 +86,25 @@ class DiskCache
     DRESULT write(BYTE drv, const BYTE* buff, DWORD sector, UINT count);
     const DiskCacheStats & getStats() const;
     int getHitRate() const;
+    int getHitRate(uint8_t access) const;
     void clear();
+    void idle();
 
   private:
     DiskCacheStats stats;
-    uint32_t lastBlock;
+    uint32_t clockHand;
+    DWORD streams[DISK_CACHE_STREAMS_NUM];   // next sector expected by each sequential reader
+    uint8_t nextStream;
+    DWORD readAheads[DISK_CACHE_STREAMS_NUM];   // first sector of each block to read ahead, 0 if none
+    uint8_t nextReadAhead;
+    BYTE readAheadsDrive;
     DiskCacheBlock * blocks;
+
+    uint8_t getAccess(DWORD sector, UINT count);
+    DiskCacheBlock * getFreeBlock();
+    uint8_t getPinnedCount() const;
+    void queueReadAhead(BYTE drv, DWORD sector);
+    void readAhead(BYTE drv, DWORD sector);
 };
 
 extern DiskCache diskCache;
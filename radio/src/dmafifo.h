@@ -68,6 +68,24 @@ class DMAFifo
       }
     }
 
+    // The bytes received which can be read without wrapping around, they
+    // stay in the fifo until consume() is called
+    uint32_t peekSpan(const uint8_t * & span)
+    {
+#if defined(SIMU)
+      return 0;
+#endif
+      uint32_t w = (N - stream->NDTR) & (N-1);
+      uint32_t r = ridx;
+      span = &fifo[r];
+      return (w >= r ? w : N) - r;
+    }
+
+    void consume(uint32_t count)
+    {
+      ridx = (ridx+count) & (N-1);
+    }
+
     uint8_t * buffer()
     {
       return fifo;
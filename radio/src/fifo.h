@@ -96,6 +96,22 @@ class Fifo
       }
     }
 
+    // The elements which can be read without wrapping around, they stay in
+    // the fifo until consume() is called. When the data wraps around, the
+    // next span starts at the beginning of the buffer.
+    uint32_t peekSpan(const T * & span) const
+    {
+      uint32_t w = widx;
+      uint32_t r = ridx;
+      span = &fifo[r];
+      return (w >= r ? w : N) - r;
+    }
+
+    void consume(uint32_t count)
+    {
+      ridx = (ridx+count) & (N-1);
+    }
+
   protected:
     T fifo[N];
     volatile uint32_t widx;
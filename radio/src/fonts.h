@@ -25,6 +25,7 @@
 
 extern const uint16_t * const fontspecsTable[16];
 extern const uint8_t * const fontsTable[16];
+extern FontAtlas * const fontAtlasTable[16];
 
 #if defined(PCBHORUS)
 extern BitmapBuffer * fontCache[2];
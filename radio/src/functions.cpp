@@ -47,7 +47,7 @@ PLAY_FUNCTION(playValue, source_t idx)
   if (idx == MIXSRC_NONE)
     return;
 
-  getvalue_t val = getValue(idx);
+  getvalue_t val = getSnapshotValue(idx);
 
 #if defined(CPUARM)
   if (idx >= MIXSRC_FIRST_TELEM) {
@@ -434,7 +434,7 @@ void evalFunctions()
             }
 #endif
             else {
-              SET_GVAR(CFN_GVAR_INDEX(cfn), calcRESXto100(getValue(CFN_PARAM(cfn))), mixerCurrentFlightMode);
+              SET_GVAR(CFN_GVAR_INDEX(cfn), calcRESXto100(getSnapshotValue(CFN_PARAM(cfn))), mixerCurrentFlightMode);
             }
             break;
 #endif
@@ -442,7 +442,7 @@ void evalFunctions()
 #if defined(MASTER_VOLUME)
           case FUNC_VOLUME:
           {
-            getvalue_t raw = getValue(CFN_PARAM(cfn));
+            getvalue_t raw = getSnapshotValue(CFN_PARAM(cfn));
             // only set volume if input changed more than hysteresis
             if (abs(requiredSpeakerVolumeRawLast - raw) > VOLUME_HYSTERESIS) {
               requiredSpeakerVolumeRawLast = raw;
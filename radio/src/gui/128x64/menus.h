@@ -171,6 +171,9 @@ static const MenuHandlerFunc menuTabModel[] PROGMEM = {
 
 void menuStatisticsView(event_t event);
 void menuStatisticsDebug(event_t event);
+#if defined(CPUARM)
+void menuStatisticsProfiler(event_t event);
+#endif
 void menuAboutView(event_t event);
 
 #if defined(DEBUG_TRACE_BUFFER)
@@ -75,6 +75,7 @@ void menuStatisticsView(event_t event)
   #define MENU_DEBUG_Y_MAH             (2*FH)
   #define MENU_DEBUG_Y_CPU_TEMP        (3*FH)
   #define MENU_DEBUG_Y_COPROC          (4*FH)
+  #define MENU_DEBUG_Y_LOGS            (4*FH)
   #define MENU_DEBUG_Y_MIXMAX          (5*FH)
   #define MENU_DEBUG_Y_RTOS            (6*FH)
 #else
@@ -105,6 +106,12 @@ void menuStatisticsDebug(event_t event)
       g_tmr1Latency_max = 0;
 #endif
       maxMixerDuration  = 0;
+#if defined(CPUARM)
+      mixerProfiler.reset();
+#endif
+#if defined(BINARY_LOGS)
+      binaryLogsOverruns = 0;
+#endif
       break;
 
 #if defined(DEBUG_TRACE_BUFFER)
@@ -114,7 +121,11 @@ void menuStatisticsDebug(event_t event)
 #endif
 
     case EVT_KEY_FIRST(KEY_DOWN):
+#if defined(CPUARM)
+      chainMenu(menuStatisticsProfiler);
+#else
       chainMenu(menuStatisticsView);
+#endif
       break;
 
     case EVT_KEY_FIRST(KEY_EXIT):
@@ -166,6 +177,9 @@ void menuStatisticsDebug(event_t event)
     drawValueWithUnit(MENU_DEBUG_COL1_OFS, MENU_DEBUG_Y_COPROC, Coproc_temp, UNIT_TEMPERATURE, LEFT);
     drawValueWithUnit(MENU_DEBUG_COL2_OFS, MENU_DEBUG_Y_COPROC, Coproc_maxtemp, UNIT_TEMPERATURE, LEFT);
   }
+#elif defined(BINARY_LOGS)
+  lcdDrawTextAlignedLeft(MENU_DEBUG_Y_LOGS, "Logs lost");
+  lcdDrawNumber(MENU_DEBUG_COL1_OFS, MENU_DEBUG_Y_LOGS, binaryLogsOverruns, LEFT);
 #endif
 
 #if defined(CPUARM)
@@ -199,3 +213,55 @@ void menuStatisticsDebug(event_t event)
   lcdDrawText(4*FW, 7*FH+1, STR_MENUTORESET);
   lcdInvertLastLine();
 }
+
+#if defined(CPUARM)
+#define MENU_PROFILER_COL_LAST     (12*FW)
+#define MENU_PROFILER_COL_AVG      (16*FW+4)
+#define MENU_PROFILER_COL_MAX      (LCD_W-1)
+#define MENU_PROFILER_ROW_H        (FH-1)
+
+void menuStatisticsProfiler(event_t event)
+{
+  TITLE("MIXER");
+
+  switch (event) {
+    case EVT_KEY_FIRST(KEY_ENTER):
+      mixerProfiler.reset();
+      break;
+
+    case EVT_KEY_FIRST(KEY_UP):
+      chainMenu(menuStatisticsDebug);
+      break;
+
+    case EVT_KEY_FIRST(KEY_DOWN):
+      chainMenu(menuStatisticsView);
+      break;
+
+    case EVT_KEY_FIRST(KEY_EXIT):
+      chainMenu(menuMainView);
+      break;
+  }
+
+  // all durations in us, in small font to fit the 7 stages and the jitter
+  lcdDrawText(MENU_PROFILER_COL_LAST, 1, "Last", SMLSIZE|RIGHT);
+  lcdDrawText(MENU_PROFILER_COL_AVG, 1, "Avg", SMLSIZE|RIGHT);
+  lcdDrawText(MENU_PROFILER_COL_MAX, 1, "Max", SMLSIZE|RIGHT);
+
+  for (uint8_t i=0; i<MIXER_STAGES_COUNT; i++) {
+    coord_t y = FH + i*MENU_PROFILER_ROW_H;
+    const MixerHistogram & stage = mixerProfiler.stages[i];
+    lcdDrawText(0, y, mixerStageNames[i], SMLSIZE);
+    lcdDrawNumber(MENU_PROFILER_COL_LAST, y, stage.last, SMLSIZE);
+    lcdDrawNumber(MENU_PROFILER_COL_AVG, y, stage.average(), SMLSIZE);
+    lcdDrawNumber(MENU_PROFILER_COL_MAX, y, stage.max, SMLSIZE);
+  }
+
+  coord_t y = FH + MIXER_STAGES_COUNT*MENU_PROFILER_ROW_H;
+  lcdDrawText(0, y, "Jitter", SMLSIZE);
+  lcdDrawNumber(lcdLastPos+3, y, mixerProfiler.jitter.average(), SMLSIZE|LEFT);
+  lcdDrawText(lcdLastPos, y, ">", SMLSIZE);
+  lcdDrawNumber(lcdLastPos+1, y, mixerProfiler.jitter.max, SMLSIZE|LEFT);
+  lcdDrawText(MENU_PROFILER_COL_AVG, y, "Miss", SMLSIZE|RIGHT);
+  lcdDrawNumber(MENU_PROFILER_COL_MAX, y, mixerProfiler.missedDeadlines, SMLSIZE);
+}
+#endif
@@ -54,6 +54,7 @@ void menuSpecialFunctions(event_t event, CustomFunctionData * functions, CustomF
 void menuModelNotes(event_t event);
 void menuStatisticsView(event_t event);
 void menuStatisticsDebug(event_t event);
+void menuStatisticsProfiler(event_t event);
 void menuAboutView(event_t event);
 #if defined(DEBUG_TRACE_BUFFER)
 void menuTraceBuffer(event_t event);
@@ -125,6 +125,14 @@ void menuStatisticsDebug(event_t event)
       maxLuaDuration = 0;
 #endif
       maxMixerDuration  = 0;
+      mixerProfiler.reset();
+#if defined(BINARY_LOGS)
+      binaryLogsOverruns = 0;
+#endif
+      break;
+
+    case EVT_KEY_BREAK(KEY_PAGE):
+      chainMenu(menuStatisticsProfiler);
       break;
 
 #if defined(DEBUG_TRACE_BUFFER)
@@ -153,6 +161,10 @@ void menuStatisticsDebug(event_t event)
   lcdDrawTextAlignedLeft(MENU_DEBUG_Y_FREE_RAM, "Free Mem");
   lcdDrawNumber(MENU_DEBUG_COL1_OFS, MENU_DEBUG_Y_FREE_RAM, availableMemory(), LEFT);
   lcdDrawText(lcdLastPos, MENU_DEBUG_Y_FREE_RAM, "b");
+#if defined(BINARY_LOGS)
+  lcdDrawText(lcdLastPos+2, MENU_DEBUG_Y_FREE_RAM+1, "[Logs lost]", SMLSIZE);
+  lcdDrawNumber(lcdLastPos, MENU_DEBUG_Y_FREE_RAM, binaryLogsOverruns, LEFT);
+#endif
 
 #if defined(LUA)
   lcdDrawTextAlignedLeft(MENU_DEBUG_Y_LUA, "Lua scripts");
@@ -191,6 +203,57 @@ void menuStatisticsDebug(event_t event)
   lcdInvertLastLine();
 }
 
+#define MENU_PROFILER_COL_LAST     (13*FW)
+#define MENU_PROFILER_COL_AVG      (18*FW)
+#define MENU_PROFILER_COL_MAX      (23*FW)
+#define MENU_PROFILER_COL_RIGHT    (26*FW)
+
+void menuStatisticsProfiler(event_t event)
+{
+  TITLE("MIXER");
+
+  switch(event)
+  {
+    case EVT_KEY_FIRST(KEY_ENTER):
+      mixerProfiler.reset();
+      break;
+
+    case EVT_KEY_BREAK(KEY_PAGE):
+      chainMenu(menuStatisticsView);
+      break;
+    case EVT_KEY_FIRST(KEY_DOWN):
+      chainMenu(menuStatisticsDebug);
+      break;
+    case EVT_KEY_FIRST(KEY_EXIT):
+      chainMenu(menuMainView);
+      break;
+  }
+
+  // all durations in us
+  lcdDrawText(MENU_PROFILER_COL_LAST, 1, "Last", SMLSIZE|RIGHT);
+  lcdDrawText(MENU_PROFILER_COL_AVG, 1, "Avg", SMLSIZE|RIGHT);
+  lcdDrawText(MENU_PROFILER_COL_MAX, 1, "Max", SMLSIZE|RIGHT);
+
+  for (uint8_t i=0; i<MIXER_STAGES_COUNT; i++) {
+    coord_t y = (i+1)*FH;
+    const MixerHistogram & stage = mixerProfiler.stages[i];
+    lcdDrawText(0, y, mixerStageNames[i], i==MIXER_STAGE_TOTAL ? BOLD : 0);
+    lcdDrawNumber(MENU_PROFILER_COL_LAST, y, stage.last, 0);
+    lcdDrawNumber(MENU_PROFILER_COL_AVG, y, stage.average(), 0);
+    lcdDrawNumber(MENU_PROFILER_COL_MAX, y, stage.max, 0);
+  }
+
+  lcdDrawText(MENU_PROFILER_COL_RIGHT, 1*FH, "Jitter", BOLD);
+  lcdDrawNumber(MENU_PROFILER_COL_RIGHT, 2*FH, mixerProfiler.jitter.average(), LEFT);
+  lcdDrawText(lcdLastPos, 2*FH+1, "us", SMLSIZE);
+  lcdDrawText(MENU_PROFILER_COL_RIGHT, 3*FH+1, ">", SMLSIZE);
+  lcdDrawNumber(lcdLastPos+1, 3*FH, mixerProfiler.jitter.max, LEFT);
+  lcdDrawText(lcdLastPos, 3*FH+1, "us", SMLSIZE);
+
+  lcdDrawText(MENU_PROFILER_COL_RIGHT, 5*FH, "Missed", BOLD);
+  lcdDrawNumber(MENU_PROFILER_COL_RIGHT, 6*FH, mixerProfiler.missedDeadlines, LEFT);
+}
+
 
 #if defined(DEBUG_TRACE_BUFFER)
 void menuTraceBuffer(event_t event)
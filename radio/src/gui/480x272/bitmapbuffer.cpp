@@ -21,6 +21,199 @@
 #include <math.h>
 #include "opentx.h"
 
+static inline bool touches(const DirtyRect & a, const DirtyRect & b)
+{
+  return a.x <= b.right() && b.x <= a.right() && a.y <= b.bottom() && b.y <= a.bottom();
+}
+
+static inline DirtyRect getUnion(const DirtyRect & a, const DirtyRect & b)
+{
+  DirtyRect result;
+  result.x = min(a.x, b.x);
+  result.y = min(a.y, b.y);
+  result.w = max(a.right(), b.right()) - result.x;
+  result.h = max(a.bottom(), b.bottom()) - result.y;
+  return result;
+}
+
+void DirtyRects::add(coord_t x, coord_t y, coord_t w, coord_t h)
+{
+  DirtyRect rect = { x, y, w, h };
+
+  for (unsigned int i=0; i<count; i++) {
+    const DirtyRect & current = rects[i];
+    if (x >= current.x && y >= current.y && rect.right() <= current.right() && rect.bottom() <= current.bottom()) {
+      return;
+    }
+  }
+
+  for (unsigned int i=0; i<count; i++) {
+    if (touches(rects[i], rect)) {
+      merge(i, rect);
+      return;
+    }
+  }
+
+  if (count < DIRTY_RECTS_COUNT) {
+    rects[count++] = rect;
+    return;
+  }
+
+  // no room left, the rectangle is merged with the one which grows the least
+  unsigned int best = 0;
+  uint32_t bestGrowth = 0xFFFFFFFF;
+  for (unsigned int i=0; i<count; i++) {
+    uint32_t growth = getUnion(rects[i], rect).area() - rects[i].area();
+    if (growth < bestGrowth) {
+      best = i;
+      bestGrowth = growth;
+    }
+  }
+  merge(best, rect);
+}
+
+void DirtyRects::add(const DirtyRects & other)
+{
+  for (unsigned int i=0; i<other.count; i++) {
+    const DirtyRect & rect = other.rects[i];
+    add(rect.x, rect.y, rect.w, rect.h);
+  }
+}
+
+// the union of rects[index] and rect is merged again with all the rectangles
+// it touches, so that the list never contains overlapping rectangles
+void DirtyRects::merge(unsigned int index, const DirtyRect & rect)
+{
+  DirtyRect result = getUnion(rects[index], rect);
+  rects[index] = rects[--count];
+
+  unsigned int i = 0;
+  while (i < count) {
+    if (touches(rects[i], result)) {
+      result = getUnion(rects[i], result);
+      rects[i] = rects[--count];
+      i = 0;
+    }
+    else {
+      i++;
+    }
+  }
+
+  rects[count++] = result;
+}
+
+bool DirtyRects::intersects(const DirtyRect & rect) const
+{
+  for (unsigned int i=0; i<count; i++) {
+    if (rects[i].intersects(rect)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+DirtyRect DirtyRects::getBounds() const
+{
+  if (count == 0) {
+    DirtyRect result = { 0, 0, 0, 0 };
+    return result;
+  }
+
+  DirtyRect result = rects[0];
+  for (unsigned int i=1; i<count; i++) {
+    result = getUnion(result, rects[i]);
+  }
+  return result;
+}
+
+uint32_t DirtyRects::getArea() const
+{
+  uint32_t result = 0;
+  for (unsigned int i=0; i<count; i++) {
+    result += rects[i].area();
+  }
+  return result;
+}
+
+const uint16_t * FontAtlas::getGlyph(uint8_t index)
+{
+  if (index >= count) {
+    return NULL;
+  }
+
+  if (!glyphs) {
+    glyphs = (uint16_t **)calloc(count, sizeof(uint16_t *));
+    if (!glyphs) {
+      return NULL;
+    }
+  }
+
+  if (!glyphs[index]) {
+    glyphs[index] = buildGlyph(index);
+  }
+
+  return glyphs[index];
+}
+
+// the pixels of a span are either all opaque or all translucent
+static inline coord_t getGlyphSpanLength(const uint8_t * q, coord_t col, coord_t width)
+{
+  bool opaque = (q[col] == OPACITY_MAX);
+  coord_t len = 1;
+  while (col+len < width && len < GLYPH_SPAN_OPAQUE-1 && q[col+len] != 0 && (q[col+len] == OPACITY_MAX) == opaque) {
+    len++;
+  }
+  return len;
+}
+
+uint16_t * FontAtlas::buildGlyph(uint8_t index)
+{
+  coord_t height = getHeight();
+  coord_t width = getGlyphWidth(index);
+  const uint8_t * pattern = font + 4 + getGlyphOffset(index);
+
+  unsigned int spansCount = 0;
+  for (coord_t row=0; row<height; row++) {
+    const uint8_t * q = pattern + row*getFontWidth();
+    for (coord_t col=0; col<width; ) {
+      if (q[col] == 0) {
+        col++;
+      }
+      else {
+        col += getGlyphSpanLength(q, col, width);
+        spansCount++;
+      }
+    }
+  }
+
+  uint16_t * rows = (uint16_t *)malloc((height+1) * sizeof(uint16_t) + spansCount * sizeof(GlyphSpan));
+  if (!rows) {
+    return NULL;
+  }
+
+  GlyphSpan * spans = (GlyphSpan *)(rows + height + 1);
+  unsigned int span = 0;
+  for (coord_t row=0; row<height; row++) {
+    const uint8_t * q = pattern + row*getFontWidth();
+    rows[row] = span;
+    for (coord_t col=0; col<width; ) {
+      if (q[col] == 0) {
+        col++;
+      }
+      else {
+        coord_t len = getGlyphSpanLength(q, col, width);
+        spans[span].col = col;
+        spans[span].len = len | (q[col] == OPACITY_MAX ? GLYPH_SPAN_OPAQUE : 0);
+        span++;
+        col += len;
+      }
+    }
+  }
+  rows[height] = span;
+
+  return rows;
+}
+
 void BitmapBuffer::drawAlphaPixel(display_t * p, uint8_t opacity, uint16_t color)
 {
   if (opacity == OPACITY_MAX) {
@@ -41,6 +234,7 @@ void BitmapBuffer::drawHorizontalLine(coord_t x, coord_t y, coord_t w, uint8_t p
 {
   if (y >= height) return;
   if (x+w > width) { w = width - x; }
+  markDirty(x, y, w, 1);
 
   display_t * p = getPixelPtr(x, y);
   display_t color = lcdColorTable[COLOR_IDX(att)];
@@ -73,6 +267,7 @@ void BitmapBuffer::drawVerticalLine(coord_t x, coord_t y, coord_t h, uint8_t pat
   if (h<0) { y+=h; h=-h; }
   if (y<0) { h+=y; y=0; if (h<=0) return; }
   if (y+h > height) { h = height - y; }
+  markDirty(x, y, 1, h);
 
   display_t color = lcdColorTable[COLOR_IDX(att)];
   uint8_t opacity = 0x0F - (att >> 24);
@@ -112,6 +307,7 @@ void BitmapBuffer::drawRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t
 
 void BitmapBuffer::drawFilledRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t pat, LcdFlags att)
 {
+  markDirty(x, y, w, h);
   for (coord_t i=y; i<y+h; i++) {
     if ((att & ROUND) && (i==y || i==y+h-1))
       drawHorizontalLine(x+1, i, w-2, pat, att);
@@ -124,6 +320,7 @@ void BitmapBuffer::invertRect(coord_t x, coord_t y, coord_t w, coord_t h, LcdFla
 {
   display_t color = lcdColorTable[COLOR_IDX(att)];
   RGB_SPLIT(color, red, green, blue);
+  markDirty(x, y, w, h);
 
   for (int i=y; i<y+h; i++) {
     display_t * p = getPixelPtr(x, i);
@@ -211,6 +408,8 @@ void BitmapBuffer::drawPie(int x0, int y0, int radius, int startAngle, int endAn
   if (!evalSlopes(slopes, startAngle, endAngle))
     return;
 
+  markDirty(x0-radius, y0-radius, 2*radius+1, 2*radius+1);
+
   for (int y=0; y<=radius; y++) {
     for (int x=0; x<=radius; x++) {
       if (x*x+y*y <= radius*radius) {
@@ -250,6 +449,7 @@ void BitmapBuffer::drawMask(coord_t x, coord_t y, BitmapBuffer * mask, LcdFlags
   }
 
   display_t color = lcdColorTable[COLOR_IDX(flags)];
+  markDirty(x, y, width, height);
 
   for (coord_t row=0; row<height; row++) {
     display_t * p = getPixelPtr(x, y+row);
@@ -275,6 +475,10 @@ void BitmapBuffer::drawBitmapPattern(coord_t x, coord_t y, const uint8_t * bmp,
   }
 
   display_t color = lcdColorTable[COLOR_IDX(flags)];
+  if (flags & VERTICAL)
+    markDirty(x, y-width+1, height, width);
+  else
+    markDirty(x, y, width, height);
 
   for (coord_t row=0; row<height; row++) {
     const uint8_t * q = bmp + 4 + row*w + offset;
@@ -306,16 +510,13 @@ uint8_t BitmapBuffer::drawCharWithCache(coord_t x, coord_t y, const BitmapBuffer
   return width;
 }
 
-void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t len, LcdFlags flags)
-{
 #define INCREMENT_POS(delta) \
   do { if (flags & VERTICAL) y -= delta; else x += delta; } while(0)
 
-  int width = getTextWidth(s, len, flags);
-  int height = getFontHeight(flags);
+// aligns the text, draws the inverted background and returns the font cache to use if any
+BitmapBuffer * BitmapBuffer::drawTextBackground(coord_t & x, coord_t & y, coord_t width, LcdFlags & flags)
+{
   uint32_t fontindex = FONTINDEX(flags);
-  const pm_uchar * font = fontsTable[fontindex];
-  const uint16_t * fontspecs = fontspecsTable[fontindex];
   BitmapBuffer * fontcache = NULL;
 
   if (flags & RIGHT)
@@ -323,8 +524,6 @@ void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t l
   else if (flags & CENTERED)
     INCREMENT_POS(-width/2);
 
-  coord_t & pos = (flags & VERTICAL) ? y : x;
-
   if ((flags & INVERS) && ((~flags & BLINK) || BLINK_ON_PHASE)) {
     uint16_t fgColor = lcdColorTable[COLOR_IDX(flags)];
     if (fgColor == lcdColorTable[TEXT_COLOR_INDEX]) {
@@ -366,6 +565,142 @@ void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t l
     }
   }
 
+  return fontcache;
+}
+
+// The glyphs are clipped once for the whole string. The opaque spans are
+// filled with the color, the others blended with the color premultiplied
+// by each opacity level, which gives the same pixels as drawAlphaPixel()
+void BitmapBuffer::drawGlyphSpans(coord_t x, coord_t y, FontAtlas * atlas, const uint8_t * glyphs, uint8_t count, coord_t width, LcdFlags flags)
+{
+  coord_t height = atlas->getHeight();
+  coord_t xmin = max<coord_t>(x, 0);
+  coord_t xmax = min<coord_t>(x+width, this->width);
+  coord_t ymin = max<coord_t>(y, 0);
+  coord_t ymax = min<coord_t>(y+height, this->height);
+
+  if (!data || xmin >= xmax || ymin >= ymax)
+    return;
+
+  markDirty(xmin, ymin, xmax-xmin, ymax-ymin);
+
+  display_t color = lcdColorTable[COLOR_IDX(flags)];
+  RGB_SPLIT(color, red, green, blue);
+  uint16_t premultiplied[OPACITY_MAX][3];
+  for (uint8_t opacity=1; opacity<OPACITY_MAX; opacity++) {
+    premultiplied[opacity][0] = red * opacity;
+    premultiplied[opacity][1] = green * opacity;
+    premultiplied[opacity][2] = blue * opacity;
+  }
+
+  for (uint8_t i=0; i<count && x<xmax; i++) {
+    uint8_t index = glyphs[i];
+    coord_t glyphWidth = atlas->getGlyphWidth(index);
+    if (x+glyphWidth > xmin) {
+      const uint16_t * rows = atlas->getGlyph(index);
+      if (!rows) {
+        drawCharWithoutCache(x, y, atlas->getFont(), atlas->getSpecs(), index, flags);
+      }
+      else {
+        const GlyphSpan * spans = (const GlyphSpan *)(rows + height + 1);
+        const uint8_t * pattern = atlas->getFont() + 4 + atlas->getGlyphOffset(index);
+        for (coord_t row=ymin-y; row<ymax-y; row++) {
+          display_t * line = getPixelPtr(0, y+row);
+          const uint8_t * q = pattern + row*atlas->getFontWidth();
+          for (uint16_t j=rows[row]; j<rows[row+1]; j++) {
+            const GlyphSpan & span = spans[j];
+            coord_t start = x + span.col;
+            coord_t first = max<coord_t>(start, xmin);
+            coord_t last = min<coord_t>(start + (span.len & ~GLYPH_SPAN_OPAQUE), xmax);
+            display_t * p = line + first;
+            if (span.len & GLYPH_SPAN_OPAQUE) {
+              for (coord_t col=first; col<last; col++) {
+                *p++ = color;
+              }
+            }
+            else {
+              const uint8_t * opacity = q + span.col + first - start;
+              for (coord_t col=first; col<last; col++) {
+                RGB_SPLIT(*p, bgRed, bgGreen, bgBlue);
+                uint8_t bgWeight = OPACITY_MAX - *opacity;
+                const uint16_t * fg = premultiplied[*opacity++];
+                *p++ = RGB_JOIN((bgRed * bgWeight + fg[0]) / OPACITY_MAX, (bgGreen * bgWeight + fg[1]) / OPACITY_MAX, (bgBlue * bgWeight + fg[2]) / OPACITY_MAX);
+              }
+            }
+          }
+        }
+      }
+    }
+    x += glyphWidth;
+  }
+}
+
+void BitmapBuffer::drawGlyphs(coord_t x, coord_t y, const uint8_t * glyphs, uint8_t count, LcdFlags flags)
+{
+  uint32_t fontindex = FONTINDEX(flags);
+  FontAtlas * atlas = fontAtlasTable[fontindex];
+  const uint16_t * fontspecs = fontspecsTable[fontindex];
+
+  coord_t width = 0;
+  for (uint8_t i=0; i<count; i++) {
+    width += atlas->getGlyphWidth(glyphs[i]);
+  }
+
+  BitmapBuffer * fontcache = drawTextBackground(x, y, width, flags);
+
+  if (fontcache) {
+    coord_t pos = x;
+    for (uint8_t i=0; i<count; i++) {
+      pos += drawCharWithCache(pos-1, y, fontcache, fontspecs, glyphs[i], flags);
+    }
+  }
+  else {
+    drawGlyphSpans(x-1, y, atlas, glyphs, count, width, flags);
+  }
+
+  lcdNextPos = x + width;
+}
+
+// the glyphs of a string, -1 if it contains position characters
+static int getTextGlyphs(const char * s, uint8_t len, LcdFlags flags, uint8_t * glyphs)
+{
+  int count = 0;
+  while (len--) {
+    unsigned char c;
+    if (flags & ZCHAR)
+      c = idx2char(*s);
+    else
+      c = pgm_read_byte(s);
+    if (!c)
+      break;
+    else if (c < 0x20)
+      return -1;
+    glyphs[count++] = getMappedChar(c);
+    s++;
+  }
+  return count;
+}
+
+void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t len, LcdFlags flags)
+{
+  if (!(flags & VERTICAL)) {
+    uint8_t glyphs[255];
+    int count = getTextGlyphs(s, len, flags, glyphs);
+    if (count >= 0) {
+      drawGlyphs(x, y, glyphs, count, flags);
+      return;
+    }
+  }
+
+  int width = getTextWidth(s, len, flags);
+  int height = getFontHeight(flags);
+  uint32_t fontindex = FONTINDEX(flags);
+  const pm_uchar * font = fontsTable[fontindex];
+  const uint16_t * fontspecs = fontspecsTable[fontindex];
+  BitmapBuffer * fontcache = drawTextBackground(x, y, width, flags);
+
+  coord_t & pos = (flags & VERTICAL) ? y : x;
+
   bool setpos = false;
   const coord_t orig_pos = pos;
   while (len--) {
@@ -422,6 +757,7 @@ void BitmapBuffer::drawBitmapPie(int x0, int y0, const uint16_t * img, int start
 
   int w2 = width/2;
   int h2 = height/2;
+  markDirty(x0, y0, width, height);
 
   for (int y=h2-1; y>=0; y--) {
     for (int x=w2-1; x>=0; x--) {
@@ -456,6 +792,7 @@ void BitmapBuffer::drawBitmapPatternPie(coord_t x0, coord_t y0, const uint8_t *
 
   int w2 = width/2;
   int h2 = height/2;
+  markDirty(x0, y0, width, height);
 
   for (int y=h2-1; y>=0; y--) {
     for (int x=w2-1; x>=0; x--) {
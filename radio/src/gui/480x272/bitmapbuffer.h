@@ -80,6 +80,141 @@ class BitmapBufferBase
 
 typedef BitmapBufferBase<const uint16_t> Bitmap;
 
+#define DIRTY_RECTS_COUNT              8
+
+struct DirtyRect
+{
+  coord_t x, y, w, h;
+
+  inline coord_t right() const
+  {
+    return x + w;
+  }
+
+  inline coord_t bottom() const
+  {
+    return y + h;
+  }
+
+  inline uint32_t area() const
+  {
+    return w * h;
+  }
+
+  inline bool intersects(const DirtyRect & other) const
+  {
+    return x < other.right() && other.x < right() && y < other.bottom() && other.y < bottom();
+  }
+};
+
+// The areas of a bitmap written since the last reset. They are kept as a few
+// bounding rectangles, which are merged when they touch each other or when
+// there is no room left for a new one
+class DirtyRects
+{
+  public:
+    DirtyRects():
+      count(0)
+    {
+    }
+
+    inline void reset()
+    {
+      count = 0;
+    }
+
+    inline unsigned int getCount() const
+    {
+      return count;
+    }
+
+    inline const DirtyRect & getRect(unsigned int index) const
+    {
+      return rects[index];
+    }
+
+    void add(coord_t x, coord_t y, coord_t w, coord_t h);
+
+    void add(const DirtyRects & other);
+
+    bool intersects(const DirtyRect & rect) const;
+
+    DirtyRect getBounds() const;
+
+    uint32_t getArea() const;
+
+  protected:
+    DirtyRect rects[DIRTY_RECTS_COUNT];
+    uint8_t count;
+
+    void merge(unsigned int index, const DirtyRect & rect);
+};
+
+// A row of consecutive pixels of a glyph which aren't transparent
+struct GlyphSpan
+{
+  uint8_t col;
+  uint8_t len;                          // GLYPH_SPAN_OPAQUE set when all the pixels are opaque
+};
+
+#define GLYPH_SPAN_OPAQUE              0x80
+
+// The glyphs of a font, stored as the spans of each row. A glyph is built
+// the first time it is drawn: rows[row]..rows[row+1] are the indexes of the
+// spans of the row, and the spans follow the height+1 indexes
+class FontAtlas
+{
+  public:
+    FontAtlas(const uint8_t * font, const uint16_t * specs, uint8_t count):
+      font(font),
+      specs(specs),
+      count(count),
+      glyphs(NULL)
+    {
+    }
+
+    inline const uint8_t * getFont() const
+    {
+      return font;
+    }
+
+    inline const uint16_t * getSpecs() const
+    {
+      return specs;
+    }
+
+    inline coord_t getFontWidth() const
+    {
+      return *((uint16_t *)font);
+    }
+
+    inline coord_t getHeight() const
+    {
+      return *(((uint16_t *)font)+1);
+    }
+
+    inline coord_t getGlyphOffset(uint8_t index) const
+    {
+      return specs[index];
+    }
+
+    inline coord_t getGlyphWidth(uint8_t index) const
+    {
+      return specs[index+1] - specs[index];
+    }
+
+    // NULL when the index isn't in the font or when there isn't enough memory
+    const uint16_t * getGlyph(uint8_t index);
+
+  protected:
+    const uint8_t * font;
+    const uint16_t * specs;
+    uint8_t count;
+    uint16_t ** glyphs;
+
+    uint16_t * buildGlyph(uint8_t index);
+};
+
 class BitmapBuffer: public BitmapBufferBase<uint16_t>
 {
   private:
@@ -87,6 +222,7 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
 #if defined(DEBUG)
     bool leakReported;
 #endif
+    DirtyRects dirtyRects;
 
   public:
 
@@ -117,6 +253,22 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
       }
     }
 
+    inline DirtyRects & getDirtyRects()
+    {
+      return dirtyRects;
+    }
+
+    inline void markDirty(coord_t x, coord_t y, coord_t w, coord_t h)
+    {
+      if (x < 0) { w += x; x = 0; }
+      if (y < 0) { h += y; y = 0; }
+      if (x + w > width) { w = width - x; }
+      if (y + h > height) { h = height - y; }
+      if (w > 0 && h > 0) {
+        dirtyRects.add(x, y, w, h);
+      }
+    }
+
     inline void setFormat(uint8_t format)
     {
       this->format = format;
@@ -180,6 +332,7 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
       if (!data || h==0 || w==0) return;
       if (h<0) { y+=h; h=-h; }
       if (w<0) { x+=w; w=-w; }
+      markDirty(x, y, w, h);
       DMAFillRect(data, width, x, y, w, h, lcdColorTable[COLOR_IDX(flags)]);
     }
 
@@ -216,6 +369,9 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
 
     void drawSizedText(coord_t x, coord_t y, const char * s, uint8_t len, LcdFlags flags);
 
+    // draws an horizontal string of font glyphs (see getMappedChar()), with the same flags as drawSizedText()
+    void drawGlyphs(coord_t x, coord_t y, const uint8_t * glyphs, uint8_t count, LcdFlags flags);
+
     template<class T>
     void drawBitmap(coord_t x, coord_t y, const T * bmp, coord_t srcx=0, coord_t srcy=0, coord_t w=0, coord_t h=0, float scale=0)
     {
@@ -233,6 +389,8 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
         w = srcw - srcx;
       if (srcy+h > srch)
         h = srch - srcy;
+      if (w <= 0 || h <= 0)
+        return;
 
       if (scale == 0) {
         if (x + w > width) {
@@ -241,6 +399,7 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
         if (y + h > height) {
           h = height - y;
         }
+        markDirty(x, y, w, h);
         if (bmp->getFormat() == BMP_ARGB4444) {
           DMACopyAlphaBitmap(data, this->width, x, y, bmp->getData(), srcw, srcx, srcy, w, h);
         }
@@ -256,6 +415,7 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
           scaledw = width - x;
         if (y + scaledh > height)
           scaledh = height - y;
+        markDirty(x, y, scaledw, scaledh);
 
         for (int i = 0; i < scaledh; i++) {
           uint16_t * p = &data[(y + i) * width + x];
@@ -290,6 +450,9 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
   protected:
     static BitmapBuffer * load_bmp(const char * filename);
     static BitmapBuffer * load_stb(const char * filename);
+
+    BitmapBuffer * drawTextBackground(coord_t & x, coord_t & y, coord_t width, LcdFlags & flags);
+    void drawGlyphSpans(coord_t x, coord_t y, FontAtlas * atlas, const uint8_t * glyphs, uint8_t count, coord_t width, LcdFlags flags);
 };
 
 extern BitmapBuffer * lcd;
@@ -86,6 +86,19 @@ const uint8_t * const fontsTable[16] = {
   font_stdsizebold, font_tinsize, font_smlsize, font_midsize, font_dblsize, font_xxlsize, font_stdsize, font_stdsize
 };
 
+FontAtlas font_tinsize_atlas(font_tinsize, font_tinsize_specs, DIM(font_tinsize_specs)-1);
+FontAtlas font_smlsize_atlas(font_smlsize, font_smlsize_specs, DIM(font_smlsize_specs)-1);
+FontAtlas font_stdsize_atlas(font_stdsize, font_stdsize_specs, DIM(font_stdsize_specs)-1);
+FontAtlas font_midsize_atlas(font_midsize, font_midsize_specs, DIM(font_midsize_specs)-1);
+FontAtlas font_dblsize_atlas(font_dblsize, font_dblsize_specs, DIM(font_dblsize_specs)-1);
+FontAtlas font_xxlsize_atlas(font_xxlsize, font_xxlsize_specs, DIM(font_xxlsize_specs)-1);
+FontAtlas font_stdsizebold_atlas(font_stdsizebold, font_stdsizebold_specs, DIM(font_stdsizebold_specs)-1);
+
+FontAtlas * const fontAtlasTable[16] = {
+  &font_stdsize_atlas, &font_tinsize_atlas, &font_smlsize_atlas, &font_midsize_atlas, &font_dblsize_atlas, &font_xxlsize_atlas, &font_stdsize_atlas, &font_stdsize_atlas,
+  &font_stdsizebold_atlas, &font_tinsize_atlas, &font_smlsize_atlas, &font_midsize_atlas, &font_dblsize_atlas, &font_xxlsize_atlas, &font_stdsize_atlas, &font_stdsize_atlas
+};
+
 BitmapBuffer * fontCache[2] = { NULL, NULL };
 
 BitmapBuffer * createFontCache(const uint8_t * font, LcdFlags fg, LcdFlags bg)
@@ -43,6 +43,121 @@ const LayoutFactory * getLayoutFactory(const char * name)
   return NULL;
 }
 
+void Layout::refresh()
+{
+  theme->drawBackground();
+  drawPanels(0, 0, LCD_W, LCD_H);
+
+  refreshDecorations();
+
+  if (widgets) {
+    for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+      refreshWidget(i);
+    }
+  }
+
+  lastFrame = lcdFramesCount;
+  fullRefreshNeeded = false;
+}
+
+bool Layout::refreshPartial()
+{
+  if (fullRefreshNeeded || !widgets || !theme->hasPartialBackground() || lcdFramesCount != lastFrame + 1 || !lcdRestoreLastFrame()) {
+    return false;
+  }
+
+  bool changed[MAX_LAYOUT_ZONES];
+  for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+    changed[i] = widgets[i] && widgets[i]->isRefreshNeeded();
+  }
+
+  // the widgets under the areas redrawn have to be redrawn as well
+  bool done = false;
+  while (!done) {
+    done = true;
+    for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+      if (widgets[i] && !changed[i] && isOverlapped(i, changed)) {
+        changed[i] = true;
+        done = false;
+      }
+    }
+  }
+
+  for (unsigned int i=0; i<decorationRects.getCount(); i++) {
+    drawBackground(decorationRects.getRect(i));
+  }
+  for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+    if (changed[i]) {
+      drawBackground(widgetRects[i]);
+    }
+  }
+
+  refreshDecorations();
+
+  for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+    if (changed[i]) {
+      refreshWidget(i);
+    }
+  }
+
+  // a decoration or a widget which now draws over a widget which wasn't redrawn
+  // needs a full refresh to restore the drawing order
+  for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+    if (widgets[i] && !changed[i] && isOverlapped(i, changed)) {
+      fullRefreshNeeded = true;
+    }
+  }
+
+  lastFrame = lcdFramesCount;
+  return true;
+}
+
+bool Layout::isOverlapped(unsigned int index, const bool * changed) const
+{
+  if (decorationRects.intersects(widgetRects[index])) {
+    return true;
+  }
+  for (unsigned int i=0; i<MAX_LAYOUT_ZONES; i++) {
+    if (changed[i] && i != index && widgetRects[i].intersects(widgetRects[index])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Layout::drawBackground(const DirtyRect & rect)
+{
+  if (rect.w > 0 && rect.h > 0) {
+    theme->drawPartialBackground(rect.x, rect.y, rect.w, rect.h);
+    drawPanels(rect.x, rect.y, rect.w, rect.h);
+  }
+}
+
+void Layout::refreshDecorations()
+{
+  DirtyRects & dirtyRects = lcd->getDirtyRects();
+  DirtyRects previous = dirtyRects;
+  dirtyRects.reset();
+  drawDecorations();
+  decorationRects = dirtyRects;
+  dirtyRects.add(previous);
+}
+
+void Layout::refreshWidget(unsigned int index)
+{
+  if (widgets[index]) {
+    DirtyRects & dirtyRects = lcd->getDirtyRects();
+    DirtyRects previous = dirtyRects;
+    dirtyRects.reset();
+    widgets[index]->refresh();
+    widgetRects[index] = dirtyRects.getBounds();
+    dirtyRects.add(previous);
+  }
+  else {
+    memset(&widgetRects[index], 0, sizeof(DirtyRect));
+  }
+}
+
 Layout * loadLayout(const char * name, Layout::PersistentData * persistentData)
 {
   const LayoutFactory * factory = getLayoutFactory(name);
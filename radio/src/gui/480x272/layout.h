@@ -37,8 +37,11 @@ class Layout: public WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>
   public:
     Layout(const LayoutFactory * factory, PersistentData * persistentData):
       WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>(persistentData),
-      factory(factory)
+      factory(factory),
+      lastFrame(0),
+      fullRefreshNeeded(true)
     {
+      memset(widgetRects, 0, sizeof(widgetRects));
     }
 
     inline const LayoutFactory * getFactory() const
@@ -50,8 +53,34 @@ class Layout: public WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>
     {
     }
 
+    virtual void refresh();
+
+    // Redraws only the decorations and the widgets which changed, over what
+    // the previous frame of this layout left in the LCD buffer. Returns false
+    // when it's not possible, nothing is drawn then
+    bool refreshPartial();
+
   protected:
     const LayoutFactory * factory;
+    uint32_t lastFrame;                         // lcdFramesCount when the layout was drawn
+    bool fullRefreshNeeded;
+    DirtyRects decorationRects;                 // drawn by drawDecorations() in the last frame
+    DirtyRect widgetRects[MAX_LAYOUT_ZONES];    // drawn by each widget in the last frame
+
+    // the panels drawn over the theme background (in a rectangle of the screen)
+    virtual void drawPanels(coord_t x, coord_t y, coord_t w, coord_t h)
+    {
+    }
+
+    // the top bar, flight mode, sliders and trims
+    virtual void drawDecorations()
+    {
+    }
+
+    bool isOverlapped(unsigned int index, const bool * changed) const;
+    void drawBackground(const DirtyRect & rect);
+    void refreshDecorations();
+    void refreshWidget(unsigned int index);
 };
 
 void registerLayout(const LayoutFactory * factory);
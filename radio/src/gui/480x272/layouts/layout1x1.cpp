@@ -65,13 +65,12 @@ class Layout1x1: public Layout
       return zone;
     }
 
-    virtual void refresh();
+  protected:
+    virtual void drawDecorations();
 };
 
-void Layout1x1::refresh()
+void Layout1x1::drawDecorations()
 {
-  theme->drawBackground();
-
   if (persistentData->options[0].boolValue) {
     drawTopBar();
   }
@@ -85,8 +84,6 @@ void Layout1x1::refresh()
     drawMainPots();
     drawTrims(mixerCurrentFlightMode);
   }
-
-  Layout::refresh();
 }
 
 BaseLayoutFactory<Layout1x1> layout1x1("Layout1x1", LBM_LAYOUT_1x1, OPTIONS_LAYOUT_1x1);
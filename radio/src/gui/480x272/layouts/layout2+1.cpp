@@ -65,13 +65,12 @@ class Layout2P1: public Layout
       return ZONES_LAYOUT_2P1[index];
     }
 
-    virtual void refresh();
+  protected:
+    virtual void drawDecorations();
 };
 
-void Layout2P1::refresh()
+void Layout2P1::drawDecorations()
 {
-  theme->drawBackground();
-
   if (persistentData->options[0].boolValue) {
     drawTopBar();
   }
@@ -95,8 +94,6 @@ void Layout2P1::refresh()
     // Trims
     drawTrims(mixerCurrentFlightMode);
   }
-
-  Layout::refresh();
 }
 
 BaseLayoutFactory<Layout2P1> layout2P1("Layout2P1", LBM_LAYOUT_2P1, OPTIONS_LAYOUT_2P1);
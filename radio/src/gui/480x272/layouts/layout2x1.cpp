@@ -64,18 +64,15 @@ class Layout2x1: public Layout
       return zone;
     }
 
-    virtual void refresh();
+  protected:
+    virtual void drawDecorations();
 };
 
-void Layout2x1::refresh()
+void Layout2x1::drawDecorations()
 {
-  theme->drawBackground();
-
   if (persistentData->options[0].boolValue) {
     drawTopBar();
   }
-
-  Layout::refresh();
 }
 
 BaseLayoutFactory<Layout2x1> Layout2x1("Layout2x1", LBM_LAYOUT_2x1, OPTIONS_LAYOUT_2x1);
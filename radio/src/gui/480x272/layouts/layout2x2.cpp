@@ -67,18 +67,15 @@ class Layout2x2: public Layout
       return zone;
     }
 
-    virtual void refresh();
+  protected:
+    virtual void drawDecorations();
 };
 
-void Layout2x2::refresh()
+void Layout2x2::drawDecorations()
 {
-  theme->drawBackground();
-
   if (persistentData->options[0].boolValue) {
     drawTopBar();
   }
-
-  Layout::refresh();
 }
 
 BaseLayoutFactory<Layout2x2> layout2x2("Layout2x2", LBM_LAYOUT_2x2, OPTIONS_LAYOUT_2x2);
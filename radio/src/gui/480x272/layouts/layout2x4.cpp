@@ -72,13 +72,42 @@ class Layout2x4: public Layout
       return zone;
     }
 
-    virtual void refresh();
+  protected:
+    virtual void drawPanels(coord_t x, coord_t y, coord_t w, coord_t h);
+    virtual void drawDecorations();
 };
 
-void Layout2x4::refresh()
+const Zone PANELS_LAYOUT_2x4[2] = {
+  { 50, 50, 180, 170 },
+  { 250, 50, 180, 170 }
+};
+
+// the part of a panel inside a rectangle
+static void drawPanel(coord_t x, coord_t y, coord_t w, coord_t h, const Zone & panel, uint32_t color)
+{
+  coord_t left = max<coord_t>(x, panel.x);
+  coord_t top = max<coord_t>(y, panel.y);
+  coord_t right = min<coord_t>(x + w, panel.x + panel.w);
+  coord_t bottom = min<coord_t>(y + h, panel.y + panel.h);
+  if (left < right && top < bottom) {
+    lcdSetColor(color);
+    lcdDrawSolidFilledRect(left, top, right - left, bottom - top, CUSTOM_COLOR);
+  }
+}
+
+void Layout2x4::drawPanels(coord_t x, coord_t y, coord_t w, coord_t h)
 {
-  theme->drawBackground();
+  if (persistentData->options[4].boolValue) {
+    drawPanel(x, y, w, h, PANELS_LAYOUT_2x4[0], persistentData->options[5].unsignedValue);
+  }
+
+  if (persistentData->options[6].boolValue) {
+    drawPanel(x, y, w, h, PANELS_LAYOUT_2x4[1], persistentData->options[7].unsignedValue);
+  }
+}
 
+void Layout2x4::drawDecorations()
+{
   if (persistentData->options[0].boolValue) {
     drawTopBar();
   }
@@ -102,18 +131,6 @@ void Layout2x4::refresh()
     // Trims
     drawTrims(mixerCurrentFlightMode);
   }
-
-  if (persistentData->options[4].boolValue) {
-    lcdSetColor(persistentData->options[5].unsignedValue);
-    lcdDrawSolidFilledRect(50, 50, 180, 170, CUSTOM_COLOR);
-  }
-
-  if (persistentData->options[6].boolValue) {
-    lcdSetColor(persistentData->options[7].unsignedValue);
-    lcdDrawSolidFilledRect(250, 50, 180, 170, CUSTOM_COLOR);
-  }
-
-  Layout::refresh();
 }
 
 BaseLayoutFactory<Layout2x4> layout2x4("Layout2x4", LBM_LAYOUT_2x4, OPTIONS_LAYOUT_2x4);
@@ -171,7 +171,22 @@ void lcdDrawNumber(coord_t x, coord_t y, int32_t val, LcdFlags flags, uint8_t le
   if (suffix) {
     strncpy(&str[32], suffix, 16);
   }
+  str[48] = '\0';
   flags &= ~LEADING0;
+
+  if (!(flags & (VERTICAL|ZCHAR))) {
+    // the number goes straight to the glyphs renderer, unless the prefix or suffix has position characters
+    uint8_t glyphs[48];
+    uint8_t count = 0;
+    for (const char * c = s; (uint8_t)*c >= 0x20; c++) {
+      glyphs[count++] = getMappedChar(*c);
+    }
+    if (s[count] == '\0') {
+      lcd->drawGlyphs(x, y, glyphs, count, flags);
+      return;
+    }
+  }
+
   lcdDrawText(x, y, s, flags);
 }
 
@@ -398,6 +413,7 @@ void lcdDrawPoint(coord_t x, coord_t y, LcdFlags att)
   display_t * p = PIXEL_PTR(x, y);
   display_t color = lcdColorTable[COLOR_IDX(att)];
   if (p < DISPLAY_END) {
+    lcd->markDirty(x, y, 1, 1);
     *p = color;
   }
 }
@@ -407,6 +423,34 @@ void lcdDrawBlackOverlay()
   lcdDrawFilledRect(0, 0, LCD_W, LCD_H, SOLID, OVERLAY_COLOR | OPACITY(8));
 }
 
+LcdFrameStats lcdFrameStats;
+uint32_t lcdFramesCount = 0;
+
+void LcdFrameStats::startFrame()
+{
+  frameStart = getTmr2MHz();
+  started = true;
+}
+
+// called by lcdRefresh() with the area written since the last frame
+void LcdFrameStats::endFrame(uint32_t area, bool partial)
+{
+  lcdFramesCount++;
+  frames++;
+  if (partial) {
+    partialFrames++;
+  }
+  dirtyArea += area;
+  if (started) {
+    uint16_t duration = (uint16_t)(getTmr2MHz() - frameStart) / 2;
+    drawTime += duration;
+    if (duration > maxDrawTime) {
+      maxDrawTime = duration;
+    }
+    started = false;
+  }
+}
+
 #if defined(SIMU)
 BitmapBuffer _lcd(BMP_RGB565, LCD_W, LCD_H, displayBuf);
 BitmapBuffer * lcd = &_lcd;
@@ -247,6 +247,44 @@ inline void lcdDrawBitmapPattern(coord_t x, coord_t y, const uint8_t * img, LcdF
   lcd->drawBitmapPattern(x, y, img, flags, offset, width);
 }
 
+// Statistics of the frames sent to the LCD, to measure what the partial refresh saves
+struct LcdFrameStats
+{
+  uint32_t frames;
+  uint32_t partialFrames;       // frames drawn over a copy of the previous one
+  uint64_t dirtyArea;           // unit 1 pixel
+  uint32_t drawTime;            // unit 1us
+  uint16_t maxDrawTime;         // unit 1us
+  uint16_t frameStart;          // unit 0.5us
+  bool started;
+
+  void reset()
+  {
+    memset(this, 0, sizeof(LcdFrameStats));
+  }
+
+  void startFrame();
+  void endFrame(uint32_t area, bool partial);
+
+  uint8_t partialPercent() const
+  {
+    return frames ? 100 * partialFrames / frames : 0;
+  }
+
+  uint8_t dirtyPercent() const
+  {
+    return frames ? 100 * dirtyArea / ((uint64_t)frames * DISPLAY_PIXELS_COUNT) : 0;
+  }
+
+  uint16_t averageDrawTime() const
+  {
+    return frames ? drawTime / frames : 0;
+  }
+};
+
+extern LcdFrameStats lcdFrameStats;
+extern uint32_t lcdFramesCount;
+
 #if defined(BOOT)
   #define BLINK_ON_PHASE               (0)
 #else
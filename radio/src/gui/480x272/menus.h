@@ -150,6 +150,7 @@ const uint8_t STATS_ICONS[] = {
   ICON_STATS,
   ICON_STATS_THROTTLE_GRAPH,
   ICON_STATS_TIMERS,
+  ICON_STATS_DEBUG,
   ICON_STATS_ANALOGS,
 #if defined(DEBUG_TRACE_BUFFER)
   ICON_STATS_DEBUG
@@ -207,6 +208,7 @@ enum MenuRadioIndexes
 {
   e_StatsGraph,
   e_StatsDebug,
+  e_StatsProfiler,
   e_StatsAnalogs,
 #if defined(DEBUG_TRACE_BUFFER)
   e_StatsTraces,
@@ -215,12 +217,14 @@ enum MenuRadioIndexes
 
 bool menuStatsGraph(event_t event);
 bool menuStatsDebug(event_t event);
+bool menuStatsProfiler(event_t event);
 bool menuStatsAnalogs(event_t event);
 bool menuStatsTraces(event_t event);
 
 static const MenuHandlerFunc menuTabStats[] PROGMEM = {
   menuStatsGraph,
   menuStatsDebug,
+  menuStatsProfiler,
   menuStatsAnalogs,
 #if defined(DEBUG_TRACE_BUFFER)
   menuStatsTraces,
@@ -219,6 +219,7 @@ bool menuModelWizard(event_t event)
 void onModelSelectMenu(const char * result)
 {
   if (result == STR_SELECT_MODEL) {
+    modelslist.saveCache();
     // we store the latest changes if any
     storageFlushCurrentModel();
     storageCheck(true);
@@ -240,6 +241,7 @@ void onModelSelectMenu(const char * result)
     selectMode = MODE_SELECT_MODEL;
     setCurrentModel(currentCategory->size() - 1);
 #if defined(LUA)
+    modelslist.saveCache();
     chainMenu(menuModelWizard);
 #endif
   }
@@ -357,6 +359,7 @@ bool menuModelSelect(event_t event)
           selectMode = MODE_SELECT_MODEL;
           break;
         case MODE_SELECT_MODEL:
+          modelslist.saveCache();
           chainMenu(menuMainView);
           return false;
       }
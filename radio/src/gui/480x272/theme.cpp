@@ -88,6 +88,11 @@ void Theme::drawBackground() const
   lcdDrawSolidFilledRect(0, 0, LCD_W, LCD_H, TEXT_BGCOLOR);
 }
 
+void Theme::drawPartialBackground(coord_t x, coord_t y, coord_t w, coord_t h) const
+{
+  lcdDrawSolidFilledRect(x, y, w, h, TEXT_BGCOLOR);
+}
+
 void Theme::drawMessageBox(const char * title, const char * text, const char * action, uint32_t type) const
 {
   //if (flags & MESSAGEBOX_TYPE_ALERT) {
@@ -71,6 +71,15 @@ class Theme
 
     virtual void drawBackground() const;
 
+    // Themes which can draw any part of their background allow the main view
+    // to redraw only what changed
+    virtual bool hasPartialBackground() const
+    {
+      return true;
+    }
+
+    virtual void drawPartialBackground(coord_t x, coord_t y, coord_t w, coord_t h) const;
+
     virtual void drawTopbarBackground(uint8_t icon) const = 0;
 
     virtual void drawMenuIcon(uint8_t index, uint8_t position, bool selected) const { }
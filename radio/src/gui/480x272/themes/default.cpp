@@ -290,6 +290,17 @@ class DefaultTheme: public Theme
       }
     }
 
+    virtual void drawPartialBackground(coord_t x, coord_t y, coord_t w, coord_t h) const
+    {
+      if (backgroundBitmap) {
+        lcd->drawBitmap(x, y, backgroundBitmap, x, y, w, h);
+      }
+      else {
+        lcdSetColor(g_eeGeneral.themeData.options[0].unsignedValue);
+        lcdDrawSolidFilledRect(x, y, w, h, CUSTOM_COLOR);
+      }
+    }
+
     virtual void drawTopbarBackground(uint8_t icon) const
     {
       if (topleftBitmap) {
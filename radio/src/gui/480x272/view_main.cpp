@@ -201,8 +201,11 @@ bool menuMainView(event_t event)
 
   for (uint8_t i=0; i<MAX_CUSTOM_SCREENS; i++) {
     if (customScreens[i]) {
-      if (i == g_model.view)
-        customScreens[i]->refresh();
+      if (i == g_model.view) {
+        // without event only the widgets which changed are redrawn
+        if (event || !customScreens[i]->refreshPartial())
+          customScreens[i]->refresh();
+      }
       else
         customScreens[i]->background();
     }
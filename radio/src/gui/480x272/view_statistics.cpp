@@ -100,9 +100,14 @@ bool menuStatsDebug(event_t event)
   {
     case EVT_KEY_FIRST(KEY_ENTER):
       maxMixerDuration  = 0;
+      mixerProfiler.reset();
+      lcdFrameStats.reset();
 #if defined(LUA)
       maxLuaInterval = 0;
       maxLuaDuration = 0;
+#endif
+#if defined(BINARY_LOGS)
+      binaryLogsOverruns = 0;
 #endif
       break;
   }
@@ -122,15 +127,37 @@ bool menuStatsDebug(event_t event)
   lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, mixerStack.available(), LEFT);
   lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+2*FH+1, "[Audio]", HEADER_COLOR|SMLSIZE);
   lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, audioStack.available(), LEFT);
+#if !defined(EEPROM)
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+2*FH+1, "[Storage]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, storageStack.available(), LEFT);
+#endif
 
   int line = 3;
 
 #if defined(DISK_CACHE)
   lcdDrawText(MENUS_MARGIN_LEFT, MENU_CONTENT_TOP+line*FH, "SD cache hits");
   lcdDrawNumber(MENU_STATS_COLUMN1, MENU_CONTENT_TOP+line*FH, diskCache.getHitRate(), PREC1|LEFT, 0, NULL, "%");
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[FS]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, diskCache.getHitRate(DISK_CACHE_ACCESS_FS), PREC1|LEFT, 0, NULL, "%");
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[Stream]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, diskCache.getHitRate(DISK_CACHE_ACCESS_STREAM), PREC1|LEFT, 0, NULL, "%");
+  ++line;
+#endif
+
+#if defined(BINARY_LOGS)
+  lcdDrawText(MENUS_MARGIN_LEFT, MENU_CONTENT_TOP+line*FH, "Logs lost");
+  lcdDrawNumber(MENU_STATS_COLUMN1, MENU_CONTENT_TOP+line*FH, binaryLogsOverruns, LEFT, 0, NULL, " records");
   ++line;
 #endif
 
+  lcdDrawText(MENUS_MARGIN_LEFT, MENU_CONTENT_TOP+line*FH, "LCD partial");
+  lcdDrawNumber(MENU_STATS_COLUMN1, MENU_CONTENT_TOP+line*FH, lcdFrameStats.partialPercent(), LEFT, 0, NULL, "%");
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[Dirty]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, lcdFrameStats.dirtyPercent(), LEFT, 0, NULL, "%");
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[Draw]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, lcdFrameStats.averageDrawTime(), LEFT, 0, NULL, "us");
+  ++line;
+
 #if defined(LUA)
   lcdDrawText(MENUS_MARGIN_LEFT, MENU_CONTENT_TOP+line*FH, "Lua duration");
   lcdDrawNumber(MENU_STATS_COLUMN1, MENU_CONTENT_TOP+line*FH, 10*maxLuaDuration, LEFT, 0, NULL, "ms");
@@ -146,6 +173,67 @@ bool menuStatsDebug(event_t event)
   return true;
 }
 
+#define MENU_PROFILER_COL_LAST     (MENUS_MARGIN_LEFT + 140)
+#define MENU_PROFILER_COL_AVG      (MENUS_MARGIN_LEFT + 190)
+#define MENU_PROFILER_COL_MAX      (MENUS_MARGIN_LEFT + 240)
+#define MENU_PROFILER_COL_HISTO    (MENUS_MARGIN_LEFT + 260)
+#define MENU_PROFILER_HISTO_WIDTH  (LCD_W - MENU_PROFILER_COL_HISTO - MENUS_MARGIN_LEFT)
+#define MENU_PROFILER_BAR_WIDTH    (MENU_PROFILER_HISTO_WIDTH / MIXER_HISTOGRAM_BUCKETS)
+
+void drawMixerHistogram(coord_t y, const char * name, const MixerHistogram & histogram, LcdFlags flags=0)
+{
+  lcdDrawText(MENUS_MARGIN_LEFT, y, name, flags);
+  lcdDrawNumber(MENU_PROFILER_COL_LAST, y, histogram.last, RIGHT);
+  lcdDrawNumber(MENU_PROFILER_COL_AVG, y, histogram.average(), RIGHT);
+  lcdDrawNumber(MENU_PROFILER_COL_MAX, y, histogram.max, RIGHT);
+
+  uint16_t highest = 0;
+  for (uint8_t i=0; i<MIXER_HISTOGRAM_BUCKETS; i++) {
+    highest = max(highest, histogram.buckets[i]);
+  }
+  if (highest) {
+    for (uint8_t i=0; i<MIXER_HISTOGRAM_BUCKETS; i++) {
+      coord_t h = (FH-6) * histogram.buckets[i] / highest;
+      if (h == 0 && histogram.buckets[i]) h = 1;
+      lcdDrawSolidFilledRect(MENU_PROFILER_COL_HISTO + i*MENU_PROFILER_BAR_WIDTH, y+FH-3-h, MENU_PROFILER_BAR_WIDTH-2, h, TEXT_COLOR);
+    }
+  }
+}
+
+bool menuStatsProfiler(event_t event)
+{
+  switch(event)
+  {
+    case EVT_KEY_FIRST(KEY_ENTER):
+      mixerProfiler.reset();
+      break;
+  }
+
+  MENU("Mixer", STATS_ICONS, menuTabStats, e_StatsProfiler, 0, { 0 });
+
+  // all durations in us
+  lcdDrawText(MENU_PROFILER_COL_LAST, MENU_TITLE_TOP+2, "Last", RIGHT|MENU_TITLE_COLOR);
+  lcdDrawText(MENU_PROFILER_COL_AVG, MENU_TITLE_TOP+2, "Avg", RIGHT|MENU_TITLE_COLOR);
+  lcdDrawText(MENU_PROFILER_COL_MAX, MENU_TITLE_TOP+2, "Max", RIGHT|MENU_TITLE_COLOR);
+  lcdDrawText(MENU_PROFILER_COL_HISTO, MENU_TITLE_TOP+2, "64us", MENU_TITLE_COLOR);
+  lcdDrawText(MENU_PROFILER_COL_HISTO + MENU_PROFILER_HISTO_WIDTH, MENU_TITLE_TOP+2, "4ms", RIGHT|MENU_TITLE_COLOR);
+
+  coord_t y = MENU_CONTENT_TOP;
+  for (uint8_t i=0; i<MIXER_STAGES_COUNT; i++) {
+    drawMixerHistogram(y, mixerStageNames[i], mixerProfiler.stages[i], i==MIXER_STAGE_TOTAL ? BOLD : 0);
+    y += FH;
+  }
+  drawMixerHistogram(y, "Jitter", mixerProfiler.jitter);
+  y += FH;
+
+  lcdDrawText(MENUS_MARGIN_LEFT, y, "Missed deadlines");
+  lcdDrawNumber(MENU_PROFILER_COL_MAX, y, mixerProfiler.missedDeadlines, RIGHT);
+
+  lcdDrawText(LCD_W/2, MENU_FOOTER_TOP+2, STR_MENUTORESET, CENTERED);
+
+  return true;
+}
+
 bool menuStatsAnalogs(event_t event)
 {
   MENU("Analogs", STATS_ICONS, menuTabStats, e_StatsAnalogs, 0, { 0 });
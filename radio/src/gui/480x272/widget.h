@@ -63,6 +63,13 @@ class Widget
 
     virtual void refresh() = 0;
 
+    // Returns false when what the widget displays didn't change since its
+    // last refresh(), so that its zone doesn't need to be redrawn
+    virtual bool isRefreshNeeded()
+    {
+      return true;
+    }
+
     virtual void background()
     {
     }
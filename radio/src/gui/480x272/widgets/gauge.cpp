@@ -24,13 +24,22 @@ class GaugeWidget: public Widget
 {
   public:
     GaugeWidget(const WidgetFactory * factory, const Zone & zone, Widget::PersistentData * persistentData):
-      Widget(factory, zone, persistentData)
+      Widget(factory, zone, persistentData),
+      lastValue(0)
     {
     }
 
     virtual void refresh();
 
+    virtual bool isRefreshNeeded()
+    {
+      return getValue(persistentData->options[0].unsignedValue) != lastValue;
+    }
+
     static const ZoneOption options[];
+
+  protected:
+    int32_t lastValue;
 };
 
 const ZoneOption GaugeWidget::options[] = {
@@ -49,6 +58,7 @@ void GaugeWidget::refresh()
   uint16_t color = persistentData->options[3].unsignedValue;
 
   int32_t value = getValue(index);
+  lastValue = value;
   int32_t value_in_range = value;
   if (value < min)
     value_in_range = min;
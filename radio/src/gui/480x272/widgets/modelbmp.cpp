@@ -63,10 +63,15 @@ class ModelBitmapWidget: public Widget
       }
     }
 
+    virtual bool isRefreshNeeded()
+    {
+      return memcmp(bitmapFilename, g_model.header.bitmap, sizeof(g_model.header.bitmap)) != 0 ||
+             memcmp(modelName, g_model.header.name, sizeof(g_model.header.name)) != 0;
+    }
+
     virtual void refresh()
     {
-      if (memcmp(bitmapFilename, g_model.header.bitmap, sizeof(g_model.header.bitmap)) != 0 ||
-          memcmp(modelName, g_model.header.name, sizeof(g_model.header.name)) != 0) {
+      if (isRefreshNeeded()) {
         refreshBuffer();
         memcpy(bitmapFilename, g_model.header.bitmap, sizeof(g_model.header.bitmap));
         memcpy(modelName, g_model.header.name, sizeof(g_model.header.name));
@@ -28,12 +28,23 @@ class OutputsWidget: public Widget
 {
   public:
     OutputsWidget(const WidgetFactory * factory, const Zone & zone, Widget::PersistentData * persistentData):
-      Widget(factory, zone, persistentData)
+      Widget(factory, zone, persistentData),
+      shownChannels(0)
     {
     }
 
     virtual void refresh();
 
+    virtual bool isRefreshNeeded()
+    {
+      for (uint8_t i = 0; i < MAX_OUTPUT_CHANNELS; i++) {
+        if ((shownChannels & (1u << i)) && calcRESXto100(channelOutputs[i]) != lastValues[i]) {
+          return true;
+        }
+      }
+      return false;
+    }
+
     uint8_t drawChannels(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t firstChan, bool bg_shown, uint16_t bg_color)
     {
       char chanString[] = "CH32";
@@ -43,6 +54,8 @@ class OutputsWidget: public Widget
 
       for (uint8_t curChan = firstChan; curChan < lastChan && curChan < 33; curChan++) {
         int16_t chanVal = calcRESXto100(channelOutputs[curChan-1]);
+        lastValues[curChan-1] = chanVal;
+        shownChannels |= (1u << (curChan-1));
         if (bg_shown) {
           lcdSetColor(bg_color);
           lcdDrawSolidFilledRect(x + RECT_BORDER, y + RECT_BORDER + (curChan - firstChan) * row_height, RECT_WIDTH , row_height - RECT_BORDER, CUSTOM_COLOR);
@@ -85,6 +98,10 @@ class OutputsWidget: public Widget
     }
 
     static const ZoneOption options[];
+
+  protected:
+    uint32_t shownChannels;
+    int16_t lastValues[MAX_OUTPUT_CHANNELS];
 };
 
 const ZoneOption OutputsWidget::options[] = {
@@ -97,6 +114,7 @@ const ZoneOption OutputsWidget::options[] = {
 
 void OutputsWidget::refresh()
 {
+  shownChannels = 0;
   if (zone.w > 300 && zone.h > 20)
     twoColumns();
   else if (zone.w > 150 && zone.h > 20)
@@ -32,6 +32,12 @@ class TextWidget: public Widget
 
     virtual void refresh();
 
+    virtual bool isRefreshNeeded()
+    {
+      // the options only change in the screens setup
+      return false;
+    }
+
     static const ZoneOption options[];
 };
 
@@ -24,13 +24,22 @@ class TimerWidget: public Widget
 {
   public:
     TimerWidget(const WidgetFactory * factory, const Zone & zone, Widget::PersistentData * persistentData):
-      Widget(factory, zone, persistentData)
+      Widget(factory, zone, persistentData),
+      lastValue(0)
     {
     }
 
     virtual void refresh();
 
+    virtual bool isRefreshNeeded()
+    {
+      return timersStates[persistentData->options[0].unsignedValue].val != lastValue;
+    }
+
     static const ZoneOption options[];
+
+  protected:
+    tmrval_t lastValue;
 };
 
 const ZoneOption TimerWidget::options[] = {
@@ -43,6 +52,7 @@ void TimerWidget::refresh()
   uint32_t index = persistentData->options[0].unsignedValue;
   TimerData & timerData = g_model.timers[index];
   TimerState & timerState = timersStates[index];
+  lastValue = timerState.val;
 
   if (zone.w >= 180 && zone.h >= 70) {
     if (timerState.val >= 0 || !(timerState.val % 2)) {
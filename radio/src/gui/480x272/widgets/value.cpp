@@ -24,13 +24,27 @@ class ValueWidget: public Widget
 {
   public:
     ValueWidget(const WidgetFactory * factory, const Zone & zone, Widget::PersistentData * persistentData):
-      Widget(factory, zone, persistentData)
+      Widget(factory, zone, persistentData),
+      lastValue(0),
+      lastAlarm(false)
     {
     }
 
     virtual void refresh();
 
+    virtual bool isRefreshNeeded();
+
     static const ZoneOption options[];
+
+  protected:
+    int32_t lastValue;
+    bool lastAlarm;
+
+    static bool isTelemetryAlarm(mixsrc_t field)
+    {
+      TelemetryItem & telemetryItem = telemetryItems[(field-MIXSRC_FIRST_TELEM)/3]; // TODO macro to convert a source to a telemetry index
+      return !telemetryItem.isAvailable() || telemetryItem.isOld();
+    }
 };
 
 const ZoneOption ValueWidget::options[] = {
@@ -39,12 +53,35 @@ const ZoneOption ValueWidget::options[] = {
   { NULL, ZoneOption::Bool }
 };
 
+bool ValueWidget::isRefreshNeeded()
+{
+  mixsrc_t field = persistentData->options[0].unsignedValue;
+
+  if (field >= MIXSRC_FIRST_TELEM) {
+    uint8_t unit = g_model.telemetrySensors[(field-MIXSRC_FIRST_TELEM)/3].unit;
+    if (unit == UNIT_GPS || unit == UNIT_DATETIME || unit == UNIT_TEXT) {
+      return true;
+    }
+    if (isTelemetryAlarm(field) != lastAlarm) {
+      return true;
+    }
+  }
+#if defined(INTERNAL_GPS)
+  else if (field == MIXSRC_TX_GPS) {
+    return true;
+  }
+#endif
+
+  return getValue(field) != lastValue;
+}
+
 void ValueWidget::refresh()
 {
   const int NUMBERS_PADDING = 4;
 
   mixsrc_t field = persistentData->options[0].unsignedValue;
   lcdSetColor(persistentData->options[1].unsignedValue);
+  lastValue = getValue(field);
   
   int x = zone.x;
   int y = zone.y;
@@ -105,8 +142,8 @@ void ValueWidget::refresh()
   }
 
   if (field >= MIXSRC_FIRST_TELEM) {
-    TelemetryItem & telemetryItem = telemetryItems[(field-MIXSRC_FIRST_TELEM)/3]; // TODO macro to convert a source to a telemetry index
-    if (!telemetryItem.isAvailable() || telemetryItem.isOld()) {
+    lastAlarm = isTelemetryAlarm(field);
+    if (lastAlarm) {
       lcdSetColor(ALARM_COLOR_INDEX);
     }
   }
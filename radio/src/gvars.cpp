@@ -48,6 +48,11 @@ void setGVarValue(uint8_t idx, int8_t value)
 uint8_t gvarDisplayTimer = 0;
 uint8_t gvarLastChanged = 0;
 
+#if defined(CPUARM)
+int16_t gvarValues[MAX_FLIGHT_MODES][MAX_GVARS];
+bool gvarValuesDirty = true;
+#endif
+
 uint8_t getGVarFlightMode(uint8_t fm, uint8_t gv) // TODO change params order to be consistent!
 {
   for (uint8_t i=0; i<MAX_FLIGHT_MODES; i++) {
@@ -61,6 +66,20 @@ uint8_t getGVarFlightMode(uint8_t fm, uint8_t gv) // TODO change params order to
   return 0;
 }
 
+#if defined(CPUARM)
+void updateGVarValues()
+{
+  // cleared first, a change during the update will trigger a new one
+  gvarValuesDirty = false;
+
+  for (uint8_t fm=0; fm<MAX_FLIGHT_MODES; fm++) {
+    for (uint8_t gv=0; gv<MAX_GVARS; gv++) {
+      gvarValues[fm][gv] = GVAR_VALUE(gv, getGVarFlightMode(fm, gv));
+    }
+  }
+}
+#endif
+
 int16_t getGVarValue(int8_t gv, int8_t fm)
 {
   int8_t mul = 1;
@@ -68,23 +87,28 @@ int16_t getGVarValue(int8_t gv, int8_t fm)
     gv = -1-gv;
     mul = -1;
   }
+#if defined(CPUARM)
+  return getResolvedGVarValue(gv, fm) * mul;
+#else
   return GVAR_VALUE(gv, getGVarFlightMode(fm, gv)) * mul;
+#endif
 }
 
 int32_t getGVarValuePrec1(int8_t gv, int8_t fm)
 {
-  int8_t mul;
-  uint8_t prec = g_model.gvars[gv].prec;
-  if (prec == 0)
-    mul = 10;
-  else
-    mul = 1;
-
+  int8_t mul = 1;
   if (gv < 0) {
     gv = -1-gv;
-    mul = -mul;
+    mul = -1;
+  }
+  if (g_model.gvars[gv].prec == 0) {
+    mul *= 10;
   }
+#if defined(CPUARM)
+  return getResolvedGVarValue(gv, fm) * mul;
+#else
   return GVAR_VALUE(gv, getGVarFlightMode(fm, gv)) * mul;
+#endif
 }
 
 void setGVarValue(uint8_t gv, int16_t value, int8_t fm)
@@ -57,10 +57,30 @@
     #define GET_GVAR_PREC1(x, min, max, fm) getGVarFieldValuePrec1(x, min, max, fm)
     extern uint8_t gvarDisplayTimer;
     extern uint8_t gvarLastChanged;
+    #if defined(CPUARM)
+      // The GVAR values of each flight mode, with the "use the value of
+      // flight mode N" links resolved. The table is rebuilt on the first
+      // read after a change of the model (storageDirty(EE_MODEL))
+      extern int16_t gvarValues[MAX_FLIGHT_MODES][MAX_GVARS];
+      extern bool gvarValuesDirty;
+      void updateGVarValues();
+      inline void invalidateGVarValues()
+      {
+        gvarValuesDirty = true;
+      }
+      inline int16_t getResolvedGVarValue(uint8_t gv, uint8_t fm)
+      {
+        if (gvarValuesDirty) {
+          updateGVarValues();
+        }
+        return gvarValues[fm][gv];
+      }
+    #endif
   #endif
 #else
   #define GET_GVAR(x, ...)             (x)
   #define GET_GVAR_PREC1(x, ...)       (x*10)
+  #define invalidateGVarValues()
 #endif
 
 #if defined(CPUARM)
@@ -35,6 +35,59 @@ void writeHeader();
 
 #define GET_3POS_STATE(sw) (switchState(SW_ ## sw ## 0) ? -1 : (switchState(SW_ ## sw ## 2) ? 1 : 0))
 
+#if defined(PCBX7)
+  #define STR_SWITCHES_LOG_HEADER  "SA,SB,SC,SD,SF,SH"
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  #define STR_SWITCHES_LOG_HEADER  "SA,SB,SC,SD,SE,SF,SG,SH"
+#else
+  #define STR_SWITCHES_LOG_HEADER  "THR,RUD,ELE,3POS,AIL,GEA,TRN"
+#endif
+
+#define MAX_LOG_SWITCHES           8
+
+#if defined(BINARY_LOGS)
+#include "binary_logs.h"
+
+#define BINARY_LOGS_BUFFER_SECTORS   4
+#define BINARY_LOGS_BUFFER_SIZE      (BINARY_LOGS_BUFFER_SECTORS * BINARY_LOGS_SECTOR_SIZE)
+#define BINARY_LOGS_MAX_VALUES       (1 + 2*MAX_TELEMETRY_SENSORS + NUM_STICKS+NUM_POTS+NUM_SLIDERS + MAX_LOG_SWITCHES + 2 + 1)
+
+// records are written to this ring by logsWrite(), and flushed to the
+// file by whole sectors by logsFlush(), once per menus cycle. The header is
+// written to the file directly, it can be bigger than the ring
+static uint8_t binaryLogsBuffer[BINARY_LOGS_BUFFER_SIZE] __DMA;
+static uint32_t binaryLogsWriteIndex;
+static uint32_t binaryLogsFlushIndex;
+static bool binaryLogsError;
+static int32_t binaryLogsValues[BINARY_LOGS_MAX_VALUES];
+static uint8_t binaryLogsValuesCount;
+static uint8_t binaryLogsRecords;
+static tmr10ms_t binaryLogsStartTime;
+static uint8_t binaryLogsSensors[MAX_TELEMETRY_SENSORS];
+static uint8_t binaryLogsSensorsCount;
+uint16_t binaryLogsOverruns;
+
+static void binaryLogsWriteHeader(const void * data, uint32_t size)
+{
+  UINT written;
+  if (!binaryLogsError && (f_write(&g_oLogFile, data, size, &written) != FR_OK || written != size)) {
+    binaryLogsError = true;
+  }
+}
+
+// the ring is empty when the header is written
+static void binaryLogsWritePadding(uint32_t size)
+{
+  memclear(binaryLogsBuffer, size);
+  binaryLogsWriteHeader(binaryLogsBuffer, size);
+}
+#endif
+
+
+#if defined(BINARY_LOGS)
+uint8_t getSwitchesLogStates(int8_t * states);
+uint32_t getLogicalSwitchesStates(uint8_t first);
+#endif
 
 void logsInit()
 {
@@ -104,9 +157,29 @@ const pm_char * logsOpen()
     return SDCARD_ERROR(result);
   }
 
+#if defined(BINARY_LOGS)
+  binaryLogsWriteIndex = 0;
+  binaryLogsFlushIndex = 0;
+  binaryLogsError = false;
+
+  // a new session starts on a sector boundary
+  uint32_t padding = f_size(&g_oLogFile) % BINARY_LOGS_SECTOR_SIZE;
+  if (padding) {
+    binaryLogsWritePadding(BINARY_LOGS_SECTOR_SIZE - padding);
+  }
+
+  writeHeader();
+
+  if (binaryLogsError) {
+    f_close(&g_oLogFile);
+    g_oLogFile.obj.fs = 0;
+    return SDCARD_ERROR(FR_DISK_ERR);
+  }
+#else
   if (f_size(&g_oLogFile) == 0) {
     writeHeader();
   }
+#endif
 
   return NULL;
 }
@@ -116,6 +189,11 @@ tmr10ms_t lastLogTime = 0;
 void logsClose()
 {
   if (sdMounted()) {
+#if defined(BINARY_LOGS)
+    if (g_oLogFile.obj.fs) {
+      logsFlush(true);
+    }
+#endif
     if (f_close(&g_oLogFile) != FR_OK) {
       // close failed, forget file
       g_oLogFile.obj.fs = 0;
@@ -132,6 +210,130 @@ getvalue_t getConvertedTelemetryValue(getvalue_t val, uint8_t unit)
 }
 #endif
 
+#if defined(CPUARM) && defined(TELEMETRY_FRSKY)
+void getSensorLogLabel(char * label, const TelemetrySensor & sensor)
+{
+  memset(label, 0, TELEM_LABEL_LEN+1);
+  zchar2str(label, sensor.label, TELEM_LABEL_LEN);
+  uint8_t unit = sensor.unit;
+  if (unit == UNIT_CELLS ) unit = UNIT_VOLTS;
+  if (UNIT_RAW < unit && unit < UNIT_FIRST_VIRTUAL) {
+    strcat(label, "(");
+    strncat(label, STR_VTELEMUNIT+1+3*unit, 3);
+    strcat(label, ")");
+  }
+}
+#endif
+
+// the name of the analog in STR_VSRCRAW, without its symbol when it has one
+void getAnalogLogLabel(char * label, uint8_t index)
+{
+  uint8_t len = pgm_read_byte(STR_VSRCRAW);
+  const pm_char * p = STR_VSRCRAW + 1 + (index+1) * len;
+  if (pgm_read_byte(p) >= 0x80) {
+    p++;
+    len--;
+  }
+  uint8_t j = 0;
+  for (; j<len && pgm_read_byte(p+j); ++j) {
+    label[j] = pgm_read_byte(p+j);
+  }
+  label[j] = '\0';
+}
+
+#if defined(BINARY_LOGS)
+static void binaryLogsAppend(const void * data, uint32_t size)
+{
+  const uint8_t * src = (const uint8_t *)data;
+  while (size--) {
+    binaryLogsBuffer[binaryLogsWriteIndex++ % BINARY_LOGS_BUFFER_SIZE] = *src++;
+  }
+}
+
+static void binaryLogsAppendColumn(const char * label, uint8_t type, uint8_t prec=0)
+{
+  BinaryLogsColumn column;
+  memset(&column, 0, sizeof(column));
+  strncpy(column.label, label, BINARY_LOGS_LABEL_LEN);
+  column.type = type;
+  column.prec = prec;
+  binaryLogsWriteHeader(&column, sizeof(column));
+  binaryLogsValuesCount += getBinaryLogsColumnWidth(type);
+}
+
+void writeHeader()
+{
+  binaryLogsSensorsCount = 0;
+#if defined(TELEMETRY_FRSKY)
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    if (isTelemetryFieldAvailable(i) && g_model.telemetrySensors[i].logs) {
+      binaryLogsSensors[binaryLogsSensorsCount++] = i;
+    }
+  }
+#endif
+
+  int8_t switches[MAX_LOG_SWITCHES];
+  uint8_t switchesCount = getSwitchesLogStates(switches);
+  uint8_t columnsCount = binaryLogsSensorsCount + NUM_STICKS+NUM_POTS+NUM_SLIDERS + switchesCount + 2;
+  uint32_t headerSize = sizeof(BinaryLogsHeader) + columnsCount * sizeof(BinaryLogsColumn);
+
+  BinaryLogsHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BINARY_LOGS_MAGIC, sizeof(header.magic));
+  header.version = BINARY_LOGS_VERSION;
+  header.headerSectors = (headerSize + BINARY_LOGS_SECTOR_SIZE - 1) / BINARY_LOGS_SECTOR_SIZE;
+  header.columnsCount = columnsCount;
+  binaryLogsStartTime = get_tmr10ms();
+#if defined(RTCLOCK)
+  header.flags = BINARY_LOGS_RTC;
+  header.startTime = g_rtcTime;
+  header.startTime10ms = g_ms100;
+#else
+  header.startTime = binaryLogsStartTime;
+#endif
+  binaryLogsWriteHeader(&header, sizeof(header));
+
+  // the first value is the time
+  binaryLogsValuesCount = 1;
+
+  char label[BINARY_LOGS_LABEL_LEN+1];
+#if defined(TELEMETRY_FRSKY)
+  for (int i=0; i<binaryLogsSensorsCount; i++) {
+    TelemetrySensor & sensor = g_model.telemetrySensors[binaryLogsSensors[i]];
+    getSensorLogLabel(label, sensor);
+    if (sensor.unit == UNIT_GPS)
+      binaryLogsAppendColumn(label, BINARY_LOGS_COLUMN_GPS);
+    else if (sensor.unit == UNIT_DATETIME)
+      binaryLogsAppendColumn(label, BINARY_LOGS_COLUMN_DATETIME);
+    else
+      binaryLogsAppendColumn(label, BINARY_LOGS_COLUMN_VALUE, sensor.prec);
+  }
+#endif
+
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    getAnalogLogLabel(label, i);
+    binaryLogsAppendColumn(label, BINARY_LOGS_COLUMN_VALUE);
+  }
+
+  const char * p = STR_SWITCHES_LOG_HEADER;
+  for (uint8_t i=0; i<switchesCount; i++) {
+    uint8_t len = 0;
+    while (p[len] && p[len] != ',') len++;
+    memcpy(label, p, len);
+    label[len] = '\0';
+    p += len + 1;
+    binaryLogsAppendColumn(label, BINARY_LOGS_COLUMN_VALUE);
+  }
+
+  binaryLogsAppendColumn("LSW", BINARY_LOGS_COLUMN_HEX64);
+  binaryLogsAppendColumn("TxBat(V)", BINARY_LOGS_COLUMN_VALUE, 1);
+
+  // records start on a sector boundary
+  binaryLogsWritePadding(header.headerSectors*BINARY_LOGS_SECTOR_SIZE - headerSize);
+
+  binaryLogsRecords = 0;
+}
+#else
 void writeHeader()
 {
 #if defined(RTCLOCK)
@@ -163,15 +365,7 @@ void writeHeader()
     if (isTelemetryFieldAvailable(i)) {
       TelemetrySensor & sensor = g_model.telemetrySensors[i];
       if (sensor.logs) {
-        memset(label, 0, sizeof(label));
-        zchar2str(label, sensor.label, TELEM_LABEL_LEN);
-        uint8_t unit = sensor.unit;
-        if (unit == UNIT_CELLS ) unit = UNIT_VOLTS;
-        if (UNIT_RAW < unit && unit < UNIT_FIRST_VIRTUAL) {
-          strcat(label, "(");
-          strncat(label, STR_VTELEMUNIT+1+3*unit, 3);
-          strcat(label, ")");
-        }
+        getSensorLogLabel(label, sensor);
         strcat(label, ",");
         f_puts(label, &g_oLogFile);
       }
@@ -180,28 +374,56 @@ void writeHeader()
 #endif
 #endif
 
-#if defined(PCBTARANIS) || defined(PCBHORUS)
-  for (uint8_t i=1; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS+1; i++) {
-    const char * p = STR_VSRCRAW + i * STR_VSRCRAW[0] + 2;
-    for (uint8_t j=0; j<STR_VSRCRAW[0]-1; ++j) {
-      if (!*p) break;
-      f_putc(*p, &g_oLogFile);
-      ++p;
-    }
+  char analogLabel[8];
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    getAnalogLogLabel(analogLabel, i);
+    f_puts(analogLabel, &g_oLogFile);
     f_putc(',', &g_oLogFile);
   }
-#if defined(PCBX7)
-  #define STR_SWITCHES_LOG_HEADER  "SA,SB,SC,SD,SF,SH"
-#else
-  #define STR_SWITCHES_LOG_HEADER  "SA,SB,SC,SD,SE,SF,SG,SH"
-#endif
+#if defined(PCBTARANIS) || defined(PCBHORUS)
   f_puts(STR_SWITCHES_LOG_HEADER ",LSW,", &g_oLogFile);
 #else
-  f_puts("Rud,Ele,Thr,Ail,P1,P2,P3,THR,RUD,ELE,3POS,AIL,GEA,TRN,", &g_oLogFile);
+  f_puts(STR_SWITCHES_LOG_HEADER ",", &g_oLogFile);
 #endif
 
   f_puts("TxBat(V)\n", &g_oLogFile);
 }
+#endif
+
+#if defined(BINARY_LOGS)
+uint8_t getSwitchesLogStates(int8_t * states)
+{
+  uint8_t count = 0;
+#if defined(PCBFLAMENCO)
+  states[count++] = GET_3POS_STATE(SA);
+  states[count++] = GET_3POS_STATE(SB);
+  states[count++] = GET_2POS_STATE(SE);
+  states[count++] = GET_3POS_STATE(SF);
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  states[count++] = GET_3POS_STATE(SA);
+  states[count++] = GET_3POS_STATE(SB);
+  states[count++] = GET_3POS_STATE(SC);
+  states[count++] = GET_3POS_STATE(SD);
+#if !defined(PCBX7)
+  states[count++] = GET_3POS_STATE(SE);
+#endif
+  states[count++] = GET_2POS_STATE(SF);
+#if !defined(PCBX7)
+  states[count++] = GET_3POS_STATE(SG);
+#endif
+  states[count++] = GET_2POS_STATE(SH);
+#else
+  states[count++] = GET_2POS_STATE(THR);
+  states[count++] = GET_2POS_STATE(RUD);
+  states[count++] = GET_2POS_STATE(ELE);
+  states[count++] = GET_3POS_STATE(ID);
+  states[count++] = GET_2POS_STATE(AIL);
+  states[count++] = GET_2POS_STATE(GEA);
+  states[count++] = GET_2POS_STATE(TRN);
+#endif
+  return count;
+}
+#endif
 
 uint32_t getLogicalSwitchesStates(uint8_t first)
 {
@@ -212,6 +434,109 @@ uint32_t getLogicalSwitchesStates(uint8_t first)
   return result;
 }
 
+#if defined(BINARY_LOGS)
+static void binaryLogsWriteRecord(tmr10ms_t tmr10ms)
+{
+  int32_t values[BINARY_LOGS_MAX_VALUES];
+  uint8_t count = 0;
+
+  values[count++] = tmr10ms - binaryLogsStartTime;
+
+#if defined(TELEMETRY_FRSKY)
+  for (int i=0; i<binaryLogsSensorsCount; i++) {
+    TelemetrySensor & sensor = g_model.telemetrySensors[binaryLogsSensors[i]];
+    TelemetryItem & telemetryItem = telemetryItems[binaryLogsSensors[i]];
+    if (sensor.unit == UNIT_GPS) {
+      values[count++] = telemetryItem.gps.latitude;
+      values[count++] = telemetryItem.gps.longitude;
+    }
+    else if (sensor.unit == UNIT_DATETIME) {
+      values[count++] = BINARY_LOGS_DATETIME(telemetryItem.datetime.year, telemetryItem.datetime.month, telemetryItem.datetime.day, telemetryItem.datetime.hour, telemetryItem.datetime.min, telemetryItem.datetime.sec);
+    }
+    else {
+      values[count++] = telemetryItem.value;
+    }
+  }
+#endif
+
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    values[count++] = calibratedStick[i];
+  }
+
+  int8_t switches[MAX_LOG_SWITCHES];
+  uint8_t switchesCount = getSwitchesLogStates(switches);
+  for (uint8_t i=0; i<switchesCount; i++) {
+    values[count++] = switches[i];
+  }
+
+  values[count++] = getLogicalSwitchesStates(32);
+  values[count++] = getLogicalSwitchesStates(0);
+  values[count++] = g_vbat100mV;
+
+  // a delta record as long as all the deltas fit in 16 bits
+  uint8_t type = BINARY_LOGS_DELTA;
+  if (binaryLogsRecords == 0) {
+    type = BINARY_LOGS_KEYFRAME;
+  }
+  else {
+    for (uint8_t i=0; i<count; i++) {
+      int32_t delta = values[i] - binaryLogsValues[i];
+      if (delta < INT16_MIN || delta > INT16_MAX) {
+        type = BINARY_LOGS_KEYFRAME;
+        break;
+      }
+    }
+  }
+
+  uint32_t size = 1 + count * (type == BINARY_LOGS_KEYFRAME ? sizeof(int32_t) : sizeof(int16_t));
+  if (binaryLogsWriteIndex - binaryLogsFlushIndex + size > BINARY_LOGS_BUFFER_SIZE) {
+    // the SD card doesn't keep up, the next record will be relative to the last written one
+    binaryLogsOverruns++;
+    return;
+  }
+
+  binaryLogsAppend(&type, 1);
+  if (type == BINARY_LOGS_KEYFRAME) {
+    binaryLogsAppend(values, count * sizeof(int32_t));
+    binaryLogsRecords = 0;
+  }
+  else {
+    for (uint8_t i=0; i<count; i++) {
+      int16_t delta = values[i] - binaryLogsValues[i];
+      binaryLogsAppend(&delta, sizeof(delta));
+    }
+  }
+
+  memcpy(binaryLogsValues, values, count * sizeof(int32_t));
+  if (++binaryLogsRecords >= BINARY_LOGS_KEYFRAME_PERIOD) {
+    binaryLogsRecords = 0;
+  }
+}
+
+// writes one sector (or everything when closing) from the ring to the file
+void logsFlush(bool all)
+{
+  if (!g_oLogFile.obj.fs || binaryLogsError) {
+    return;
+  }
+
+  do {
+    uint32_t size = binaryLogsWriteIndex - binaryLogsFlushIndex;
+    if (size > BINARY_LOGS_SECTOR_SIZE)
+      size = BINARY_LOGS_SECTOR_SIZE;
+    else if (size == 0 || (size < BINARY_LOGS_SECTOR_SIZE && !all))
+      return;
+    UINT written;
+    FRESULT result = f_write(&g_oLogFile, &binaryLogsBuffer[binaryLogsFlushIndex % BINARY_LOGS_BUFFER_SIZE], size, &written);
+    if (result != FR_OK || written != size) {
+      binaryLogsError = true;
+      return;
+    }
+    binaryLogsFlushIndex += size;
+  } while (all);
+}
+#endif
+
 void logsWrite()
 {
   static const pm_char * error_displayed = NULL;
@@ -232,6 +557,15 @@ void logsWrite()
         }
       }
 
+#if defined(BINARY_LOGS)
+      binaryLogsWriteRecord(tmr10ms);
+
+      if (binaryLogsError && !error_displayed) {
+        error_displayed = STR_SDCARD_ERROR;
+        POPUP_WARNING(STR_SDCARD_ERROR);
+        logsClose();
+      }
+#else
 #if defined(RTCLOCK)
       {
         static struct gtm utm;
@@ -384,6 +718,7 @@ void logsWrite()
         POPUP_WARNING(STR_SDCARD_ERROR);
         logsClose();
       }
+#endif
     }
   }
   else {
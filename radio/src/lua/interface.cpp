@@ -29,10 +29,13 @@
 
 extern "C" {
   #include <lundump.h>
+  #include <lstate.h>
 }
 
 #define PERMANENT_SCRIPTS_MAX_INSTRUCTIONS (10000/100)
 #define MANUAL_SCRIPTS_MAX_INSTRUCTIONS    (20000/100)
+#define PERMANENT_SCRIPTS_TIME_SLICE       (2000*2)     // 2ms per script and per cycle (2MHz ticks)
+#define LUA_FULL_GC_THRESHOLD              (8*1024)     // memory growth (bytes) before a full GC cycle
 #define LUA_WARNING_INFO_LEN               64
 
 lua_State *lsScripts = NULL;
@@ -45,6 +48,8 @@ uint16_t maxLuaInterval = 0;
 uint16_t maxLuaDuration = 0;
 bool luaLcdAllowed;
 int instructionsPercent = 0;
+bool luaTimeSlicing = false;
+uint16_t luaTimeSliceStart;
 char lua_warning_info[LUA_WARNING_INFO_LEN+1];
 struct our_longjmp * global_lj = 0;
 
@@ -68,6 +73,10 @@ void luaHook(lua_State * L, lua_Debug *ar)
     lua_sethook(L, luaHook, LUA_MASKLINE, 0);
     luaL_error(L, "");
   }
+  else if (luaTimeSlicing && L->nny == 0 && (uint16_t)(getTmr2MHz() - luaTimeSliceStart) >= PERMANENT_SCRIPTS_TIME_SLICE) {
+    // the script has used its time slice, it will be resumed at the next cycle
+    lua_yield(L, 0);
+  }
 }
 
 void luaSetInstructionsLimit(lua_State * L, int count)
@@ -210,6 +219,11 @@ void luaFree(lua_State * L, ScriptInternalData & sid)
       luaL_unref(L, LUA_REGISTRYINDEX, sid.background);
       sid.background = 0;
     }
+    if (sid.thread) {
+      luaL_unref(L, LUA_REGISTRYINDEX, sid.thread);
+      sid.thread = 0;
+      sid.coroutine = NULL;
+    }
   }
   else {
     luaDisable();
@@ -219,6 +233,19 @@ void luaFree(lua_State * L, ScriptInternalData & sid)
   luaDoGc(L);
 }
 
+static uint8_t luaLoadStatusToScriptState(int lstatus)
+{
+  if (lstatus == LUA_OK) {
+    return SCRIPT_OK;
+  } else if (lstatus == LUA_ERRFILE) {
+    return SCRIPT_NOFILE;
+  } else if (lstatus == LUA_ERRSYNTAX) {
+    return SCRIPT_SYNTAX_ERROR;
+  } else {  //  LUA_ERRMEM or LUA_ERRGCMM
+    return SCRIPT_PANIC;
+  }
+}
+
 #if defined(LUA_COMPILER)
 /// callback for luaU_dump()
 static int luaDumpWriter(lua_State * L, const void* p, size_t size, void* u)
@@ -256,6 +283,494 @@ static void luaDumpState(lua_State * L, const char * filename, const FILINFO * f
   } else
     TRACE_ERROR("luaDumpState(%s): Error: Could not open output file.", filename);
 }
+
+/*
+  Bytecode cache
+
+  The scripts loaded together (the permanent scripts of a model, the themes
+  and widgets) are compiled once and saved in a single cache file:
+    LuaCacheHeader
+    LuaCacheEntry[count]
+    bytecode of each entry, in the entries order
+
+  Each entry keeps a hash of its source, computed while the source is
+  compiled. The cache also keeps a signature of each directory holding its
+  scripts (the names, sizes and dates of the directory files): a directory is
+  listed once when its first script is loaded, and while its signature is
+  unchanged its scripts are loaded without reading their sources. Otherwise
+  a source is read and hashed, and only compiled again if its hash changed.
+
+  The cache is only used by a firmware with the same Lua ABI (the luaU_header()
+  bytes). The scripts compiled since the cache was opened are kept in a
+  temporary file, and the cache is rewritten when it's closed, only if its
+  content changed.
+*/
+
+#define LUA_CACHE_MAGIC          "LCAC"
+#define LUA_CACHE_VERSION        3
+#define LUA_CACHE_MAX_ENTRIES    32
+#define LUA_CACHE_STRIPPED       0x01
+#define LUA_CACHE_TEMP_EXT       ".tmp"
+#define LUA_CACHE_NEW_EXT        ".new"
+#define LUA_CACHE_NAME_MAXLEN    (LEN_FILE_PATH_MAX + 32)
+
+PACK(struct LuaCacheHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t abi[LUAC_HEADERSIZE];
+  uint8_t count;
+  uint8_t directoriesCount;
+});
+
+PACK(struct LuaCacheDirectory {
+  uint32_t name;        // hash of the directory path
+  uint32_t signature;   // hash of the names, sizes and dates of its files
+});
+
+PACK(struct LuaCacheEntry {
+  uint32_t name;        // hash of the script path
+  uint32_t directory;   // hash of the directory path
+  uint32_t source;      // hash of the script source
+  uint32_t size;        // bytecode size
+  uint8_t flags;
+});
+
+enum LuaCacheOrigin {
+  LUA_CACHE_ORIGIN_FILE,
+  LUA_CACHE_ORIGIN_TEMP,
+};
+
+struct LuaCacheItem {
+  LuaCacheEntry entry;
+  uint32_t offset;
+  uint8_t origin;
+};
+
+struct LuaScriptsCache {
+  char path[LUA_CACHE_NAME_MAXLEN];    // without extension
+  FIL file;             // the cache as it was opened
+  FIL temp;             // the bytecode compiled since then
+  FIL work;             // the sources being read, then the new cache
+  bool fileOpened;
+  bool tempOpened;
+  bool changed;         // a directory signature changed
+  uint8_t count;
+  uint8_t loadedCount;
+  uint8_t directoriesCount;
+  uint8_t listedCount;
+  LuaCacheItem items[LUA_CACHE_MAX_ENTRIES];
+  LuaCacheItem loaded[LUA_CACHE_MAX_ENTRIES];
+  LuaCacheDirectory directories[LUA_CACHE_MAX_ENTRIES];   // as in the cache
+  LuaCacheDirectory listed[LUA_CACHE_MAX_ENTRIES];        // as on the SD card
+  FIL * reader;
+  uint32_t remaining;
+  uint32_t sourceHash;
+  bool sourceComment;   // in the first line of the source, a comment
+  uint8_t buffer[256];
+};
+
+static LuaScriptsCache * luaScriptsCache = NULL;
+
+static uint32_t luaCacheHash(uint32_t hash, const uint8_t * data, uint32_t size)
+{
+  // FNV-1a
+  while (size--) {
+    hash = (hash ^ *data++) * 16777619u;
+  }
+  return hash;
+}
+
+static void luaCacheGetPath(char * path, const char * extension)
+{
+  strcpy(path, luaScriptsCache->path);
+  strcat(path, extension);
+}
+
+static const char * luaCacheReader(lua_State * L, void * ud, size_t * size)
+{
+  UNUSED(L);
+  LuaScriptsCache * cache = (LuaScriptsCache *)ud;
+  UINT read = 0;
+  if (cache->remaining == 0 || f_read(cache->reader, cache->buffer, min<uint32_t>(cache->remaining, sizeof(cache->buffer)), &read) != FR_OK || read == 0) {
+    *size = 0;
+    return NULL;
+  }
+  cache->remaining -= read;
+  *size = read;
+  return (const char *)cache->buffer;
+}
+
+/// callback for lua_load(), the source is hashed as it's read, the UTF-8 BOM
+/// and a first line comment are skipped as luaL_loadfilex() does
+static const char * luaCacheSourceReader(lua_State * L, void * ud, size_t * size)
+{
+  UNUSED(L);
+  LuaScriptsCache * cache = (LuaScriptsCache *)ud;
+  bool first = (f_tell(&cache->work) == 0);
+  UINT read = 0;
+  if (f_read(&cache->work, cache->buffer, sizeof(cache->buffer), &read) != FR_OK || read == 0) {
+    *size = 0;
+    return NULL;
+  }
+  cache->sourceHash = luaCacheHash(cache->sourceHash, cache->buffer, read);
+
+  uint8_t * ptr = cache->buffer;
+  uint8_t * end = ptr + read;
+  if (first) {
+    if (read >= 3 && !memcmp(ptr, "\xEF\xBB\xBF", 3)) {
+      ptr += 3;
+    }
+    cache->sourceComment = (ptr < end && *ptr == '#');
+  }
+  // the comment is blanked, the line numbers are kept
+  for (uint8_t * c = ptr; cache->sourceComment && c < end; c++) {
+    if (*c == '\n')
+      cache->sourceComment = false;
+    else
+      *c = ' ';
+  }
+
+  *size = end - ptr;
+  return (const char *)ptr;
+}
+
+static bool luaCacheHashSource(const char * filename, uint32_t & hash)
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  if (f_open(&cache->work, filename, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+    return false;
+  }
+  hash = 2166136261u;
+  UINT read;
+  while (f_read(&cache->work, cache->buffer, sizeof(cache->buffer), &read) == FR_OK && read > 0) {
+    hash = luaCacheHash(hash, cache->buffer, read);
+  }
+  f_close(&cache->work);
+  return true;
+}
+
+static LuaCacheDirectory * luaCacheFindDirectory(LuaCacheDirectory * directories, uint8_t count, uint32_t name)
+{
+  for (uint8_t i=0; i<count; i++) {
+    if (directories[i].name == name) {
+      return &directories[i];
+    }
+  }
+  return NULL;
+}
+
+/*
+  The directory of a script, listed the first time one of its scripts is
+  loaded. Returns true when it's unchanged since the cache was written.
+*/
+static bool luaCacheListDirectory(const char * filename, uint32_t & name)
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  const char * separator = strrchr(filename, '/');
+  uint32_t length = separator ? separator - filename : 0;
+  name = luaCacheHash(2166136261u, (const uint8_t *)filename, length);
+
+  LuaCacheDirectory * directory = luaCacheFindDirectory(cache->listed, cache->listedCount, name);
+  if (!directory) {
+    if (cache->listedCount >= LUA_CACHE_MAX_ENTRIES) {
+      return false;
+    }
+    char path[LEN_FILE_PATH_MAX + _MAX_LFN + 1];
+    if (length >= sizeof(path)) {
+      return false;
+    }
+    memcpy(path, filename, length);
+    path[length] = '\0';
+
+    DIR dir;
+    FILINFO info;
+    uint32_t signature = 2166136261u;
+    if (f_opendir(&dir, length ? path : "/") != FR_OK) {
+      return false;
+    }
+    while (f_readdir(&dir, &info) == FR_OK && info.fname[0]) {
+      signature = luaCacheHash(signature, (const uint8_t *)info.fname, strlen(info.fname));
+      signature = luaCacheHash(signature, (const uint8_t *)&info.fsize, sizeof(info.fsize));
+      signature = luaCacheHash(signature, (const uint8_t *)&info.fdate, sizeof(info.fdate));
+      signature = luaCacheHash(signature, (const uint8_t *)&info.ftime, sizeof(info.ftime));
+    }
+    f_closedir(&dir);
+
+    directory = &cache->listed[cache->listedCount++];
+    directory->name = name;
+    directory->signature = signature;
+  }
+
+  LuaCacheDirectory * cached = luaCacheFindDirectory(cache->directories, cache->directoriesCount, name);
+  return cached && cached->signature == directory->signature;
+}
+
+static LuaCacheItem * luaCacheFind(LuaCacheItem * items, uint8_t count, uint32_t name)
+{
+  for (uint8_t i=0; i<count; i++) {
+    if (items[i].entry.name == name) {
+      return &items[i];
+    }
+  }
+  return NULL;
+}
+
+static int luaCacheLoadItem(lua_State * L, const LuaCacheItem * item, const char * chunkname)
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  cache->reader = (item->origin == LUA_CACHE_ORIGIN_FILE ? &cache->file : &cache->temp);
+  cache->remaining = item->entry.size;
+  if (f_lseek(cache->reader, item->offset) != FR_OK) {
+    return LUA_ERRFILE;
+  }
+  return lua_load(L, luaCacheReader, cache, chunkname, "b");
+}
+
+void luaOpenScriptsCache(const char * name)
+{
+  luaCloseScriptsCache();
+
+  LuaScriptsCache * cache = (LuaScriptsCache *)malloc(sizeof(LuaScriptsCache));
+  if (!cache) {
+    return;
+  }
+  memset(cache, 0, sizeof(LuaScriptsCache));
+  strcpy(cache->path, SCRIPTS_CACHE_PATH "/");
+  strncat(cache->path, name, sizeof(cache->path) - sizeof(SCRIPTS_CACHE_PATH) - sizeof(LUA_CACHE_NEW_EXT) - 1);
+  luaScriptsCache = cache;
+
+  char path[LUA_CACHE_NAME_MAXLEN + sizeof(SCRIPTS_CACHE_EXT)];
+  luaCacheGetPath(path, SCRIPTS_CACHE_EXT);
+  if (f_open(&cache->file, path, FA_READ) != FR_OK) {
+    return;
+  }
+  cache->fileOpened = true;
+
+  LuaCacheHeader header;
+  uint8_t abi[LUAC_HEADERSIZE];
+  UINT read;
+  luaU_header(abi);
+  if (f_read(&cache->file, &header, sizeof(header), &read) != FR_OK || read != sizeof(header) ||
+      memcmp(header.magic, LUA_CACHE_MAGIC, sizeof(header.magic)) || header.version != LUA_CACHE_VERSION ||
+      memcmp(header.abi, abi, sizeof(abi)) || header.count > LUA_CACHE_MAX_ENTRIES || header.directoriesCount > LUA_CACHE_MAX_ENTRIES) {
+    TRACE("luaOpenScriptsCache(%s): cache ignored", path);
+    return;
+  }
+
+  // the directories follow the header, then the entries, then the bytecode
+  UINT size = header.directoriesCount * sizeof(LuaCacheDirectory);
+  if (f_read(&cache->file, cache->directories, size, &read) != FR_OK || read != size) {
+    TRACE("luaOpenScriptsCache(%s): cache ignored", path);
+    return;
+  }
+  uint32_t offset = sizeof(header) + size + header.count * sizeof(LuaCacheEntry);
+  for (uint8_t i=0; i<header.count; i++) {
+    LuaCacheItem & item = cache->items[i];
+    if (f_read(&cache->file, &item.entry, sizeof(LuaCacheEntry), &read) != FR_OK || read != sizeof(LuaCacheEntry)) {
+      TRACE("luaOpenScriptsCache(%s): cache ignored", path);
+      return;
+    }
+    item.offset = offset;
+    item.origin = LUA_CACHE_ORIGIN_FILE;
+    offset += item.entry.size;
+  }
+  cache->directoriesCount = header.directoriesCount;
+  cache->count = header.count;
+}
+
+static bool luaCacheCopy(FIL * source, uint32_t offset, uint32_t size)
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  if (f_lseek(source, offset) != FR_OK) {
+    return false;
+  }
+  while (size > 0) {
+    UINT count = min<uint32_t>(size, sizeof(cache->buffer));
+    UINT read, written;
+    if (f_read(source, cache->buffer, count, &read) != FR_OK || read != count ||
+        f_write(&cache->work, cache->buffer, count, &written) != FR_OK || written != count) {
+      return false;
+    }
+    size -= count;
+  }
+  return true;
+}
+
+static bool luaCacheWrite(const char * path)
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  if (f_open(&cache->work, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+    return false;
+  }
+
+  // the directories of the scripts loaded, as they were listed
+  LuaCacheDirectory directories[LUA_CACHE_MAX_ENTRIES];
+  uint8_t directoriesCount = 0;
+  for (uint8_t i=0; i<cache->listedCount; i++) {
+    for (uint8_t j=0; j<cache->loadedCount; j++) {
+      if (cache->loaded[j].entry.directory == cache->listed[i].name) {
+        directories[directoriesCount++] = cache->listed[i];
+        break;
+      }
+    }
+  }
+
+  LuaCacheHeader header;
+  memcpy(header.magic, LUA_CACHE_MAGIC, sizeof(header.magic));
+  header.version = LUA_CACHE_VERSION;
+  luaU_header(header.abi);
+  header.count = cache->loadedCount;
+  header.directoriesCount = directoriesCount;
+  UINT written;
+  UINT size = directoriesCount * sizeof(LuaCacheDirectory);
+  bool result = (f_write(&cache->work, &header, sizeof(header), &written) == FR_OK && written == sizeof(header) &&
+                 f_write(&cache->work, directories, size, &written) == FR_OK && written == size);
+  for (uint8_t i=0; result && i<cache->loadedCount; i++) {
+    result = (f_write(&cache->work, &cache->loaded[i].entry, sizeof(LuaCacheEntry), &written) == FR_OK && written == sizeof(LuaCacheEntry));
+  }
+  for (uint8_t i=0; result && i<cache->loadedCount; i++) {
+    const LuaCacheItem & item = cache->loaded[i];
+    result = luaCacheCopy(item.origin == LUA_CACHE_ORIGIN_FILE ? &cache->file : &cache->temp, item.offset, item.entry.size);
+  }
+
+  return (f_close(&cache->work) == FR_OK && result);
+}
+
+void luaCloseScriptsCache()
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  if (!cache) {
+    return;
+  }
+
+  char path[LUA_CACHE_NAME_MAXLEN + sizeof(SCRIPTS_CACHE_EXT)];
+  char newPath[LUA_CACHE_NAME_MAXLEN + sizeof(LUA_CACHE_NEW_EXT)];
+  luaCacheGetPath(path, SCRIPTS_CACHE_EXT);
+  luaCacheGetPath(newPath, LUA_CACHE_NEW_EXT);
+
+  // the cache is rewritten only when scripts were compiled or aren't used
+  // anymore, or when the directories changed
+  bool written = false;
+  if (cache->tempOpened || cache->changed || cache->loadedCount != cache->count) {
+    if (cache->loadedCount == 0) {
+      written = true;
+    }
+    else if (luaCacheWrite(newPath)) {
+      written = true;
+    }
+    else {
+      TRACE_ERROR("luaCloseScriptsCache(%s): Error: Could not write the cache.", path);
+      f_unlink(newPath);
+    }
+  }
+
+  if (cache->fileOpened) {
+    f_close(&cache->file);
+  }
+  if (cache->tempOpened) {
+    char tempPath[LUA_CACHE_NAME_MAXLEN + sizeof(LUA_CACHE_TEMP_EXT)];
+    luaCacheGetPath(tempPath, LUA_CACHE_TEMP_EXT);
+    f_close(&cache->temp);
+    f_unlink(tempPath);
+  }
+  if (written) {
+    f_unlink(path);
+    if (cache->loadedCount > 0) {
+      f_rename(newPath, path);
+      TRACE("luaCloseScriptsCache(%s): %d scripts saved", path, cache->loadedCount);
+    }
+  }
+
+  luaScriptsCache = NULL;
+  free(cache);
+}
+
+/*
+  Load a script source from the cache, or compile it and add it to the cache.
+  Returns -1 when the source doesn't exist, otherwise the lua_load() status.
+*/
+static int luaCacheLoadScript(lua_State * L, const char * filename, const char * lmode)
+{
+  LuaScriptsCache * cache = luaScriptsCache;
+  uint32_t name = luaCacheHash(2166136261u, (const uint8_t *)filename, strlen(filename));
+  uint32_t directory;
+  bool unchanged = luaCacheListDirectory(filename, directory);
+
+  // stripped bytecode, unless the debug info is needed
+  uint8_t flags = (strchr(lmode, 'd') || strchr(lmode, 'T')) ? 0 : LUA_CACHE_STRIPPED;
+
+  // a script already loaded (a script used by several functions), then the cache
+  LuaCacheItem * item = luaCacheFind(cache->loaded, cache->loadedCount, name);
+  bool loaded = (item != NULL);
+  if (!item && !strchr(lmode, 'c')) {
+    item = luaCacheFind(cache->items, cache->count, name);
+    if (item && !(unchanged && item->entry.directory == directory)) {
+      // the directory changed, the source is read to know if the script did
+      uint32_t source;
+      if (!luaCacheHashSource(filename, source)) {
+        return -1;
+      }
+      if (source == item->entry.source) {
+        item->entry.directory = directory;
+        cache->changed = true;
+      }
+      else {
+        item = NULL;
+      }
+    }
+  }
+  if (item && item->entry.flags == flags) {
+    int lstatus = luaCacheLoadItem(L, item, filename);
+    if (lstatus == LUA_OK) {
+      TRACE("luaLoadScriptFileToState(%s, %s): loaded from cache", filename, lmode);
+      if (!loaded && cache->loadedCount < LUA_CACHE_MAX_ENTRIES) {
+        cache->loaded[cache->loadedCount++] = *item;
+      }
+      return LUA_OK;
+    }
+    lua_pop(L, 1);
+  }
+
+  if (f_open(&cache->work, filename, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+    return -1;
+  }
+  cache->sourceHash = 2166136261u;
+  lua_pushfstring(L, "@%s", filename);
+  int lstatus = lua_load(L, luaCacheSourceReader, cache, lua_tostring(L, -1), NULL);
+  lua_remove(L, -2);
+  f_close(&cache->work);
+  if (lstatus != LUA_OK) {
+    return lstatus;
+  }
+
+  if (!loaded && cache->loadedCount < LUA_CACHE_MAX_ENTRIES) {
+    if (!cache->tempOpened) {
+      char path[LUA_CACHE_NAME_MAXLEN + sizeof(LUA_CACHE_TEMP_EXT)];
+      luaCacheGetPath(path, LUA_CACHE_TEMP_EXT);
+      f_mkdir(SCRIPTS_CACHE_PATH);
+      cache->tempOpened = (f_open(&cache->temp, path, FA_READ | FA_WRITE | FA_CREATE_ALWAYS) == FR_OK);
+    }
+    if (cache->tempOpened) {
+      uint32_t offset = f_tell(&cache->temp);
+      lua_lock(L);
+      int error = luaU_dump(L, getproto(L->top - 1), luaDumpWriter, &cache->temp, flags & LUA_CACHE_STRIPPED);
+      lua_unlock(L);
+      if (!error) {
+        LuaCacheItem & added = cache->loaded[cache->loadedCount++];
+        added.entry.name = name;
+        added.entry.directory = directory;
+        added.entry.source = cache->sourceHash;
+        added.entry.size = f_tell(&cache->temp) - offset;
+        added.entry.flags = flags;
+        added.offset = offset;
+        added.origin = LUA_CACHE_ORIGIN_TEMP;
+        TRACE("luaLoadScriptFileToState(%s, %s): compiled to cache", filename, lmode);
+      }
+    }
+  }
+
+  return LUA_OK;
+}
 #endif  // LUA_COMPILER
 
 /**
@@ -281,6 +796,9 @@ static void luaDumpState(lua_State * L, const char * filename, const FILINFO * f
     Add "d" to keep extra debug info in the compiled binary.
       Eg: "td", "btd", or "tcd" (no effect with just "b" or with "x").
 
+  When a scripts cache is opened (see luaOpenScriptsCache()), the modes allowing text and without "x" load
+   the bytecode of the source from the cache, and the .luac files are neither read nor written.
+
   @retval (int)
   SCRIPT_OK on success (LUA_OK)
   SCRIPT_NOFILE if file wasn't found for specified mode or Lua could not open file (LUA_ERRFILE)
@@ -327,6 +845,18 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
   }
   strncat(filenameFull, filename, fnamelen);
 
+  if (luaScriptsCache && strpbrk(lmode, "tT") && !strchr(lmode, 'x')) {
+    // the source is loaded from the cache (or added to it) instead of the .luac file
+    strcpy(filenameFull + fnamelen, SCRIPT_EXT);
+    lstatus = luaCacheLoadScript(L, filenameFull, lmode);
+    if (lstatus >= 0) {
+      if (lstatus != LUA_OK) {
+        TRACE_ERROR("luaLoadScriptFileToState(%s, %s): Error loading script: %s\n", filename, lmode, lua_tostring(L, -1));
+      }
+      return luaLoadStatusToScriptState(lstatus);
+    }
+  }
+
   // check if binary version exists
   strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
   frLuaC = f_stat(filenameFull, &fnoLuaC);
@@ -418,13 +948,7 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
 #endif
   else {
     TRACE_ERROR("luaLoadScriptFileToState(%s, %s): Error loading script: %s\n", filename, lmode, lua_tostring(L, -1));
-    if (lstatus == LUA_ERRFILE) {
-      ret = SCRIPT_NOFILE;
-    } else if (lstatus == LUA_ERRSYNTAX) {
-      ret = SCRIPT_SYNTAX_ERROR;
-    } else {  //  LUA_ERRMEM or LUA_ERRGCMM
-      ret = SCRIPT_PANIC;
-    }
+    ret = luaLoadStatusToScriptState(lstatus);
   }
 
   return ret;
@@ -585,12 +1109,8 @@ uint8_t isTelemetryScriptAvailable(uint8_t index)
   return SCRIPT_NOFILE;
 }
 
-void luaLoadPermanentScripts()
+static void luaLoadModelScripts()
 {
-  luaScriptsCount = 0;
-  memset(scriptInternalData, 0, sizeof(scriptInternalData));
-  memset(scriptInputsOutputs, 0, sizeof(scriptInputsOutputs));
-
   // Load model scripts
   for (int i=0; i<MAX_SCRIPTS; i++) {
     if (!luaLoadMixScript(i)) {
@@ -615,6 +1135,33 @@ void luaLoadPermanentScripts()
 #endif
 }
 
+void luaLoadPermanentScripts()
+{
+  luaScriptsCount = 0;
+  memset(scriptInternalData, 0, sizeof(scriptInternalData));
+  memset(scriptInputsOutputs, 0, sizeof(scriptInputsOutputs));
+
+#if defined(LUA_COMPILER)
+#if defined(PCBHORUS)
+  char name[LEN_MODEL_FILENAME+1];
+  strncpy(name, g_eeGeneral.currModelFilename, LEN_MODEL_FILENAME);
+  name[LEN_MODEL_FILENAME] = '\0';
+  char * extension = strrchr(name, '.');
+  if (extension) {
+    *extension = '\0';
+  }
+#else
+  char name[sizeof("model")+2];
+  strAppendUnsigned(strAppend(name, "model"), g_eeGeneral.currModel+1, 2);
+#endif
+  luaOpenScriptsCache(name);
+  luaLoadModelScripts();
+  luaCloseScriptsCache();
+#else
+  luaLoadModelScripts();
+#endif
+}
+
 void displayLuaError(const char * title)
 {
 #if !defined(COLORLCD)
@@ -743,6 +1290,17 @@ void luaDoOneRunStandalone(event_t evt)
           lcdDrawText(0, 7*FH, "GV Use: ");
           lcdDrawNumber(lcdLastPos, 7*FH, luaGetMemUsed(lsScripts), LEFT);
           lcdDrawChar(lcdLastPos, 7*FH, 'b');
+#if defined(USE_BIN_ALLOCATOR) && LCD_W >= 212
+          BinAllocatorStats stats;
+          binAllocatorGetStats(stats);
+          lcdDrawText(lcdLastPos+FW, 7*FH, "Bins ");
+          lcdDrawNumber(lcdLastPos, 7*FH, stats.usedBytes * 100 / stats.totalBytes, LEFT);
+          lcdDrawChar(lcdLastPos, 7*FH, '/');
+          lcdDrawNumber(lcdLastPos, 7*FH, stats.highWaterBytes * 100 / stats.totalBytes, LEFT);
+          lcdDrawText(lcdLastPos, 7*FH, "% F");
+          lcdDrawNumber(lcdLastPos, 7*FH, stats.fragmentation(), LEFT);
+          lcdDrawChar(lcdLastPos, 7*FH, '%');
+#endif
           lcdDrawSolidHorizontalLine(0, 7*FH-2, lcdLastPos+6, FORCE);
           lcdDrawVerticalLine(lcdLastPos+6, 7*FH-2, FH+2, SOLID, FORCE);
 #endif
@@ -781,28 +1339,83 @@ void luaDoOneRunStandalone(event_t evt)
   }
 }
 
+#if defined(SIMU) || defined(DEBUG)
+static const char * getPermanentScriptName(const ScriptInternalData & sid)
+{
+  if (sid.reference <= SCRIPT_MIX_LAST)
+    return g_model.scriptsData[sid.reference-SCRIPT_MIX_FIRST].file;
+  else if (sid.reference <= SCRIPT_FUNC_LAST)
+    return g_model.customFn[sid.reference-SCRIPT_FUNC_FIRST].play.name;
+#if defined(PCBTARANIS)
+  else
+    return g_model.frsky.screens[sid.reference-SCRIPT_TELEMETRY_FIRST].script.file;
+#else
+  else
+    return "";
+#endif
+}
+#endif
+
+// Runs the function pushed on the coroutine of the script, or resumes it,
+// until it returns or its time slice is over
+static int luaResumePermanentScript(ScriptInternalData & sid, int inputsCount, int outputsCount)
+{
+  int memory = luaGetMemUsed(lsScripts);
+  uint16_t start = getTmr2MHz();
+
+  instructionsPercent = sid.runInstructions;
+  lua_sethook(sid.coroutine, luaHook, LUA_MASKCOUNT, PERMANENT_SCRIPTS_MAX_INSTRUCTIONS);
+  luaTimeSliceStart = start;
+  luaTimeSlicing = true;
+  int status = lua_resume(sid.coroutine, lsScripts, inputsCount);
+  luaTimeSlicing = false;
+
+  if (status == LUA_OK) {
+    // the results are adjusted and moved to the main state, as lua_pcall() does
+    int top = lua_gettop(lsScripts);
+    lua_xmove(sid.coroutine, lsScripts, lua_gettop(sid.coroutine));
+    lua_settop(lsScripts, top + outputsCount);
+  }
+
+  sid.runTicks += (uint16_t)(getTmr2MHz() - start);
+  sid.runMemory += luaGetMemUsed(lsScripts) - memory;
+  sid.runInstructions = instructionsPercent;
+  if (sid.runSlices < 0xFFFF) {
+    sid.runSlices++;
+  }
+
+  return status;
+}
+
 bool luaDoOneRunPermanentScript(uint8_t evt, int i, uint32_t scriptType)
 {
   ScriptInternalData & sid = scriptInternalData[i];
   if (sid.state != SCRIPT_OK) return false;
 
-  luaSetInstructionsLimit(lsScripts, PERMANENT_SCRIPTS_MAX_INSTRUCTIONS);
+  uint8_t runType = 0;
   int inputsCount = 0;
 #if defined(SIMU) || defined(DEBUG)
-  const char *filename;
+  const char * filename = getPermanentScriptName(sid);
 #endif
   ScriptInputsOutputs * sio = NULL;
 #if SCRIPT_MIX_FIRST > 0
-  if ((scriptType & RUN_MIX_SCRIPT) && (sid.reference >= SCRIPT_MIX_FIRST && sid.reference <= SCRIPT_MIX_LAST)) {
+  if (sid.reference >= SCRIPT_MIX_FIRST && sid.reference <= SCRIPT_MIX_LAST) {
 #else
-  if ((scriptType & RUN_MIX_SCRIPT) && (sid.reference <= SCRIPT_MIX_LAST)) {
+  if (sid.reference <= SCRIPT_MIX_LAST) {
 #endif
-    ScriptData & sd = g_model.scriptsData[sid.reference-SCRIPT_MIX_FIRST];
     sio = &scriptInputsOutputs[sid.reference-SCRIPT_MIX_FIRST];
+  }
+
+  if (sid.runType) {
+    // the run started in a previous cycle is resumed
+    if (scriptType & sid.runType) {
+      runType = sid.runType;
+    }
+  }
+  else if ((scriptType & RUN_MIX_SCRIPT) && sio) {
+    ScriptData & sd = g_model.scriptsData[sid.reference-SCRIPT_MIX_FIRST];
+    runType = RUN_MIX_SCRIPT;
     inputsCount = sio->inputsCount;
-#if defined(SIMU) || defined(DEBUG)
-    filename = sd.file;
-#endif
     lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
     for (int j=0; j<sio->inputsCount; j++) {
       if (sio->inputs[j].type == 1)
@@ -813,49 +1426,81 @@ bool luaDoOneRunPermanentScript(uint8_t evt, int i, uint32_t scriptType)
   }
   else if ((scriptType & RUN_FUNC_SCRIPT) && (sid.reference >= SCRIPT_FUNC_FIRST && sid.reference <= SCRIPT_FUNC_LAST)) {
     CustomFunctionData & fn = g_model.customFn[sid.reference-SCRIPT_FUNC_FIRST];
-#if defined(SIMU) || defined(DEBUG)
-    filename = fn.play.name;
-#endif
-    if (getSwitch(fn.swtch))
+    if (getSwitch(fn.swtch)) {
+      runType = RUN_FUNC_SCRIPT;
       lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
-    else if (sid.background)
+    }
+    else if (sid.background) {
+      runType = RUN_FUNC_SCRIPT;
       lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.background);
-    else
-      return false;
+    }
   }
-  else {
 #if defined(PCBTARANIS)
-#if defined(SIMU) || defined(DEBUG)
-    TelemetryScriptData & script = g_model.frsky.screens[sid.reference-SCRIPT_TELEMETRY_FIRST].script;
-    filename = script.file;
+  else if ((scriptType & RUN_TELEM_BG_SCRIPT) && sid.reference >= SCRIPT_TELEMETRY_FIRST && sid.background) {
+    runType = RUN_TELEM_BG_SCRIPT;
+    lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.background);
+  }
+
+  // the foreground script draws the screen, it isn't sliced and is run in the
+  // main Lua state, even if its background function is suspended
+  if (!runType && (scriptType & RUN_TELEM_FG_SCRIPT) && (menuHandlers[0]==menuViewTelemetryFrsky && sid.reference==SCRIPT_TELEMETRY_FIRST+s_frsky_view)) {
+    runType = RUN_TELEM_FG_SCRIPT;
+    lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
+    lua_pushunsigned(lsScripts, evt);
+    inputsCount = 1;
+  }
 #endif
-    if ((scriptType & RUN_TELEM_FG_SCRIPT) && (menuHandlers[0]==menuViewTelemetryFrsky && sid.reference==SCRIPT_TELEMETRY_FIRST+s_frsky_view)) {
-      lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
-      lua_pushunsigned(lsScripts, evt);
-      inputsCount = 1;
+
+  if (!runType) {
+    return false;
+  }
+
+  int outputsCount = (runType == RUN_MIX_SCRIPT ? sio->outputsCount : 0);
+  uint32_t runTicks, runSlices;
+  int32_t runMemory;
+  int status;
+
+  if (runType == RUN_TELEM_FG_SCRIPT) {
+    runMemory = luaGetMemUsed(lsScripts);
+    uint16_t start = getTmr2MHz();
+    luaSetInstructionsLimit(lsScripts, PERMANENT_SCRIPTS_MAX_INSTRUCTIONS);
+    status = lua_pcall(lsScripts, inputsCount, outputsCount, 0);
+    runTicks = (uint16_t)(getTmr2MHz() - start);
+    runMemory = luaGetMemUsed(lsScripts) - runMemory;
+    runSlices = 1;
+  }
+  else {
+    if (!sid.runType) {
+      if (!sid.coroutine) {
+        sid.coroutine = lua_newthread(lsScripts);
+        sid.thread = luaL_ref(lsScripts, LUA_REGISTRYINDEX);
+      }
+      lua_xmove(lsScripts, sid.coroutine, inputsCount + 1);
+      sid.runType = runType;
+      sid.runInstructions = 0;
+      sid.runSlices = 0;
+      sid.runTicks = 0;
+      sid.runMemory = 0;
     }
-    else if ((scriptType & RUN_TELEM_BG_SCRIPT) && (sid.background)) {
-      lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.background);
+    status = luaResumePermanentScript(sid, inputsCount, outputsCount);
+    if (status == LUA_YIELD) {
+      return true;
     }
-    else {
-      return false;
-    }
-#else
-    return false;
-#endif
+    sid.runType = 0;
+    runTicks = sid.runTicks;
+    runMemory = sid.runMemory;
+    runSlices = sid.runSlices;
   }
 
-  if (lua_pcall(lsScripts, inputsCount, sio ? sio->outputsCount : 0, 0) == 0) {
-    if (sio) {
-      for (int j=sio->outputsCount-1; j>=0; j--) {
-        if (!lua_isnumber(lsScripts, -1)) {
-          sid.state = (instructionsPercent > 100 ? SCRIPT_KILLED : SCRIPT_SYNTAX_ERROR);
-          TRACE("Script %8s disabled", filename);
-          break;
-        }
-        sio->outputs[j].value = lua_tointeger(lsScripts, -1);
-        lua_pop(lsScripts, 1);
+  if (status == LUA_OK) {
+    for (int j=outputsCount-1; j>=0; j--) {
+      if (!lua_isnumber(lsScripts, -1)) {
+        sid.state = (instructionsPercent > 100 ? SCRIPT_KILLED : SCRIPT_SYNTAX_ERROR);
+        TRACE("Script %8s disabled", filename);
+        break;
       }
+      sio->outputs[j].value = lua_tointeger(lsScripts, -1);
+      lua_pop(lsScripts, 1);
     }
   }
   else {
@@ -864,7 +1509,7 @@ bool luaDoOneRunPermanentScript(uint8_t evt, int i, uint32_t scriptType)
       sid.state = SCRIPT_KILLED;
     }
     else {
-      TRACE("Script %8s error: %s", filename, lua_tostring(lsScripts, -1));
+      TRACE("Script %8s error: %s", filename, lua_tostring(runType == RUN_TELEM_FG_SCRIPT ? lsScripts : sid.coroutine, -1));
       sid.state = SCRIPT_SYNTAX_ERROR;
     }
   }
@@ -876,6 +1521,12 @@ bool luaDoOneRunPermanentScript(uint8_t evt, int i, uint32_t scriptType)
     if (instructionsPercent > sid.instructions) {
       sid.instructions = instructionsPercent;
     }
+    sid.lastRunTime = runTicks / 2;
+    if (sid.lastRunTime > sid.maxRunTime) {
+      sid.maxRunTime = sid.lastRunTime;
+    }
+    sid.lastRunMemory = runMemory;
+    sid.lastRunSlices = runSlices;
   }
   return true;
 }
@@ -899,8 +1550,11 @@ bool luaTask(event_t evt, uint8_t scriptType, bool allowLcdUsage)
       return false;
     }
     UNPROTECT_LUA();
+    luaDoGc(lsScripts);
   }
   else {
+    static int memoryAfterGc = 0;
+
     // run permanent scripts
     if (luaState & INTERPRETER_RELOAD_PERMANENT_SCRIPTS) {
       luaState = 0;
@@ -908,21 +1562,34 @@ bool luaTask(event_t evt, uint8_t scriptType, bool allowLcdUsage)
       if (luaState == INTERPRETER_PANIC) return false;
       luaLoadPermanentScripts();
       if (luaState == INTERPRETER_PANIC) return false;
+      memoryAfterGc = luaGetMemUsed(lsScripts);
     }
 
     for (int i=0; i<luaScriptsCount; i++) {
       PROTECT_LUA() {
-        scriptWasRun |= luaDoOneRunPermanentScript(evt, i, scriptType);
+        if (luaDoOneRunPermanentScript(evt, i, scriptType)) {
+          scriptWasRun = true;
+          // the garbage collection is spread between the scripts
+          lua_gc(lsScripts, LUA_GCSTEP, 0);
+        }
       }
       else {
         luaDisable();
         break;
       }
       UNPROTECT_LUA();
-      //todo gc step between scripts
+    }
+
+    // a full collection only when the incremental steps didn't keep up
+    int memory = luaGetMemUsed(lsScripts);
+    if (memory > memoryAfterGc + LUA_FULL_GC_THRESHOLD) {
+      luaDoGc(lsScripts);
+      memoryAfterGc = luaGetMemUsed(lsScripts);
+    }
+    else if (memory < memoryAfterGc) {
+      memoryAfterGc = memory;
     }
   }
-  luaDoGc(lsScripts);
   return scriptWasRun;
 }
 
@@ -98,6 +98,19 @@ struct ScriptInternalData {
   int run;
   int background;
   uint8_t instructions;
+  // the permanent scripts run in a coroutine, which yields when the script
+  // has used its time slice and is resumed at the next cycle
+  int thread;
+  lua_State * coroutine;
+  uint8_t runType;              // RUN_xxx_SCRIPT of the run in progress, 0 when none
+  uint8_t runInstructions;      // instructions of the run in progress, in % of the limit
+  uint16_t runSlices;           // saturates at 0xFFFF
+  uint16_t lastRunSlices;       // time slices used by the last complete run
+  uint32_t runTicks;
+  uint32_t lastRunTime;         // us
+  uint32_t maxRunTime;          // us
+  int32_t runMemory;
+  int32_t lastRunMemory;        // bytes allocated by the last complete run (net of the garbage collected meanwhile)
 };
 struct ScriptInputsOutputs {
   uint8_t inputsCount;
@@ -155,6 +168,10 @@ void luaRegisterLibraries(lua_State * L);
 void registerBitmapClass(lua_State * L);
 void luaSetInstructionsLimit(lua_State* L, int count);
 int luaLoadScriptFileToState(lua_State * L, const char * filename, const char * mode);
+#if defined(LUA_COMPILER)
+void luaOpenScriptsCache(const char * name);
+void luaCloseScriptsCache();
+#endif
 #else  // defined(LUA)
 #define luaInit()
 #define LUA_INIT_THEMES_AND_WIDGETS()
@@ -131,6 +131,11 @@ class LuaTheme: public Theme
       exec(drawBackgroundFunction);
     }
 
+    virtual bool hasPartialBackground() const
+    {
+      return false;
+    }
+
     virtual void drawTopbarBackground(uint8_t icon) const
     {
       exec(drawTopbarBackgroundFunction);
@@ -451,7 +456,13 @@ void luaInitThemesAndWidgets()
     }
     UNPROTECT_LUA();
     TRACE("lsWidgets %p", lsWidgets);
+#if defined(LUA_COMPILER)
+    luaOpenScriptsCache("WIDGETS");
+#endif
     luaLoadFiles(THEMES_PATH, luaLoadThemeCallback);
     luaLoadFiles(WIDGETS_PATH, luaLoadWidgetCallback);
+#if defined(LUA_COMPILER)
+    luaCloseScriptsCache();
+#endif
   }
 }
@@ -180,6 +180,7 @@ void guiMain(event_t evt)
   DEBUG_TIMER_START(debugTimerLcdRefreshWait);
   lcdRefreshWait();
   DEBUG_TIMER_STOP(debugTimerLcdRefreshWait);
+  lcdFrameStats.startFrame();
 
   // draw LCD from menus or from Lua script
   // run Lua scripts that use LCD
@@ -197,6 +198,7 @@ void guiMain(event_t evt)
   }
 #else
   lcdRefreshWait();   // WARNING: make sure no code above this line does any change to the LCD display buffer!
+  lcdFrameStats.startFrame();
 #endif
 
   if (!refreshNeeded) {
@@ -382,6 +384,7 @@ void perMain()
   logsWrite();
   handleUsbConnection();
   checkTrainerSettings();
+  UPDATE_MODEL_CURVES();
   periodicTick();
   DEBUG_TIMER_STOP(debugTimerPerMain1);
 
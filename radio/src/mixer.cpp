@@ -75,7 +75,7 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
         v = ovwrValue;
       }
       else {
-        v = getValue(ed->srcRaw);
+        v = getSnapshotValue(ed->srcRaw);
         if (ed->srcRaw >= MIXSRC_FIRST_TELEM && ed->scale > 0) {
           v = (v * 1024) / convertTelemValue(ed->srcRaw-MIXSRC_FIRST_TELEM+1, ed->scale);
         }
@@ -326,7 +326,7 @@ getvalue_t getValue(mixsrc_t i)
 
 #if defined(GVARS)
   else if (i <= MIXSRC_LAST_GVAR) {
-    return GVAR_VALUE(i-MIXSRC_GVAR1, getGVarFlightMode(mixerCurrentFlightMode, i - MIXSRC_GVAR1));
+    return getGVarValue(i - MIXSRC_GVAR1, mixerCurrentFlightMode);
   }
 #endif
 
@@ -582,12 +582,338 @@ int getSourceTrimValue(int source, int stickValue=0)
 }
 #endif
 
+#if defined(CPUARM)
+MixerPlan mixerPlan;
+bool mixerPlanDirty = true;
+
+bool isMixAlwaysDisabled(const MixData * md)
+{
+  // a disabled line with speed or delay still contributes to its channel
+  if (md->speedUp || md->speedDown || md->delayUp || md->delayDown)
+    return false;
+
+  if (md->swtch == SWSRC_OFF)
+    return true;
+
+  uint16_t allFlightModes = (1 << MAX_FLIGHT_MODES) - 1;
+  return (md->flightModes & allFlightModes) == allFlightModes;
+}
+
+#if defined(VIRTUAL_INPUTS)
+bool isGVarFlightModeDependent(uint8_t gv)
+{
+#if defined(GVARS)
+  for (uint8_t fm=1; fm<MAX_FLIGHT_MODES; fm++) {
+    if (getGVarFlightMode(fm, gv) != 0)
+      return true;
+  }
+#endif
+  return false;
+}
+
+bool isGVarFieldFlightModeDependent(int16_t value, int16_t min, int16_t max)
+{
+#if defined(GVARS)
+  if (GV_IS_GV_VALUE(value, min, max)) {
+    int8_t gv = GV_INDEX_CALCULATION(value, max);
+    return isGVarFlightModeDependent(gv < 0 ? -1-gv : gv);
+  }
+#endif
+  return false;
+}
+
+bool isCurveFlightModeDependent(const CurveRef & curve)
+{
+  if (curve.type == CURVE_REF_DIFF || curve.type == CURVE_REF_EXPO)
+    return isGVarFieldFlightModeDependent(curve.value, -100, 100);
+  else
+    return false;
+}
+
+bool isSwitchFlightModeDependent(swsrc_t swtch)
+{
+  // logical switches have one state per flight mode
+  swsrc_t idx = abs(swtch);
+  return (idx >= SWSRC_FIRST_LOGICAL_SWITCH && idx <= SWSRC_LAST_LOGICAL_SWITCH) ||
+         (idx >= SWSRC_FIRST_FLIGHT_MODE && idx <= SWSRC_LAST_FLIGHT_MODE);
+}
+
+bool areTrimsFlightModeDependent()
+{
+  for (uint8_t fm=1; fm<MAX_FLIGHT_MODES; fm++) {
+    for (uint8_t i=0; i<NUM_STICKS+NUM_AUX_TRIMS; i++) {
+      if (g_model.flightModeData[fm].trim[i].mode != 0)
+        return true;
+    }
+  }
+  return false;
+}
+
+bool isSourceFlightModeDependent(mixsrc_t source, bool trims)
+{
+  if (source >= MIXSRC_FIRST_INPUT && source <= MIXSRC_LAST_INPUT) {
+    uint8_t input = source - MIXSRC_FIRST_INPUT;
+    for (uint8_t i=0; i<MAX_EXPOS; i++) {
+      ExpoData * ed = expoAddress(i);
+      if (!EXPO_VALID(ed)) break;
+      if (ed->chn != input) continue;
+      if (ed->flightModes || isSwitchFlightModeDependent(ed->swtch))
+        return true;
+      if (isGVarFieldFlightModeDependent(ed->weight, MIN_EXPO_WEIGHT, 100) || isGVarFieldFlightModeDependent(ed->offset, -100, 100))
+        return true;
+      if (isCurveFlightModeDependent(ed->curve))
+        return true;
+      if (trims && ed->carryTrim <= TRIM_ON)
+        return true;
+      if (isSourceFlightModeDependent(ed->srcRaw, trims))
+        return true;
+    }
+    return false;
+  }
+  else if (source >= MIXSRC_FIRST_GVAR && source <= MIXSRC_LAST_GVAR) {
+    return isGVarFlightModeDependent(source - MIXSRC_FIRST_GVAR);
+  }
+  else if (source >= MIXSRC_FIRST_TRIM && source <= MIXSRC_LAST_TRIM) {
+    return trims;
+  }
+  else {
+    // the cyclic values depend on the swash sources
+    return (source >= MIXSRC_FIRST_HELI && source < MIXSRC_FIRST_TRIM) ||
+           (source >= MIXSRC_FIRST_LOGICAL_SWITCH && source <= MIXSRC_LAST_LOGICAL_SWITCH);
+  }
+}
+
+bool isMixFlightModeDependent(const MixData * md, bool trims)
+{
+  // delays are only handled in the current flight mode
+  if (md->flightModes || md->delayUp || md->delayDown || isSwitchFlightModeDependent(md->swtch))
+    return true;
+  if (isGVarFieldFlightModeDependent(md->weight, GV_RANGELARGE_NEG, GV_RANGELARGE) || isGVarFieldFlightModeDependent(md->offset, GV_RANGELARGE_NEG, GV_RANGELARGE))
+    return true;
+  if (isCurveFlightModeDependent(md->curve))
+    return true;
+  if (trims && md->carryTrim == 0 && ((md->srcRaw >= MIXSRC_Rud && md->srcRaw <= MIXSRC_Ail) || (md->srcRaw >= MIXSRC_FIRST_INPUT && md->srcRaw <= MIXSRC_LAST_INPUT)))
+    return true;
+  return isSourceFlightModeDependent(md->srcRaw, trims);
+}
+#endif
+
+void buildMixerPlan()
+{
+  MixerPlanItem items[MAX_MIXERS];
+  bitfield_channels_t dependencies[MAX_OUTPUT_CHANNELS];
+  bitfield_channels_t usedChannels = 0;
+  bitfield_channels_t fmChannels = 0;
+  uint8_t count = 0;
+#if defined(VIRTUAL_INPUTS)
+  bool trims = areTrimsFlightModeDependent();
+#endif
+
+  mixerPlanDirty = false;
+  memclear(dependencies, sizeof(dependencies));
+
+  for (uint8_t i=0; i<MAX_MIXERS; i++) {
+    MixData * md = mixAddress(i);
+
+    if (md->srcRaw == 0) break;
+
+    if (isMixAlwaysDisabled(md)) {
+      // same state as if the line had been evaluated
+      swOn[i].now = swOn[i].prev = 0;
+      swOn[i].delay = 0;
+      swOn[i].activeMix = 0;
+      continue;
+    }
+
+    MixerPlanItem & item = items[count++];
+    item.index = i;
+    item.destCh = md->destCh;
+    item.srcChannel = -1;
+    usedChannels |= (bitfield_channels_t)1 << md->destCh;
+
+#if defined(VIRTUAL_INPUTS)
+    if (isMixFlightModeDependent(md, trims))
+#endif
+    {
+      fmChannels |= (bitfield_channels_t)1 << md->destCh;
+    }
+
+    if (md->srcRaw >= MIXSRC_CH1 && md->srcRaw <= MIXSRC_LAST_CH) {
+      item.srcChannel = md->srcRaw - MIXSRC_CH1;
+      if (item.srcChannel != md->destCh) {
+        dependencies[md->destCh] |= (bitfield_channels_t)1 << item.srcChannel;
+      }
+    }
+  }
+
+  // Channels ordering, the lowest channel first among the ready ones, which
+  // keeps the lines order when no channel is used before being computed
+  bitfield_channels_t done = ~usedChannels;
+  uint8_t ordered = 0;
+  while (usedChannels & ~done) {
+    uint8_t ch = 0;
+    while (ch < MAX_OUTPUT_CHANNELS && ((done & ((bitfield_channels_t)1 << ch)) || (dependencies[ch] & ~done))) {
+      ch++;
+    }
+    if (ch == MAX_OUTPUT_CHANNELS) {
+      break; // loop between channels
+    }
+    for (uint8_t k=0; k<count; k++) {
+      if (items[k].destCh == ch) {
+        mixerPlan.items[ordered++] = items[k];
+      }
+    }
+    done |= (bitfield_channels_t)1 << ch;
+  }
+
+  mixerPlan.ordered = (ordered == count);
+  if (mixerPlan.ordered) {
+    // a channel using a flight mode dependent channel depends on the flight mode
+    bitfield_channels_t previous;
+    do {
+      previous = fmChannels;
+      for (uint8_t ch=0; ch<MAX_OUTPUT_CHANNELS; ch++) {
+        if (dependencies[ch] & fmChannels) {
+          fmChannels |= (bitfield_channels_t)1 << ch;
+        }
+      }
+    } while (fmChannels != previous);
+  }
+  else {
+    // fallback to the lines order, evaluated with several passes
+    memcpy(mixerPlan.items, items, count * sizeof(MixerPlanItem));
+    fmChannels = usedChannels;
+  }
+  mixerPlan.fmChannels = fmChannels;
+  mixerPlan.count = count;
+}
+#endif
+
+#if defined(CPUARM)
+SourcesSnapshot sourcesSnapshot;
+bool sourcesSnapshotDirty = true;
+
+// The sources whose value doesn't change during a mixer cycle. The sticks,
+// inputs, trims, GVARs, logical switches and cyclic values are computed again
+// for each flight mode evaluated, the other ones are direct array reads.
+bool isSnapshotSource(mixsrc_t source)
+{
+  return (source >= MIXSRC_FIRST_SWITCH && source <= MIXSRC_LAST_SWITCH) ||
+         (source >= MIXSRC_FIRST_TRAINER && source <= MIXSRC_LAST_CH) ||
+         (source >= MIXSRC_TX_VOLTAGE && source <= MIXSRC_LAST_TELEM);
+}
+
+void addSnapshotSource(mixsrc_t source)
+{
+  if (!isSnapshotSource(source) || sourcesSnapshot.count >= MAX_SNAPSHOT_SOURCES)
+    return;
+
+  uint8_t & index = sourcesSnapshot.index[source - MIXSRC_FIRST_SWITCH];
+  if (index == SNAPSHOT_NONE) {
+    index = sourcesSnapshot.count++;
+    sourcesSnapshot.sources[index] = source;
+  }
+}
+
+void addSnapshotFunctionsSources(const CustomFunctionData * functions)
+{
+  for (uint8_t i=0; i<MAX_SPECIAL_FUNCTIONS; i++) {
+    const CustomFunctionData * cfn = &functions[i];
+    if (CFN_EMPTY(cfn))
+      continue;
+    switch (CFN_FUNC(cfn)) {
+#if defined(GVARS)
+      case FUNC_ADJUST_GVAR:
+        if (CFN_GVAR_MODE(cfn) == FUNC_ADJUST_GVAR_SOURCE)
+          addSnapshotSource(CFN_PARAM(cfn));
+        break;
+#endif
+#if defined(MASTER_VOLUME)
+      case FUNC_VOLUME:
+#endif
+      case FUNC_PLAY_VALUE:
+        addSnapshotSource(CFN_PARAM(cfn));
+        break;
+    }
+  }
+}
+
+void buildSourcesSnapshot()
+{
+  sourcesSnapshotDirty = false;
+  sourcesSnapshot.valid = false;
+  sourcesSnapshot.count = 0;
+  memset(sourcesSnapshot.index, SNAPSHOT_NONE, sizeof(sourcesSnapshot.index));
+
+  for (uint8_t i=0; i<MAX_MIXERS; i++) {
+    MixData * md = mixAddress(i);
+    if (md->srcRaw == 0) break;
+    addSnapshotSource(md->srcRaw);
+  }
+
+#if defined(VIRTUAL_INPUTS)
+  for (uint8_t i=0; i<MAX_EXPOS; i++) {
+    ExpoData * ed = expoAddress(i);
+    if (!EXPO_VALID(ed)) break;
+    addSnapshotSource(ed->srcRaw);
+  }
+#endif
+
+  for (uint8_t i=0; i<MAX_LOGICAL_SWITCHES; i++) {
+    LogicalSwitchData * ls = lswAddress(i);
+    uint8_t family = lswFamily(ls->func);
+    if (ls->func == LS_FUNC_NONE)
+      continue;
+    if (family == LS_FAMILY_OFS || family == LS_FAMILY_DIFF || family == LS_FAMILY_COMP)
+      addSnapshotSource(ls->v1);
+    if (family == LS_FAMILY_COMP)
+      addSnapshotSource(ls->v2);
+  }
+
+#if defined(HELI) && defined(VIRTUAL_INPUTS)
+  addSnapshotSource(g_model.swashR.elevatorSource);
+  addSnapshotSource(g_model.swashR.aileronSource);
+  addSnapshotSource(g_model.swashR.collectiveSource);
+#endif
+
+  addSnapshotFunctionsSources(g_model.customFn);
+  if (!g_model.noGlobalFunctions) {
+    addSnapshotFunctionsSources(g_eeGeneral.customFn);
+  }
+}
+
+void fillSourcesSnapshot()
+{
+  if (sourcesSnapshotDirty) {
+    buildSourcesSnapshot();
+  }
+
+  for (uint8_t i=0; i<sourcesSnapshot.count; i++) {
+    sourcesSnapshot.values[i] = getValue(sourcesSnapshot.sources[i]);
+  }
+
+  sourcesSnapshot.valid = true;
+}
+#endif
+
 uint8_t mixerCurrentFlightMode;
+#if defined(CPUARM)
+void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms, bitfield_channels_t channels)
+#else
 void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
+#endif
 {
+  MIXER_PROFILE_START(MIXER_STAGE_INPUTS);
   evalInputs(mode);
+  MIXER_PROFILE_STOP(MIXER_STAGE_INPUTS);
+
+  if (tick10ms) {
+    MIXER_PROFILE_START(MIXER_STAGE_LOGICAL_SWITCHES);
+    evalLogicalSwitches(mode==e_perout_mode_normal);
+    MIXER_PROFILE_STOP(MIXER_STAGE_LOGICAL_SWITCHES);
+  }
 
-  if (tick10ms) evalLogicalSwitches(mode==e_perout_mode_normal);
+  MIXER_PROFILE_START(MIXER_STAGE_MIXES);
 
 #if defined(MODULE_ALWAYS_SEND_PULSES)
   checkStartupWarnings();
@@ -595,8 +921,8 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
 #if defined(HELI)
 #if defined(VIRTUAL_INPUTS)
-  int heliEleValue = getValue(g_model.swashR.elevatorSource);
-  int heliAilValue = getValue(g_model.swashR.aileronSource);
+  int heliEleValue = getSnapshotValue(g_model.swashR.elevatorSource);
+  int heliAilValue = getSnapshotValue(g_model.swashR.aileronSource);
 #else
   int16_t heliEleValue = anas[ELE_STICK];
   int16_t heliAilValue = anas[AIL_STICK];
@@ -626,7 +952,7 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 #endif
     getvalue_t vc = 0;
     if (g_model.swashR.collectiveSource)
-      vc = getValue(g_model.swashR.collectiveSource);
+      vc = getSnapshotValue(g_model.swashR.collectiveSource);
 
 #if defined(VIRTUAL_INPUTS)
     vp = (vp * g_model.swashR.elevatorWeight) / 100;
@@ -673,20 +999,43 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
   }
 #endif
 
+#if defined(CPUARM)
+  // Outputs to 0, the other ones are kept
+  for (uint8_t ch=0; ch<MAX_OUTPUT_CHANNELS; ch++) {
+    if (channels & ((bitfield_channels_t)1 << ch)) {
+      chans[ch] = 0;
+    }
+  }
+
+  if (mixerPlanDirty || !s_mixer_first_run_done) {
+    buildMixerPlan();
+  }
+#else
   memclear(chans, sizeof(chans));        // All outputs to 0
+#endif
 
   //========== MIXER LOOP ===============
   uint8_t lv_mixWarning = 0;
 
   uint8_t pass = 0;
 
+#if defined(CPUARM)
+  bitfield_channels_t dirtyChannels = channels; // all dirty when mixer starts
+#else
   bitfield_channels_t dirtyChannels = (bitfield_channels_t)-1; // all dirty when mixer starts
+#endif
 
   do {
 
     bitfield_channels_t passDirtyChannels = 0;
 
+#if defined(CPUARM)
+    for (uint8_t k=0; k<mixerPlan.count; k++) {
+      const MixerPlanItem & item = mixerPlan.items[k];
+      uint8_t i = item.index;
+#else
     for (uint8_t i=0; i<MAX_MIXERS; i++) {
+#endif
 
 #if defined(BOLD_FONT)
       if (mode==e_perout_mode_normal && pass==0) swOn[i].activeMix = 0;
@@ -694,14 +1043,20 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
       MixData *md = mixAddress(i);
 
+#if !defined(CPUARM)
       if (md->srcRaw == 0) break;
+#endif
 
       mixsrc_t stickIndex = md->srcRaw - MIXSRC_Rud;
 
       if (!(dirtyChannels & ((bitfield_channels_t)1 << md->destCh))) continue;
 
       // if this is the first calculation for the destination channel, initialize it with 0 (otherwise would be random)
+#if defined(CPUARM)
+      if (k == 0 || item.destCh != mixerPlan.items[k-1].destCh) {
+#else
       if (i == 0 || md->destCh != (md-1)->destCh) {
+#endif
         chans[md->destCh] = 0;
       }
 
@@ -733,7 +1088,7 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
           continue;
         }
         else {
-          v = getValue(md->srcRaw);
+          v = getSnapshotValue(md->srcRaw);
         }
 #else
         if (!mixEnabled || stickIndex >= NUM_STICKS || (stickIndex == THR_STICK && g_model.thrTrim)) {
@@ -750,10 +1105,17 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
           v = md->noExpo ? rawAnas[stickIndex] : anas[stickIndex];
         }
         else
+#endif
+#if defined(CPUARM)
+        if (mixerPlan.ordered && item.srcChannel >= 0 && item.srcChannel != item.destCh) {
+          // the source channel has already been computed during this pass
+          v = chans[item.srcChannel] >> 8;
+        }
+        else
 #endif
         {
           mixsrc_t srcRaw = MIXSRC_Rud + stickIndex;
-          v = getValue(srcRaw);
+          v = getSnapshotValue(srcRaw);
           srcRaw -= MIXSRC_CH1;
           if (srcRaw<=MIXSRC_LAST_CH-MIXSRC_CH1 && md->destCh != srcRaw) {
             if (dirtyChannels & ((bitfield_channels_t)1 << srcRaw) & (passDirtyChannels|~(((bitfield_channels_t) 1 << md->destCh)-1)))
@@ -1001,7 +1363,12 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
   } while (++pass < 5 && dirtyChannels);
 
-  mixWarning = lv_mixWarning;
+  // the other flight modes evaluated for the fades don't set the warnings
+  if (mode == e_perout_mode_normal) {
+    mixWarning = lv_mixWarning;
+  }
+
+  MIXER_PROFILE_STOP(MIXER_STAGE_MIXES);
 }
 
 int32_t sum_chans512[MAX_OUTPUT_CHANNELS] = {0};
@@ -1070,6 +1437,34 @@ void evalMixes(uint8_t tick10ms)
   int32_t weight = 0;
   if (flightModesFade) {
     memclear(sum_chans512, sizeof(sum_chans512));
+#if defined(CPUARM)
+    // the current flight mode first, the channels which don't depend on the
+    // flight mode are then kept as they are for the other flight modes
+    bitfield_channels_t fmChannels = (bitfield_channels_t)-1;
+    if (flightModesFade & ((ACTIVE_PHASES_TYPE)1 << fm)) {
+      LS_RECURSIVE_EVALUATION_RESET();
+      mixerCurrentFlightMode = fm;
+      evalFlightModeMixes(e_perout_mode_normal, tick10ms);
+      for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++)
+        sum_chans512[i] += (chans[i] >> 4) * fp_act[fm];
+      weight += fp_act[fm];
+      fmChannels = mixerPlan.fmChannels;
+      LS_RECURSIVE_EVALUATION_RESET();
+    }
+    for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
+      LS_RECURSIVE_EVALUATION_RESET();
+      if (p != fm && (flightModesFade & ((ACTIVE_PHASES_TYPE)1 << p))) {
+        mixerCurrentFlightMode = p;
+        if (fmChannels) {
+          evalFlightModeMixes(e_perout_mode_inactive_flight_mode, 0, fmChannels);
+        }
+        for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++)
+          sum_chans512[i] += (chans[i] >> 4) * fp_act[p];
+        weight += fp_act[p];
+      }
+      LS_RECURSIVE_EVALUATION_RESET();
+    }
+#else
     for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
       LS_RECURSIVE_EVALUATION_RESET();
       if (flightModesFade & ((ACTIVE_PHASES_TYPE)1 << p)) {
@@ -1081,6 +1476,7 @@ void evalMixes(uint8_t tick10ms)
       }
       LS_RECURSIVE_EVALUATION_RESET();
     }
+#endif
     assert(weight);
     mixerCurrentFlightMode = fm;
   }
@@ -1093,6 +1489,8 @@ void evalMixes(uint8_t tick10ms)
   // must be done after mixing because some functions use the inputs/channels values
   // must be done before limits because of the applyLimit function: it checks for safety switches which would be not initialized otherwise
   if (tick10ms) {
+    MIXER_PROFILE_START(MIXER_STAGE_FUNCTIONS);
+
 #if defined(MASTER_VOLUME)
     requiredSpeakerVolume = g_eeGeneral.speakerVolume + VOLUME_LEVEL_DEF;
 #endif
@@ -1105,9 +1503,12 @@ void evalMixes(uint8_t tick10ms)
 #else
     evalFunctions();
 #endif
+
+    MIXER_PROFILE_STOP(MIXER_STAGE_FUNCTIONS);
   }
 
   //========== LIMITS ===============
+  MIXER_PROFILE_START(MIXER_STAGE_LIMITS);
   for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
     // chans[i] holds data from mixer.   chans[i] = v*weight => 1024*256
     // later we multiply by the limit (up to 100) and then we need to normalize
@@ -1128,6 +1529,7 @@ void evalMixes(uint8_t tick10ms)
     channelOutputs[i] = value;  // copy consistent word to int-level
     sei();
   }
+  MIXER_PROFILE_STOP(MIXER_STAGE_LIMITS);
 
   if (tick10ms && flightModesFade) {
     uint16_t tick_delta = delta * tick10ms;
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "opentx.h"
+
+MixerProfiler mixerProfiler;
+
+const char * const mixerStageNames[MIXER_STAGES_COUNT] = {
+   "Inputs"     // MIXER_STAGE_INPUTS
+  ,"Log. sw."   // MIXER_STAGE_LOGICAL_SWITCHES
+  ,"Mixes"      // MIXER_STAGE_MIXES
+  ,"Functions"  // MIXER_STAGE_FUNCTIONS
+  ,"Limits"     // MIXER_STAGE_LIMITS
+  ,"Telemetry"  // MIXER_STAGE_TELEMETRY
+  ,"Total"      // MIXER_STAGE_TOTAL
+};
+
+void MixerHistogram::add(uint16_t value)
+{
+  last = value;
+  if (value > max) max = value;
+  sum += value;
+  count++;
+
+  uint8_t bucket = 0;
+  while (bucket < MIXER_HISTOGRAM_BUCKETS-1 && value >= bucketLimit(bucket)) {
+    bucket++;
+  }
+  if (buckets[bucket] < 0xFFFF) {
+    buckets[bucket]++;
+  }
+}
+
+void MixerProfiler::reset()
+{
+  __disable_irq();
+  memclear(this, sizeof(MixerProfiler));
+  __enable_irq();
+}
+
+// called by scheduleNextMixerCalculation() each time a module frame is sent
+void MixerProfiler::schedule(uint8_t module, uint32_t wakeup)
+{
+  uint8_t mask = 1 << module;
+  if ((pending & mask) && !s_pulses_paused) {
+    // the mixer didn't run since the previous frame of this module
+    missedDeadlines++;
+  }
+  expectedStart[module] = getTmr2MHz() + wakeup * 4000/*2ms*/;
+  pending |= mask;
+}
+
+void MixerProfiler::startCycle()
+{
+  cycleStart = getTmr2MHz();
+  memclear(stageTicks, sizeof(stageTicks));
+
+  // schedule() is called from the pulses interrupts
+  uint16_t deltas[NUM_MODULES];
+  uint8_t started = 0;
+  __disable_irq();
+  for (uint8_t module=0; module<NUM_MODULES; module++) {
+    uint8_t mask = 1 << module;
+    if (pending & mask) {
+      // the mixer task only wakes up on 2ms ticks, so it may start up to 1 tick earlier
+      int16_t delta = cycleStart - expectedStart[module];
+      if (delta > -4000) {
+        deltas[module] = abs(delta);
+        started |= mask;
+        pending &= ~mask;
+      }
+    }
+  }
+  __enable_irq();
+
+  for (uint8_t module=0; module<NUM_MODULES; module++) {
+    if (started & (1 << module)) {
+      jitter.add(deltas[module] / 2);
+    }
+  }
+}
+
+void MixerProfiler::endCycle()
+{
+  stageTicks[MIXER_STAGE_TOTAL] = getTmr2MHz() - cycleStart;
+  for (uint8_t stage=0; stage<MIXER_STAGES_COUNT; stage++) {
+    stages[stage].add(stageTicks[stage] / 2);
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MIXER_PROFILER_H_
+#define _MIXER_PROFILER_H_
+
+#if defined(CPUARM)
+
+enum MixerStages {
+  MIXER_STAGE_INPUTS,
+  MIXER_STAGE_LOGICAL_SWITCHES,
+  MIXER_STAGE_MIXES,
+  MIXER_STAGE_FUNCTIONS,
+  MIXER_STAGE_LIMITS,
+  MIXER_STAGE_TELEMETRY,
+  MIXER_STAGE_TOTAL,
+  MIXER_STAGES_COUNT
+};
+
+// histogram buckets: <64us, <128us, <256us, ... <4096us, >=4096us
+#define MIXER_HISTOGRAM_BUCKETS        8
+#define MIXER_HISTOGRAM_FIRST_BUCKET   6   // log2(64us)
+
+struct MixerHistogram
+{
+  uint16_t last;        // unit 1us
+  uint16_t max;         // unit 1us
+  uint32_t sum;         // unit 1us
+  uint32_t count;
+  uint16_t buckets[MIXER_HISTOGRAM_BUCKETS];
+
+  void add(uint16_t value);
+
+  uint16_t average() const
+  {
+    return count ? sum / count : 0;
+  }
+
+  static uint16_t bucketLimit(uint8_t bucket)
+  {
+    return 1 << (MIXER_HISTOGRAM_FIRST_BUCKET + bucket);
+  }
+};
+
+struct MixerProfiler
+{
+  MixerHistogram stages[MIXER_STAGES_COUNT];
+  MixerHistogram jitter;                    // mixer start vs scheduled wakeup
+  uint32_t missedDeadlines;                 // frames sent without a new mixer result
+  uint16_t stageTicks[MIXER_STAGES_COUNT];  // current cycle, unit 0.5us
+  uint16_t cycleStart;
+  uint16_t expectedStart[NUM_MODULES];      // unit 0.5us
+  uint8_t pending;                          // modules waiting for a mixer run
+
+  void reset();
+  void schedule(uint8_t module, uint32_t wakeup);
+  void startCycle();
+  void endCycle();
+};
+
+extern MixerProfiler mixerProfiler;
+
+extern const char * const mixerStageNames[MIXER_STAGES_COUNT];
+
+#define MIXER_PROFILE_START(stage)     uint16_t _mixerProfile_##stage = getTmr2MHz()
+#define MIXER_PROFILE_STOP(stage)      mixerProfiler.stageTicks[stage] += (uint16_t)(getTmr2MHz() - _mixerProfile_##stage)
+
+#else
+
+#define MIXER_PROFILE_START(stage)
+#define MIXER_PROFILE_STOP(stage)
+
+#endif // #if defined(CPUARM)
+
+#endif // _MIXER_PROFILER_H_
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "opentx.h"
+
+MixerScheduler mixerScheduler;
+
+void MixerScheduler::reset()
+{
+  memclear(wakeupTime, sizeof(wakeupTime));
+  lastRunTime = 0;
+  duration = MIXER_SCHEDULER_DEFAULT_DURATION;
+  pending = 0;
+}
+
+void MixerScheduler::schedule(uint8_t module, uint32_t now, uint16_t period)
+{
+  // the frame was sent somewhere in the current tick, the next one will
+  // be sent at least <period> ms after its start. The mixer has to be
+  // finished by then, it only wakes up at the beginning of a tick.
+  int32_t lead = (int32_t)period * 1000 - duration - MIXER_SCHEDULER_MARGIN;
+  wakeupTime[module] = now + (lead > 0 ? lead / MIXER_SCHEDULER_TICK_US : 0);
+  pending |= (1 << module);
+}
+
+int32_t MixerScheduler::getTimeout(uint32_t now) const
+{
+  int32_t timeout = (int32_t)(lastRunTime + MIXER_SCHEDULER_MAX_PERIOD - now);
+
+  for (uint8_t module=0; module<NUM_MODULES; module++) {
+    if (pending & (1 << module)) {
+      timeout = min(timeout, (int32_t)(wakeupTime[module] - now));
+    }
+  }
+
+  // never run twice during the same tick
+  if (now == lastRunTime && timeout < 1) {
+    timeout = 1;
+  }
+
+  return timeout;
+}
+
+void MixerScheduler::start(uint32_t now)
+{
+  for (uint8_t module=0; module<NUM_MODULES; module++) {
+    if ((pending & (1 << module)) && (int32_t)(now - wakeupTime[module]) >= 0) {
+      pending &= ~(1 << module);
+    }
+  }
+  lastRunTime = now;
+}
+
+void MixerScheduler::updateDuration(uint16_t value)
+{
+  // follow increases immediately, forget them slowly
+  if (value >= duration)
+    duration = value;
+  else
+    duration -= (duration - value + 15) / 16;
+}
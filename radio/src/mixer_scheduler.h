@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MIXER_SCHEDULER_H_
+#define _MIXER_SCHEDULER_H_
+
+#define MIXER_SCHEDULER_TICK_US            2000  // 1 OS tick
+#define MIXER_SCHEDULER_MAX_PERIOD         10    // run at least every 20ms
+#define MIXER_SCHEDULER_DEFAULT_DURATION   2000  // us, until the first run is measured
+#define MIXER_SCHEDULER_MARGIN             500   // us, between the mixer end and the frame
+
+// Decides when the mixer task has to wake up. All times are OS ticks
+// given by the caller, so that it can be driven by a virtual clock.
+class MixerScheduler
+{
+  public:
+    MixerScheduler()
+    {
+      reset();
+    }
+
+    void reset();
+
+    // a frame of this module has just been sent, the next one will be sent in <period> ms
+    void schedule(uint8_t module, uint32_t now, uint16_t period);
+
+    // number of ticks to sleep before the next mixer run, <= 0 when the mixer is late
+    int32_t getTimeout(uint32_t now) const;
+
+    // the mixer starts, the modules waiting for this run are served
+    void start(uint32_t now);
+
+    // measured mixer duration (us)
+    void updateDuration(uint16_t duration);
+
+    uint16_t getDuration() const
+    {
+      return duration;
+    }
+
+    uint32_t getWakeupTime(uint8_t module) const
+    {
+      return wakeupTime[module];
+    }
+
+    bool isPending(uint8_t module) const
+    {
+      return pending & (1 << module);
+    }
+
+  protected:
+    uint32_t wakeupTime[NUM_MODULES];
+    uint32_t lastRunTime;
+    uint16_t duration;    // rolling estimate, us
+    uint8_t pending;      // modules waiting for a mixer run
+};
+
+extern MixerScheduler mixerScheduler;
+
+#endif // _MIXER_SCHEDULER_H_
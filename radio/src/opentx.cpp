@@ -1646,10 +1646,18 @@ void doMixerCalculations()
   adcPrepareBandgap();
 #endif
 
+#if defined(CPUARM)
+  fillSourcesSnapshot();
+#endif
+
   DEBUG_TIMER_START(debugTimerEvalMixes);
   evalMixes(tick10ms);
   DEBUG_TIMER_STOP(debugTimerEvalMixes);
 
+#if defined(CPUARM)
+  releaseSourcesSnapshot();
+#endif
+
 #if !defined(CPUARM)
   // Bandgap has had plenty of time to settle...
   getADC_bandgap();
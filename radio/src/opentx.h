@@ -661,10 +661,40 @@ extern uint8_t flightModeTransitionLast;
   #define availableMemory() ((unsigned int)((unsigned char *)&_heap_end - heap))
 #endif
 
+#if defined(CPUARM)
+// Compiled mixer plan: the mixer lines which may contribute to an output,
+// in channel dependency order when there is no loop between channels.
+// It is rebuilt by the mixer when the model is loaded or edited.
+PACK(struct MixerPlanItem {
+  uint8_t index;          // index in g_model.mixData
+  uint8_t destCh;
+  int8_t  srcChannel;     // channel used as source, -1 if none
+});
+
+struct MixerPlan {
+  MixerPlanItem items[MAX_MIXERS];
+  uint8_t count;
+  uint8_t ordered;        // all channel sources are computed before being used
+  bitfield_channels_t fmChannels; // channels which may differ between flight modes
+};
+
+extern MixerPlan mixerPlan;
+extern bool mixerPlanDirty;
+void buildMixerPlan();
+inline void invalidateMixerPlan()
+{
+  mixerPlanDirty = true;
+}
+#endif
+
+#if defined(CPUARM)
+void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms, bitfield_channels_t channels=(bitfield_channels_t)-1);
+#else
 void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms);
+#endif
 void evalMixes(uint8_t tick10ms);
 void doMixerCalculations();
-void scheduleNextMixerCalculation(uint8_t module, uint16_t delay);
+void scheduleNextMixerCalculation(uint8_t module, uint16_t period);
 
 #if defined(CPUARM)
   void checkTrims();
@@ -674,6 +704,47 @@ NOINLINE void per10ms();
 
 getvalue_t getValue(mixsrc_t i);
 
+#if defined(CPUARM)
+// The values of the sources used by the model which don't change during a
+// mixer cycle, read once per cycle before the mixes. The mixes, logical
+// switches and functions use the same values during the whole cycle.
+#define MAX_SNAPSHOT_SOURCES           64
+#define SNAPSHOT_NONE                  0xFF
+
+struct SourcesSnapshot {
+  uint8_t index[MIXSRC_LAST_TELEM-MIXSRC_FIRST_SWITCH+1];  // position of each source in the values, SNAPSHOT_NONE if not used
+  mixsrc_t sources[MAX_SNAPSHOT_SOURCES];
+  getvalue_t values[MAX_SNAPSHOT_SOURCES];
+  uint8_t count;
+  uint8_t valid;          // the values are the ones of the current mixer cycle
+};
+
+extern SourcesSnapshot sourcesSnapshot;
+extern bool sourcesSnapshotDirty;
+void buildSourcesSnapshot();
+void fillSourcesSnapshot();
+inline void invalidateSourcesSnapshot()
+{
+  sourcesSnapshotDirty = true;
+}
+inline void releaseSourcesSnapshot()
+{
+  sourcesSnapshot.valid = false;
+}
+inline getvalue_t getSnapshotValue(mixsrc_t i)
+{
+  if (sourcesSnapshot.valid && i >= MIXSRC_FIRST_SWITCH && i <= MIXSRC_LAST_TELEM) {
+    uint8_t index = sourcesSnapshot.index[i-MIXSRC_FIRST_SWITCH];
+    if (index != SNAPSHOT_NONE) {
+      return sourcesSnapshot.values[index];
+    }
+  }
+  return getValue(i);
+}
+#else
+#define getSnapshotValue(i)            getValue(i)
+#endif
+
 #if defined(CPUARM)
 #define GETSWITCH_MIDPOS_DELAY   1
 bool getSwitch(swsrc_t swtch, uint8_t flags=0);
@@ -685,6 +756,12 @@ void logicalSwitchesTimerTick();
 void logicalSwitchesReset();
 
 #if defined(CPUARM)
+  extern bool logicalSwitchesPlanDirty;
+  void buildLogicalSwitchesPlan();
+  inline void invalidateLogicalSwitchesPlan()
+  {
+    logicalSwitchesPlanDirty = true;
+  }
   void evalLogicalSwitches(bool isCurrentPhase=true);
   void logicalSwitchesCopyState(uint8_t src, uint8_t dst);
   #define LS_RECURSIVE_EVALUATION_RESET()
@@ -823,6 +900,12 @@ extern uint16_t lastMixerDuration;
   uint16_t getTmr16KHz();
 #endif
 
+#include "mixer_profiler.h"
+
+#if defined(CPUARM)
+#include "mixer_scheduler.h"
+#endif
+
 #if !defined(CPUARM)
   uint16_t stackAvailable();
 #endif
@@ -1020,11 +1103,29 @@ struct point_t
 point_t getPoint(uint8_t i);
 #if !defined(CURVES)
 #define LOAD_MODEL_CURVES()
+#define UPDATE_MODEL_CURVES()
 #define applyCurve(x, idx) (x)
 #elif defined(CPUARM)
 typedef CurveData CurveInfo;
+// smooth curves tables, 2^CURVE_LUT_BITS segments over -RESX..RESX
+#if !defined(CURVE_LUT_BITS)
+  #define CURVE_LUT_BITS               8
+#endif
+#if !defined(CURVE_LUT_COUNT)
+  #define CURVE_LUT_COUNT              8
+#endif
+#if !defined(CURVE_LUT_MAX_ERROR)
+  #define CURVE_LUT_MAX_ERROR          2
+#endif
+#define CURVE_LUT_SIZE                 ((1 << CURVE_LUT_BITS) + 1)
+#define CURVE_LUT_STEP                 ((2 * RESX) >> CURVE_LUT_BITS)
 void loadCurves();
 #define LOAD_MODEL_CURVES() loadCurves()
+void invalidateCurve(uint8_t idx);
+void updateCurveLuts();
+#define UPDATE_MODEL_CURVES() updateCurveLuts()
+const int16_t * getCurveLut(uint8_t idx);
+int16_t hermite_spline(int16_t x, uint8_t idx);
 int intpol(int x, uint8_t idx);
 int applyCurve(int x, CurveRef & curve);
 int applyCustomCurve(int x, uint8_t idx);
@@ -1042,6 +1143,7 @@ CurveInfo curveInfo(uint8_t idx);
 int intpol(int x, uint8_t idx);
 int applyCurve(int x, int8_t idx);
 #define LOAD_MODEL_CURVES()
+#define UPDATE_MODEL_CURVES()
 #define applyCustomCurve(x, idx) intpol(x, idx)
 int applyCurrentCurve(int x);
 bool moveCurve(uint8_t index, int8_t shift, int8_t custom=0);
@@ -44,25 +44,33 @@
 #define SCRIPTS_MIXES_PATH  SCRIPTS_PATH "/MIXES"
 #define SCRIPTS_FUNCS_PATH  SCRIPTS_PATH "/FUNCTIONS"
 #define SCRIPTS_TELEM_PATH  SCRIPTS_PATH "/TELEMETRY"
+#define SCRIPTS_CACHE_PATH  SCRIPTS_PATH "/CACHE"
 
 #define LEN_FILE_PATH_MAX   (sizeof(SCRIPTS_TELEM_PATH)+1)  // longest + "/"
 
 #if defined(COLORLCD)
 const char RADIO_MODELSLIST_PATH[] = RADIO_PATH "/models.txt";
 const char RADIO_SETTINGS_PATH[] = RADIO_PATH "/radio.bin";
+const char RADIO_MODELSCACHE_PATH[] = RADIO_PATH "/models.cache";
 #endif
 
 #define MODELS_EXT          ".bin"
+#if defined(BINARY_LOGS)
+#define LOGS_EXT            ".tlm"
+#else
 #define LOGS_EXT            ".csv"
+#endif
 #define SOUNDS_EXT          ".wav"
 #define BMP_EXT             ".bmp"
 #define PNG_EXT             ".png"
 #define JPG_EXT             ".jpg"
 #define SCRIPT_EXT          ".lua"
 #define SCRIPT_BIN_EXT      ".luac"
+#define SCRIPTS_CACHE_EXT   ".luc"
 #define TEXT_EXT            ".txt"
 #define FIRMWARE_EXT        ".bin"
 #define EEPROM_EXT          ".bin"
+#define TMP_EXT             ".tmp"
 #define SPORT_FIRMWARE_EXT  ".frk"
 
 #define LEN_FILE_EXTENSION_MAX  5  // longest used, including the dot, excluding null term.
@@ -94,6 +102,11 @@ extern uint8_t logDelay;
 void logsInit();
 void logsClose();
 void logsWrite();
+void getAnalogLogLabel(char * label, uint8_t index);
+#if defined(BINARY_LOGS)
+void logsFlush(bool all=false);
+extern uint16_t binaryLogsOverruns;
+#endif
 
 uint32_t sdGetNoSectors();
 uint32_t sdGetSize();
@@ -26,24 +26,158 @@
 
 #define MODELCELL_WIDTH                172
 #define MODELCELL_HEIGHT               59
+#define MODELCELL_SIZE                 (MODELCELL_WIDTH * MODELCELL_HEIGHT * sizeof(uint16_t))
+
+// The cells are cached in RADIO_MODELSCACHE_PATH, so that they don't have to
+// be rendered again (model header read, bitmap decoded and scaled) each time
+// the models list is displayed. The file starts with a header and the table
+// of the entries, read at once when the list is loaded, followed by the
+// pixels of the cells, each one read with a single f_read() when displayed.
+#define MODELS_CACHE_MAGIC             "MCCH"
+#define MODELS_CACHE_VERSION           1
+
+PACK(struct ModelsCacheHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t width;
+  uint8_t height;
+  uint8_t spare;
+  uint16_t colors[4];   // the theme colors used to render the cells
+  uint16_t count;
+});
+
+PACK(struct ModelsCacheEntry {
+  char modelFilename[LEN_MODEL_FILENAME+1];
+  uint16_t fileDate;    // the model file date, time and size when the cell was rendered
+  uint16_t fileTime;
+  uint32_t fileSize;
+  char name[LEN_MODEL_NAME];
+  char bitmap[LEN_BITMAP_NAME];
+  uint8_t error;
+});
+
+inline uint32_t getModelsCacheEntryOffset(unsigned int index)
+{
+  return sizeof(ModelsCacheHeader) + index * sizeof(ModelsCacheEntry);
+}
+
+inline uint32_t getModelsCacheCellOffset(unsigned int count, unsigned int index)
+{
+  return getModelsCacheEntryOffset(count) + index * MODELCELL_SIZE;
+}
+
+inline void getModelsCacheColors(uint16_t * colors)
+{
+  colors[0] = lcdColorTable[TEXT_COLOR_INDEX];
+  colors[1] = lcdColorTable[TEXT_BGCOLOR_INDEX];
+  colors[2] = lcdColorTable[TITLE_BGCOLOR_INDEX];
+  colors[3] = lcdColorTable[LINE_COLOR_INDEX];
+}
+
+enum ModelCellCacheState {
+  MODELCELL_CACHED,
+  MODELCELL_CACHE_ENTRY_CHANGED,  // the model file changed, not its header
+  MODELCELL_CACHE_CELL_CHANGED,   // the cell has been rendered again
+};
 
 class ModelCell
 {
   public:
     ModelCell(const char * name):
-      buffer(NULL)
+      buffer(NULL),
+      cacheIndex(-1),
+      cacheOffset(0),
+      cacheState(MODELCELL_CACHED),
+      fileDate(0),
+      fileTime(0),
+      fileSize(0)
     {
       strncpy(this->modelFilename, name, sizeof(this->modelFilename));
+      modelName[0] = '\0';
+      memset(&entry, 0, sizeof(entry));
+    }
+
+    ~ModelCell()
+    {
+      delete buffer;
     }
 
     const BitmapBuffer * getBuffer()
     {
-      if (!buffer) {
+      if (!buffer && !loadFromCache()) {
         load();
       }
       return buffer;
     }
 
+    bool isCurrentModel() const
+    {
+      return strncmp(modelFilename, g_eeGeneral.currModelFilename, LEN_MODEL_FILENAME) == 0;
+    }
+
+    void readFileInfo()
+    {
+      static FILINFO fno;
+      char path[256];
+      getModelPath(path, modelFilename);
+      if (f_stat(path, &fno) == FR_OK) {
+        fileDate = fno.fdate;
+        fileTime = fno.ftime;
+        fileSize = fno.fsize;
+      }
+    }
+
+    bool isHeaderCached(const ModelHeader & header) const
+    {
+      return !entry.error && !memcmp(entry.name, header.name, LEN_MODEL_NAME) && !memcmp(entry.bitmap, header.bitmap, LEN_BITMAP_NAME);
+    }
+
+    bool loadFromCache()
+    {
+      if (cacheIndex < 0) {
+        return false;
+      }
+
+      // the current model header may have changed since it was written
+      if (isCurrentModel()) {
+        if (!isHeaderCached(g_model.header)) {
+          return false;
+        }
+      }
+      else if (fileDate != entry.fileDate || fileTime != entry.fileTime || fileSize != entry.fileSize) {
+        ModelHeader header;
+        if (readModel(modelFilename, (uint8_t *)&header, sizeof(header)) || !isHeaderCached(header)) {
+          return false;
+        }
+        entry.fileDate = fileDate;
+        entry.fileTime = fileTime;
+        entry.fileSize = fileSize;
+        cacheState = MODELCELL_CACHE_ENTRY_CHANGED;
+      }
+
+      buffer = new BitmapBuffer(BMP_RGB565, MODELCELL_WIDTH, MODELCELL_HEIGHT);
+      if (buffer == NULL) {
+        return false;
+      }
+
+      FIL file;
+      UINT read;
+      bool result = false;
+      if (f_open(&file, RADIO_MODELSCACHE_PATH, FA_OPEN_EXISTING | FA_READ) == FR_OK) {
+        result = (f_lseek(&file, cacheOffset) == FR_OK && f_read(&file, buffer->getData(), MODELCELL_SIZE, &read) == FR_OK && read == MODELCELL_SIZE);
+        f_close(&file);
+      }
+
+      if (!result) {
+        delete buffer;
+        buffer = NULL;
+        return false;
+      }
+
+      zchar2str(modelName, entry.name, LEN_MODEL_NAME);
+      return true;
+    }
+
     void load()
     {
       ModelHeader header;
@@ -54,18 +188,31 @@ class ModelCell
         return;
       }
 
-      if (strncmp(modelFilename, g_eeGeneral.currModelFilename, LEN_MODEL_FILENAME) == 0)
+      memset(&entry, 0, sizeof(entry));
+      strncpy(entry.modelFilename, modelFilename, LEN_MODEL_FILENAME);
+      cacheState = MODELCELL_CACHE_CELL_CHANGED;
+
+      if (isCurrentModel()) {
+        // the header will be checked again once the model is saved
         header = g_model.header;
-      else
+      }
+      else {
         error = readModel(modelFilename, (uint8_t *)&header, sizeof(header));
+        entry.fileDate = fileDate;
+        entry.fileTime = fileTime;
+        entry.fileSize = fileSize;
+      }
 
       buffer->clear(TEXT_BGCOLOR);
 
       if (error) {
+        entry.error = 1;
         buffer->drawText(5, 2, "(Invalid Model)", TEXT_COLOR);
         buffer->drawBitmapPattern(5, 23, LBM_LIBRARY_SLOT, TEXT_COLOR);
       }
       else {
+        memcpy(entry.name, header.name, LEN_MODEL_NAME);
+        memcpy(entry.bitmap, header.bitmap, LEN_BITMAP_NAME);
         zchar2str(modelName, header.name, LEN_MODEL_NAME);
         char timer[LEN_TIMER_STRING];
         buffer->drawSizedText(5, 2, header.name, LEN_MODEL_NAME, SMLSIZE|ZCHAR|TEXT_COLOR);
@@ -90,6 +237,13 @@ class ModelCell
     char modelFilename[LEN_MODEL_FILENAME+1];
     char modelName[LEN_MODEL_NAME+1];
     BitmapBuffer * buffer;
+    ModelsCacheEntry entry;
+    int16_t cacheIndex;     // -1 when the model isn't in the cache
+    uint32_t cacheOffset;   // offset of the cell pixels in the cache
+    uint8_t cacheState;
+    uint16_t fileDate;      // the model file date, time and size on the SD card
+    uint16_t fileTime;
+    uint32_t fileSize;
 };
 
 class ModelsCategory: public std::list<ModelCell *>
@@ -100,6 +254,13 @@ class ModelsCategory: public std::list<ModelCell *>
       strncpy(this->name, name, sizeof(this->name));
     }
 
+    ~ModelsCategory()
+    {
+      for (std::list<ModelCell *>::iterator it = begin(); it != end(); ++it) {
+        delete *it;
+      }
+    }
+
     ModelCell * addModel(const char * name)
     {
       ModelCell * result = new ModelCell(name);
@@ -158,7 +319,8 @@ class ModelsCategory: public std::list<ModelCell *>
 class ModelsList
 {
   public:
-    ModelsList()
+    ModelsList():
+      cacheCount(0)
     {
     }
 
@@ -216,9 +378,240 @@ class ModelsList
         categories.push_back(category);
       }
 
+      loadCache();
+      readModelsFilesInfo();
+
       return true;
     }
 
+    ModelCell * findModel(const char * name)
+    {
+      for (std::list<ModelsCategory *>::iterator it = categories.begin(); it != categories.end(); ++it) {
+        for (ModelsCategory::iterator cell = (*it)->begin(); cell != (*it)->end(); ++cell) {
+          if (!strncmp((*cell)->modelFilename, name, LEN_MODEL_FILENAME)) {
+            return *cell;
+          }
+        }
+      }
+      return NULL;
+    }
+
+    // the date, time and size of all the models files, with one directory scan
+    void readModelsFilesInfo()
+    {
+      static FILINFO fno;
+      DIR dir;
+
+      if (f_opendir(&dir, MODELS_PATH) != FR_OK) {
+        return;
+      }
+
+      while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != '\0') {
+        ModelCell * model = findModel(fno.fname);
+        if (model) {
+          model->fileDate = fno.fdate;
+          model->fileTime = fno.ftime;
+          model->fileSize = fno.fsize;
+        }
+      }
+
+      f_closedir(&dir);
+    }
+
+    bool isCacheHeaderValid(const ModelsCacheHeader & header)
+    {
+      uint16_t colors[DIM(header.colors)];
+      getModelsCacheColors(colors);
+      return !memcmp(header.magic, MODELS_CACHE_MAGIC, sizeof(header.magic)) && header.version == MODELS_CACHE_VERSION &&
+             header.width == MODELCELL_WIDTH && header.height == MODELCELL_HEIGHT && !memcmp(header.colors, colors, sizeof(colors));
+    }
+
+    void loadCache()
+    {
+      ModelsCacheHeader header;
+      UINT read;
+
+      cacheCount = 0;
+
+      if (f_open(&file, RADIO_MODELSCACHE_PATH, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        return;
+      }
+
+      if (f_read(&file, &header, sizeof(header), &read) == FR_OK && read == sizeof(header) && isCacheHeaderValid(header) &&
+          f_size(&file) == getModelsCacheCellOffset(header.count, header.count)) {
+        UINT size = header.count * sizeof(ModelsCacheEntry);
+        ModelsCacheEntry * entries = (ModelsCacheEntry *)malloc(size);
+        if (entries && f_read(&file, entries, size, &read) == FR_OK && read == size) {
+          cacheCount = header.count;
+          for (unsigned int i=0; i<cacheCount; i++) {
+            ModelCell * model = findModel(entries[i].modelFilename);
+            if (model && model->cacheIndex < 0) {
+              model->entry = entries[i];
+              model->cacheIndex = i;
+              model->cacheOffset = getModelsCacheCellOffset(cacheCount, i);
+            }
+          }
+        }
+        free(entries);
+      }
+
+      f_close(&file);
+    }
+
+    // the changed entries and cells are written in place when all of them
+    // are already in the cache, otherwise the cache is written again
+    void saveCache()
+    {
+      bool changed = false;
+      bool complete = true;
+
+      for (std::list<ModelsCategory *>::iterator it = categories.begin(); it != categories.end(); ++it) {
+        for (ModelsCategory::iterator cell = (*it)->begin(); cell != (*it)->end(); ++cell) {
+          if ((*cell)->cacheState != MODELCELL_CACHED) {
+            changed = true;
+            if ((*cell)->cacheIndex < 0) {
+              complete = false;
+            }
+          }
+        }
+      }
+
+      if (changed && !(complete && updateCache())) {
+        writeCache();
+      }
+    }
+
+    bool updateCache()
+    {
+      UINT written;
+
+      if (f_open(&file, RADIO_MODELSCACHE_PATH, FA_OPEN_EXISTING | FA_WRITE) != FR_OK) {
+        return false;
+      }
+
+      bool result = true;
+      for (std::list<ModelsCategory *>::iterator it = categories.begin(); result && it != categories.end(); ++it) {
+        for (ModelsCategory::iterator cell = (*it)->begin(); result && cell != (*it)->end(); ++cell) {
+          ModelCell * model = *cell;
+          if (model->cacheState == MODELCELL_CACHED) {
+            continue;
+          }
+          // the cell is written before its entry, which validates it
+          if (model->cacheState == MODELCELL_CACHE_CELL_CHANGED) {
+            result = (f_lseek(&file, model->cacheOffset) == FR_OK && f_write(&file, model->buffer->getData(), MODELCELL_SIZE, &written) == FR_OK && written == MODELCELL_SIZE);
+          }
+          if (result) {
+            result = (f_lseek(&file, getModelsCacheEntryOffset(model->cacheIndex)) == FR_OK && f_write(&file, &model->entry, sizeof(model->entry), &written) == FR_OK && written == sizeof(model->entry));
+          }
+          if (result) {
+            model->cacheState = MODELCELL_CACHED;
+          }
+        }
+      }
+
+      return f_close(&file) == FR_OK && result;
+    }
+
+    // the cache is written in a temporary file, the cells which are not
+    // loaded are copied from the previous cache
+    void writeCache()
+    {
+      ModelsCacheHeader header;
+      uint16_t colors[DIM(header.colors)];
+      char tmpFilename[sizeof(RADIO_MODELSCACHE_PATH) + sizeof(TMP_EXT)];
+      FIL previous;
+      UINT written, read;
+
+      strAppend(strAppend(tmpFilename, RADIO_MODELSCACHE_PATH), TMP_EXT);
+
+      memcpy(header.magic, MODELS_CACHE_MAGIC, sizeof(header.magic));
+      header.version = MODELS_CACHE_VERSION;
+      header.width = MODELCELL_WIDTH;
+      header.height = MODELCELL_HEIGHT;
+      header.spare = 0;
+      getModelsCacheColors(colors);
+      memcpy(header.colors, colors, sizeof(header.colors));
+      header.count = 0;
+      for (std::list<ModelsCategory *>::iterator it = categories.begin(); it != categories.end(); ++it) {
+        for (ModelsCategory::iterator cell = (*it)->begin(); cell != (*it)->end(); ++cell) {
+          if ((*cell)->buffer || (*cell)->cacheIndex >= 0) {
+            header.count++;
+          }
+        }
+      }
+
+      uint8_t * copy = (uint8_t *)malloc(MODELCELL_SIZE);
+      if (copy == NULL) {
+        return;
+      }
+
+      bool hasPrevious = (f_open(&previous, RADIO_MODELSCACHE_PATH, FA_OPEN_EXISTING | FA_READ) == FR_OK);
+
+      bool result = (f_open(&file, tmpFilename, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+      if (result) {
+        result = (f_write(&file, &header, sizeof(header), &written) == FR_OK && written == sizeof(header));
+        for (std::list<ModelsCategory *>::iterator it = categories.begin(); result && it != categories.end(); ++it) {
+          for (ModelsCategory::iterator cell = (*it)->begin(); result && cell != (*it)->end(); ++cell) {
+            if ((*cell)->buffer || (*cell)->cacheIndex >= 0) {
+              result = (f_write(&file, &(*cell)->entry, sizeof(ModelsCacheEntry), &written) == FR_OK && written == sizeof(ModelsCacheEntry));
+            }
+          }
+        }
+        for (std::list<ModelsCategory *>::iterator it = categories.begin(); result && it != categories.end(); ++it) {
+          for (ModelsCategory::iterator cell = (*it)->begin(); result && cell != (*it)->end(); ++cell) {
+            ModelCell * model = *cell;
+            const void * data;
+            if (model->buffer) {
+              data = model->buffer->getData();
+            }
+            else if (model->cacheIndex >= 0) {
+              result = (hasPrevious && f_lseek(&previous, model->cacheOffset) == FR_OK && f_read(&previous, copy, MODELCELL_SIZE, &read) == FR_OK && read == MODELCELL_SIZE);
+              data = copy;
+            }
+            else {
+              continue;
+            }
+            if (result) {
+              result = (f_write(&file, data, MODELCELL_SIZE, &written) == FR_OK && written == MODELCELL_SIZE);
+            }
+          }
+        }
+        if (f_close(&file) != FR_OK) {
+          result = false;
+        }
+      }
+
+      if (hasPrevious) {
+        f_close(&previous);
+      }
+      free(copy);
+
+      if (!result) {
+        f_unlink(tmpFilename);
+        return;
+      }
+
+      f_unlink(RADIO_MODELSCACHE_PATH);
+      if (f_rename(tmpFilename, RADIO_MODELSCACHE_PATH) != FR_OK) {
+        return;
+      }
+
+      // the cells now have their place in the new cache
+      cacheCount = header.count;
+      unsigned int index = 0;
+      for (std::list<ModelsCategory *>::iterator it = categories.begin(); it != categories.end(); ++it) {
+        for (ModelsCategory::iterator cell = (*it)->begin(); cell != (*it)->end(); ++cell) {
+          ModelCell * model = *cell;
+          if (model->buffer || model->cacheIndex >= 0) {
+            model->cacheIndex = index;
+            model->cacheOffset = getModelsCacheCellOffset(cacheCount, index);
+            model->cacheState = MODELCELL_CACHED;
+            index++;
+          }
+        }
+      }
+    }
+
     void save()
     {
       FRESULT result = f_open(&file, RADIO_MODELSLIST_PATH, FA_CREATE_ALWAYS | FA_WRITE);
@@ -261,6 +654,7 @@ class ModelsList
     ModelCell * addModel(ModelsCategory * category, const char * name)
     {
       ModelCell * result = category->addModel(name);
+      result->readFileInfo();
       modelsCount++;
       save();
       return result;
@@ -297,6 +691,7 @@ class ModelsList
     ModelsCategory * currentCategory;
     ModelCell * currentModel;
     unsigned int modelsCount;
+    unsigned int cacheCount;
 
   protected:
     FIL file;
@@ -35,7 +35,12 @@ const char * writeFile(const char * filename, const uint8_t * data, uint16_t siz
   char buf[8];
   UINT written;
 
-  FRESULT result = f_open(&file, filename, FA_CREATE_ALWAYS | FA_WRITE);
+  // the data is written in a temporary file, renamed once complete, so that
+  // a power loss during the write never leaves a truncated file
+  char tmpFilename[256];
+  strAppend(strAppend(tmpFilename, filename), TMP_EXT);
+
+  FRESULT result = f_open(&file, tmpFilename, FA_CREATE_ALWAYS | FA_WRITE);
   if (result != FR_OK) {
     return SDCARD_ERROR(result);
   }
@@ -57,10 +62,47 @@ const char * writeFile(const char * filename, const uint8_t * data, uint16_t siz
     return SDCARD_ERROR(result);
   }
 
-  f_close(&file);
+  result = f_close(&file);
+  if (result != FR_OK) {
+    return SDCARD_ERROR(result);
+  }
+
+  // f_rename() doesn't replace an existing file
+  f_unlink(filename);
+  result = f_rename(tmpFilename, filename);
+  if (result != FR_OK) {
+    return SDCARD_ERROR(result);
+  }
+
   return NULL;
 }
 
+// A power loss between the removal of the previous file and the rename of
+// the new one leaves only the temporary file, complete
+static bool restoreFile(const char * filename)
+{
+  FIL file;
+  char buf[8];
+  UINT read;
+
+  char tmpFilename[256];
+  strAppend(strAppend(tmpFilename, filename), TMP_EXT);
+
+  if (f_open(&file, tmpFilename, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+    return false;
+  }
+
+  bool complete = (f_size(&file) >= 8 && f_read(&file, (uint8_t *)buf, 8, &read) == FR_OK && read == 8 && f_size(&file) == 8u + *(uint16_t*)&buf[6]);
+  f_close(&file);
+
+  if (!complete) {
+    return false;
+  }
+
+  TRACE("restoreFile(%s)", filename);
+  return f_rename(tmpFilename, filename) == FR_OK;
+}
+
 const char * writeModel()
 {
   char path[256];
@@ -77,6 +119,9 @@ const char * loadFile(const char * filename, uint8_t * data, uint16_t maxsize)
   UINT read;
 
   FRESULT result = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+  if (result != FR_OK && restoreFile(filename)) {
+    result = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+  }
   if (result != FR_OK) {
     return SDCARD_ERROR(result);
   }
@@ -151,24 +196,112 @@ const char * writeGeneralSettings()
   return writeFile(RADIO_SETTINGS_PATH, (uint8_t *)&g_eeGeneral, sizeof(g_eeGeneral));
 }
 
+// The radio settings and the model are copied when they have to be written,
+// and the copies are written by the storage task, so that the menus never
+// wait for the SD card. The changes made meanwhile are written with the next
+// copies, at most once per STORAGE_WRITE_PERIOD_10MS.
+#define STORAGE_WRITE_PERIOD_10MS      500
+#define STORAGE_TASK_PERIOD_TICKS      25    // 50ms
+
+static RadioData generalSnapshot __SDRAM;
+static ModelData modelSnapshot __SDRAM;
+static char modelSnapshotFilename[LEN_MODEL_FILENAME+1];
+static volatile uint8_t generalSnapshotPending = 0;
+static volatile uint8_t modelSnapshotPending = 0;
+static tmr10ms_t lastSnapshotTime10ms;
+static volatile bool storageTaskRunning = false;
+
+static void storageWriteSnapshots()
+{
+  if (generalSnapshotPending) {
+    const char * error = writeFile(RADIO_SETTINGS_PATH, (uint8_t *)&generalSnapshot, sizeof(generalSnapshot));
+    if (error) {
+      TRACE("writeGeneralSettings error=%s", error);
+    }
+    generalSnapshotPending = 0;
+  }
+
+  if (modelSnapshotPending) {
+    char path[256];
+    getModelPath(path, modelSnapshotFilename);
+    const char * error = writeFile(path, (uint8_t *)&modelSnapshot, sizeof(modelSnapshot));
+    if (error) {
+      TRACE("writeModel error=%s", error);
+    }
+    modelSnapshotPending = 0;
+  }
+}
+
+void storageTask(void * pdata)
+{
+  storageTaskRunning = true;
+
+  while (1) {
+#if defined(SIMU)
+    if (main_thread_running == 0) {
+      storageTaskRunning = false;
+      return;
+    }
+#endif
+    storageWriteSnapshots();
+#if defined(DISK_CACHE)
+    diskCache.idle();
+#endif
+    CoTickDelay(STORAGE_TASK_PERIOD_TICKS);
+  }
+}
+
 void storageCheck(bool immediately)
 {
+  if (immediately) {
+    // the copies not written yet are older than the current data
+    while (storageTaskRunning && (generalSnapshotPending || modelSnapshotPending)) {
+      CoTickDelay(1);
+    }
+
+    if (storageDirtyMsk & EE_GENERAL) {
+      TRACE("eeprom write general");
+      storageDirtyMsk -= EE_GENERAL;
+      const char * error = writeGeneralSettings();
+      if (error) {
+        TRACE("writeGeneralSettings error=%s", error);
+      }
+    }
+
+    if (storageDirtyMsk & EE_MODEL) {
+      TRACE("eeprom write model");
+      storageDirtyMsk -= EE_MODEL;
+      const char * error = writeModel();
+      if (error) {
+        TRACE("writeModel error=%s", error);
+      }
+    }
+    return;
+  }
+
+  if (generalSnapshotPending || modelSnapshotPending || (tmr10ms_t)(get_tmr10ms() - lastSnapshotTime10ms) < (tmr10ms_t)STORAGE_WRITE_PERIOD_10MS) {
+    return;
+  }
+
+  lastSnapshotTime10ms = get_tmr10ms();
+
   if (storageDirtyMsk & EE_GENERAL) {
     TRACE("eeprom write general");
     storageDirtyMsk -= EE_GENERAL;
-    const char * error = writeGeneralSettings();
-    if (error) {
-      TRACE("writeGeneralSettings error=%s", error);
-    }
+    memcpy(&generalSnapshot, &g_eeGeneral, sizeof(generalSnapshot));
+    generalSnapshotPending = 1;
   }
 
   if (storageDirtyMsk & EE_MODEL) {
     TRACE("eeprom write model");
     storageDirtyMsk -= EE_MODEL;
-    const char * error = writeModel();
-    if (error) {
-      TRACE("writeModel error=%s", error);
-    }
+    memcpy(&modelSnapshot, &g_model, sizeof(modelSnapshot));
+    memcpy(modelSnapshotFilename, g_eeGeneral.currModelFilename, sizeof(modelSnapshotFilename));
+    modelSnapshotPending = 1;
+  }
+
+  if (!storageTaskRunning) {
+    storageWriteSnapshots();
   }
 }
 
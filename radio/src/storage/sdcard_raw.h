@@ -26,9 +26,12 @@
 #define DEFAULT_CATEGORY         "Models"
 #define DEFAULT_MODEL_FILENAME   "model1.bin"
 
+void getModelPath(char * path, const char * filename);
 const char * readModel(const char * filename, uint8_t * buffer, uint32_t size);
 const char * loadModel(const char * filename, bool alarms=true);
 const char * createModel();
+const char * loadRadioSettingsSettings();
+void storageTask(void * pdata);
 
 PACK(struct RamBackup {
   uint16_t size;
@@ -33,6 +33,19 @@ void storageDirty(uint8_t msk)
   storageDirtyMsk |= msk;
   storageDirtyTime10ms = get_tmr10ms();
 
+#if defined(CPUARM)
+  if (msk & EE_MODEL) {
+    invalidateMixerPlan();
+    invalidateLogicalSwitchesPlan();
+    invalidateTelemetrySensorsIndex();
+    invalidateGVarValues();
+  }
+  if (msk & (EE_MODEL|EE_GENERAL)) {
+    // the global functions sources
+    invalidateSourcesSnapshot();
+  }
+#endif
+
 #if defined(RAMBACKUP)
   rambackupDirtyMsk = storageDirtyMsk;
   rambackupDirtyTime10ms = storageDirtyTime10ms;
@@ -86,6 +99,14 @@ void postModelLoad(bool alarms)
 
   LOAD_MODEL_CURVES();
 
+#if defined(CPUARM)
+  invalidateMixerPlan();
+  invalidateLogicalSwitchesPlan();
+  invalidateTelemetrySensorsIndex();
+  invalidateGVarValues();
+  invalidateSourcesSnapshot();
+#endif
+
   resumeMixerCalculations();
   // TODO pulses should be started after mixer calculations ...
 
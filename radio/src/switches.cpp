@@ -277,7 +277,7 @@ void getSwitchesPosition(bool startup)
 
 getvalue_t getValueForLogicalSwitch(mixsrc_t i)
 {
-  getvalue_t result = getValue(i);
+  getvalue_t result = getSnapshotValue(i);
   if (i>=MIXSRC_FIRST_INPUT && i<=MIXSRC_LAST_INPUT) {
     int8_t trimIdx = virtualInputsTrims[i-MIXSRC_FIRST_INPUT];
     if (trimIdx >= 0) {
@@ -291,7 +291,7 @@ getvalue_t getValueForLogicalSwitch(mixsrc_t i)
   return result;
 }
 #else
-  #define getValueForLogicalSwitch(i) getValue(i)
+  #define getValueForLogicalSwitch(i) getSnapshotValue(i)
 #endif
 
 PACK(typedef struct {
@@ -631,12 +631,215 @@ bool getSwitch(swsrc_t swtch)
 }
 
 #if defined(CPUARM)
+// The logical switches plan: the used logical switches in dependency order,
+// the index order being kept between independent switches and within loops.
+// A switch which only depends on telemetry values, timers and logical
+// switches evaluated before it, without delay nor duration, is evaluated
+// again only when one of them changes. The plan is rebuilt when the model is
+// loaded or edited.
+#define LS_PLAN_NONE                   0xFF
+
+struct LogicalSwitchesPlanItem {
+  uint8_t index;
+  uint8_t tracked;
+  uint8_t switches[3];                 // logical switches used by the switch
+  mixsrc_t sources[2];                 // telemetry and timer sources used by the switch
+  getvalue_t lastValues[2];
+};
+
+static LogicalSwitchesPlanItem logicalSwitchesPlan[MAX_LOGICAL_SWITCHES];
+static uint8_t logicalSwitchesPlanCount;
+static uint8_t logicalSwitchesPlanFlightMode;  // the flight mode of the last evaluation, 255 when all switches need to be evaluated
+static bool logicalSwitchesPlanStreaming;
+bool logicalSwitchesPlanDirty = true;
+
+static uint8_t getSwitchLogicalSwitch(swsrc_t swtch)
+{
+  swsrc_t idx = abs(swtch);
+  if (idx >= SWSRC_FIRST_LOGICAL_SWITCH && idx <= SWSRC_LAST_LOGICAL_SWITCH)
+    return idx - SWSRC_FIRST_LOGICAL_SWITCH;
+  else
+    return LS_PLAN_NONE;
+}
+
+static uint8_t getSourceLogicalSwitch(mixsrc_t source)
+{
+  if (source >= MIXSRC_FIRST_LOGICAL_SWITCH && source <= MIXSRC_LAST_LOGICAL_SWITCH)
+    return source - MIXSRC_FIRST_LOGICAL_SWITCH;
+  else
+    return LS_PLAN_NONE;
+}
+
+// the timer or telemetry source whose changes are checked, MIXSRC_NONE otherwise
+static mixsrc_t getTrackedValueSource(mixsrc_t source)
+{
+  if ((source >= MIXSRC_FIRST_TIMER && source <= MIXSRC_LAST_TIMER) || (source >= MIXSRC_FIRST_TELEM && source <= MIXSRC_LAST_TELEM))
+    return source;
+  else
+    return MIXSRC_NONE;
+}
+
+// whether the changes of a switch used by a logical switch are known
+static bool isSwitchTracked(swsrc_t swtch, const bool * evaluated)
+{
+  swsrc_t idx = abs(swtch);
+  uint8_t ls = getSwitchLogicalSwitch(swtch);
+  if (ls != LS_PLAN_NONE)
+    return evaluated[ls];
+  else
+    return (idx == SWSRC_NONE || idx == SWSRC_ON);
+}
+
+// whether the changes of a source used by a logical switch are known
+static bool isSourceTracked(mixsrc_t source, const bool * evaluated)
+{
+  uint8_t ls = getSourceLogicalSwitch(source);
+  if (ls != LS_PLAN_NONE)
+    return evaluated[ls];
+  else
+    return getTrackedValueSource(source) != MIXSRC_NONE;
+}
+
+static void addLogicalSwitchToPlan(uint8_t idx, const uint8_t * switches, const bool * evaluated)
+{
+  LogicalSwitchData * ls = lswAddress(idx);
+  LogicalSwitchesPlanItem & item = logicalSwitchesPlan[logicalSwitchesPlanCount++];
+  uint8_t family = lswFamily(ls->func);
+
+  item.index = idx;
+  memcpy(item.switches, switches, sizeof(item.switches));
+  item.sources[0] = item.sources[1] = MIXSRC_NONE;
+  item.tracked = (ls->delay == 0 && ls->duration == 0 && isSwitchTracked(ls->andsw, evaluated));
+
+  if (family == LS_FAMILY_BOOL) {
+    item.tracked = item.tracked && isSwitchTracked(ls->v1, evaluated) && isSwitchTracked(ls->v2, evaluated);
+  }
+  else if (family == LS_FAMILY_OFS) {
+    item.tracked = item.tracked && isSourceTracked(ls->v1, evaluated);
+    item.sources[0] = getTrackedValueSource(ls->v1);
+  }
+  else if (family == LS_FAMILY_COMP) {
+    item.tracked = item.tracked && isSourceTracked(ls->v1, evaluated) && isSourceTracked(ls->v2, evaluated);
+    item.sources[0] = getTrackedValueSource(ls->v1);
+    item.sources[1] = getTrackedValueSource(ls->v2);
+  }
+  else {
+    // the other families have a state
+    item.tracked = false;
+  }
+}
+
+void buildLogicalSwitchesPlan()
+{
+  uint8_t switches[MAX_LOGICAL_SWITCHES][3];
+  bool evaluated[MAX_LOGICAL_SWITCHES];
+  uint8_t remaining = 0;
+
+  logicalSwitchesPlanDirty = false;
+  logicalSwitchesPlanCount = 0;
+  logicalSwitchesPlanFlightMode = 255;
+
+  for (uint8_t idx=0; idx<MAX_LOGICAL_SWITCHES; idx++) {
+    LogicalSwitchData * ls = lswAddress(idx);
+    uint8_t family = lswFamily(ls->func);
+
+    memset(switches[idx], LS_PLAN_NONE, sizeof(switches[idx]));
+    if (ls->func == LS_FUNC_NONE) {
+      // an unused switch is off
+      evaluated[idx] = true;
+      for (uint8_t fm=0; fm<MAX_FLIGHT_MODES; fm++) {
+        memclear(&lswFm[fm].lsw[idx], sizeof(LogicalSwitchContext));
+        LS_LAST_VALUE(fm, idx) = CS_LAST_VALUE_INIT;
+      }
+      continue;
+    }
+
+    evaluated[idx] = false;
+    remaining++;
+    switches[idx][0] = getSwitchLogicalSwitch(ls->andsw);
+    if (family == LS_FAMILY_BOOL) {
+      switches[idx][1] = getSwitchLogicalSwitch(ls->v1);
+      switches[idx][2] = getSwitchLogicalSwitch(ls->v2);
+    }
+    else if (family == LS_FAMILY_OFS || family == LS_FAMILY_DIFF) {
+      switches[idx][1] = getSourceLogicalSwitch(ls->v1);
+    }
+    else if (family == LS_FAMILY_COMP) {
+      switches[idx][1] = getSourceLogicalSwitch(ls->v1);
+      switches[idx][2] = getSourceLogicalSwitch(ls->v2);
+    }
+  }
+
+  while (remaining > 0) {
+    // the first switch whose switches are evaluated, or the first
+    // remaining one when they are in a loop
+    uint8_t next = LS_PLAN_NONE;
+    for (uint8_t idx=0; idx<MAX_LOGICAL_SWITCHES; idx++) {
+      if (evaluated[idx])
+        continue;
+      if (next == LS_PLAN_NONE)
+        next = idx;
+      bool ready = true;
+      for (uint8_t i=0; i<3; i++) {
+        uint8_t ls = switches[idx][i];
+        if (ls != LS_PLAN_NONE && ls != idx && !evaluated[ls]) {
+          ready = false;
+          break;
+        }
+      }
+      if (ready) {
+        next = idx;
+        break;
+      }
+    }
+    addLogicalSwitchToPlan(next, switches[next], evaluated);
+    evaluated[next] = true;
+    remaining--;
+  }
+}
+
 /**
   @brief Calculates new state of logical switches for mixerCurrentFlightMode
 */
 void evalLogicalSwitches(bool isCurrentPhase)
 {
-  for (unsigned int idx=0; idx<MAX_LOGICAL_SWITCHES; idx++) {
+  if (logicalSwitchesPlanDirty) {
+    buildLogicalSwitchesPlan();
+  }
+
+  // the telemetry switches are off when the telemetry is lost
+  bool streaming = TELEMETRY_STREAMING();
+  bool all = (logicalSwitchesPlanFlightMode != mixerCurrentFlightMode || logicalSwitchesPlanStreaming != streaming);
+  logicalSwitchesPlanFlightMode = mixerCurrentFlightMode;
+  logicalSwitchesPlanStreaming = streaming;
+
+  bool changed[MAX_LOGICAL_SWITCHES];
+  memclear(changed, sizeof(changed));
+
+  for (uint8_t i=0; i<logicalSwitchesPlanCount; i++) {
+    LogicalSwitchesPlanItem & item = logicalSwitchesPlan[i];
+    uint8_t idx = item.index;
+
+    if (item.tracked) {
+      bool unchanged = !all;
+      for (uint8_t j=0; j<3 && unchanged; j++) {
+        if (item.switches[j] != LS_PLAN_NONE && changed[item.switches[j]])
+          unchanged = false;
+      }
+      for (uint8_t j=0; j<2; j++) {
+        if (item.sources[j] != MIXSRC_NONE) {
+          // the value the switch is evaluated with
+          getvalue_t value = getSnapshotValue(item.sources[j]);
+          if (value != item.lastValues[j]) {
+            item.lastValues[j] = value;
+            unchanged = false;
+          }
+        }
+      }
+      if (unchanged)
+        continue;
+    }
+
     LogicalSwitchContext & context = lswFm[mixerCurrentFlightMode].lsw[idx];
     bool result = getLogicalSwitch(idx);
     if (isCurrentPhase) {
@@ -647,6 +850,7 @@ void evalLogicalSwitches(bool isCurrentPhase)
         if (context.state) PLAY_LOGICAL_SWITCH_OFF(idx);
       }
     }
+    changed[idx] = (context.state != result);
     context.state = result;
   }
 }
@@ -1063,6 +1267,7 @@ void logicalSwitchesReset()
 #if defined(CPUARM)
   flightModeTransitionLast = 255;
   memset(lswFm, 0, sizeof(lswFm));
+  invalidateLogicalSwitchesPlan();
 #else
   s_last_switch_value = 0;
 #endif
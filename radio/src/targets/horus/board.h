@@ -376,6 +376,7 @@ void DMACopyAlphaBitmap(uint16_t * dest, uint16_t destw, uint16_t x, uint16_t y,
 void DMABitmapConvert(uint16_t * dest, const uint8_t * src, uint16_t w, uint16_t h, uint32_t format);
 void lcdStoreBackupBuffer(void);
 int lcdRestoreBackupBuffer(void);
+bool lcdRestoreLastFrame(void);
 void lcdSetContrast();
 #define lcdOff(...)
 #define lcdSetRefVolt(...)
@@ -424,6 +425,8 @@ void telemetryPortInit(uint32_t baudrate, uint8_t mode);
 void telemetryPortSetDirectionOutput(void);
 void sportSendBuffer(uint8_t * buffer, uint32_t count);
 uint8_t telemetryGetByte(uint8_t * byte);
+uint32_t telemetryPeekData(const uint8_t ** data);
+void telemetryConsumeData(uint32_t count);
 
 // Haptic driver
 void hapticInit(void);
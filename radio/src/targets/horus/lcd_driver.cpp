@@ -549,15 +549,50 @@ void lcdStoreBackupBuffer()
 int lcdRestoreBackupBuffer()
 {
   DMAcopy(LCD_BACKUP_FRAME_BUFFER, lcd->getData(), DISPLAY_BUFFER_SIZE);
+  lcd->markDirty(0, 0, LCD_W, LCD_H);
   return 1;
 }
 
+// What changed in the displayed layer when it was drawn. The hidden layer still
+// contains the frame before, so copying these areas is enough to restore the
+// displayed frame, unless this one was drawn over an older frame and didn't
+// cover the whole screen
+DirtyRects lcdFrontDirtyRects;
+bool lcdFrontComplete = false;
+bool lcdBackRestored = false;
+
+bool lcdRestoreLastFrame()
+{
+  if (!lcdFrontComplete) {
+    return false;
+  }
+
+  BitmapBuffer * front = (lcd == &lcdBuffer1 ? &lcdBuffer2 : &lcdBuffer1);
+  for (unsigned int i=0; i<lcdFrontDirtyRects.getCount(); i++) {
+    const DirtyRect & rect = lcdFrontDirtyRects.getRect(i);
+    DMACopyBitmap(lcd->getData(), LCD_W, rect.x, rect.y, front->getData(), LCD_W, rect.x, rect.y, rect.w, rect.h);
+  }
+
+  lcd->getDirtyRects().reset();
+  lcdBackRestored = true;
+  return true;
+}
+
 void lcdRefresh()
 {
+  DirtyRects & dirtyRects = lcd->getDirtyRects();
+  uint32_t dirtyArea = dirtyRects.getArea();
+  lcdFrameStats.endFrame(dirtyArea, lcdBackRestored);
+  lcdFrontDirtyRects = dirtyRects;
+  lcdFrontComplete = lcdBackRestored || dirtyArea == DISPLAY_PIXELS_COUNT;
+
   LCD_SetTransparency(255);
   if (CurrentLayer == LCD_FIRST_LAYER)
     LCD_SetLayer(LCD_SECOND_LAYER);
   else
     LCD_SetLayer(LCD_FIRST_LAYER);
   LCD_SetTransparency(0);
+
+  lcd->getDirtyRects().reset();
+  lcdBackRestored = false;
 }
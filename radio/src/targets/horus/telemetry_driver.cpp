@@ -212,3 +212,20 @@ uint8_t telemetryGetByte(uint8_t * byte)
   else
     return telemetryDMAFifo.pop(*byte);
 }
+
+// The bytes received which can be processed at once
+uint32_t telemetryPeekData(const uint8_t ** data)
+{
+  if (telemetryFifoMode & TELEMETRY_SERIAL_WITHOUT_DMA)
+    return telemetryNoDMAFifo.peekSpan(*data);
+  else
+    return telemetryDMAFifo.peekSpan(*data);
+}
+
+void telemetryConsumeData(uint32_t count)
+{
+  if (telemetryFifoMode & TELEMETRY_SERIAL_WITHOUT_DMA)
+    telemetryNoDMAFifo.consume(count);
+  else
+    telemetryDMAFifo.consume(count);
+}
@@ -536,12 +536,38 @@ void lcdOff()
 }
 #endif
 
+#if defined(PCBHORUS)
+#define LCD_STATS_FRAMES               500
+
+bool lcdLastFrameRestored = false;
+
+bool lcdRestoreLastFrame()
+{
+  // there is only one buffer here, it still contains the frame on screen
+  lcd->getDirtyRects().reset();
+  lcdLastFrameRestored = true;
+  return true;
+}
+#endif
+
 void lcdRefresh()
 {
 #if defined(PCBFLAMENCO)
   TW8823_SendScreen();
 #endif
 
+#if defined(PCBHORUS)
+  lcdFrameStats.endFrame(lcd->getDirtyRects().getArea(), lcdLastFrameRestored);
+  lcd->getDirtyRects().reset();
+  lcdLastFrameRestored = false;
+  if (lcdFrameStats.frames >= LCD_STATS_FRAMES) {
+    TRACE("LCD: %d frames, %d%% partial, %d%% dirty, draw time %dus avg %dus max",
+          lcdFrameStats.frames, lcdFrameStats.partialPercent(), lcdFrameStats.dirtyPercent(),
+          lcdFrameStats.averageDrawTime(), lcdFrameStats.maxDrawTime);
+    lcdFrameStats.reset();
+  }
+#endif
+
   memcpy(simuLcdBuf, displayBuf, sizeof(simuLcdBuf));
   simuLcdRefresh = true;
 }
@@ -560,6 +586,9 @@ void lcdStoreBackupBuffer()
 int lcdRestoreBackupBuffer()
 {
   memcpy(displayBuf, simuLcdBackupBuf, sizeof(displayBuf));
+#if defined(PCBHORUS)
+  lcd->markDirty(0, 0, LCD_W, LCD_H);
+#endif
   return 1;
 }
 #endif
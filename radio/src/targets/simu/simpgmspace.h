@@ -421,6 +421,7 @@ OS_TID CoCreateTask(FUNCPtr task, void *argv, uint32_t parameter, void * stk, ui
 #define CoLeaveMutexSection(m)         pthread_mutex_unlock(&(m))
 
 #define CoSetFlag(...)
+#define isr_SetFlag(...)
 #define CoClearFlag(...)
 #define CoSetTmrCnt(...)
 #define CoEnterISR(...)
@@ -481,6 +482,8 @@ inline void delay_01us(int dummy) { }
 
 #if defined(SIMU_USE_SDCARD)
   void simuFatfsSetPaths(const char * sdPath, const char * settingsPath);
+  void simuFatfsSetPowerCut(int count);
+  int simuFatfsGetPowerCut();
 #else
   #define simuFatfsSetPaths(...)
 #endif
@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// Headless batch simulation: the model is loaded, an input trace is
+// replayed and the mixer, the logical switches, the timers and the
+// functions run on a virtual 10ms clock, as fast as the host allows.
+// The channel outputs of each cycle are written as CSV or binary records.
+//
+// The input trace has one event per line: "<time ms> <input> <args>"
+//   ana <index> <-1024..1024>      sticks, pots and sliders (calibrated)
+//   switch <index> <-1|0|1>
+//   trim <index> <0|1>             trim buttons, pressed / released
+//   key <index> <0|1>
+//   trainer <channel> <value>      as received on the trainer port
+//   sport <hex bytes>              S.Port packet, the checksum may be omitted
+// The inputs keep their value until the next event. Lines starting
+// with '#' are ignored. simubatch-sample.trace has an example of each.
+
+#include "opentx.h"
+#include "timers.h"
+#include "crc.h"
+#include <getopt.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+int16_t g_anas[NUM_STICKS+NUM_POTS+NUM_SLIDERS];
+
+uint16_t anaIn(uint8_t chan)
+{
+  return g_anas[chan];
+}
+
+uint16_t getAnalogValue(uint8_t index)
+{
+  return anaIn(index);
+}
+
+#define BATCH_TRACE_MAGIC     "OTXT"
+#define BATCH_TRACE_VERSION   1
+
+PACK(struct BatchTraceHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t channels;
+  uint8_t logicalSwitches;
+  uint8_t timers;
+});
+
+PACK(struct BatchTraceRecord {
+  uint32_t time;
+  uint8_t flightMode;
+  int16_t channels[MAX_OUTPUT_CHANNELS];
+  uint8_t logicalSwitches[(MAX_LOGICAL_SWITCHES+7)/8];
+  int32_t timers[TIMERS];
+});
+
+struct BatchEvent {
+  uint32_t time;
+  char input[16];
+  int index;
+  int value;
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+};
+
+static void usage(const char * name)
+{
+  fprintf(stderr, "Usage: %s [options] TRACE\n", name);
+#if defined(EEPROM)
+  fprintf(stderr, "  -e, --eeprom FILE      the EEPROM image (never written)\n");
+  fprintf(stderr, "  -m, --model INDEX      the model to load (default the current one)\n");
+#else
+  fprintf(stderr, "  -m, --model FILE       the model to load (default the current one)\n");
+#endif
+  fprintf(stderr, "  -D, --defaults         run the default settings and model instead of the storage\n");
+  fprintf(stderr, "  -s, --sdcard DIR       the SD card directory\n");
+  fprintf(stderr, "  -S, --settings DIR     the RADIO directory, if not on the SD card\n");
+  fprintf(stderr, "  -o, --output FILE      the outputs (default stdout)\n");
+  fprintf(stderr, "  -b, --binary           write binary records instead of CSV\n");
+  fprintf(stderr, "  -d, --duration MS      the duration (default the last event)\n");
+}
+
+static bool parseEvent(const char * line, BatchEvent & event)
+{
+  unsigned int time;
+  char args[64];
+  int count = sscanf(line, "%u %15s %63[^\n]", &time, event.input, args);
+  if (count < 2) {
+    return false;
+  }
+  event.time = time;
+
+  if (!strcmp(event.input, "sport")) {
+    unsigned int len = 0;
+    for (const char * c=args; count==3 && *c && len<FRSKY_SPORT_PACKET_SIZE; ) {
+      unsigned int byte;
+      int n;
+      if (sscanf(c, " %2x%n", &byte, &n) != 1)
+        break;
+      event.packet[len++] = byte;
+      c += n;
+    }
+    if (len == FRSKY_SPORT_PACKET_SIZE-1) {
+      event.packet[len++] = 0xFF - sportChecksum(event.packet+1, FRSKY_SPORT_PACKET_SIZE-2);
+    }
+    return len == FRSKY_SPORT_PACKET_SIZE;
+  }
+
+  return count == 3 && sscanf(args, "%d %d", &event.index, &event.value) == 2;
+}
+
+static bool applyEvent(const BatchEvent & event)
+{
+  if (!strcmp(event.input, "ana")) {
+    if (event.index < 0 || event.index >= NUM_STICKS+NUM_POTS+NUM_SLIDERS)
+      return false;
+    // the simulator inputs are already calibrated
+    g_anas[event.index] = limit(-RESX, event.value, RESX);
+  }
+  else if (!strcmp(event.input, "switch")) {
+    simuSetSwitch(event.index, event.value);
+  }
+  else if (!strcmp(event.input, "trim")) {
+    simuSetTrim(event.index, event.value);
+  }
+  else if (!strcmp(event.input, "key")) {
+    simuSetKey(event.index, event.value);
+  }
+  else if (!strcmp(event.input, "trainer")) {
+    if (event.index < 0 || event.index >= MAX_TRAINER_CHANNELS)
+      return false;
+    ppmInput[event.index] = event.value;
+    ppmInputValidityTimer = PPM_IN_VALID_TIMEOUT;
+  }
+#if defined(TELEMETRY_FRSKY_SPORT)
+  else if (!strcmp(event.input, "sport")) {
+    sportProcessTelemetryPacket(event.packet);
+  }
+#endif
+  else {
+    return false;
+  }
+  return true;
+}
+
+static void writeCsvHeader(FILE * output)
+{
+  fprintf(output, "Time,FM");
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    fprintf(output, ",CH%d", i+1);
+  }
+  for (int i=0; i<TIMERS; i++) {
+    fprintf(output, ",T%d", i+1);
+  }
+  fprintf(output, ",LS\n");
+}
+
+static void writeCsvRecord(FILE * output, uint32_t time)
+{
+  fprintf(output, "%u,%d", time, mixerCurrentFlightMode);
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    fprintf(output, ",%d", channelOutputs[i]);
+  }
+  for (int i=0; i<TIMERS; i++) {
+    fprintf(output, ",%d", (int)timersStates[i].val);
+  }
+  // LS1 first
+  fputc(',', output);
+  for (int i=0; i<MAX_LOGICAL_SWITCHES; i++) {
+    fputc(getSwitch(SWSRC_SW1+i) ? '1' : '0', output);
+  }
+  fputc('\n', output);
+}
+
+static void writeBinaryHeader(FILE * output)
+{
+  BatchTraceHeader header;
+  memcpy(header.magic, BATCH_TRACE_MAGIC, sizeof(header.magic));
+  header.version = BATCH_TRACE_VERSION;
+  header.channels = MAX_OUTPUT_CHANNELS;
+  header.logicalSwitches = MAX_LOGICAL_SWITCHES;
+  header.timers = TIMERS;
+  fwrite(&header, sizeof(header), 1, output);
+}
+
+static void writeBinaryRecord(FILE * output, uint32_t time)
+{
+  BatchTraceRecord record;
+  memclear(&record, sizeof(record));
+  record.time = time;
+  record.flightMode = mixerCurrentFlightMode;
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    record.channels[i] = channelOutputs[i];
+  }
+  for (int i=0; i<MAX_LOGICAL_SWITCHES; i++) {
+    if (getSwitch(SWSRC_SW1+i)) {
+      record.logicalSwitches[i/8] |= 1 << (i%8);
+    }
+  }
+  for (int i=0; i<TIMERS; i++) {
+    record.timers[i] = timersStates[i].val;
+  }
+  fwrite(&record, sizeof(record), 1, output);
+}
+
+#if defined(PCBHORUS)
+// The batch doesn't draw the top bar, it only needs one to load the
+// model: it gets its own zeroed data, not the packed g_model member
+static void createTopbar()
+{
+  static Topbar::PersistentData topbarData;
+  topbar = new Topbar(&topbarData);
+}
+#endif
+
+// The storage is loaded without the startup checks, and never written:
+// a model which can't be read stops the batch instead of being replaced
+// by a default one
+#if defined(EEPROM)
+static bool loadStorage(const char * eepromPath, const char * model)
+{
+  FILE * f = fopen(eepromPath, "rb");
+  if (!f) {
+    perror(eepromPath);
+    return false;
+  }
+  size_t size = fread(eeprom, 1, EEPROM_SIZE, f);
+  fclose(f);
+  if (size == 0) {
+    fprintf(stderr, "%s: empty EEPROM\n", eepromPath);
+    return false;
+  }
+
+  // the eventual conversion is written in memory only
+  StartEepromThread(NULL);
+
+  if (!eepromOpen() || !eeLoadGeneral()) {
+    fprintf(stderr, "%s: invalid EEPROM\n", eepromPath);
+    return false;
+  }
+
+#if defined(CPUARM)
+  eeLoadModelHeaders();
+#endif
+  int index = (model ? atoi(model) - 1 : g_eeGeneral.currModel);
+  if (index < 0 || index >= MAX_MODELS || !eeModelExists(index)) {
+    fprintf(stderr, "%s: no model %d\n", eepromPath, index + 1);
+    return false;
+  }
+
+  g_eeGeneral.currModel = index;
+  eeLoadModel(index);
+  return true;
+}
+#else
+static bool loadStorage(const char * model)
+{
+  const char * error = loadRadioSettingsSettings();
+  if (error) {
+    fprintf(stderr, "%s: %s\n", RADIO_SETTINGS_PATH, error);
+    return false;
+  }
+
+  if (model) {
+    strncpy(g_eeGeneral.currModelFilename, model, sizeof(g_eeGeneral.currModelFilename));
+  }
+
+  char filename[sizeof(g_eeGeneral.currModelFilename)+1];
+  memset(filename, 0, sizeof(filename));
+  memcpy(filename, g_eeGeneral.currModelFilename, sizeof(g_eeGeneral.currModelFilename));
+
+  static ModelData modelData;
+  error = readModel(filename, (uint8_t *)&modelData, sizeof(modelData));
+  if (error) {
+    fprintf(stderr, "%s: %s\n", filename, error);
+    return false;
+  }
+
+#if defined(PCBHORUS)
+  createTopbar();
+#endif
+
+  loadModel(filename, false);
+  return true;
+}
+#endif
+
+// The default model of a new radio, no storage is read
+static void loadDefaults()
+{
+  generalDefault();
+#if defined(PCBHORUS)
+  createTopbar();
+#endif
+  preModelLoad();
+  modelDefault(0);
+  postModelLoad(false);
+}
+
+int main(int argc, char ** argv)
+{
+  static const struct option options[] = {
+    { "eeprom", required_argument, NULL, 'e' },
+    { "defaults", no_argument, NULL, 'D' },
+    { "sdcard", required_argument, NULL, 's' },
+    { "settings", required_argument, NULL, 'S' },
+    { "model", required_argument, NULL, 'm' },
+    { "output", required_argument, NULL, 'o' },
+    { "binary", no_argument, NULL, 'b' },
+    { "duration", required_argument, NULL, 'd' },
+    { NULL, 0, NULL, 0 }
+  };
+
+#if defined(EEPROM)
+  const char * eepromPath = "eeprom.bin";
+#endif
+  const char * sdPath = ".";
+  const char * settingsPath = NULL;
+  const char * model = NULL;
+  const char * outputPath = NULL;
+  bool defaults = false;
+  bool binary = false;
+  long duration = -1;
+
+  int option;
+  while ((option = getopt_long(argc, argv, "e:Ds:S:m:o:bd:", options, NULL)) != -1) {
+    switch (option) {
+#if defined(EEPROM)
+      case 'e':
+        eepromPath = optarg;
+        break;
+#endif
+      case 'D':
+        defaults = true;
+        break;
+      case 's':
+        sdPath = optarg;
+        break;
+      case 'S':
+        settingsPath = optarg;
+        break;
+      case 'm':
+        model = optarg;
+        break;
+      case 'o':
+        outputPath = optarg;
+        break;
+      case 'b':
+        binary = true;
+        break;
+      case 'd':
+        duration = atol(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  FILE * trace = fopen(argv[optind], "r");
+  if (!trace) {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  std::vector<BatchEvent> events;
+  char line[256];
+  for (int number=1; fgets(line, sizeof(line), trace); number++) {
+    const char * c = line;
+    while (*c == ' ' || *c == '\t')
+      c++;
+    if (*c == '#' || *c == '\n' || *c == '\r' || *c == '\0')
+      continue;
+    BatchEvent event;
+    if (!parseEvent(c, event) || (!events.empty() && event.time < events.back().time)) {
+      fprintf(stderr, "%s:%d: invalid event\n", argv[optind], number);
+      fclose(trace);
+      return 1;
+    }
+    events.push_back(event);
+  }
+  fclose(trace);
+
+  if (duration < 0) {
+    duration = events.empty() ? 0 : events.back().time;
+  }
+
+  FILE * output;
+  if (outputPath) {
+    output = fopen(outputPath, binary ? "wb" : "w");
+    if (!output) {
+      perror(outputPath);
+      return 1;
+    }
+  }
+  else {
+    // the records keep stdout, the traces of the firmware go to stderr
+    fflush(stdout);
+    output = fdopen(dup(STDOUT_FILENO), binary ? "wb" : "w");
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+  }
+
+  simuInit();
+  for (int i=0; i<(NUM_STICKS+NUM_AUX_TRIMS)*2; i++) {
+    simuSetTrim(i, false);
+  }
+  main_thread_running = 1;
+  g_tmr10ms = 1;
+
+  simuFatfsSetPaths(sdPath, settingsPath);
+  bool loaded;
+  if (defaults) {
+    loadDefaults();
+    loaded = true;
+  }
+  else {
+#if defined(EEPROM)
+    loaded = loadStorage(eepromPath, model);
+#else
+    loaded = loadStorage(model);
+#endif
+  }
+  if (!loaded) {
+    return 1;
+  }
+
+  if (binary)
+    writeBinaryHeader(output);
+  else
+    writeCsvHeader(output);
+
+  auto start = std::chrono::steady_clock::now();
+
+  unsigned int next = 0;
+  uint32_t cycles = 0;
+  for (uint32_t time=0; time<=(uint32_t)duration; time+=10, cycles++) {
+    for (; next<events.size() && events[next].time<=time; next++) {
+      if (!applyEvent(events[next])) {
+        fprintf(stderr, "%u: invalid %s event ignored\n", events[next].time, events[next].input);
+      }
+    }
+
+    per10ms();
+    doMixerCalculations();
+#if defined(CPUARM) && (defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK))
+    telemetryWakeup();
+#endif
+
+    if (binary)
+      writeBinaryRecord(output, time);
+    else
+      writeCsvRecord(output, time);
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  fprintf(stderr, "%u cycles (%ums) simulated in %ldus\n", cycles, cycles * 10, elapsed);
+
+  fclose(output);
+
+  return 0;
+}
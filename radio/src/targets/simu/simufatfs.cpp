@@ -60,6 +60,7 @@ namespace simu {
 
 std::string simuSdDirectory;          // path to the root of the SD card image
 std::string simuSettingsDirectory;    // path to the root of the models and settings (only for the radios that use SD for model storage)
+int simuFatfsPowerCut = -1;           // bytes written or files changed before a simulated power loss
 
 bool isPathDelimiter(char delimiter)
 {
@@ -84,6 +85,28 @@ std::string fixPathDelimiters(const char * path)
   return result;
 }
 
+// simulates a power loss after <count> bytes written or files changed, -1 for no power loss
+void simuFatfsSetPowerCut(int count)
+{
+  simuFatfsPowerCut = count;
+}
+
+int simuFatfsGetPowerCut()
+{
+  return simuFatfsPowerCut;
+}
+
+// the part of a change done before the power loss
+static unsigned int powerCutLimit(unsigned int count)
+{
+  if (simuFatfsPowerCut < 0) {
+    return count;
+  }
+  unsigned int result = std::min<unsigned int>(count, simuFatfsPowerCut);
+  simuFatfsPowerCut -= result;
+  return result;
+}
+
 void simuFatfsSetPaths(const char * sdPath, const char * settingsPath)
 {
   if (sdPath) {
@@ -146,6 +169,7 @@ std::string convertFromSimuPath(const char * path)
 typedef std::map<std::string, std::string> filemap_t;
 
 filemap_t fileMap;
+pthread_mutex_t fileMapMutex = PTHREAD_MUTEX_INITIALIZER;  // the storage task writes while the menus read
 
 void splitPath(const std::string & path, std::string & dir, std::string & name)
 {
@@ -231,10 +255,12 @@ std::string findTrueFileName(const std::string & path)
 {
   TRACE_SIMPGMSPACE("findTrueFileName(%s)", path.c_str());
   std::string result;
+  pthread_mutex_lock(&fileMapMutex);
   filemap_t::iterator i = fileMap.find(path);
   if (i != fileMap.end()) {
     result = i->second;
     TRACE_SIMPGMSPACE("\tfound in map: %s", result.c_str());
+    pthread_mutex_unlock(&fileMapMutex);
     return result;
   }
   else {
@@ -247,14 +273,25 @@ std::string findTrueFileName(const std::string & path)
       if (!strcasecmp(files[i].c_str(), path.c_str())) {
         TRACE_SIMPGMSPACE("\tfound: %s", files[i].c_str());
         fileMap.insert(filemap_t::value_type(path, files[i]));
+        pthread_mutex_unlock(&fileMapMutex);
         return files[i];
       }
     }
   }
+  pthread_mutex_unlock(&fileMapMutex);
   TRACE_SIMPGMSPACE("\tnot found");
   return std::string(path);
 }
 
+static void setFileInfoTime(FILINFO * fno, const struct stat & st)
+{
+  // convert to FatFs fdate/ftime
+  struct tm *ltime = localtime(&st.st_mtime);
+  fno->fdate = ((ltime->tm_year - 80) << 9) | ((ltime->tm_mon + 1) << 5) | ltime->tm_mday;
+  fno->ftime = (ltime->tm_hour << 11) | (ltime->tm_min << 5) | (ltime->tm_sec / 2);
+  fno->fsize = (DWORD)st.st_size;
+}
+
 FRESULT f_stat (const TCHAR * name, FILINFO *fno)
 {
   std::string path = convertToSimuPath(name);
@@ -268,11 +305,7 @@ FRESULT f_stat (const TCHAR * name, FILINFO *fno)
     TRACE_SIMPGMSPACE("f_stat(%s) = OK", path.c_str());
     if (fno) {
       fno->fattrib = (tmp.st_mode & S_IFDIR) ? AM_DIR : 0;
-      // convert to FatFs fdate/ftime
-      struct tm *ltime = localtime(&tmp.st_mtime);
-      fno->fdate = ((ltime->tm_year - 80) << 9) | ((ltime->tm_mon + 1) << 5) | ltime->tm_mday;
-      fno->ftime = (ltime->tm_hour << 11) | (ltime->tm_min << 5) | (ltime->tm_sec / 2);
-      fno->fsize = (DWORD)tmp.st_size;
+      setFileInfoTime(fno, tmp);
     }
     return FR_OK;
   }
@@ -288,16 +321,29 @@ FRESULT f_open (FIL * fil, const TCHAR *name, BYTE flag)
   std::string path = convertToSimuPath(name);
   std::string realPath = findTrueFileName(path);
   fil->obj.fs = 0;
+  if ((flag & FA_WRITE) && powerCutLimit(1) == 0) {
+    TRACE_SIMPGMSPACE("f_open(%s) = DISK_ERR (power cut)", path.c_str());
+    return FR_DISK_ERR;
+  }
+  struct stat tmp;
+  bool exists = (stat(realPath.c_str(), &tmp) == 0);
   if (!(flag & FA_WRITE)) {
-    struct stat tmp;
-    if (stat(realPath.c_str(), &tmp)) {
+    if (!exists) {
       TRACE_SIMPGMSPACE("f_open(%s) = INVALID_NAME (FIL %p)", path.c_str(), fil);
       return FR_INVALID_NAME;
     }
     fil->obj.objsize = tmp.st_size;
     fil->fptr = 0;
   }
-  fil->obj.fs = (FATFS*)fopen(realPath.c_str(), (flag & FA_WRITE) ? ((flag & FA_CREATE_ALWAYS) ? "wb+" : "ab+") : "rb+");
+  const char * mode = "rb+";
+  if (flag & FA_WRITE) {
+    // an existing file opened without FA_OPEN_APPEND is written where f_lseek() sets the pointer
+    if (flag & FA_CREATE_ALWAYS)
+      mode = "wb+";
+    else if ((flag & FA_OPEN_APPEND) == FA_OPEN_APPEND || !exists)
+      mode = "ab+";
+  }
+  fil->obj.fs = (FATFS*)fopen(realPath.c_str(), mode);
   fil->fptr = 0;
   if (fil->obj.fs) {
     TRACE_SIMPGMSPACE("f_open(%s, %x) = %p (FIL %p)", path.c_str(), flag, fil->obj.fs, fil);
@@ -320,9 +366,13 @@ FRESULT f_read (FIL* fil, void* data, UINT size, UINT* read)
 FRESULT f_write (FIL* fil, const void* data, UINT size, UINT* written)
 {
   if (fil && fil->obj.fs) {
-    *written = fwrite(data, 1, size, (FILE*)fil->obj.fs);
-    fil->fptr += size;
+    UINT count = powerCutLimit(size);
+    *written = fwrite(data, 1, count, (FILE*)fil->obj.fs);
+    fil->fptr += count;
     // TRACE_SIMPGMSPACE("fwrite(%p) %u, %u", fil->obj.fs, size, *written);
+    if (count < size) {
+      return FR_DISK_ERR;
+    }
   }
   return FR_OK;
 }
@@ -424,6 +474,15 @@ FRESULT f_readdir (DIR * rep, FILINFO * fil)
   }
 #endif
 
+  fil->fdate = fil->ftime = 0;
+  fil->fsize = 0;
+#if !MSVC_BUILD
+  struct stat st;
+  if (fstatat(simu::dirfd((simu::DIR *)rep->obj.fs), ent->d_name, &st, 0) == 0) {
+    setFileInfoTime(fil, st);
+  }
+#endif
+
   memset(fil->fname, 0, SD_SCREEN_FILE_LENGTH);
   strcpy(fil->fname, ent->d_name);
   // TRACE_SIMPGMSPACE("f_readdir(): %s", fil->fname);
@@ -439,6 +498,9 @@ FRESULT f_mkfs (const TCHAR* path, BYTE opt, DWORD au, void* work, UINT len)
 FRESULT f_mkdir (const TCHAR * name)
 {
   std::string path = convertToSimuPath(name);
+  if (powerCutLimit(1) == 0) {
+    return FR_DISK_ERR;
+  }
 #if defined(WIN32) && defined(__GNUC__)
   if (mkdir(path.c_str())) {
 #else
@@ -457,6 +519,9 @@ FRESULT f_mkdir (const TCHAR * name)
 FRESULT f_unlink (const TCHAR * name)
 {
   std::string path = convertToSimuPath(name);
+  if (powerCutLimit(1) == 0) {
+    return FR_DISK_ERR;
+  }
   if (unlink(path.c_str())) {
     TRACE_SIMPGMSPACE("f_unlink(%s) = error %d (%s)", path.c_str(), errno, strerror(errno));
     return FR_INVALID_NAME;
@@ -472,6 +537,9 @@ FRESULT f_rename(const TCHAR *oldname, const TCHAR *newname)
   std::string old = convertToSimuPath(oldname);
   std::string path = convertToSimuPath(newname);
 
+  if (powerCutLimit(1) == 0) {
+    return FR_DISK_ERR;
+  }
   if (rename(old.c_str(), path.c_str()) < 0) {
     TRACE_SIMPGMSPACE("f_rename(%s, %s) = error %d (%s)", old.c_str(), path.c_str(), errno, strerror(errno));
     return FR_INVALID_NAME;
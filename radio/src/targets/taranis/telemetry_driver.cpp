@@ -186,3 +186,28 @@ uint8_t telemetryGetByte(uint8_t * byte)
   return telemetryFifo.pop(*byte);
 #endif
 }
+
+// The bytes received which can be processed at once
+uint32_t telemetryPeekData(const uint8_t ** data)
+{
+#if defined(SERIAL2)
+  if (telemetryProtocol == PROTOCOL_FRSKY_D_SECONDARY) {
+    if (serial2Mode == UART_MODE_TELEMETRY)
+      return serial2RxFifo.peekSpan(*data);
+    else
+      return 0;
+  }
+#endif
+  return telemetryFifo.peekSpan(*data);
+}
+
+void telemetryConsumeData(uint32_t count)
+{
+#if defined(SERIAL2)
+  if (telemetryProtocol == PROTOCOL_FRSKY_D_SECONDARY) {
+    serial2RxFifo.consume(count);
+    return;
+  }
+#endif
+  telemetryFifo.consume(count);
+}
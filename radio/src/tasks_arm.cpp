@@ -35,6 +35,11 @@ OS_TID btTaskId;
 TaskStack<BLUETOOTH_STACK_SIZE> bluetoothStack;
 #endif
 
+#if !defined(EEPROM)
+OS_TID storageTaskId;
+TaskStack<STORAGE_STACK_SIZE> storageStack;
+#endif
+
 OS_MutexID audioMutex;
 OS_MutexID mixerMutex;
 
@@ -44,6 +49,7 @@ enum TaskIndex {
   AUDIO_TASK_INDEX,
   CLI_TASK_INDEX,
   BLUETOOTH_TASK_INDEX,
+  STORAGE_TASK_INDEX,
   TASK_INDEX_COUNT,
   MAIN_TASK_INDEX = 255
 };
@@ -74,6 +80,9 @@ void stackPaint()
   menusStack.paint();
   mixerStack.paint();
   audioStack.paint();
+#if !defined(EEPROM)
+  storageStack.paint();
+#endif
 #if defined(CLI)
   cliStack.paint();
 #endif
@@ -117,11 +126,21 @@ bool isForcePowerOffRequested()
   return false;
 }
 
-uint32_t nextMixerTime[NUM_MODULES];
+OS_FlagID mixerFlag;
+
+#if defined(PCBTARANIS)
+inline bool isSbusInputPolled()
+{
+#if defined(SERIAL2)
+  return currentTrainerMode == TRAINER_MODE_MASTER_SBUS_EXTERNAL_MODULE || currentTrainerMode == TRAINER_MODE_MASTER_BATTERY_COMPARTMENT;
+#else
+  return currentTrainerMode == TRAINER_MODE_MASTER_SBUS_EXTERNAL_MODULE;
+#endif
+}
+#endif
 
 void mixerTask(void * pdata)
 {
-  static uint32_t lastRunTime;
   s_pulses_paused = true;
 
   while(1) {
@@ -135,34 +154,35 @@ void mixerTask(void * pdata)
     processSbusInput();
 #endif
 
-    CoTickDelay(1);
-
     if (isForcePowerOffRequested()) {
       pwrOff();
     }
 
     uint32_t now = CoGetOSTime();
-    bool run = false;
-    if ((now - lastRunTime) > 10) {     // run at least every 20ms
-      run = true;
-    }
-    else if (now == nextMixerTime[0]) {
-      run = true;
-    }
-#if NUM_MODULES >= 2
-    else if (now == nextMixerTime[1]) {
-      run = true;
-    }
+    int32_t timeout = mixerScheduler.getTimeout(now);
+    if (timeout > 0) {
+#if defined(PCBTARANIS)
+      // the SBUS frames are split by looking at the gaps between bytes
+      if (isSbusInputPolled()) {
+        timeout = 1;
+      }
+#endif
+      // woken up earlier by scheduleNextMixerCalculation()
+#if defined(SIMU)
+      CoTickDelay(1);
+#else
+      CoWaitForSingleFlag(mixerFlag, timeout);
 #endif
-    if (!run) {
       continue;  // go back to sleep
     }
 
-    lastRunTime = now;
+    mixerScheduler.start(now);
 
     if (!s_pulses_paused) {
       uint16_t t0 = getTmr2MHz();
 
+      mixerProfiler.startCycle();
+
       DEBUG_TIMER_START(debugTimerMixer);
       CoEnterMutexSection(mixerMutex);
       doMixerCalculations();
@@ -173,7 +193,9 @@ void mixerTask(void * pdata)
 
 #if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
       DEBUG_TIMER_START(debugTimerTelemetryWakeup);
+      MIXER_PROFILE_START(MIXER_STAGE_TELEMETRY);
       telemetryWakeup();
+      MIXER_PROFILE_STOP(MIXER_STAGE_TELEMETRY);
       DEBUG_TIMER_STOP(debugTimerTelemetryWakeup);
 #endif
 
@@ -182,17 +204,23 @@ void mixerTask(void * pdata)
         heartbeat = 0;
       }
 
+      mixerProfiler.endCycle();
+
       t0 = getTmr2MHz() - t0;
       if (t0 > maxMixerDuration) maxMixerDuration = t0 ;
+      mixerScheduler.updateDuration(t0 / 2);
     }
   }
 }
 
-void scheduleNextMixerCalculation(uint8_t module, uint16_t delay)
+void scheduleNextMixerCalculation(uint8_t module, uint16_t period)
 {
-  // Schedule next mixer calculation time,
-  // for now assume mixer calculation takes 2 ms.
-  nextMixerTime[module] = (uint32_t)CoGetOSTime() + (delay)/2 - 1/*2ms*/;
+  // Schedule next mixer calculation time, so that it ends just
+  // before the next frame of this module
+  uint32_t now = CoGetOSTime();
+  mixerScheduler.schedule(module, now, period);
+  mixerProfiler.schedule(module, mixerScheduler.getWakeupTime(module) - now);
+  isr_SetFlag(mixerFlag);
   DEBUG_TIMER_STOP(debugTimerMixerCalcToUsage);
 }
 
@@ -221,6 +249,12 @@ void menusTask(void * pdata)
     DEBUG_TIMER_STOP(debugTimerPerMain);
     // TODO remove completely massstorage from sky9x firmware
     uint32_t runtime = ((uint32_t)CoGetOSTime() - start);
+#if defined(BINARY_LOGS)
+    // one sector of logs is written to the SD card on each cycle, even a busy
+    // one: it's more than the records written meanwhile (one per 100ms at most)
+    logsFlush();
+    runtime = ((uint32_t)CoGetOSTime() - start);
+#endif
     // deduct the thread run-time from the wait, if run-time was more than
     // desired period, then skip the wait all together
     if (runtime < MENU_TASK_PERIOD_TICKS) {
@@ -262,11 +296,16 @@ void tasksStart()
   btTaskId = CoCreateTask(btTask, NULL, 15, &bluetoothStack.stack[BLUETOOTH_STACK_SIZE-1], BLUETOOTH_STACK_SIZE);
 #endif
 
+  mixerFlag = CoCreateFlag(true, false);
   mixerTaskId = CoCreateTask(mixerTask, NULL, 5, &mixerStack.stack[MIXER_STACK_SIZE-1], MIXER_STACK_SIZE);
   menusTaskId = CoCreateTask(menusTask, NULL, 10, &menusStack.stack[MENUS_STACK_SIZE-1], MENUS_STACK_SIZE);
 #if !defined(SIMU)
   // TODO move the SIMU audio in this task
   audioTaskId = CoCreateTask(audioTask, NULL, 7, &audioStack.stack[AUDIO_STACK_SIZE-1], AUDIO_STACK_SIZE);
+#endif
+#if !defined(EEPROM)
+  // lowest priority, the model and the settings are written when the other tasks are idle
+  storageTaskId = CoCreateTask(storageTask, NULL, 20, &storageStack.stack[STORAGE_STACK_SIZE-1], STORAGE_STACK_SIZE);
 #endif
   audioMutex = CoCreateMutex();
   mixerMutex = CoCreateMutex();
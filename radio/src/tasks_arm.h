@@ -31,6 +31,9 @@ extern "C" {
 #define MIXER_STACK_SIZE       500
 #define AUDIO_STACK_SIZE       500
 #define BLUETOOTH_STACK_SIZE   500
+// a model write, writeFile() then f_rename() with its LFN buffer, peaks at 2280 bytes
+// on a painted stack, plus the context and FPU frames (136 bytes) and the SD driver
+#define STORAGE_STACK_SIZE     800
 
 #if defined(_MSC_VER)
 #define _ALIGNED(x) __declspec(align(x))
@@ -76,6 +79,11 @@ extern OS_TID btTaskId;
 extern TaskStack<BLUETOOTH_STACK_SIZE> bluetoothStack;
 #endif
 
+#if !defined(EEPROM)
+extern OS_TID storageTaskId;
+extern TaskStack<STORAGE_STACK_SIZE> storageStack;
+#endif
+
 void tasksStart();
 
 #endif // _TASKS_ARM_H_
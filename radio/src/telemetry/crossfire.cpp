@@ -244,6 +244,29 @@ void processCrossfireTelemetryData(uint8_t data)
   }
 }
 
+void processCrossfireTelemetrySpan(const uint8_t * data, uint32_t count)
+{
+  while (count > 0) {
+    uint32_t len = 0;
+    if (telemetryRxBufferCount == 0) {
+      len = telemetrySkipToStartByte(data, count, RADIO_ADDRESS);
+      if (len > 0) {
+        TRACE("[XF] %d bytes skipped", len);
+      }
+    }
+    else if (telemetryRxBufferCount >= 2) {
+      len = telemetryCopyFrameData(data, count, telemetryRxBuffer[1] + 2);
+    }
+    if (len == 0) {
+      // the address, length and last byte of the frame
+      processCrossfireTelemetryData(*data);
+      len = 1;
+    }
+    data += len;
+    count -= len;
+  }
+}
+
 void crossfireSetDefault(int index, uint8_t id, uint8_t subId)
 {
   TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
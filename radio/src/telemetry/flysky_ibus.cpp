@@ -154,6 +154,29 @@ void processFlySkyTelemetryData(uint8_t data)
   }
 }
 
+void processFlySkyTelemetrySpan(const uint8_t * data, uint32_t count)
+{
+  while (count > 0) {
+    uint32_t len;
+    if (telemetryRxBufferCount == 0) {
+      len = telemetrySkipToStartByte(data, count, 0xAA);
+      if (len > 0) {
+        TRACE("[IBUS] %d bytes skipped", len);
+      }
+    }
+    else {
+      len = telemetryCopyFrameData(data, count, FLYSKY_TELEMETRY_LENGTH);
+    }
+    if (len == 0) {
+      // the start byte and the last byte
+      processFlySkyTelemetryData(*data);
+      len = 1;
+    }
+    data += len;
+    count -= len;
+  }
+}
+
 const FlySkySensor *getFlySkySensor(uint16_t id)
 {
   for (const FlySkySensor * sensor = flySkySensors; sensor->id; sensor++) {
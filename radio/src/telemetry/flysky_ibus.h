@@ -22,6 +22,7 @@
 #define _FLYSKY_IBUS_H
 
 void processFlySkyTelemetryData(uint8_t data);
+void processFlySkyTelemetrySpan(const uint8_t * data, uint32_t count);
 void flySkySetDefault(int index, uint16_t id, uint8_t subId, uint8_t instance);
 
 // Used by multi protocol
@@ -48,10 +48,11 @@ enum FrSkyDataState {
 #endif
 };
 
-NOINLINE void processFrskyTelemetryData(uint8_t data)
-{
-  static uint8_t dataState = STATE_DATA_IDLE;
+static uint8_t dataState = STATE_DATA_IDLE;
 
+// The copies of the telemetry stream
+static inline void forwardFrskyTelemetryData(uint8_t data)
+{
 #if defined(BLUETOOTH)
   // TODO if (g_model.bt_telemetry)
   btPushByte(data);
@@ -75,6 +76,11 @@ NOINLINE void processFrskyTelemetryData(uint8_t data)
     bluetoothIndex = 0;
   }
 #endif
+}
+
+NOINLINE void processFrskyTelemetryData(uint8_t data)
+{
+  forwardFrskyTelemetryData(data);
 
   switch (dataState) {
     case STATE_DATA_START:
@@ -171,6 +177,41 @@ NOINLINE void processFrskyTelemetryData(uint8_t data)
 #endif
 }
 
+#if defined(CPUARM)
+void processFrskyTelemetrySpan(const uint8_t * data, uint32_t count)
+{
+  while (count > 0) {
+    uint32_t len = 0;
+    if (dataState == STATE_DATA_IDLE) {
+      len = telemetrySkipToStartByte(data, count, START_STOP);
+    }
+    else if (dataState == STATE_DATA_IN_FRAME) {
+      // the bytes of the frame until a control byte, the last byte of a
+      // S.Port packet ends the packet in the bytes parser
+      uint32_t size = (IS_FRSKY_SPORT_PROTOCOL() ? FRSKY_SPORT_PACKET_SIZE - 1 : TELEMETRY_RX_PACKET_SIZE);
+      uint32_t max = (size > telemetryRxBufferCount ? min<uint32_t>(count, size - telemetryRxBufferCount) : 0);
+      while (len < max && data[len] != START_STOP && data[len] != BYTESTUFF) {
+        len++;
+      }
+      memcpy(&telemetryRxBuffer[telemetryRxBufferCount], data, len);
+      telemetryRxBufferCount += len;
+    }
+
+    if (len == 0) {
+      processFrskyTelemetryData(*data);
+      len = 1;
+    }
+    else {
+      for (uint32_t i=0; i<len; i++) {
+        forwardFrskyTelemetryData(data[i]);
+      }
+    }
+    data += len;
+    count -= len;
+  }
+}
+#endif
+
 #if defined(FRSKY_HUB) && !defined(CPUARM)
 void frskyUpdateCells(void)
 {
@@ -476,5 +476,8 @@ void frskyUpdateCells();
 #endif
 
 void processFrskyTelemetryData(uint8_t data);
+#if defined(CPUARM)
+void processFrskyTelemetrySpan(const uint8_t * data, uint32_t count);
+#endif
 
 #endif // _FRSKY_H_
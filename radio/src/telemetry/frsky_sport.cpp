@@ -19,6 +19,7 @@
  */
 
 #include "opentx.h"
+#include "crc.h"
 
 struct FrSkySportSensor {
   const uint16_t firstId;
@@ -80,14 +81,7 @@ const FrSkySportSensor * getFrSkySportSensor(uint16_t id, uint8_t subId=0)
 
 bool checkSportPacket(const uint8_t *packet)
 {
-  short crc = 0;
-  for (int i=1; i<FRSKY_SPORT_PACKET_SIZE; ++i) {
-    crc += packet[i]; // 0-1FE
-    crc += crc >> 8;  // 0-1FF
-    crc &= 0x00ff;    // 0-FF
-  }
-  // TRACE("crc: 0x%02x", crc);
-  return (crc == 0x00ff);
+  return sportChecksum(packet+1, FRSKY_SPORT_PACKET_SIZE-1) == 0xFF;
 }
 
 #define SPORT_DATA_U8(packet)   (packet[4])
@@ -443,6 +443,29 @@ void processSpektrumTelemetryData(uint8_t data)
   }
 }
 
+void processSpektrumTelemetrySpan(const uint8_t * data, uint32_t count)
+{
+  while (count > 0) {
+    uint32_t len = 0;
+    if (telemetryRxBufferCount == 0) {
+      len = telemetrySkipToStartByte(data, count, 0xAA);
+      if (len > 0) {
+        TRACE("[SPK] %d bytes skipped", len);
+      }
+    }
+    else if (telemetryRxBufferCount >= 2) {
+      len = telemetryCopyFrameData(data, count, telemetryRxBuffer[1] == 0x80 ? DSM_BIND_PACKET_LENGTH : SPEKTRUM_TELEMETRY_LENGTH);
+    }
+    if (len == 0) {
+      // the start byte, the byte telling whether it's a bind packet, and the last byte
+      processSpektrumTelemetryData(*data);
+      len = 1;
+    }
+    data += len;
+    count -= len;
+  }
+}
+
 const SpektrumSensor *getSpektrumSensor(uint16_t pseudoId)
 {
   uint8_t startByte = (uint8_t) (pseudoId & 0xff);
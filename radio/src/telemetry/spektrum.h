@@ -22,6 +22,7 @@
 #define _SPEKTRUM_H
 
 void processSpektrumTelemetryData(uint8_t data);
+void processSpektrumTelemetrySpan(const uint8_t * data, uint32_t count);
 void spektrumSetDefault(int index, uint16_t id, uint8_t subId, uint8_t instance);
 
 // Used directly by multi telemetry protocol
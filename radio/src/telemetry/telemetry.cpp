@@ -84,6 +84,56 @@ void processTelemetryData(uint8_t data)
 #endif
   processFrskyTelemetryData(data);
 }
+
+// The bytes received are processed by spans: the parsers look for the start
+// of the frames and copy their content at once, the bytes which change the
+// state of a parser (start, length, end of frame) still go one by one
+// through the bytes parsers.
+void processTelemetryData(const uint8_t * data, uint32_t count)
+{
+#if defined(CROSSFIRE)
+  if (telemetryProtocol == PROTOCOL_PULSES_CROSSFIRE) {
+    processCrossfireTelemetrySpan(data, count);
+    return;
+  }
+#endif
+#if defined(MULTIMODULE)
+  if (telemetryProtocol == PROTOCOL_SPEKTRUM) {
+    processSpektrumTelemetrySpan(data, count);
+    return;
+  } else if (telemetryProtocol == PROTOCOL_FLYSKY_IBUS) {
+    processFlySkyTelemetrySpan(data, count);
+    return;
+  } else if (telemetryProtocol == PROTOCOL_MULTIMODULE) {
+    for (uint32_t i=0; i<count; i++) {
+      processMultiTelemetryData(data[i]);
+    }
+    return;
+  }
+#endif
+  processFrskyTelemetrySpan(data, count);
+}
+
+// The number of bytes before the start byte of a frame
+uint32_t telemetrySkipToStartByte(const uint8_t * data, uint32_t count, uint8_t start)
+{
+  const uint8_t * found = (const uint8_t *)memchr(data, start, count);
+  return (found ? found - data : count);
+}
+
+// Copies the bytes of the frame being received, but its last one which ends
+// the frame in the bytes parser, returns the number of bytes copied
+uint32_t telemetryCopyFrameData(const uint8_t * data, uint32_t count, uint32_t length)
+{
+  uint32_t received = telemetryRxBufferCount;
+  if (received + 1 >= length) {
+    return 0;
+  }
+  uint32_t result = min<uint32_t>(count, length - 1 - received);
+  memcpy(&telemetryRxBuffer[received], data, result);
+  telemetryRxBufferCount = received + result;
+  return result;
+}
 #endif
 
 void telemetryWakeup()
@@ -103,13 +153,15 @@ void telemetryWakeup()
 #endif
 
 #if defined(STM32)
-  uint8_t data;
-  if (telemetryGetByte(&data)) {
+  const uint8_t * data;
+  uint32_t count = telemetryPeekData(&data);
+  if (count > 0) {
     LOG_TELEMETRY_WRITE_START();
     do {
-      processTelemetryData(data);
-      LOG_TELEMETRY_WRITE_BYTE(data);
-    } while (telemetryGetByte(&data));
+      processTelemetryData(data, count);
+      LOG_TELEMETRY_WRITE_DATA(data, count);
+      telemetryConsumeData(count);
+    } while ((count = telemetryPeekData(&data)) > 0);
   }
 #elif defined(PCBSKY9X)
   if (telemetryProtocol == PROTOCOL_FRSKY_D_SECONDARY) {
@@ -484,9 +536,22 @@ void logTelemetryWriteStart()
   }
 }
 
-void logTelemetryWriteByte(uint8_t data)
+void logTelemetryWriteData(const uint8_t * data, uint32_t count)
 {
-  f_printf(&g_telemetryFile, " %02X", data);
+  static const char hex[] = "0123456789ABCDEF";
+  char buffer[3*32];
+  while (count > 0) {
+    uint32_t len = min<uint32_t>(count, sizeof(buffer) / 3);
+    for (uint32_t i=0; i<len; i++) {
+      buffer[3*i] = ' ';
+      buffer[3*i+1] = hex[data[i] >> 4];
+      buffer[3*i+2] = hex[data[i] & 0x0F];
+    }
+    UINT written;
+    f_write(&g_telemetryFile, buffer, 3*len, &written);
+    data += len;
+    count -= len;
+  }
 }
 #endif
 
@@ -80,6 +80,12 @@ extern uint8_t telemetryState;
 extern uint8_t telemetryRxBuffer[TELEMETRY_RX_PACKET_SIZE];
 extern uint8_t telemetryRxBufferCount;
 
+#if defined(CPUARM)
+// Helpers of the parsers processing the received bytes by spans
+uint32_t telemetrySkipToStartByte(const uint8_t * data, uint32_t count, uint8_t start);
+uint32_t telemetryCopyFrameData(const uint8_t * data, uint32_t count, uint32_t length);
+#endif
+
 #if defined(CPUARM)
 #define TELEMETRY_AVERAGE_COUNT        3
 
@@ -109,7 +115,11 @@ PACK(struct CellValue
   }
 });
 
+#define TELEMETRY_SENSORS_INDEX_BITS     6
+#define TELEMETRY_SENSORS_INDEX_BUCKETS  (1 << TELEMETRY_SENSORS_INDEX_BITS)
+
 int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, uint8_t instance, int32_t value, uint32_t unit, uint32_t prec);
+void invalidateTelemetrySensorsIndex();
 void delTelemetryIndex(uint8_t index);
 int availableTelemetryIndex();
 int lastUsedTelemetryIndex();
@@ -172,12 +182,12 @@ inline uint8_t modelTelemetryProtocol()
 
 #if defined(LOG_TELEMETRY) && !defined(SIMU)
 void logTelemetryWriteStart();
-void logTelemetryWriteByte(uint8_t data);
+void logTelemetryWriteData(const uint8_t * data, uint32_t count);
 #define LOG_TELEMETRY_WRITE_START()    logTelemetryWriteStart()
-#define LOG_TELEMETRY_WRITE_BYTE(data) logTelemetryWriteByte(data)
+#define LOG_TELEMETRY_WRITE_DATA(data, count) logTelemetryWriteData(data, count)
 #else
 #define LOG_TELEMETRY_WRITE_START()
-#define LOG_TELEMETRY_WRITE_BYTE(data)
+#define LOG_TELEMETRY_WRITE_DATA(data, count)
 #endif
 
 #define TELEMETRY_OUTPUT_FIFO_SIZE 16
@@ -419,11 +419,57 @@ int lastUsedTelemetryIndex()
   return -1;
 }
 
+// The custom sensors, hashed by id / subId / instance (id / subId only when
+// the instances are ignored). Each list is in the sensors order.
+struct TelemetrySensorsIndex {
+  int8_t buckets[TELEMETRY_SENSORS_INDEX_BUCKETS];
+  int8_t next[MAX_TELEMETRY_SENSORS];
+  bool valid;
+  bool ignoreInstance;
+};
+
+TelemetrySensorsIndex telemetrySensorsIndex;
+
+void invalidateTelemetrySensorsIndex()
+{
+  telemetrySensorsIndex.valid = false;
+}
+
+inline uint8_t getTelemetrySensorsIndexBucket(uint16_t id, uint8_t subId, uint8_t instance)
+{
+  uint32_t key = id | (subId << 16) | (instance << 19);
+  return (key * 2654435761u) >> (32 - TELEMETRY_SENSORS_INDEX_BITS);
+}
+
+void buildTelemetrySensorsIndex()
+{
+  TelemetrySensorsIndex & sensorsIndex = telemetrySensorsIndex;
+  memset(sensorsIndex.buckets, -1, sizeof(sensorsIndex.buckets));
+  sensorsIndex.ignoreInstance = g_model.ignoreSensorIds;
+  for (int index=MAX_TELEMETRY_SENSORS-1; index>=0; index--) {
+    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+    if (telemetrySensor.type == TELEM_TYPE_CUSTOM) {
+      uint8_t bucket = getTelemetrySensorsIndexBucket(telemetrySensor.id, telemetrySensor.subId, sensorsIndex.ignoreInstance ? 0 : telemetrySensor.instance);
+      sensorsIndex.next[index] = sensorsIndex.buckets[bucket];
+      sensorsIndex.buckets[bucket] = index;
+    }
+    else {
+      sensorsIndex.next[index] = -1;
+    }
+  }
+  sensorsIndex.valid = true;
+}
+
 int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, uint8_t instance, int32_t value, uint32_t unit, uint32_t prec)
 {
   bool available = false;
 
-  for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+  if (!telemetrySensorsIndex.valid || telemetrySensorsIndex.ignoreInstance != g_model.ignoreSensorIds) {
+    buildTelemetrySensorsIndex();
+  }
+
+  uint8_t bucket = getTelemetrySensorsIndexBucket(id, subId, g_model.ignoreSensorIds ? 0 : instance);
+  for (int index=telemetrySensorsIndex.buckets[bucket]; index>=0; index=telemetrySensorsIndex.next[index]) {
     TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
     if (telemetrySensor.type == TELEM_TYPE_CUSTOM && telemetrySensor.id == id && telemetrySensor.subId == subId && (telemetrySensor.instance == instance || g_model.ignoreSensorIds)) {
       telemetryItems[index].setValue(telemetrySensor, value, unit, prec);
@@ -438,6 +484,8 @@ int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, ui
 
   int index = availableTelemetryIndex();
   if (index >= 0) {
+    // the new sensor is initialized below or by the caller
+    invalidateTelemetrySensorsIndex();
     switch (protocol) {
 #if defined(TELEMETRY_FRSKY_SPORT)
       case TELEM_PROTO_FRSKY_SPORT:
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gtests.h"
+
+#if defined(CPUARM)
+
+#define SINE_VALUES_COUNT 1024
+#define SINE_MAX_STEP     200   // max difference between 2 consecutive sine values
+
+// The tones as they were generated with floating point, mixed in an
+// audio buffer initialized with silence
+class LegacyToneContext
+{
+  public:
+    LegacyToneContext(uint16_t freq, uint16_t duration, uint16_t pause, int8_t freqIncr):
+      tone(freq, duration, pause, freqIncr, false)
+    {
+      memset(&state, 0, sizeof(state));
+    }
+
+    int mixBuffer(audio_data_t * buffer, int volume, unsigned int fade)
+    {
+      int duration = 0;
+
+      int remainingDuration = tone.duration - state.duration;
+      if (remainingDuration > 0) {
+        int points;
+        double toneIdx = state.idx;
+
+        if (tone.freq != state.freq) {
+          state.freq = tone.freq;
+          state.step = limit<double>(1, double(SINE_VALUES_COUNT*tone.freq) / AUDIO_SAMPLE_RATE, 512);
+          state.volume = evalVolumeRatio(tone.freq, volume);
+        }
+
+        if (tone.freqIncr) {
+          int freqChange = AUDIO_BUFFER_DURATION * tone.freqIncr;
+          if (freqChange > 0) {
+            tone.freq = min<int>(BEEP_MAX_FREQ, tone.freq + freqChange);
+          }
+          else if (tone.freq > BEEP_MIN_FREQ - freqChange) {
+            tone.freq += freqChange;
+          }
+          else {
+            tone.freq = BEEP_MIN_FREQ;
+          }
+        }
+
+        if (remainingDuration > AUDIO_BUFFER_DURATION) {
+          duration = AUDIO_BUFFER_DURATION;
+          points = AUDIO_BUFFER_SIZE;
+        }
+        else {
+          duration = remainingDuration;
+          points = (duration * AUDIO_BUFFER_SIZE) / AUDIO_BUFFER_DURATION;
+          unsigned int end = toneIdx + (state.step * points);
+          if (end > SINE_VALUES_COUNT)
+            end -= (end % SINE_VALUES_COUNT);
+          else
+            end = SINE_VALUES_COUNT;
+          points = (double(end) - toneIdx) / state.step;
+        }
+
+        for (int i=0; i<points; i++) {
+          int16_t sample = sineValues[int(toneIdx)] / state.volume;
+          buffer[i] = limit(AUDIO_DATA_MIN, buffer[i] + ((sample >> fade) >> (16-AUDIO_BITS_PER_SAMPLE)), AUDIO_DATA_MAX);
+          toneIdx += state.step;
+          if ((unsigned int)toneIdx >= SINE_VALUES_COUNT)
+            toneIdx -= SINE_VALUES_COUNT;
+        }
+
+        if (remainingDuration > AUDIO_BUFFER_DURATION) {
+          state.duration += AUDIO_BUFFER_DURATION;
+          state.idx = toneIdx;
+          return AUDIO_BUFFER_SIZE;
+        }
+        else {
+          state.duration = 32000;
+        }
+      }
+
+      remainingDuration = tone.pause - state.pause;
+      if (remainingDuration > 0) {
+        state.pause += min<unsigned int>(AUDIO_BUFFER_DURATION-duration, tone.pause);
+        return AUDIO_BUFFER_SIZE;
+      }
+
+      return 0;
+    }
+
+  protected:
+    Tone tone;
+
+    struct {
+      double step;
+      double idx;
+      float  volume;
+      uint16_t freq;
+      uint16_t duration;
+      uint16_t pause;
+    } state;
+
+    static float evalVolumeRatio(int freq, int volume)
+    {
+      static const unsigned int toneVolumes[] = { 10, 8, 6, 4, 2 };
+      float result = toneVolumes[2+volume];
+      if (freq < 330) {
+        result = (result * freq * freq) / (330 * 330);
+      }
+      return result;
+    }
+};
+
+struct TestTone
+{
+  uint16_t freq;
+  uint16_t duration;
+  uint16_t pause;
+  int8_t freqIncr;
+  int8_t volume;
+};
+
+static const TestTone testTones[] = {
+  { BEEP_DEFAULT_FREQ, 100, 0, 0, 0 },
+  { BEEP_KEY_UP_FREQ, 40, 20, 0, 2 },
+  { 1000, 255, 0, 0, -2 },
+  { 500, 100, 30, 10, 1 },
+  { 4000, 73, 0, -10, -1 },
+  { 300, 200, 0, 0, 2 },     // gain increased below 330Hz
+  { 15000, 30, 0, 0, 0 },
+};
+
+static bool isSilence(const audio_data_t * buffer, int start, int end)
+{
+  for (int i=start; i<end; i++) {
+    if (buffer[i] != AUDIO_DATA_SILENCE)
+      return false;
+  }
+  return true;
+}
+
+// Each 10ms buffer of the tone and the buffer written to the audio driver
+// are compared with the floating point implementation
+TEST(Audio, tonesGoldenOutput)
+{
+  for (unsigned int t=0; t<DIM(testTones); t++) {
+    const TestTone & tone = testTones[t];
+    for (unsigned int fade=0; fade<3; fade++) {
+      ToneContext context;
+      context.clear();
+      context.setFragment(tone.freq, tone.duration, tone.pause, 0, tone.freqIncr, false);
+      LegacyToneContext legacy(tone.freq, tone.duration, tone.pause, tone.freqIncr);
+
+      for (int n=0; ; n++) {
+        audio_mix_t mix[AUDIO_BUFFER_SIZE];
+        audio_data_t result[AUDIO_BUFFER_SIZE];
+        audio_data_t expected[AUDIO_BUFFER_SIZE];
+        memset(mix, 0, sizeof(mix));
+        for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+          expected[i] = AUDIO_DATA_SILENCE;
+        }
+
+        int size = context.mixBuffer(mix, tone.volume, fade);
+        ASSERT_EQ(size, legacy.mixBuffer(expected, tone.volume, fade)) << "tone " << t << " buffer " << n;
+        if (size == 0) {
+          break;
+        }
+
+        writeAudioSamples(result, mix, size);
+        for (int i=0; i<size; i++) {
+          // the gain is rounded differently, and when the phase is close to
+          // a sine table index both implementations may pick a neighbour (the
+          // gain is always below 1). The tone may also end one sample earlier
+          // or later.
+          int diff = abs((int)expected[i] - (int)result[i]);
+          if (diff > 2 && (!isSilence(expected, i+1, size) || !isSilence(result, i+1, size))) {
+            ASSERT_LE(diff, ((SINE_MAX_STEP >> fade) >> (16-AUDIO_BITS_PER_SAMPLE)) + 2) << "tone " << t << " fade " << fade << " buffer " << n << " sample " << i;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(Audio, mixSaturation)
+{
+  ToneContext first, second;
+  first.clear();
+  first.setFragment(1000, 100, 0, 0, 0, false);
+  second.clear();
+  second.setFragment(1000, 100, 0, 0, 0, false);
+
+  audio_mix_t mix[AUDIO_BUFFER_SIZE];
+  memset(mix, 0, sizeof(mix));
+  for (int n=0; n<4; n++) {
+    EXPECT_EQ(first.mixBuffer(mix, 2, 0), AUDIO_BUFFER_SIZE);
+    EXPECT_EQ(second.mixBuffer(mix, 2, 0), AUDIO_BUFFER_SIZE);
+  }
+
+  // the peaks of the sum are clipped
+  int minimum = AUDIO_MIX_MAX, maximum = AUDIO_MIX_MIN;
+  for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+    minimum = min<int>(minimum, mix[i]);
+    maximum = max<int>(maximum, mix[i]);
+  }
+  EXPECT_EQ(minimum, AUDIO_MIX_MIN);
+  EXPECT_EQ(maximum, AUDIO_MIX_MAX);
+}
+
+TEST(Audio, tonesBenchmark)
+{
+  const int iterations = 2000;
+  audio_data_t buffer[AUDIO_BUFFER_SIZE];
+
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    LegacyToneContext legacy(BEEP_DEFAULT_FREQ, 1000, 0, 0);
+    LegacyToneContext vario(800, 1000, 0, 5);
+    for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+      buffer[i] = AUDIO_DATA_SILENCE;
+    }
+    legacy.mixBuffer(buffer, 0, 0);
+    vario.mixBuffer(buffer, 0, 1);
+#if defined(SOFTWARE_VOLUME)
+    for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+      int32_t sample = (int32_t)((uint32_t)buffer[i] - AUDIO_DATA_SILENCE);
+      buffer[i] = (int16_t)(((sample * currentSpeakerVolume) / VOLUME_LEVEL_MAX) + AUDIO_DATA_SILENCE);
+    }
+#endif
+  }
+  auto end = std::chrono::steady_clock::now();
+  long legacyTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    ToneContext tone, vario;
+    tone.clear();
+    tone.setFragment(BEEP_DEFAULT_FREQ, 1000, 0, 0, 0, false);
+    vario.clear();
+    vario.setFragment(800, 1000, 0, 0, 5, false);
+    audio_mix_t mix[AUDIO_BUFFER_SIZE];
+    memset(mix, 0, sizeof(mix));
+    tone.mixBuffer(mix, 0, 0);
+    vario.mixBuffer(mix, 0, 1);
+    writeAudioSamples(buffer, mix, AUDIO_BUFFER_SIZE);
+  }
+  end = std::chrono::steady_clock::now();
+  long fixedTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  printf("Audio buffers: 2 tones x %d\n", iterations);
+  printf("  floating point: %6ldus\n", legacyTime);
+  printf("  fixed point:    %6ldus\n", fixedTime);
+}
+
+static void writeAudioTestFile(const std::string & directory, const char * name, int size)
+{
+  std::string path = directory + "/" + name;
+  FILE * f = fopen(path.c_str(), "wb");
+  for (int i=0; i<size; i++) {
+    fputc(0, f);
+  }
+  fclose(f);
+}
+
+static bool isSystemAudioFileReferenced(int index)
+{
+  char filename[AUDIO_FILENAME_MAXLEN+1];
+  return isAudioFileReferenced((SYSTEM_AUDIO_CATEGORY << 24) + index, filename);
+}
+
+// The sounds directory is indexed again on each load, it follows the files
+// added, removed or renamed, and the directories too big for the index are
+// still found
+TEST(Audio, systemFilesIndex)
+{
+  char sdPath[] = "/tmp/opentx-gtests-XXXXXX";
+  ASSERT_TRUE(mkdtemp(sdPath) != NULL);
+  std::string sounds = std::string(sdPath) + "/SOUNDS";
+  std::string language = sounds + "/en";
+  std::string system = language + "/" SYSTEM_SUBDIR;
+  mkdir(sounds.c_str(), 0777);
+  mkdir(language.c_str(), 0777);
+  mkdir(system.c_str(), 0777);
+  simuFatfsSetPaths(sdPath, NULL);
+
+  writeAudioTestFile(system, "hello.wav", 10);
+  writeAudioTestFile(system, "bye.txt", 10);
+  referenceSystemAudioFiles();
+  EXPECT_TRUE(isSystemAudioFileReferenced(AUDIO_HELLO));
+  EXPECT_FALSE(isSystemAudioFileReferenced(AU_BYE));
+
+  // a file added
+  writeAudioTestFile(system, "bye.wav", 10);
+  referenceSystemAudioFiles();
+  EXPECT_TRUE(isSystemAudioFileReferenced(AUDIO_HELLO));
+  EXPECT_TRUE(isSystemAudioFileReferenced(AU_BYE));
+
+  // a file replaced by another one of a different size
+  unlink((system + "/hello.wav").c_str());
+  writeAudioTestFile(system, "HELLO2.WAV", 20);
+  referenceSystemAudioFiles();
+  EXPECT_FALSE(isSystemAudioFileReferenced(AUDIO_HELLO));
+  EXPECT_TRUE(isSystemAudioFileReferenced(AU_BYE));
+
+  // a file renamed, with the same size and date
+  rename((system + "/bye.wav").c_str(), (system + "/bye2.wav").c_str());
+  referenceSystemAudioFiles();
+  EXPECT_FALSE(isSystemAudioFileReferenced(AU_BYE));
+  rename((system + "/bye2.wav").c_str(), (system + "/bye.wav").c_str());
+  referenceSystemAudioFiles();
+  EXPECT_TRUE(isSystemAudioFileReferenced(AU_BYE));
+
+  // a file removed
+  unlink((system + "/bye.wav").c_str());
+  referenceSystemAudioFiles();
+  EXPECT_FALSE(isSystemAudioFileReferenced(AU_BYE));
+
+  // more files than the index can hold
+  const int count = 300;
+  for (int i=0; i<count; i++) {
+    char name[16];
+    sprintf(name, "file%d.wav", i);
+    writeAudioTestFile(system, name, 1);
+  }
+  writeAudioTestFile(system, "Bye.wav", 10);
+  referenceSystemAudioFiles();
+  EXPECT_FALSE(isSystemAudioFileReferenced(AUDIO_HELLO));
+  EXPECT_TRUE(isSystemAudioFileReferenced(AU_BYE));
+
+  simuFatfsSetPaths("", NULL);
+  for (int i=0; i<count; i++) {
+    char name[16];
+    sprintf(name, "/file%d.wav", i);
+    unlink((system + name).c_str());
+  }
+  unlink((system + "/Bye.wav").c_str());
+  unlink((system + "/HELLO2.WAV").c_str());
+  unlink((system + "/bye.txt").c_str());
+  rmdir(system.c_str());
+  rmdir(language.c_str());
+  rmdir(sounds.c_str());
+  rmdir(sdPath);
+  referenceSystemAudioFiles();
+}
+
+// The previous lookup, each wav file compared with every prompt name
+static void legacyReferenceSystemAudioFiles(BitField<(AU_SPECIAL_SOUND_FIRST)> & available)
+{
+  char path[AUDIO_FILENAME_MAXLEN+1];
+  FILINFO fno;
+  DIR dir;
+
+  available.reset();
+
+  char * filename = strAppendSystemAudioPath(path);
+  *(filename-1) = '\0';
+
+  FRESULT res = f_opendir(&dir, path);
+  if (res == FR_OK) {
+    for (;;) {
+      res = f_readdir(&dir, &fno);
+      if (res != FR_OK || fno.fname[0] == 0) break;
+      uint8_t len = strlen(fno.fname);
+      if (len < 5 || strcasecmp(fno.fname+len-4, SOUNDS_EXT) || (fno.fattrib & AM_DIR)) continue;
+      for (int i=0; i<AU_SPECIAL_SOUND_FIRST; i++) {
+        getSystemAudioFile(path, i);
+        if (!strcasecmp(filename, fno.fname)) {
+          available.setBit(i);
+          break;
+        }
+      }
+    }
+    f_closedir(&dir);
+  }
+}
+
+TEST(Audio, systemFilesBenchmark)
+{
+  const int iterations = 200;
+  char sdPath[] = "/tmp/opentx-gtests-XXXXXX";
+  ASSERT_TRUE(mkdtemp(sdPath) != NULL);
+  std::string sounds = std::string(sdPath) + "/SOUNDS";
+  std::string language = sounds + "/en";
+  std::string system = language + "/" SYSTEM_SUBDIR;
+  mkdir(sounds.c_str(), 0777);
+  mkdir(language.c_str(), 0777);
+  mkdir(system.c_str(), 0777);
+  simuFatfsSetPaths(sdPath, NULL);
+
+  // a full system directory, every second prompt present, plus other files
+  std::vector<std::string> names;
+  for (int i=0; i<AU_SPECIAL_SOUND_FIRST; i+=2) {
+    char filename[AUDIO_FILENAME_MAXLEN+1];
+    getSystemAudioFile(filename, i);
+    names.push_back(strrchr(filename, '/') + 1);
+  }
+  for (int i=0; i<100; i++) {
+    names.push_back("other" + std::to_string(i) + ".wav");
+  }
+  for (auto & name: names) {
+    writeAudioTestFile(system, name.c_str(), 1);
+  }
+
+  BitField<(AU_SPECIAL_SOUND_FIRST)> available;
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    legacyReferenceSystemAudioFiles(available);
+  }
+  auto end = std::chrono::steady_clock::now();
+  long legacyTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    referenceSystemAudioFiles();
+  }
+  end = std::chrono::steady_clock::now();
+  long indexTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  for (int i=0; i<AU_SPECIAL_SOUND_FIRST; i++) {
+    EXPECT_EQ(available.getBit(i), isSystemAudioFileReferenced(i)) << "prompt " << i;
+  }
+
+  printf("System prompts: %d wav files x %d\n", (int)names.size(), iterations);
+  printf("  names compared: %6ldus\n", legacyTime);
+  printf("  hash index:     %6ldus\n", indexTime);
+
+  simuFatfsSetPaths("", NULL);
+  for (auto & name: names) {
+    unlink((system + "/" + name).c_str());
+  }
+  rmdir(system.c_str());
+  rmdir(language.c_str());
+  rmdir(sounds.c_str());
+  rmdir(sdPath);
+  referenceSystemAudioFiles();
+}
+
+#endif
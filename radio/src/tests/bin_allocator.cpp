@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <map>
+#include <vector>
+#include <chrono>
+#include "gtests.h"
+#include "location.h"
+#include "bin_allocator.h"
+
+TEST(BinAllocator, FreeList)
+{
+  BinAllocator<16, 4> * allocator = new BinAllocator<16, 4>;
+  void * slots[4];
+
+  EXPECT_EQ(allocator->malloc(17), (void *)0);
+  for (int i=0; i<4; i++) {
+    slots[i] = allocator->malloc(16);
+    ASSERT_NE(slots[i], (void *)0);
+    EXPECT_TRUE(allocator->is_member(slots[i]));
+    EXPECT_EQ(0u, (uintptr_t)slots[i] % sizeof(void *));
+  }
+  EXPECT_EQ(allocator->malloc(1), (void *)0);
+  EXPECT_EQ(allocator->size(), 4u);
+
+  // the last freed slot is the next one allocated
+  EXPECT_TRUE(allocator->free(slots[2]));
+  EXPECT_TRUE(allocator->free(slots[0]));
+  EXPECT_EQ(allocator->size(), 2u);
+  EXPECT_EQ(allocator->malloc(8), slots[0]);
+  EXPECT_EQ(allocator->malloc(8), slots[2]);
+  EXPECT_EQ(allocator->highWaterMark(), 4u);
+
+  // the byte after the last slot doesn't belong to the allocator
+  EXPECT_FALSE(allocator->is_member((char *)slots[3] + 16));
+  EXPECT_FALSE(allocator->free((char *)slots[3] + 16));
+
+  delete allocator;
+}
+
+struct LuaAllocation
+{
+  int ptr;      // index of the block, -1 for a new block
+  int result;   // index of the resulting block, -1 for a free
+  size_t osize;
+  size_t nsize;
+};
+
+struct LuaAllocationsTrace
+{
+  std::vector<LuaAllocation> allocations;
+  int count;
+};
+
+// The bin_l_alloc() lines of a Lua session trace, the pointers are replaced
+// by the index of their block
+static bool loadLuaTrace(const char * path, LuaAllocationsTrace & trace)
+{
+  FILE * f = fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  std::map<uintptr_t, int> blocks;
+  trace.count = 0;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    char ptr[32], res[32];
+    unsigned int osize, nsize;
+    if (sscanf(line, "bin_l_alloc(%31[^,], %u, %u) = %31s", ptr, &osize, &nsize, res) == 4) {
+      // (nil) is read as 0
+      uintptr_t address = strtoull(ptr, NULL, 16);
+      LuaAllocation allocation = { -1, -1, osize, nsize };
+      if (address) {
+        if (blocks.find(address) == blocks.end()) {
+          fclose(f);
+          return false;
+        }
+        allocation.ptr = blocks[address];
+        blocks.erase(address);
+      }
+      if (nsize) {
+        allocation.result = trace.count++;
+        blocks[strtoull(res, NULL, 16)] = allocation.result;
+      }
+      if (address || nsize) {
+        trace.allocations.push_back(allocation);
+      }
+    }
+  }
+  fclose(f);
+  return blocks.empty();
+}
+
+typedef void * (* LuaAllocator)(void * ud, void * ptr, size_t osize, size_t nsize);
+
+// replays the trace through a Lua allocator, returns the libc fallbacks
+static unsigned int replayLuaTrace(LuaAllocator alloc, bool (*isMember)(void *), const LuaAllocationsTrace & trace)
+{
+  std::vector<void *> blocks(trace.count);
+  unsigned int fallbacks = 0;
+  for (const LuaAllocation & allocation: trace.allocations) {
+    void * ptr = (allocation.ptr >= 0 ? blocks[allocation.ptr] : NULL);
+    void * res = alloc(NULL, ptr, allocation.osize, allocation.nsize);
+    if (allocation.result >= 0) {
+      blocks[allocation.result] = res;
+      if (isMember && !isMember(res)) {
+        fallbacks++;
+      }
+    }
+  }
+  return fallbacks;
+}
+
+template <class F>
+static long measure(F function, int iterations)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    function();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+// The previous BinAllocator, kept as a reference: a used flag in each slot,
+// malloc() and free() scan the slots
+template <int SIZE_SLOT, int NUM_BINS> class LegacyBinAllocator {
+private:
+  PACK(struct Bin {
+    char data[SIZE_SLOT];
+    bool Used;
+  });
+  struct Bin Bins[NUM_BINS];
+  int NoUsedBins;
+public:
+  LegacyBinAllocator() : NoUsedBins(0) {
+    memclear(Bins, sizeof(Bins));
+  }
+  bool free(void * ptr) {
+    for (size_t n = 0; n < NUM_BINS; ++n) {
+      if (ptr == Bins[n].data) {
+        Bins[n].Used = false;
+        --NoUsedBins;
+        return true;
+      }
+    }
+    return false;
+  }
+  bool is_member(void * ptr) {
+    return (ptr >= Bins[0].data && ptr <= Bins[NUM_BINS-1].data);
+  }
+  void * malloc(size_t size) {
+    if (size > SIZE_SLOT) {
+      return 0;
+    }
+    if (NoUsedBins >= NUM_BINS) {
+      return 0;
+    }
+    for (size_t n = 0; n < NUM_BINS; ++n) {
+      if (!Bins[n].Used) {
+        Bins[n].Used = true;
+        ++NoUsedBins;
+        return Bins[n].data;
+      }
+    }
+    return 0;
+  }
+  size_t size(void * ptr) {
+    return is_member(ptr) ? SIZE_SLOT : 0;
+  }
+};
+
+// the previous allocator with the current slots
+template <class T> struct LegacyBinAllocatorOf;
+template <int SIZE_SLOT, int NUM_BINS> struct LegacyBinAllocatorOf< BinAllocator<SIZE_SLOT, NUM_BINS> >
+{
+  typedef LegacyBinAllocator<SIZE_SLOT, NUM_BINS> type;
+};
+
+static LegacyBinAllocatorOf<BinAllocator_slots1>::type legacySlots1;
+static LegacyBinAllocatorOf<BinAllocator_slots2>::type legacySlots2;
+static LegacyBinAllocatorOf<BinAllocator_slots3>::type legacySlots3;
+static LegacyBinAllocatorOf<BinAllocator_slots4>::type legacySlots4;
+
+static bool legacy_is_member(void * ptr)
+{
+  return legacySlots1.is_member(ptr) || legacySlots2.is_member(ptr) || legacySlots3.is_member(ptr) || legacySlots4.is_member(ptr);
+}
+
+static void * legacy_malloc(size_t size)
+{
+  void * res = legacySlots1.malloc(size);
+  if (!res) res = legacySlots2.malloc(size);
+  if (!res) res = legacySlots3.malloc(size);
+  if (!res) res = legacySlots4.malloc(size);
+  return res;
+}
+
+// bin_l_alloc() on the previous allocator, without the statistics
+static void * legacy_l_alloc(void * ud, void * ptr, size_t osize, size_t nsize)
+{
+  if (nsize == 0) {
+    if (ptr && !(legacySlots1.free(ptr) || legacySlots2.free(ptr) || legacySlots3.free(ptr) || legacySlots4.free(ptr))) {
+      free(ptr);
+    }
+    return NULL;
+  }
+  if (!ptr) {
+    void * res = legacy_malloc(nsize);
+    return res ? res : malloc(nsize);
+  }
+  size_t slotSize = legacySlots1.size(ptr) + legacySlots2.size(ptr) + legacySlots3.size(ptr) + legacySlots4.size(ptr);
+  if (slotSize == 0) {
+    return realloc(ptr, nsize);
+  }
+  if (nsize <= slotSize) {
+    return ptr;
+  }
+  void * res = legacy_malloc(nsize);
+  if (!res) {
+    res = malloc(nsize);
+  }
+  memcpy(res, ptr, slotSize);
+  legacySlots1.free(ptr) || legacySlots2.free(ptr) || legacySlots3.free(ptr) || legacySlots4.free(ptr);
+  return res;
+}
+
+static void * libc_l_alloc(void * ud, void * ptr, size_t osize, size_t nsize)
+{
+  if (nsize == 0) {
+    free(ptr);
+    return NULL;
+  }
+  return realloc(ptr, nsize);
+}
+
+TEST(BinAllocator, LuaAllocatorStats)
+{
+  BinAllocatorStats before, stats;
+  binAllocatorGetStats(before);
+
+  void * small = bin_l_alloc(NULL, NULL, LUA_TSTRING, 10);
+  ASSERT_TRUE(is_bin_member(small));
+  EXPECT_EQ(bin_size(small), slots1.slotSize());
+  binAllocatorGetStats(stats);
+  EXPECT_EQ(stats.usedBytes, before.usedBytes + slots1.slotSize());
+  EXPECT_EQ(stats.requestedBytes, before.requestedBytes + 10);
+  EXPECT_GE(stats.highWaterBytes, stats.usedBytes);
+
+  // still fits in its slot
+  EXPECT_EQ(bin_l_alloc(NULL, small, 10, slots1.slotSize()), small);
+  binAllocatorGetStats(stats);
+  EXPECT_EQ(stats.requestedBytes, before.requestedBytes + slots1.slotSize());
+
+  // moved to the next slots size, the content is kept
+  memset(small, 0x55, slots1.slotSize());
+  void * bigger = bin_l_alloc(NULL, small, slots1.slotSize(), slots1.slotSize() + 1);
+  ASSERT_TRUE(is_bin_member(bigger));
+  EXPECT_EQ(bin_size(bigger), slots2.slotSize());
+  EXPECT_EQ(((uint8_t *)bigger)[slots1.slotSize() - 1], 0x55);
+  binAllocatorGetStats(stats);
+  EXPECT_EQ(stats.usedBytes, before.usedBytes + slots2.slotSize());
+  EXPECT_EQ(stats.requestedBytes, before.requestedBytes + slots1.slotSize() + 1);
+  EXPECT_EQ(stats.fallbacks, before.fallbacks);
+
+  // too big for any slot: the libc allocator
+  void * large = bin_l_alloc(NULL, bigger, slots1.slotSize() + 1, slots4.slotSize() + 1);
+  ASSERT_NE(large, (void *)NULL);
+  EXPECT_FALSE(is_bin_member(large));
+  EXPECT_EQ(((uint8_t *)large)[slots1.slotSize() - 1], 0x55);
+  binAllocatorGetStats(stats);
+  EXPECT_EQ(stats.usedBytes, before.usedBytes);
+  EXPECT_EQ(stats.requestedBytes, before.requestedBytes);
+  EXPECT_EQ(stats.fallbacks, before.fallbacks + 1);
+
+  EXPECT_EQ(bin_l_alloc(NULL, large, slots4.slotSize() + 1, 0), (void *)NULL);
+  binAllocatorGetStats(stats);
+  EXPECT_EQ(stats.usedBytes, before.usedBytes);
+  EXPECT_EQ(stats.fallbacks, before.fallbacks + 1);
+}
+
+// lua_allocations_trace.txt is the trace of bin_l_alloc() on the simulator,
+// running the SD card snake.lua and WIZARD/plane.lua scripts for 1000 cycles
+// each with key events
+TEST(BinAllocator, LuaTraceReplay)
+{
+  LuaAllocationsTrace trace;
+  ASSERT_TRUE(loadLuaTrace(TESTS_PATH "/tests/lua_allocations_trace.txt", trace));
+  ASSERT_GT(trace.allocations.size(), 10000u);
+
+  // the same slots and the same decisions
+  BinAllocatorStats before, stats;
+  binAllocatorGetStats(before);
+  unsigned int fallbacks = replayLuaTrace(bin_l_alloc, is_bin_member, trace);
+  EXPECT_EQ(fallbacks, replayLuaTrace(legacy_l_alloc, legacy_is_member, trace));
+
+  // everything is freed at the end of the trace
+  binAllocatorGetStats(stats);
+  EXPECT_EQ(stats.usedBytes, before.usedBytes);
+  EXPECT_EQ(stats.requestedBytes, before.requestedBytes);
+  EXPECT_EQ(stats.fallbacks, before.fallbacks + fallbacks);
+  EXPECT_GT(stats.highWaterBytes, 0u);
+  EXPECT_LE(stats.highWaterBytes, stats.totalBytes);
+
+  const int iterations = 20;
+  long binTime = measure([&] { replayLuaTrace(bin_l_alloc, NULL, trace); }, iterations);
+  long legacyTime = measure([&] { replayLuaTrace(legacy_l_alloc, NULL, trace); }, iterations);
+  long libcTime = measure([&] { replayLuaTrace(libc_l_alloc, NULL, trace); }, iterations);
+
+  printf("Lua trace: %d allocations x %d, %u libc fallbacks, %u bytes high water\n", (int)trace.allocations.size(), iterations, fallbacks, stats.highWaterBytes);
+  printf("  free lists:   %6ldus\n", binTime);
+  printf("  linear scans: %6ldus\n", legacyTime);
+  printf("  libc:         %6ldus\n", libcTime);
+}
@@ -18,6 +18,7 @@
  * GNU General Public License for more details.
  */
 
+#include <chrono>
 #include "gtests.h"
 
 #if defined(COLORLCD)
@@ -51,4 +52,147 @@ TEST(color, ARGB)
   EXPECT_EQ(ARGB(128, 30, 40, 150), (uint16_t)0x8129);
 }
 
+TEST(DirtyRects, merge)
+{
+  DirtyRects rects;
+  EXPECT_EQ(rects.getCount(), 0u);
+  EXPECT_EQ(rects.getArea(), 0u);
+
+  rects.add(10, 10, 20, 20);
+  rects.add(15, 15, 5, 5);    // inside the first one
+  EXPECT_EQ(rects.getCount(), 1u);
+  EXPECT_EQ(rects.getArea(), 400u);
+
+  rects.add(100, 10, 10, 10);
+  EXPECT_EQ(rects.getCount(), 2u);
+  EXPECT_EQ(rects.getArea(), 500u);
+
+  // touches both rectangles, which are merged in one
+  rects.add(30, 10, 70, 1);
+  EXPECT_EQ(rects.getCount(), 1u);
+  DirtyRect bounds = rects.getBounds();
+  EXPECT_EQ(bounds.x, 10);
+  EXPECT_EQ(bounds.y, 10);
+  EXPECT_EQ(bounds.w, 100);
+  EXPECT_EQ(bounds.h, 20);
+
+  DirtyRect inside = { 50, 20, 10, 10 };
+  DirtyRect outside = { 50, 30, 10, 10 };
+  EXPECT_TRUE(rects.intersects(inside));
+  EXPECT_FALSE(rects.intersects(outside));
+}
+
+TEST(DirtyRects, overflow)
+{
+  DirtyRects rects;
+  for (int i=0; i<DIRTY_RECTS_COUNT; i++) {
+    rects.add(i * 50, 0, 10, 10);
+  }
+  EXPECT_EQ(rects.getCount(), (unsigned int)DIRTY_RECTS_COUNT);
+
+  // no room left, merged with the closest rectangle
+  rects.add(12, 0, 10, 10);
+  EXPECT_EQ(rects.getCount(), (unsigned int)DIRTY_RECTS_COUNT);
+  EXPECT_EQ(rects.getArea(), (unsigned int)(DIRTY_RECTS_COUNT * 100 + 120));
+  EXPECT_EQ(rects.getBounds().w, (DIRTY_RECTS_COUNT - 1) * 50 + 10);
+}
+
+TEST(DirtyRects, draw)
+{
+  BitmapBuffer bitmap(BMP_RGB565, 100, 100);
+  bitmap.markDirty(90, 90, 20, 20);   // clipped to the bitmap
+  EXPECT_EQ(bitmap.getDirtyRects().getArea(), 100u);
+  bitmap.getDirtyRects().reset();
+  bitmap.drawSolidFilledRect(20, 20, 10, 5, 0);
+  EXPECT_EQ(bitmap.getDirtyRects().getArea(), 50u);
+  bitmap.getDirtyRects().reset();
+  bitmap.drawHorizontalLine(0, 50, 10, SOLID, 0);
+  EXPECT_EQ(bitmap.getDirtyRects().getArea(), 10u);
+}
+
+// the glyphs drawn one by one, as drawSizedText() did before the fonts atlas
+static void drawTextPerGlyph(BitmapBuffer * dc, coord_t x, coord_t y, const char * s, LcdFlags flags)
+{
+  uint32_t fontindex = FONTINDEX(flags);
+  while (*s) {
+    x += dc->drawCharWithoutCache(x-1, y, fontsTable[fontindex], fontspecsTable[fontindex], getMappedChar(*s++), flags);
+  }
+}
+
+struct TelemetryPageItem
+{
+  coord_t x, y;
+  const char * text;
+  LcdFlags flags;
+};
+
+static const TelemetryPageItem telemetryPage[] = {
+  { 10, 10, "RSSI", SMLSIZE }, { 10, 25, "98dB", MIDSIZE },
+  { 130, 10, "RxBt", SMLSIZE }, { 130, 25, "5.12V", MIDSIZE },
+  { 250, 10, "A2", SMLSIZE }, { 250, 25, "12.47V", MIDSIZE },
+  { 370, 10, "Curr", SMLSIZE }, { 370, 25, "23.8A", MIDSIZE },
+  { 10, 70, "Alt", SMLSIZE }, { 10, 85, "356.2m", DBLSIZE },
+  { 250, 70, "VSpd", SMLSIZE }, { 250, 85, "-2.35m/s", DBLSIZE },
+  { 10, 130, "Fuel", SMLSIZE }, { 10, 145, "67%", XXLSIZE },
+  { 250, 130, "Tmp1", SMLSIZE }, { 250, 145, "45C", MIDSIZE },
+  { 370, 130, "Tmp2", SMLSIZE }, { 370, 145, "37C", MIDSIZE },
+  { 250, 190, "GPS 45.123456 3.654321", 0 },
+  { 250, 210, "Dist 1234m Spd 78.5kmh", 0 },
+  { 10, 230, "Hdg 271 Sats 12 Hdop 0.9 Cells 3.92 3.91 3.93", TINSIZE },
+};
+
+static void drawTelemetryBackground(BitmapBuffer * dc)
+{
+  for (uint32_t i=0; i<LCD_W*LCD_H; i++) {
+    dc->getData()[i] = RGB(i % LCD_W / 2, 40, i / LCD_W / 2);
+  }
+}
+
+static void drawTelemetryPage(BitmapBuffer * dc, bool perGlyph)
+{
+  for (unsigned int i=0; i<DIM(telemetryPage); i++) {
+    const TelemetryPageItem & item = telemetryPage[i];
+    if (perGlyph)
+      drawTextPerGlyph(dc, item.x, item.y, item.text, item.flags | CUSTOM_COLOR);
+    else
+      dc->drawText(item.x, item.y, item.text, item.flags | CUSTOM_COLOR | NO_FONTCACHE);
+  }
+}
+
+TEST(Lcd, glyphsBenchmark)
+{
+  lcdColorTable[CUSTOM_COLOR_INDEX] = RGB(255, 255, 0);
+
+  unsigned int glyphs = 0;
+  for (unsigned int i=0; i<DIM(telemetryPage); i++) {
+    glyphs += strlen(telemetryPage[i].text);
+  }
+
+  BitmapBuffer perGlyph(BMP_RGB565, LCD_W, LCD_H);
+  BitmapBuffer atlas(BMP_RGB565, LCD_W, LCD_H);
+  drawTelemetryBackground(&perGlyph);
+  drawTelemetryBackground(&atlas);
+
+  const int iterations = 200;
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    drawTelemetryPage(&perGlyph, true);
+  }
+  auto end = std::chrono::steady_clock::now();
+  long perGlyphTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    drawTelemetryPage(&atlas, false);
+  }
+  end = std::chrono::steady_clock::now();
+  long atlasTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  EXPECT_EQ(memcmp(perGlyph.getData(), atlas.getData(), LCD_W*LCD_H*sizeof(display_t)), 0);
+
+  printf("Telemetry page: %d glyphs x %d\n", glyphs, iterations);
+  printf("  per glyph:   %8ld glyphs/s\n", (long)((uint64_t)glyphs * iterations * 1000000 / (perGlyphTime ? perGlyphTime : 1)));
+  printf("  fonts atlas: %8ld glyphs/s\n", (long)((uint64_t)glyphs * iterations * 1000000 / (atlasTime ? atlasTime : 1)));
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <chrono>
+#include "gtests.h"
+#include "crc.h"
+
+#if defined(CPUARM)
+
+// The CRCs computed byte per byte, as in the ISRs
+template <class ENGINE>
+typename ENGINE::type bytewiseCrc(const uint8_t * buf, uint32_t len)
+{
+  typename ENGINE::type crc = 0;
+  for (uint32_t i=0; i<len; i++) {
+    crc = ENGINE::update(crc, buf[i]);
+  }
+  return crc;
+}
+
+static uint16_t referenceCrc16(const uint8_t * buf, uint32_t len)
+{
+  uint16_t crc = 0;
+  for (uint32_t i=0; i<len; i++) {
+    crc ^= buf[i] << 8;
+    for (int bit=0; bit<8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static uint8_t referenceCrc8(const uint8_t * buf, uint32_t len)
+{
+  uint8_t crc = 0;
+  for (uint32_t i=0; i<len; i++) {
+    crc ^= buf[i];
+    for (int bit=0; bit<8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0xD5 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static uint8_t referenceSportChecksum(const uint8_t * buf, uint32_t len)
+{
+  uint16_t crc = 0;
+  for (uint32_t i=0; i<len; i++) {
+    crc += buf[i];
+    crc += crc >> 8;
+    crc &= 0x00ff;
+  }
+  return crc;
+}
+
+TEST(Crc, checkValues)
+{
+  const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  EXPECT_EQ(0x31C3, crc16(check, sizeof(check)));  // CRC-16/XMODEM
+  EXPECT_EQ(0xBC, crc8(check, sizeof(check)));     // CRC-8/DVB-S2
+}
+
+TEST(Crc, tables)
+{
+  // the first values of the tables which were written in the sources
+  const uint16_t crc16Ccitt[] = { 0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7 };
+  const uint16_t crc16Pxx[] = { 0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf };
+  const uint8_t crc8Dvb[] = { 0x00, 0xD5, 0x7F, 0xAA, 0xFE, 0x2B, 0x81, 0x54 };
+  for (int i=0; i<8; i++) {
+    EXPECT_EQ(crc16Ccitt[i], Crc16Ccitt::Table<1>::tables.values[i]);
+    EXPECT_EQ(crc16Pxx[i], Crc16Pxx::Table<1>::tables.values[i]);
+    EXPECT_EQ(crc8Dvb[i], Crc8Dvb::Table<1>::tables.values[i]);
+  }
+  EXPECT_EQ(0x0f78, Crc16Pxx::Table<1>::tables.values[255]);
+  EXPECT_EQ(0x1ef0, Crc16Ccitt::Table<1>::tables.values[255]);
+  EXPECT_EQ(0xF9, Crc8Dvb::Table<1>::tables.values[255]);
+
+  // the first slice of the slicing-by-N tables is the byte table
+  for (int i=0; i<256; i++) {
+    EXPECT_EQ(Crc16Pxx::Table<1>::tables.values[i], Crc16Pxx::Table<8>::tables.values[i]);
+  }
+}
+
+// All lengths and alignments, the slicing variants give the same results
+// as the byte per byte and the bit per bit implementations
+TEST(Crc, slicing)
+{
+  uint8_t buffer[300];
+  for (unsigned int i=0; i<sizeof(buffer); i++) {
+    buffer[i] = rand();
+  }
+
+  for (unsigned int offset=0; offset<8; offset++) {
+    for (unsigned int len=0; len<=sizeof(buffer)-offset; len++) {
+      const uint8_t * buf = buffer + offset;
+      uint16_t crc16Value = referenceCrc16(buf, len);
+      ASSERT_EQ(crc16Value, bytewiseCrc<Crc16Ccitt>(buf, len));
+      ASSERT_EQ(crc16Value, Crc16Ccitt::compute<1>(0, buf, len));
+      ASSERT_EQ(crc16Value, Crc16Ccitt::compute<4>(0, buf, len));
+      ASSERT_EQ(crc16Value, Crc16Ccitt::compute<8>(0, buf, len));
+      ASSERT_EQ(crc16Value, crc16(buf, len));
+
+      uint16_t pxxValue = bytewiseCrc<Crc16Pxx>(buf, len);
+      ASSERT_EQ(pxxValue, Crc16Pxx::compute<4>(0, buf, len));
+      ASSERT_EQ(pxxValue, Crc16Pxx::compute<8>(0, buf, len));
+
+      uint8_t crc8Value = referenceCrc8(buf, len);
+      ASSERT_EQ(crc8Value, bytewiseCrc<Crc8Dvb>(buf, len));
+      ASSERT_EQ(crc8Value, Crc8Dvb::compute<4>(0, buf, len));
+      ASSERT_EQ(crc8Value, Crc8Dvb::compute<8>(0, buf, len));
+      ASSERT_EQ(crc8Value, crc8(buf, len));
+
+      ASSERT_EQ(referenceSportChecksum(buf, len), sportChecksum(buf, len));
+    }
+  }
+
+  // the CRC may be computed in several parts
+  uint16_t crc = Crc16Pxx::compute<4>(0, buffer, 13);
+  crc = Crc16Pxx::compute<8>(crc, buffer + 13, 101);
+  EXPECT_EQ(bytewiseCrc<Crc16Pxx>(buffer, 114), crc);
+}
+
+TEST(Crc, sportChecksumLimits)
+{
+  uint8_t packet[7];
+  memset(packet, 0, sizeof(packet));
+  EXPECT_EQ(referenceSportChecksum(packet, sizeof(packet)), sportChecksum(packet, sizeof(packet)));
+  memset(packet, 0xFF, sizeof(packet));
+  EXPECT_EQ(referenceSportChecksum(packet, sizeof(packet)), sportChecksum(packet, sizeof(packet)));
+  packet[0] = 0x01;
+  EXPECT_EQ(referenceSportChecksum(packet, sizeof(packet)), sportChecksum(packet, sizeof(packet)));
+}
+
+template <class ENGINE, unsigned SLICES>
+long benchmarkCrc(const uint8_t * buf, uint32_t len, int iterations, typename ENGINE::type & result)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    result += ENGINE::template compute<SLICES>(result, buf, len);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+TEST(Crc, benchmark)
+{
+  const int iterations = 2000;
+  static uint8_t buffer[4096];
+  for (unsigned int i=0; i<sizeof(buffer); i++) {
+    buffer[i] = rand();
+  }
+
+  uint16_t crc16Value = 0;
+  uint8_t crc8Value = 0;
+  long crc16Times[3], crc8Times[3];
+  crc16Times[0] = benchmarkCrc<Crc16Ccitt, 1>(buffer, sizeof(buffer), iterations, crc16Value);
+  crc16Times[1] = benchmarkCrc<Crc16Ccitt, 4>(buffer, sizeof(buffer), iterations, crc16Value);
+  crc16Times[2] = benchmarkCrc<Crc16Ccitt, 8>(buffer, sizeof(buffer), iterations, crc16Value);
+  crc8Times[0] = benchmarkCrc<Crc8Dvb, 1>(buffer, sizeof(buffer), iterations, crc8Value);
+  crc8Times[1] = benchmarkCrc<Crc8Dvb, 4>(buffer, sizeof(buffer), iterations, crc8Value);
+  crc8Times[2] = benchmarkCrc<Crc8Dvb, 8>(buffer, sizeof(buffer), iterations, crc8Value);
+
+  printf("CRC of %d x %d bytes (%04x %02x)\n", iterations, (int)sizeof(buffer), crc16Value, crc8Value);
+  printf("            byte    slicing-by-4  slicing-by-8\n");
+  printf("  crc16: %6ldus %12ldus %12ldus\n", crc16Times[0], crc16Times[1], crc16Times[2]);
+  printf("  crc8:  %6ldus %12ldus %12ldus\n", crc8Times[0], crc8Times[1], crc8Times[2]);
+}
+
+#endif
@@ -18,6 +18,7 @@
  * GNU General Public License for more details.
  */
 
+#include <vector>
 #include "gtests.h"
 
 #if defined(CROSSFIRE)
@@ -43,5 +44,65 @@ TEST(Crossfire, crc8)
   uint8_t crc = crc8(&frame[2], frame[1]-1);
   ASSERT_EQ(frame[frame[1]+1], crc);
 }
+
+static void appendCrossfireBatteryFrame(std::vector<uint8_t> & stream, uint16_t voltage)
+{
+  uint8_t frame[] = { RADIO_ADDRESS, 10, BATTERY_ID, uint8_t(voltage >> 8), uint8_t(voltage), 0x00, 0x10, 0x00, 0x00, 0x20, 0x50, 0x00 };
+  frame[11] = crc8(&frame[2], frame[1]-1);
+  stream.insert(stream.end(), frame, frame + sizeof(frame));
+}
+
+static int32_t crossfireStreamState()
+{
+  int32_t result = telemetryRxBufferCount;
+  for (int i=0; i<4; i++) {
+    result = result * 31 + telemetryItems[i].value;
+  }
+  return result;
+}
+
+TEST(Crossfire, processSpans)
+{
+  std::vector<uint8_t> stream;
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  telemetryRxBufferCount = 0;
+
+  // garbage, bad lengths and broken frames between the frames
+  srand(42);
+  for (int n=0; n<200; n++) {
+    for (int i=rand() % 4; i>0; i--) {
+      stream.push_back(rand() % 4 == 0 ? RADIO_ADDRESS : rand());
+    }
+    appendCrossfireBatteryFrame(stream, rand() & 0x7FFF);
+    if (n % 10 == 0) {
+      stream.resize(stream.size() - 3);
+    }
+  }
+  // a frame with a length of 2 is never processed
+  stream.push_back(RADIO_ADDRESS);
+  stream.push_back(2);
+  stream.insert(stream.end(), TELEMETRY_RX_PACKET_SIZE, 0x00);
+  appendCrossfireBatteryFrame(stream, 120);
+
+  // the state after each byte
+  std::vector<int32_t> states;
+  for (auto data: stream) {
+    processCrossfireTelemetryData(data);
+    states.push_back(crossfireStreamState());
+  }
+  EXPECT_EQ(120, telemetryItems[0].value);
+
+  // the same states at the end of each span
+  TELEMETRY_RESET();
+  for (unsigned int start=0; start<stream.size(); ) {
+    unsigned int count = std::min<unsigned int>(1 + rand() % 40, stream.size() - start);
+    processCrossfireTelemetrySpan(&stream[start], count);
+    start += count;
+    ASSERT_EQ(states[start-1], crossfireStreamState()) << "at byte " << start;
+  }
+}
 #endif
 
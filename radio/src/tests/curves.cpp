@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <chrono>
+#include "gtests.h"
+
+#if defined(CPUARM) && defined(CURVES)
+
+class CurvesTest : public OpenTxTest {};
+
+// A smooth curve in the first curve, with random points. The custom curves
+// have sorted X coordinates.
+static void setRandomCurve(uint8_t type, int8_t points)
+{
+  CurveData & crv = g_model.curves[0];
+  crv.type = type;
+  crv.points = points;
+  crv.smooth = 1;
+
+  uint8_t count = 5 + points;
+  int8_t y = rand() % 201 - 100;
+  for (int i=0; i<count; i++) {
+    // mostly gentle slopes, sometimes a step
+    y = limit(-100, y + (rand() % 8 == 0 ? rand() % 201 - 100 : rand() % 41 - 20), 100);
+    g_model.points[i] = y;
+  }
+
+  if (type == CURVE_TYPE_CUSTOM) {
+    resetCustomCurveX(g_model.points, count);
+    for (int i=0; i<count-2; i++) {
+      int8_t min = (i == 0 ? -100 : g_model.points[count+i-1]);
+      int8_t max = (i == count-3 ? 100 : g_model.points[count+i+1]);
+      g_model.points[count+i] = min + rand() % (max - min + 1);
+    }
+  }
+
+  loadCurves();
+}
+
+// The greatest difference between the curve and its spline
+static int maxCurveError(uint8_t idx)
+{
+  int result = 0;
+  for (int x=-RESX-10; x<=RESX+10; x++) {
+    result = std::max<int>(result, abs(applyCustomCurve(x, idx) - hermite_spline(x, idx)));
+  }
+  return result;
+}
+
+TEST_F(CurvesTest, lutMaxError)
+{
+  int tabulated = 0;
+  const int iterations = 500;
+
+  srand(42);
+  for (int n=0; n<iterations; n++) {
+    setRandomCurve(n & 1 ? CURVE_TYPE_CUSTOM : CURVE_TYPE_STANDARD, rand() % 16 - 3);
+    ASSERT_LE(maxCurveError(0), CURVE_LUT_MAX_ERROR) << "curve " << n;
+    if (getCurveLut(0)) {
+      tabulated++;
+      // the nodes are the spline values
+      for (int i=0; i<CURVE_LUT_SIZE; i++) {
+        ASSERT_EQ(hermite_spline(-RESX + i * CURVE_LUT_STEP, 0), getCurveLut(0)[i]);
+      }
+    }
+  }
+
+  printf("%d/%d smooth curves tabulated\n", tabulated, iterations);
+  EXPECT_GT(tabulated, iterations / 2);
+}
+
+TEST_F(CurvesTest, lutInvalidation)
+{
+  g_model.curves[0].smooth = 1;
+  for (int i=0; i<5; i++) {
+    g_model.points[i] = -50 + i * 25;
+  }
+  loadCurves();
+  EXPECT_TRUE(getCurveLut(0) != NULL);
+  EXPECT_EQ(hermite_spline(512, 0), applyCustomCurve(512, 0));
+
+  // as the curve editors do, the spline is used until the menus task
+  // rebuilds the table
+  g_model.points[3] = 10;
+  invalidateCurve(0);
+  EXPECT_TRUE(getCurveLut(0) == NULL);
+  EXPECT_EQ(hermite_spline(512, 0), applyCustomCurve(512, 0));
+  updateCurveLuts();
+  EXPECT_TRUE(getCurveLut(0) != NULL);
+  EXPECT_LE(maxCurveError(0), CURVE_LUT_MAX_ERROR);
+
+  // the linear curves are not tabulated
+  g_model.curves[0].smooth = 0;
+  invalidateCurve(0);
+  updateCurveLuts();
+  EXPECT_EQ(intpol(512, 0), applyCustomCurve(512, 0));
+  EXPECT_TRUE(getCurveLut(0) == NULL);
+}
+
+TEST_F(CurvesTest, lutPool)
+{
+  for (int idx=0; idx<MAX_CURVES; idx++) {
+    g_model.curves[idx].smooth = 1;
+  }
+  loadCurves();
+  for (int idx=0; idx<MAX_CURVES; idx++) {
+    int8_t * points = curveAddress(idx);
+    for (int i=0; i<5; i++) {
+      points[i] = (i - 2) * (idx % 5) * 10;
+    }
+  }
+  loadCurves();
+
+  // the first curves have a table, the other ones are computed
+  for (int idx=0; idx<MAX_CURVES; idx++) {
+    EXPECT_EQ(idx < CURVE_LUT_COUNT, getCurveLut(idx) != NULL) << "curve " << idx;
+    EXPECT_LE(maxCurveError(idx), CURVE_LUT_MAX_ERROR) << "curve " << idx;
+  }
+
+  // a table is released when its curve becomes linear
+  g_model.curves[0].smooth = 0;
+  invalidateCurve(0);
+  invalidateCurve(CURVE_LUT_COUNT);
+  updateCurveLuts();
+  EXPECT_TRUE(getCurveLut(0) == NULL);
+  EXPECT_TRUE(getCurveLut(CURVE_LUT_COUNT) != NULL);
+}
+
+template <class FUNCTION>
+long benchmarkCurve(FUNCTION function, int iterations, int & result)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    for (int x=-RESX; x<=RESX; x++) {
+      result += function(x);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+TEST_F(CurvesTest, benchmark)
+{
+  const int iterations = 200;
+  int result = 0;
+
+  srand(42);
+  do {
+    setRandomCurve(CURVE_TYPE_CUSTOM, 12);
+  } while (!getCurveLut(0));
+
+  long splineTime = benchmarkCurve([](int x) { return hermite_spline(x, 0); }, iterations, result);
+  long lutTime = benchmarkCurve([](int x) { return applyCustomCurve(x, 0); }, iterations, result);
+  g_model.curves[0].smooth = 0;
+  long intpolTime = benchmarkCurve([](int x) { return applyCustomCurve(x, 0); }, iterations, result);
+  long expoTime = benchmarkCurve([](int x) { return expo(x, 40); }, iterations, result);
+
+  printf("%d x %d values of a 17 points curve (%d)\n", iterations, 2*RESX+1, result);
+  printf("  spline:  %6ldus\n", splineTime);
+  printf("  table:   %6ldus\n", lutTime);
+  printf("  linear:  %6ldus\n", intpolTime);
+  printf("  expo:    %6ldus\n", expoTime);
+}
+
+#endif
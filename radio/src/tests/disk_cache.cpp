@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <vector>
+#include "gtests.h"
+#include "location.h"
+
+#if defined(DISK_CACHE)
+
+struct DiskAccess
+{
+  bool write;
+  uint32_t sector;
+  uint32_t count;
+};
+
+// The disk_read() / disk_write() lines of a simudisk trace
+static bool loadDiskTrace(const char * path, std::vector<DiskAccess> & accesses)
+{
+  FILE * f = fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    DiskAccess access;
+    char function[16];
+    if (sscanf(line, "%15[a-z_](%*u, %*[^,], %u, %u)", function, &access.sector, &access.count) == 3) {
+      access.write = !strcmp(function, "disk_write");
+      if (access.write || !strcmp(function, "disk_read")) {
+        accesses.push_back(access);
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// The previous DiskCache, kept as a reference: a free block if any,
+// otherwise the next one (round robin)
+class LegacyDiskCache
+{
+  public:
+    LegacyDiskCache():
+      lastBlock(0),
+      noHits(0),
+      noMisses(0)
+    {
+      memclear(startSectors, sizeof(startSectors));
+      memclear(endSectors, sizeof(endSectors));
+    }
+
+    void read(uint32_t sector, uint32_t count)
+    {
+      if (count > DISK_CACHE_BLOCK_SECTORS) {
+        return;
+      }
+      for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+        if (sector >= startSectors[n] && sector+count <= endSectors[n]) {
+          ++noHits;
+          return;
+        }
+      }
+      ++noMisses;
+      for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+        if (endSectors[n] == 0) {
+          fill(n, sector);
+          return;
+        }
+      }
+      if (++lastBlock >= DISK_CACHE_BLOCKS_NUM) {
+        lastBlock = 0;
+      }
+      fill(lastBlock, sector);
+    }
+
+    void write(uint32_t sector, uint32_t count)
+    {
+      for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+        if (sector < endSectors[n] && sector+count > startSectors[n]) {
+          endSectors[n] = 0;
+        }
+      }
+    }
+
+    int getHitRate() const
+    {
+      return noHits + noMisses ? (noHits * 1000) / (noHits + noMisses) : 0;
+    }
+
+  protected:
+    uint32_t startSectors[DISK_CACHE_BLOCKS_NUM];
+    uint32_t endSectors[DISK_CACHE_BLOCKS_NUM];
+    int lastBlock;
+    uint32_t noHits;
+    uint32_t noMisses;
+
+    void fill(int n, uint32_t sector)
+    {
+      startSectors[n] = sector;
+      endSectors[n] = sector + DISK_CACHE_BLOCK_SECTORS;
+    }
+};
+
+// disk_cache_trace.txt is the trace of a session on a 512MB FAT32 image:
+// boot (settings, model, theme, widgets and scripts), the model selection
+// page, and 2 minutes of logs at 10Hz with timer and telemetry sounds
+TEST(DiskCache, SessionTraceHitRate)
+{
+  std::vector<DiskAccess> accesses;
+  ASSERT_TRUE(loadDiskTrace(TESTS_PATH "/tests/disk_cache_trace.txt", accesses));
+  ASSERT_GT(accesses.size(), 1000u);
+
+  static uint8_t buffer[DISK_CACHE_BLOCK_SIZE];
+  LegacyDiskCache legacy;
+  diskCache.clear();
+  for (const DiskAccess & access: accesses) {
+    if (access.write) {
+      legacy.write(access.sector, access.count);
+      EXPECT_EQ(RES_OK, disk_write(0, buffer, access.sector, access.count));
+    }
+    else {
+      legacy.read(access.sector, access.count);
+      EXPECT_EQ(RES_OK, disk_read(0, buffer, access.sector, access.count));
+    }
+    // the storage task between the accesses
+    diskCache.idle();
+  }
+
+  const DiskCacheStats & stats = diskCache.getStats();
+  printf("Disk cache hit rate: %d.%d%% (round robin %d.%d%%), %u read aheads, %u used\n",
+         diskCache.getHitRate() / 10, diskCache.getHitRate() % 10, legacy.getHitRate() / 10, legacy.getHitRate() % 10,
+         stats.noReadAheads, stats.noReadAheadHits);
+  EXPECT_GT(diskCache.getHitRate(), legacy.getHitRate());
+  EXPECT_GT(stats.noReadAheadHits, 0u);
+  EXPECT_GT(diskCache.getHitRate(DISK_CACHE_ACCESS_STREAM), diskCache.getHitRate(DISK_CACHE_ACCESS_RANDOM));
+
+  diskCache.clear();
+}
+
+// A stream miss reads one block, the next one is read in idle()
+TEST(DiskCache, DeferredReadAhead)
+{
+  static uint8_t buffer[DISK_CACHE_BLOCK_SIZE];
+  const DiskCacheStats & stats = diskCache.getStats();
+  diskCache.clear();
+
+  EXPECT_EQ(RES_OK, disk_read(0, buffer, 1000, 4));
+  EXPECT_EQ(RES_OK, disk_read(0, buffer, 1004, 4));
+  EXPECT_EQ(RES_OK, disk_read(0, buffer, 1008, 4));
+  EXPECT_EQ(RES_OK, disk_read(0, buffer, 1012, 4));
+  EXPECT_EQ(0u, stats.noReadAheads);
+
+  // the stream leaves the first block
+  EXPECT_EQ(RES_OK, disk_read(0, buffer, 1016, 4));
+  EXPECT_EQ(0u, stats.noReadAheads);
+  diskCache.idle();
+  EXPECT_EQ(1u, stats.noReadAheads);
+  diskCache.idle();
+  EXPECT_EQ(1u, stats.noReadAheads);
+
+  EXPECT_EQ(RES_OK, disk_read(0, buffer, 1032, 4));
+  EXPECT_EQ(1u, stats.noReadAheadHits);
+  EXPECT_EQ(2u, stats.noMisses);
+
+  diskCache.clear();
+}
+
+#endif // #if defined(DISK_CACHE)
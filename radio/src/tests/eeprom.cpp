@@ -18,6 +18,9 @@
  * GNU General Public License for more details.
  */
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
 #include "gtests.h"
 
 extern const char * eepromFile;
@@ -43,6 +46,207 @@ TEST(Storage, BackupAndRestore)
   if (memcmp(&ramBackupUncompressed, &ramBackupRestored, sizeof(ramBackupUncompressed)) != 0)
     TRACE("ERROR restore");
 }
+
+static void fillModel(uint8_t value)
+{
+  memset(&g_model, value, sizeof(g_model));
+  storageDirty(EE_MODEL);
+}
+
+// The power is cut at random points of the model writes: the model file is
+// always the previous model or the new one
+TEST(Storage, PowerLossDuringWrite)
+{
+  char sdPath[] = "/tmp/opentx-gtests-XXXXXX";
+  ASSERT_TRUE(mkdtemp(sdPath) != NULL);
+  std::string models = std::string(sdPath) + MODELS_PATH;
+  mkdir(models.c_str(), 0777);
+  simuFatfsSetPaths(sdPath, NULL);
+  strcpy(g_eeGeneral.currModelFilename, "model1.bin");
+
+  fillModel(0);
+  storageCheck(true);
+
+  // the number of bytes and files changes of a write
+  simuFatfsSetPowerCut(INT_MAX);
+  fillModel(1);
+  storageCheck(true);
+  int writeSize = INT_MAX - simuFatfsGetPowerCut();
+
+  // before the temporary file is created, after it's written, after the
+  // previous file is removed, after the rename, then random points
+  const int cuts[] = { 0, writeSize - 2, writeSize - 1, writeSize };
+  static ModelData model;
+  uint8_t previous = 1;
+  for (int i=0; i<200; i++) {
+    uint8_t value = 2 + (i % 200);
+    fillModel(value);
+    simuFatfsSetPowerCut(i < (int)DIM(cuts) ? cuts[i] : rand() % (writeSize + 1));
+    storageCheck(true);
+    simuFatfsSetPowerCut(-1);
+
+    // next power on
+    ASSERT_EQ(NULL, readModel(g_eeGeneral.currModelFilename, (uint8_t *)&model, sizeof(model))) << "write " << i;
+    uint8_t expected = (((uint8_t *)&model)[0] == value ? value : previous);
+    for (unsigned int j=0; j<sizeof(model); j++) {
+      ASSERT_EQ(expected, ((uint8_t *)&model)[j]) << "write " << i << " byte " << j;
+    }
+    previous = expected;
+  }
+
+  simuFatfsSetPaths("", NULL);
+  unlink((models + "/model1.bin").c_str());
+  unlink((models + "/model1.bin" TMP_EXT).c_str());
+  rmdir(models.c_str());
+  rmdir(sdPath);
+  MODEL_RESET();
+}
+
+#if defined(PCBHORUS)
+#include <utime.h>
+#include "storage/modelslist.h"
+
+static void writeTestModel(const char * filename, const char * name)
+{
+  strcpy(g_eeGeneral.currModelFilename, filename);
+  memset(&g_model, 0, sizeof(g_model));
+  str2zchar(g_model.header.name, name, LEN_MODEL_NAME);
+  storageDirty(EE_MODEL);
+  storageCheck(true);
+}
+
+static void setModelFileTime(const std::string & models, const char * filename, time_t time)
+{
+  struct utimbuf times = { time, time };
+  utime((models + "/" + filename).c_str(), &times);
+}
+
+static ModelCell * getModelCell(ModelsList & list, unsigned int index)
+{
+  ModelsCategory::iterator it = list.categories.front()->begin();
+  std::advance(it, index);
+  return *it;
+}
+
+// The cells are painted from the cache, unless the model file changed or,
+// for the current model, its header
+TEST(Storage, ModelsListCache)
+{
+  char sdPath[] = "/tmp/opentx-gtests-XXXXXX";
+  ASSERT_TRUE(mkdtemp(sdPath) != NULL);
+  std::string models = std::string(sdPath) + MODELS_PATH;
+  std::string radio = std::string(sdPath) + RADIO_PATH;
+  mkdir(models.c_str(), 0777);
+  mkdir(radio.c_str(), 0777);
+  simuFatfsSetPaths(sdPath, NULL);
+
+  const char * filenames[] = { "model1.bin", "model2.bin", "model3.bin", "model4.bin" };
+  writeTestModel(filenames[0], "MODEL1");
+  writeTestModel(filenames[1], "MODEL2");
+  writeTestModel(filenames[2], "MODEL3");
+  for (int i=0; i<3; i++) {
+    setModelFileTime(models, filenames[i], 1000000000);
+  }
+  writeTestModel(filenames[0], "MODEL1");
+  setModelFileTime(models, filenames[0], 1000000000);
+  FILE * f = fopen((radio + "/models.txt").c_str(), "w");
+  ASSERT_TRUE(f != NULL);
+  fputs("[Models]\nmodel1.bin\nmodel2.bin\nmodel3.bin\n", f);
+  fclose(f);
+
+  // the cells are rendered, then cached
+  static uint16_t cells[3][MODELCELL_WIDTH * MODELCELL_HEIGHT];
+  {
+    ModelsList list;
+    list.load();
+    for (int i=0; i<3; i++) {
+      ModelCell * model = getModelCell(list, i);
+      ASSERT_TRUE(model->getBuffer() != NULL);
+      EXPECT_EQ(MODELCELL_CACHE_CELL_CHANGED, model->cacheState);
+      memcpy(cells[i], model->buffer->getData(), MODELCELL_SIZE);
+    }
+    list.saveCache();
+    EXPECT_EQ(3u, list.cacheCount);
+  }
+
+  {
+    ModelsList list;
+    list.load();
+    for (int i=0; i<3; i++) {
+      ModelCell * model = getModelCell(list, i);
+      ASSERT_TRUE(model->getBuffer() != NULL);
+      EXPECT_EQ(MODELCELL_CACHED, model->cacheState);
+      EXPECT_EQ(0, memcmp(cells[i], model->buffer->getData(), MODELCELL_SIZE));
+    }
+    EXPECT_STREQ("MODEL2", getModelCell(list, 1)->modelName);
+  }
+
+  // the current model header, a model header and a model file date change
+  str2zchar(g_model.header.name, "CURRENT", LEN_MODEL_NAME);
+  writeTestModel(filenames[1], "RENAMED");
+  setModelFileTime(models, filenames[2], 1000000100);
+  strcpy(g_eeGeneral.currModelFilename, filenames[0]);
+  memset(&g_model, 0, sizeof(g_model));
+  str2zchar(g_model.header.name, "CURRENT", LEN_MODEL_NAME);
+  {
+    ModelsList list;
+    list.load();
+    getModelCell(list, 0)->getBuffer();
+    getModelCell(list, 1)->getBuffer();
+    getModelCell(list, 2)->getBuffer();
+    EXPECT_EQ(MODELCELL_CACHE_CELL_CHANGED, getModelCell(list, 0)->cacheState);
+    EXPECT_EQ(MODELCELL_CACHE_CELL_CHANGED, getModelCell(list, 1)->cacheState);
+    EXPECT_EQ(MODELCELL_CACHE_ENTRY_CHANGED, getModelCell(list, 2)->cacheState);
+    EXPECT_EQ(0, memcmp(cells[2], getModelCell(list, 2)->buffer->getData(), MODELCELL_SIZE));
+    EXPECT_STREQ("RENAMED", getModelCell(list, 1)->modelName);
+    EXPECT_STREQ("CURRENT", getModelCell(list, 0)->modelName);
+    list.saveCache();
+  }
+
+  // a new model makes the cache written again
+  writeTestModel(filenames[3], "MODEL4");
+  strcpy(g_eeGeneral.currModelFilename, filenames[0]);
+  memset(&g_model, 0, sizeof(g_model));
+  str2zchar(g_model.header.name, "CURRENT", LEN_MODEL_NAME);
+  {
+    ModelsList list;
+    list.load();
+    for (int i=0; i<3; i++) {
+      ASSERT_TRUE(getModelCell(list, i)->getBuffer() != NULL);
+      EXPECT_EQ(MODELCELL_CACHED, getModelCell(list, i)->cacheState) << "model " << i;
+    }
+    EXPECT_STREQ("RENAMED", getModelCell(list, 1)->modelName);
+    list.addModel(list.categories.front(), filenames[3]);
+    ModelCell * model = getModelCell(list, 3);
+    ASSERT_TRUE(model->getBuffer() != NULL);
+    EXPECT_EQ(-1, model->cacheIndex);
+    list.saveCache();
+    EXPECT_EQ(4u, list.cacheCount);
+  }
+
+  {
+    ModelsList list;
+    list.load();
+    for (int i=0; i<4; i++) {
+      ASSERT_TRUE(getModelCell(list, i)->getBuffer() != NULL);
+      EXPECT_EQ(MODELCELL_CACHED, getModelCell(list, i)->cacheState) << "model " << i;
+    }
+    EXPECT_EQ(0, memcmp(cells[2], getModelCell(list, 2)->buffer->getData(), MODELCELL_SIZE));
+    EXPECT_STREQ("MODEL4", getModelCell(list, 3)->modelName);
+  }
+
+  simuFatfsSetPaths("", NULL);
+  for (unsigned int i=0; i<DIM(filenames); i++) {
+    unlink((models + "/" + filenames[i]).c_str());
+  }
+  unlink((radio + "/models.txt").c_str());
+  unlink((radio + "/models.cache").c_str());
+  rmdir(models.c_str());
+  rmdir(radio.c_str());
+  rmdir(sdPath);
+  MODEL_RESET();
+}
+#endif
 #endif
 
 #if defined(EEPROM_RLC)
@@ -18,6 +18,8 @@
  * GNU General Public License for more details.
  */
 
+#include <chrono>
+#include <vector>
 #include "gtests.h"
 
 void frskyDProcessPacket(const uint8_t *packet);
@@ -553,4 +555,320 @@ TEST(FrSkySPORT, frskyCurrent)
   EXPECT_EQ(telemetryItems[0].valueMax, 505);
 }
 
+static void generateSportPacket(uint8_t * packet, uint8_t physicalId, uint16_t id, int32_t data)
+{
+  packet[0] = physicalId;
+  packet[1] = 0x10; //DATA_FRAME
+  *((uint16_t *)(packet+2)) = id;
+  *((int32_t *)(packet+4)) = data;
+  setSportPacketCrc(packet);
+}
+
+TEST(FrSkySPORT, SensorsIndex)
+{
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = false;
+
+  // two sensors sharing the same id and instance, and a second instance
+  for (int i=0; i<3; i++) {
+    TelemetrySensor & sensor = g_model.telemetrySensors[i];
+    sensor.id = VFAS_FIRST_ID;
+    sensor.instance = (i == 2 ? 3 : 2);
+    sensor.init("VFAS", UNIT_VOLTS, 2);
+  }
+  storageDirty(EE_MODEL);
+
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, VFAS_FIRST_ID, 0, 2, 1180, UNIT_VOLTS, 2);
+  EXPECT_EQ(telemetryItems[0].value, 1180);
+  EXPECT_EQ(telemetryItems[1].value, 1180);
+  EXPECT_FALSE(telemetryItems[2].isAvailable());
+
+  // the index follows the "ignore instance" option
+  g_model.ignoreSensorIds = 1;
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, VFAS_FIRST_ID, 0, 5, 1200, UNIT_VOLTS, 2);
+  EXPECT_EQ(telemetryItems[0].value, 1200);
+  EXPECT_EQ(telemetryItems[1].value, 1200);
+  EXPECT_EQ(telemetryItems[2].value, 1200);
+  g_model.ignoreSensorIds = 0;
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, VFAS_FIRST_ID, 0, 3, 1150, UNIT_VOLTS, 2);
+  EXPECT_EQ(telemetryItems[0].value, 1200);
+  EXPECT_EQ(telemetryItems[2].value, 1150);
+
+  // a deleted sensor isn't updated anymore
+  delTelemetryIndex(1);
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, VFAS_FIRST_ID, 0, 2, 1100, UNIT_VOLTS, 2);
+  EXPECT_EQ(telemetryItems[0].value, 1100);
+  EXPECT_FALSE(telemetryItems[1].isAvailable());
+
+  // a discovered sensor is found with the next value
+  allowNewSensors = true;
+  EXPECT_EQ(setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RPM_FIRST_ID, 0, 4, 2400, UNIT_RPMS, 0), 1);
+  EXPECT_EQ(setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RPM_FIRST_ID, 0, 4, 2500, UNIT_RPMS, 0), -1);
+  EXPECT_EQ(telemetryItems[1].value, 2500);
+  EXPECT_EQ(availableTelemetryIndex(), 3);
+  allowNewSensors = false;
+}
+
+// setTelemetryValue() as it was before the sensors index
+static void linearSetTelemetryValue(uint16_t id, uint8_t subId, uint8_t instance, int32_t value, uint32_t unit, uint32_t prec)
+{
+  for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+    if (telemetrySensor.type == TELEM_TYPE_CUSTOM && telemetrySensor.id == id && telemetrySensor.subId == subId && (telemetrySensor.instance == instance || g_model.ignoreSensorIds)) {
+      telemetryItems[index].setValue(telemetrySensor, value, unit, prec);
+    }
+  }
+}
+
+// one second of the S.Port stream of a X8R with a vario, a FLVSS, a FAS40, a GPS and a RPM / temperatures sensor
+static const struct {
+  uint8_t physicalId;
+  uint16_t id;
+  int32_t data;
+} sportStream[] = {
+  { 0x98, RSSI_ID, 82 }, { 0x98, BATT_ID, 131 },
+  { 0x00, ALT_FIRST_ID, 1250 }, { 0x00, VARIO_FIRST_ID, -35 },
+  { 0xA1, CELLS_FIRST_ID, (int32_t)0x83483430 }, { 0xA1, CELLS_FIRST_ID, 0x00034832 },
+  { 0x22, CURR_FIRST_ID, 123 }, { 0x22, VFAS_FIRST_ID, 1180 },
+  { 0x83, GPS_LONG_LATI_FIRST_ID, 0x00B2A4C8 }, { 0x83, GPS_LONG_LATI_FIRST_ID, (int32_t)0x8011A2B0 },
+  { 0x83, GPS_ALT_FIRST_ID, 5230 }, { 0x83, GPS_SPEED_FIRST_ID, 12400 }, { 0x83, GPS_COURS_FIRST_ID, 27850 },
+  { 0xE4, RPM_FIRST_ID, 2400 }, { 0xE4, T1_FIRST_ID, 45 }, { 0xE4, T2_FIRST_ID, 31 },
+  { 0x98, RSSI_ID, 81 }, { 0x00, ALT_FIRST_ID, 1262 }, { 0x00, VARIO_FIRST_ID, -20 },
+  { 0x22, CURR_FIRST_ID, 131 }, { 0x22, VFAS_FIRST_ID, 1176 }, { 0xE4, RPM_FIRST_ID, 2450 },
+};
+
+TEST(FrSkySPORT, SensorsIndexBenchmark)
+{
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+
+  // sensors discovery
+  allowNewSensors = true;
+  for (auto & value: sportStream) {
+    generateSportPacket(packet, value.physicalId, value.id, value.data);
+    sportProcessTelemetryPacket(packet);
+  }
+  allowNewSensors = false;
+  int sensorsCount = availableTelemetryIndex();
+  EXPECT_EQ(sensorsCount, 14);
+
+  // the rest of the sensors are calculated ones
+  for (int i=sensorsCount; i<MAX_TELEMETRY_SENSORS; i++) {
+    g_model.telemetrySensors[i].type = TELEM_TYPE_CALCULATED;
+    g_model.telemetrySensors[i].formula = TELEM_FORMULA_ADD;
+  }
+  storageDirty(EE_MODEL);
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    telemetryItems[i].clear();
+  }
+
+  const int iterations = 10000;
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    for (auto & value: sportStream) {
+      setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, value.id, 0, (value.physicalId & 0x1F) + 1, value.data + (n & 7), UNIT_RAW, 0);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  long indexTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  int32_t values[MAX_TELEMETRY_SENSORS];
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    values[i] = telemetryItems[i].value;
+    telemetryItems[i].clear();
+  }
+
+  start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    for (auto & value: sportStream) {
+      linearSetTelemetryValue(value.id, 0, (value.physicalId & 0x1F) + 1, value.data + (n & 7), UNIT_RAW, 0);
+    }
+  }
+  end = std::chrono::steady_clock::now();
+  long linearTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    EXPECT_EQ(values[i], telemetryItems[i].value) << "sensor " << i;
+  }
+
+  printf("S.Port stream: %d values x %d\n", (int)DIM(sportStream), iterations);
+  printf("  linear scan:   %6ldus\n", linearTime);
+  printf("  sensors index: %6ldus\n", indexTime);
+}
+
+
+// The stuffed S.Port frame of a packet
+static void appendSportFrame(std::vector<uint8_t> & stream, const uint8_t * packet)
+{
+  stream.push_back(START_STOP);
+  for (int i=0; i<FRSKY_SPORT_PACKET_SIZE; i++) {
+    if (packet[i] == START_STOP || packet[i] == BYTESTUFF) {
+      stream.push_back(BYTESTUFF);
+      stream.push_back(packet[i] ^ STUFF_MASK);
+    }
+    else {
+      stream.push_back(packet[i]);
+    }
+  }
+}
+
+static int32_t frskyStreamState()
+{
+  int32_t result = telemetryRxBufferCount;
+  for (int i=0; i<4; i++) {
+    result = result * 31 + telemetryItems[i].value;
+  }
+  return result;
+}
+
+TEST(FrSkySPORT, processSpans)
+{
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+  std::vector<uint8_t> stream;
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  uint8_t protocol = telemetryProtocol;
+  telemetryProtocol = PROTOCOL_FRSKY_SPORT;
+
+  // garbage, stuffed bytes and broken frames between the packets
+  srand(42);
+  for (int n=0; n<200; n++) {
+    for (int i=rand() % 4; i>0; i--) {
+      stream.push_back(rand() % 8 == 0 ? START_STOP : rand());
+    }
+    generateSportFasVoltagePacket(packet, n % 3 == 0 ? 0x7D7E + n : rand() & 0xFFFF);
+    appendSportFrame(stream, packet);
+  }
+  generateSportFasVoltagePacket(packet, 1000);
+  appendSportFrame(stream, packet);
+
+  // the state after each byte
+  std::vector<int32_t> states;
+  for (auto data: stream) {
+    processFrskyTelemetryData(data);
+    states.push_back(frskyStreamState());
+  }
+  EXPECT_EQ(1000, telemetryItems[0].value);
+
+  // the same states at the end of each span
+  TELEMETRY_RESET();
+  for (unsigned int start=0; start<stream.size(); ) {
+    unsigned int count = std::min<unsigned int>(1 + rand() % 40, stream.size() - start);
+    processFrskyTelemetrySpan(&stream[start], count);
+    start += count;
+    ASSERT_EQ(states[start-1], frskyStreamState()) << "at byte " << start;
+  }
+
+  telemetryProtocol = protocol;
+}
+
+// The stuffed FrSky D frame of a packet, with its end byte
+static void appendFrskyDFrame(std::vector<uint8_t> & stream, const uint8_t * packet, int size)
+{
+  stream.push_back(START_STOP);
+  for (int i=0; i<size; i++) {
+    if (packet[i] == START_STOP || packet[i] == BYTESTUFF) {
+      stream.push_back(BYTESTUFF);
+      stream.push_back(packet[i] ^ STUFF_MASK);
+    }
+    else {
+      stream.push_back(packet[i]);
+    }
+  }
+  stream.push_back(START_STOP);
+}
+
+TEST(FrSky, processSpans)
+{
+  uint8_t packet[2 * TELEMETRY_RX_PACKET_SIZE];
+  std::vector<uint8_t> stream;
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  uint8_t protocol = telemetryProtocol;
+  telemetryProtocol = PROTOCOL_FRSKY_D;
+
+  // link packets and fuel levels in user data packets, with garbage,
+  // stuffed bytes and frames longer than the buffer between them
+  srand(42);
+  for (int n=0; n<200; n++) {
+    for (int i=rand() % 4; i>0; i--) {
+      stream.push_back(rand() % 8 == 0 ? START_STOP : rand());
+    }
+    if (n % 4 == 0) {
+      uint8_t user[] = { USRPKT, 5, 0x00, 0x5E, FUEL_ID, uint8_t(rand() % 101), 0x00, 0x5E, 0x00 };
+      appendFrskyDFrame(stream, user, sizeof(user));
+    }
+    else if (n % 10 == 1) {
+      packet[0] = LINKPKT;
+      memset(&packet[1], 0x11, sizeof(packet) - 1);
+      appendFrskyDFrame(stream, packet, sizeof(packet));
+    }
+    else {
+      // A1, A2, the 2 RSSIs and 4 unused bytes
+      packet[0] = LINKPKT;
+      for (int i=1; i<9; i++) {
+        packet[i] = (n % 3 == 0 ? 0x7D + (i & 1) : rand());
+      }
+      appendFrskyDFrame(stream, packet, 9);
+    }
+  }
+  uint8_t user[] = { USRPKT, 5, 0x00, 0x5E, FUEL_ID, 100, 0x00, 0x5E, 0x00 };
+  appendFrskyDFrame(stream, user, sizeof(user));
+
+  // the state after each byte
+  std::vector<int32_t> states;
+  for (auto data: stream) {
+    processFrskyTelemetryData(data);
+    states.push_back(frskyStreamState());
+  }
+  EXPECT_EQ(100, telemetryItems[0].value);
+
+  // the same states at the end of each span
+  TELEMETRY_RESET();
+  for (unsigned int start=0; start<stream.size(); ) {
+    unsigned int count = std::min<unsigned int>(1 + rand() % 40, stream.size() - start);
+    processFrskyTelemetrySpan(&stream[start], count);
+    start += count;
+    ASSERT_EQ(states[start-1], frskyStreamState()) << "at byte " << start;
+  }
+
+  telemetryProtocol = protocol;
+}
+
+TEST(Telemetry, fifoSpans)
+{
+  Fifo<uint8_t, 16> fifo;
+  const uint8_t * span;
+  uint8_t next = 0;
+  uint8_t expected = 0;
+
+  EXPECT_EQ(0u, fifo.peekSpan(span));
+  for (int n=0; n<20; n++) {
+    for (int i=0; i<5+n%7; i++) {
+      fifo.push(next++);
+    }
+    uint32_t size = fifo.size();
+    uint32_t read = 0;
+    uint32_t count;
+    // the data wraps around at most once
+    for (int i=0; (count = fifo.peekSpan(span)) > 0; i++) {
+      ASSERT_LT(i, 2);
+      for (uint32_t j=0; j<count; j++) {
+        ASSERT_EQ(expected++, span[j]);
+      }
+      fifo.consume(count);
+      read += count;
+    }
+    EXPECT_EQ(size, read);
+    EXPECT_TRUE(fifo.isEmpty());
+  }
+}
+
 #endif  //#if defined(TELEMETRY_FRSKY_SPORT)
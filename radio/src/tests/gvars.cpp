@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+
+#if defined(CPUARM) && defined(GVARS)
+
+class GVarsTest : public OpenTxTest {};
+
+// The value of a flight mode which uses the value of another flight mode
+static int16_t gvarLink(uint8_t fm, uint8_t target)
+{
+  return GVAR_MAX + 1 + (target < fm ? target : target - 1);
+}
+
+// choice 0 is an own value, choice N the value of the Nth other flight mode
+static void setGVarChoice(uint8_t gv, uint8_t fm, unsigned int choice)
+{
+  if (fm == 0 || choice == 0) {
+    g_model.flightModeData[fm].gvars[gv] = fm * 100 + gv * 10 - 500;
+  }
+  else {
+    uint8_t target = choice - 1;
+    if (target >= fm) target++;
+    g_model.flightModeData[fm].gvars[gv] = gvarLink(fm, target);
+  }
+}
+
+// the resolved values are the ones found by the chain walk
+static void checkResolvedValues()
+{
+  for (uint8_t fm=0; fm<MAX_FLIGHT_MODES; fm++) {
+    for (uint8_t gv=0; gv<MAX_GVARS; gv++) {
+      int16_t expected = GVAR_VALUE(gv, getGVarFlightMode(fm, gv));
+      int32_t prec = (g_model.gvars[gv].prec == 0 ? 10 : 1);
+      ASSERT_EQ(expected, getGVarValue(gv, fm)) << "FM" << (int)fm << " GV" << gv+1;
+      ASSERT_EQ(-expected, getGVarValue(-1-gv, fm)) << "FM" << (int)fm << " -GV" << gv+1;
+      ASSERT_EQ(expected * prec, getGVarValuePrec1(gv, fm)) << "FM" << (int)fm << " GV" << gv+1;
+      ASSERT_EQ(-expected * prec, getGVarValuePrec1(-1-gv, fm)) << "FM" << (int)fm << " -GV" << gv+1;
+      mixerCurrentFlightMode = fm;
+      ASSERT_EQ(expected, getValue(MIXSRC_GVAR1 + gv)) << "FM" << (int)fm << " GV" << gv+1 << " source";
+    }
+  }
+  mixerCurrentFlightMode = 0;
+}
+
+// All the chains between the first flight modes (each one may use its own
+// value or the value of any other flight mode), one configuration per GVAR,
+// the last flight modes linked to the configuration to build long chains
+// and loops
+TEST_F(GVarsTest, chainWalkEquivalence)
+{
+  const unsigned int choices = MAX_FLIGHT_MODES;
+  const unsigned int exhaustiveModes = 4;
+  unsigned int configurations = 1;
+  for (unsigned int i=0; i<exhaustiveModes; i++) {
+    configurations *= choices;
+  }
+
+  for (unsigned int first=0; first<configurations; first+=MAX_GVARS) {
+    for (uint8_t gv=0; gv<MAX_GVARS; gv++) {
+      unsigned int configuration = first + gv;
+      g_model.gvars[gv].prec = configuration & 1;
+      for (uint8_t fm=1; fm<MAX_FLIGHT_MODES; fm++) {
+        unsigned int choice;
+        if (fm <= exhaustiveModes) {
+          choice = configuration % choices;
+          configuration /= choices;
+        }
+        else {
+          choice = (first / MAX_GVARS + fm * gv) % choices;
+        }
+        setGVarChoice(gv, fm, choice);
+      }
+    }
+    storageDirty(EE_MODEL);
+    checkResolvedValues();
+  }
+}
+
+TEST_F(GVarsTest, randomChains)
+{
+  srand(42);
+  for (int n=0; n<2000; n++) {
+    for (uint8_t gv=0; gv<MAX_GVARS; gv++) {
+      g_model.gvars[gv].prec = rand() & 1;
+      for (uint8_t fm=1; fm<MAX_FLIGHT_MODES; fm++) {
+        setGVarChoice(gv, fm, rand() % MAX_FLIGHT_MODES);
+      }
+    }
+    storageDirty(EE_MODEL);
+    checkResolvedValues();
+  }
+}
+
+TEST_F(GVarsTest, updatedOnChange)
+{
+  // FM2 -> FM1 -> FM0
+  g_model.flightModeData[0].gvars[0] = 10;
+  g_model.flightModeData[1].gvars[0] = gvarLink(1, 0);
+  g_model.flightModeData[2].gvars[0] = gvarLink(2, 1);
+  storageDirty(EE_MODEL);
+  EXPECT_EQ(10, getGVarValue(0, 2));
+
+  // written in the flight mode at the end of the chain
+  setGVarValue(0, 20, 2);
+  EXPECT_EQ(20, g_model.flightModeData[0].gvars[0]);
+  EXPECT_EQ(20, getGVarValue(0, 2));
+  EXPECT_EQ(20, getGVarValue(0, 1));
+
+  // the editors
+  g_model.flightModeData[1].gvars[0] = 30;
+  storageDirty(EE_MODEL);
+  EXPECT_EQ(20, getGVarValue(0, 0));
+  EXPECT_EQ(30, getGVarValue(0, 1));
+  EXPECT_EQ(30, getGVarValue(0, 2));
+
+  // a loop FM1 -> FM2 -> FM1 falls back to FM0
+  g_model.flightModeData[1].gvars[0] = gvarLink(1, 2);
+  storageDirty(EE_MODEL);
+  EXPECT_EQ(20, getGVarValue(0, 1));
+  EXPECT_EQ(20, getGVarValue(0, 2));
+}
+
+#endif
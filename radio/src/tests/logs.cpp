@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gtests.h"
+
+#if defined(BINARY_LOGS)
+#include <QBuffer>
+#include <QString>
+#include <QStringList>
+#include "binary_logs.h"
+#include "../../../companion/src/binarylogs.h"
+
+#define LOGS_TEST_RECORDS   (2*BINARY_LOGS_KEYFRAME_PERIOD + 5)
+
+static int16_t getLogsTestStick(int record)
+{
+  return (record % 2) ? 1024 : -1024;
+}
+
+static tmr10ms_t getLogsTestPeriod(int record)
+{
+  // a time delta which doesn't fit in 16 bits forces a keyframe
+  return record == BINARY_LOGS_KEYFRAME_PERIOD / 2 ? 40000 : 10;
+}
+
+// the time of a CSV row, unit 10ms
+static int getLogsTestTime(const QStringList & labels, const QStringList & row)
+{
+  if (labels[0] == "Date") {
+    int hours, minutes, seconds, ms;
+    sscanf(row[1].toUtf8().constData(), "%d:%d:%d.%d", &hours, &minutes, &seconds, &ms);
+    return ((hours * 60 + minutes) * 60 + seconds) * 100 + ms / 10;
+  }
+  return atoi(row[0].toUtf8().constData());
+}
+
+// The records written by logsWrite() are read back by the Companion converter
+TEST(Logs, binaryRoundTrip)
+{
+  char sdPath[] = "/tmp/opentx-logs-XXXXXX";
+  ASSERT_NE(mkdtemp(sdPath), (char *)NULL);
+  simuFatfsSetPaths(sdPath, NULL);
+
+  MODEL_RESET();
+  modelDefault(0);
+  logsInit();
+  logDelay = 1;
+  modelFunctionsContext.activeFunctions |= (1 << FUNCTION_LOGS);
+
+  for (int i=0; i<LOGS_TEST_RECORDS; i++) {
+    g_tmr10ms += getLogsTestPeriod(i);
+    calibratedStick[0] = getLogsTestStick(i);
+    calibratedStick[1] = i * 7;
+    g_vbat100mV = 75 + i;
+    logsWrite();
+    logsFlush();
+  }
+  logsClose();
+
+  modelFunctionsContext.activeFunctions = 0;
+  logDelay = 0;
+
+  std::string logsPath = std::string(sdPath) + LOGS_PATH;
+  std::string filename;
+  DIR dir;
+  FILINFO info;
+  ASSERT_EQ(FR_OK, f_opendir(&dir, LOGS_PATH));
+  while (f_readdir(&dir, &info) == FR_OK && info.fname[0]) {
+    if (info.fname[0] != '.') {
+      filename = logsPath + "/" + info.fname;
+    }
+  }
+  f_closedir(&dir);
+  simuFatfsSetPaths("", NULL);
+  ASSERT_FALSE(filename.empty());
+
+  QBuffer csv;
+  csv.open(QIODevice::WriteOnly);
+  EXPECT_EQ(0, convertBinaryLogFile(filename.c_str(), csv));
+  unlink(filename.c_str());
+  rmdir(logsPath.c_str());
+  rmdir(sdPath);
+
+  QStringList lines = QString(csv.data()).split('\n', QString::SkipEmptyParts);
+  ASSERT_EQ(LOGS_TEST_RECORDS + 1, lines.size());
+
+  QStringList labels = lines[0].split(',');
+  char label[8];
+  getAnalogLogLabel(label, 0);
+  EXPECT_STREQ("Rud", label);
+  int stick = labels.indexOf(label);
+  ASSERT_GE(stick, 0);
+  getAnalogLogLabel(label, 1);
+  EXPECT_EQ(stick + 1, labels.indexOf(label));
+  EXPECT_TRUE(labels.last() == "TxBat(V)");
+
+  int start = getLogsTestTime(labels, lines[1].split(','));
+  int elapsed = 0;
+  for (int i=0; i<LOGS_TEST_RECORDS; i++) {
+    QStringList row = lines[i+1].split(',');
+    ASSERT_EQ(labels.size(), row.size());
+    if (i > 0)
+      elapsed += getLogsTestPeriod(i);
+    EXPECT_EQ(elapsed, (getLogsTestTime(labels, row) - start + 24*3600*100) % (24*3600*100)) << "record " << i;
+    EXPECT_TRUE(row[stick] == QString::number(getLogsTestStick(i))) << "record " << i;
+    EXPECT_TRUE(row[stick+1] == QString::number(i * 7)) << "record " << i;
+    EXPECT_TRUE(row.last() == QString("%1.%2").arg((75 + i) / 10).arg((75 + i) % 10)) << "record " << i;
+  }
+}
+
+#endif // #if defined(BINARY_LOGS)
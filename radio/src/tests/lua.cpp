@@ -19,6 +19,9 @@
  */
 
 #include <math.h>
+#include <chrono>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "gtests.h"
 
 #if defined(LUA)
@@ -165,4 +168,179 @@ TEST(Lua, testModelInputs)
 
 }
 
+TEST(Lua, testPermanentScriptTimeSlice)
+{
+  MODEL_RESET();
+  luaInit();
+  luaState = 0;
+
+  // a function script longer than its time slice, but within the instructions limit
+  luaExecStr("count = 0");
+  luaExecStr("function slow() for i=1,100 do local s = string.rep('0123456789', 100000) end count = count + 1 end");
+  g_model.customFn[0].swtch = SWSRC_ON;
+  ScriptInternalData & sid = scriptInternalData[0];
+  memset(&sid, 0, sizeof(sid));
+  sid.reference = SCRIPT_FUNC_FIRST;
+  lua_getglobal(lsScripts, "slow");
+  sid.run = luaL_ref(lsScripts, LUA_REGISTRYINDEX);
+  luaScriptsCount = 1;
+
+  // it yields and is resumed at the next cycles
+  EXPECT_TRUE(luaTask(0, RUN_FUNC_SCRIPT, false));
+  EXPECT_EQ(RUN_FUNC_SCRIPT, sid.runType);
+  EXPECT_FALSE(luaTask(0, RUN_TELEM_FG_SCRIPT, true));
+  for (int i=0; i<1000 && sid.runType; i++) {
+    EXPECT_TRUE(luaTask(0, RUN_FUNC_SCRIPT, false));
+  }
+  EXPECT_EQ(SCRIPT_OK, sid.state);
+  EXPECT_EQ(0, sid.runType);
+  EXPECT_GT(sid.lastRunSlices, 1);
+  EXPECT_GT(sid.lastRunTime, 0u);
+  luaExecStr("if count ~= 1 then error('count') end");
+
+  // the next run starts from the beginning
+  EXPECT_TRUE(luaTask(0, RUN_FUNC_SCRIPT, false));
+  EXPECT_EQ(RUN_FUNC_SCRIPT, sid.runType);
+
+  luaScriptsCount = 0;
+  luaInit();
+}
+
+#if defined(LUA_COMPILER)
+#define CACHE_TEST_SCRIPTS    8
+
+static void writeCacheTestScript(const char * sdPath, int index, int value, const char * header="")
+{
+  char path[256];
+  sprintf(path, "%s" SCRIPTS_FUNCS_PATH "/cache%d" SCRIPT_EXT, sdPath, index);
+  FILE * f = fopen(path, "w");
+  ASSERT_TRUE(f != NULL);
+  fputs(header, f);
+  // enough code for the compilation to matter
+  for (int i=0; i<100; i++) {
+    fprintf(f, "local function f%d(x)\n  local t = {}\n  for i=1,x do t[i] = string.format('%%d', i*%d) end\n  return t\nend\n", i, i);
+  }
+  fprintf(f, "return { run = function() return %d end }\n", value);
+  fclose(f);
+}
+
+static int loadCacheTestScript(int index)
+{
+  char filename[64];
+  sprintf(filename, SCRIPTS_FUNCS_PATH "/cache%d" SCRIPT_EXT, index);
+  if (luaLoadScriptFileToState(lsScripts, filename, LUA_SCRIPT_LOAD_MODE) != SCRIPT_OK) {
+    return -1;
+  }
+  int value = -1;
+  if (lua_pcall(lsScripts, 0, 1, 0) == LUA_OK) {
+    lua_getfield(lsScripts, -1, "run");
+    if (lua_pcall(lsScripts, 0, 1, 0) == LUA_OK) {
+      value = lua_tointeger(lsScripts, -1);
+    }
+    lua_pop(lsScripts, 1);
+  }
+  lua_pop(lsScripts, 1);
+  return value;
+}
+
+static long loadCacheTestScripts(bool cache, int iterations)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int n=0; n<iterations; n++) {
+    if (cache) {
+      luaOpenScriptsCache("test");
+    }
+    for (int i=0; i<CACHE_TEST_SCRIPTS; i++) {
+      loadCacheTestScript(i);
+    }
+    if (cache) {
+      luaCloseScriptsCache();
+    }
+    lua_gc(lsScripts, LUA_GCCOLLECT, 0);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+TEST(Lua, scriptsCache)
+{
+  char sdPath[] = "/tmp/opentx-gtests-XXXXXX";
+  ASSERT_TRUE(mkdtemp(sdPath) != NULL);
+  std::string root(sdPath);
+  mkdir((root + SCRIPTS_PATH).c_str(), 0777);
+  mkdir((root + SCRIPTS_FUNCS_PATH).c_str(), 0777);
+  for (int i=0; i<CACHE_TEST_SCRIPTS; i++) {
+    writeCacheTestScript(sdPath, i, i);
+  }
+  simuFatfsSetPaths(sdPath, NULL);
+  luaInit();
+
+  // the cache is written when it's closed
+  luaOpenScriptsCache("test");
+  for (int i=0; i<CACHE_TEST_SCRIPTS; i++) {
+    EXPECT_EQ(i, loadCacheTestScript(i));
+  }
+  luaCloseScriptsCache();
+  FILINFO info;
+  EXPECT_EQ(FR_OK, f_stat(SCRIPTS_CACHE_PATH "/test" SCRIPTS_CACHE_EXT, &info));
+
+  // the scripts are loaded from the cache, except the one which changed
+  writeCacheTestScript(sdPath, 3, 33);
+  luaOpenScriptsCache("test");
+  for (int i=0; i<CACHE_TEST_SCRIPTS; i++) {
+    EXPECT_EQ(i == 3 ? 33 : i, loadCacheTestScript(i));
+  }
+  luaCloseScriptsCache();
+
+  // the directory changes: a script is rewritten with the same source and is
+  // still loaded from the cache, another one starts with a comment line, as
+  // luaL_loadfilex() accepts them
+  writeCacheTestScript(sdPath, 5, 5);
+  writeCacheTestScript(sdPath, 6, 66, "#!/usr/bin/lua\n");
+  for (int n=0; n<2; n++) {
+    luaOpenScriptsCache("test");
+    for (int i=0; i<CACHE_TEST_SCRIPTS; i++) {
+      EXPECT_EQ(i == 3 ? 33 : (i == 6 ? 66 : i), loadCacheTestScript(i));
+    }
+    luaCloseScriptsCache();
+  }
+
+  // a removed script isn't loaded from the cache
+  char removed[256];
+  sprintf(removed, "%s" SCRIPTS_FUNCS_PATH "/cache%d" SCRIPT_EXT, sdPath, 7);
+  unlink(removed);
+  luaOpenScriptsCache("test");
+  EXPECT_EQ(-1, loadCacheTestScript(7));
+  luaCloseScriptsCache();
+  writeCacheTestScript(sdPath, 7, 7);
+
+  // the scripts not loaded are removed from the cache
+  luaOpenScriptsCache("test");
+  EXPECT_EQ(33, loadCacheTestScript(3));
+  luaCloseScriptsCache();
+
+  // load time of the scripts with and without the cache
+  const int iterations = 20;
+  long sourceTime = loadCacheTestScripts(false, iterations);
+  long cacheTime = loadCacheTestScripts(true, iterations);
+  printf("Lua scripts load: %d scripts x %d\n", CACHE_TEST_SCRIPTS, iterations);
+  printf("  without cache: %6ldus\n", sourceTime);
+  printf("  with cache:    %6ldus\n", cacheTime);
+
+  luaInit();
+  simuFatfsSetPaths("", NULL);
+  for (int i=0; i<CACHE_TEST_SCRIPTS; i++) {
+    char path[256];
+    sprintf(path, "%s" SCRIPTS_FUNCS_PATH "/cache%d", sdPath, i);
+    unlink((std::string(path) + SCRIPT_EXT).c_str());
+    unlink((std::string(path) + SCRIPT_BIN_EXT).c_str());
+  }
+  unlink((root + SCRIPTS_CACHE_PATH "/test" SCRIPTS_CACHE_EXT).c_str());
+  rmdir((root + SCRIPTS_CACHE_PATH).c_str());
+  rmdir((root + SCRIPTS_FUNCS_PATH).c_str());
+  rmdir((root + SCRIPTS_PATH).c_str());
+  rmdir(sdPath);
+}
+#endif
+
 #endif   // #if defined(LUA)
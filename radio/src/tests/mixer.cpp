@@ -556,6 +556,167 @@ TEST_F(MixerTest, BlockingChannel)
   EXPECT_EQ(chans[0], 0);
 }
 
+#if defined(CPUARM)
+TEST_F(MixerTest, MixerPlanOrder)
+{
+  memclear(g_model.mixData, sizeof(g_model.mixData));
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].srcRaw = MIXSRC_CH2;
+  g_model.mixData[0].weight = 100;
+  g_model.mixData[1].destCh = 1;
+  g_model.mixData[1].srcRaw = MIXSRC_MAX;
+  g_model.mixData[1].weight = 100;
+  g_model.mixData[2].destCh = 2;
+  g_model.mixData[2].srcRaw = MIXSRC_MAX;
+  g_model.mixData[2].weight = 100;
+  g_model.mixData[2].flightModes = (1 << MAX_FLIGHT_MODES) - 1;
+  // the line was active before it was disabled
+  swOn[2].activeMix = 1;
+  buildMixerPlan();
+  EXPECT_FALSE(isMixActive(2));
+  EXPECT_TRUE(mixerPlan.ordered);
+  EXPECT_EQ(mixerPlan.count, 2);
+  EXPECT_EQ(mixerPlan.items[0].index, 1);
+  EXPECT_EQ(mixerPlan.items[1].index, 0);
+  EXPECT_EQ(mixerPlan.items[1].srcChannel, 1);
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(chans[0], CHANNEL_MAX);
+  EXPECT_EQ(chans[1], CHANNEL_MAX);
+  EXPECT_EQ(chans[2], 0);
+}
+
+TEST_F(MixerTest, MixerPlanLoop)
+{
+  memclear(g_model.mixData, sizeof(g_model.mixData));
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].srcRaw = MIXSRC_CH2;
+  g_model.mixData[0].weight = 100;
+  g_model.mixData[1].destCh = 1;
+  g_model.mixData[1].srcRaw = MIXSRC_CH1;
+  g_model.mixData[1].weight = 100;
+  buildMixerPlan();
+  EXPECT_FALSE(mixerPlan.ordered);
+  EXPECT_EQ(mixerPlan.count, 2);
+  EXPECT_EQ(mixerPlan.items[0].index, 0);
+  EXPECT_EQ(mixerPlan.items[1].index, 1);
+}
+
+TEST_F(MixerTest, FadeSharedChannels)
+{
+  memclear(g_model.mixData, sizeof(g_model.mixData));
+  g_model.flightModeData[1].swtch = SWSRC_ID1;
+  g_model.flightModeData[0].fadeOut = 10;
+  g_model.flightModeData[1].fadeIn = 10;
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].srcRaw = MIXSRC_MAX;
+  g_model.mixData[0].weight = 100;
+  g_model.mixData[1].destCh = 1;
+  g_model.mixData[1].srcRaw = MIXSRC_MAX;
+  g_model.mixData[1].flightModes = 0b10;
+  g_model.mixData[1].weight = 100;
+  g_model.mixData[2].destCh = 2;
+  g_model.mixData[2].srcRaw = MIXSRC_CH2;
+  g_model.mixData[2].weight = 100;
+  lastFlightMode = 255;
+  simuSetSwitch(0, -1);
+  evalMixes(1);
+  EXPECT_EQ(mixerPlan.fmChannels, (bitfield_channels_t)0b110);
+  EXPECT_EQ(channelOutputs[0], 1024);
+  EXPECT_EQ(channelOutputs[1], 1024);
+  EXPECT_EQ(channelOutputs[2], 1024);
+  simuSetSwitch(0, 0);
+  for (int n=0; n<20; n++) {
+    evalMixes(1);
+  }
+  EXPECT_EQ(channelOutputs[0], 1024);
+  EXPECT_GT(channelOutputs[1], 0);
+  EXPECT_LT(channelOutputs[1], 1024);
+  EXPECT_EQ(channelOutputs[2], channelOutputs[1]);
+  // run mixes enough time to fade out flight modes (otherwise the mixer internal state flightModesFade  could affect other tests)
+  for (int n=0; n<500; n++) {
+    evalMixes(1);
+  }
+  EXPECT_EQ(channelOutputs[0], 1024);
+  EXPECT_EQ(channelOutputs[1], 0);
+  EXPECT_EQ(channelOutputs[2], 0);
+}
+
+TEST_F(MixerTest, MixWarningDuringFade)
+{
+  memclear(g_model.mixData, sizeof(g_model.mixData));
+  g_model.flightModeData[1].swtch = SWSRC_ID1;
+  g_model.flightModeData[0].fadeOut = 10;
+  g_model.flightModeData[1].fadeIn = 10;
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].srcRaw = MIXSRC_MAX;
+  g_model.mixData[0].flightModes = 0b01;
+  g_model.mixData[0].mixWarn = 1;
+  g_model.mixData[0].weight = 100;
+  lastFlightMode = 255;
+  simuSetSwitch(0, -1);
+  evalMixes(1);
+  EXPECT_EQ(0, mixWarning);
+  simuSetSwitch(0, 0);
+  for (int n=0; n<20; n++) {
+    evalMixes(1);
+    // the flight mode faded out doesn't clear the warning of the current one
+    EXPECT_EQ(1, mixWarning);
+  }
+  for (int n=0; n<500; n++) {
+    evalMixes(1);
+  }
+  EXPECT_EQ(1, mixWarning);
+  simuSetSwitch(0, -1);
+  for (int n=0; n<500; n++) {
+    evalMixes(1);
+  }
+  EXPECT_EQ(0, mixWarning);
+}
+
+TEST_F(MixerTest, SourcesSnapshot)
+{
+  memclear(g_model.mixData, sizeof(g_model.mixData));
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].srcRaw = MIXSRC_FIRST_TIMER;
+  g_model.mixData[0].weight = 100;
+  g_model.mixData[1].destCh = 1;
+  g_model.mixData[1].srcRaw = MIXSRC_MAX;
+  g_model.mixData[1].weight = 100;
+  g_model.mixData[2].destCh = 2;
+  g_model.mixData[2].srcRaw = MIXSRC_FIRST_TIMER;
+  g_model.mixData[2].weight = 50;
+  g_model.logicalSw[0].func = LS_FUNC_VPOS;
+  g_model.logicalSw[0].v1 = MIXSRC_FIRST_TRAINER;
+  g_model.logicalSw[0].v2 = 0;
+  storageDirty(EE_MODEL);
+
+  // the values read before the mixes are used during the whole cycle
+  timersStates[0].val = 100;
+  ppmInput[0] = 50;
+  fillSourcesSnapshot();
+  EXPECT_EQ(sourcesSnapshot.count, 2);
+  EXPECT_EQ(sourcesSnapshot.sources[0], MIXSRC_FIRST_TIMER);
+  EXPECT_EQ(sourcesSnapshot.sources[1], MIXSRC_FIRST_TRAINER);
+  timersStates[0].val = 200;
+  ppmInput[0] = -50;
+  evalFlightModeMixes(e_perout_mode_normal, 1);
+  EXPECT_EQ(getSnapshotValue(MIXSRC_FIRST_TIMER), 100);
+  EXPECT_EQ(chans[0], 100 << 8);
+  EXPECT_EQ(chans[1], CHANNEL_MAX);
+  EXPECT_EQ(chans[2], 50 << 8);
+  EXPECT_TRUE(getSwitch(SWSRC_SW1));
+
+  // and outside of the mixer cycle the sources are read again
+  releaseSourcesSnapshot();
+  EXPECT_EQ(getSnapshotValue(MIXSRC_FIRST_TIMER), 200);
+  evalFlightModeMixes(e_perout_mode_normal, 1);
+  EXPECT_EQ(chans[0], 200 << 8);
+  EXPECT_FALSE(getSwitch(SWSRC_SW1));
+  timersStates[0].val = 0;
+  ppmInput[0] = 0;
+}
+#endif
+
 TEST_F(MixerTest, RecursiveAddChannel)
 {
   g_model.mixData[0].destCh = 0;
@@ -981,3 +1142,97 @@ TEST(Trainer, UnpluggedTest)
   ppmInput[0] = 1024;
   CHECK_DELAY(0, 5000);
 }
+
+#if defined(CPUARM)
+TEST(MixerScheduler, DurationEstimate)
+{
+  MixerScheduler scheduler;
+  EXPECT_EQ(scheduler.getDuration(), MIXER_SCHEDULER_DEFAULT_DURATION);
+  scheduler.updateDuration(3000);
+  EXPECT_EQ(scheduler.getDuration(), 3000);
+  for (int i=0; i<200; i++) {
+    scheduler.updateDuration(800);
+  }
+  EXPECT_EQ(scheduler.getDuration(), 800);
+
+  // a longer mixer wakes up earlier
+  scheduler.schedule(0, 100, 9);
+  EXPECT_EQ(scheduler.getWakeupTime(0), 103u);
+  scheduler.updateDuration(3000);
+  scheduler.schedule(0, 100, 9);
+  EXPECT_EQ(scheduler.getWakeupTime(0), 102u);
+}
+
+TEST(MixerScheduler, LateWakeup)
+{
+  MixerScheduler scheduler;
+  scheduler.start(10);
+  EXPECT_EQ(scheduler.getTimeout(10), MIXER_SCHEDULER_MAX_PERIOD);
+  scheduler.schedule(0, 11, 9);
+  EXPECT_EQ(scheduler.getTimeout(11), 3);
+  // the wakeup tick has been missed, the mixer runs at once instead of waiting for the next 20ms
+  EXPECT_EQ(scheduler.getTimeout(16), -2);
+  scheduler.start(16);
+  EXPECT_FALSE(scheduler.isPending(0));
+  EXPECT_EQ(scheduler.getTimeout(16), MIXER_SCHEDULER_MAX_PERIOD);
+}
+
+#if NUM_MODULES >= 2
+TEST(MixerScheduler, TwoModulesVirtualClock)
+{
+  // PXX on the internal module, PPM 22.5ms on the external one
+  const uint32_t framePeriod[NUM_MODULES] = { 9000, 22500 };
+  const uint16_t schedulePeriod[NUM_MODULES] = { 9, 22 };
+  const uint16_t mixerDuration = 800;
+
+  MixerScheduler scheduler;
+  uint32_t nextFrame[NUM_MODULES] = { 1300, 1700 };
+  uint32_t frames[NUM_MODULES] = { 0, 0 };
+  uint32_t runEnd = 0, previousRunEnd = 0;
+  uint32_t sleepUntil = 0;
+  int wakeups = 0, runs = 0, missed = 0;
+
+  for (uint32_t tick=0; tick<1000; tick++) {
+    uint32_t now = tick * MIXER_SCHEDULER_TICK_US;
+    if (tick >= sleepUntil) {
+      wakeups++;
+      int32_t timeout = scheduler.getTimeout(tick);
+      if (timeout <= 0) {
+        runs++;
+        scheduler.start(tick);
+        previousRunEnd = runEnd;
+        runEnd = now + mixerDuration;
+        scheduler.updateDuration(mixerDuration);
+        timeout = scheduler.getTimeout(tick);
+      }
+      sleepUntil = tick + timeout;
+    }
+    for (uint8_t module=0; module<NUM_MODULES; module++) {
+      while (nextFrame[module] < now + MIXER_SCHEDULER_TICK_US) {
+        uint32_t frameTime = nextFrame[module];
+        uint32_t lastEnd = (runEnd <= frameTime ? runEnd : previousRunEnd);
+        if (frames[module] > 0 && lastEnd + framePeriod[module] <= frameTime) {
+          missed++;
+        }
+        if (frames[module] > 2) {
+          // once the mixer duration is known, the channels are never older than 2 ticks when they are sent
+          EXPECT_LT(frameTime - lastEnd, 2*MIXER_SCHEDULER_TICK_US + 500u);
+        }
+        frames[module]++;
+        scheduler.schedule(module, tick, schedulePeriod[module]);
+        // the flag wakes up the mixer task which goes back to sleep
+        wakeups++;
+        sleepUntil = tick + max<int32_t>(1, scheduler.getTimeout(tick));
+        nextFrame[module] += framePeriod[module];
+      }
+    }
+  }
+
+  EXPECT_EQ(missed, 0);
+  EXPECT_GT(frames[0], 200u);
+  EXPECT_GT(frames[1], 80u);
+  EXPECT_LE(runs, (int)(frames[0] + frames[1]));
+  EXPECT_LT(wakeups, 1000);
+}
+#endif
+#endif
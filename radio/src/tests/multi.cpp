@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <vector>
+#include "gtests.h"
+
+#if defined(MULTIMODULE)
+static int32_t multiStreamState()
+{
+  int32_t result = telemetryRxBufferCount;
+  for (int i=0; i<8; i++) {
+    result = result * 31 + telemetryItems[i].value;
+  }
+  return result;
+}
+
+// Garbage without start byte, or a broken frame followed by enough garbage
+// for the parser to drop it
+static void appendMultiGarbage(std::vector<uint8_t> & stream, int n, int length)
+{
+  for (int i=rand() % 4; i>0; i--) {
+    stream.push_back(0x55 + rand() % 0x40);
+  }
+  if (n % 10 == 5) {
+    stream.push_back(0xAA);
+    stream.insert(stream.end(), length + rand() % 8, 0x00);
+  }
+}
+
+// The stream is processed byte by byte, then in random spans, with the same
+// state at the end of each span
+template <class BYTE, class SPAN>
+static void checkMultiSpans(const std::vector<uint8_t> & stream, BYTE processByte, SPAN processSpan)
+{
+  std::vector<int32_t> states;
+  for (auto data: stream) {
+    processByte(data);
+    states.push_back(multiStreamState());
+  }
+
+  TELEMETRY_RESET();
+  for (unsigned int start=0; start<stream.size(); ) {
+    unsigned int count = std::min<unsigned int>(1 + rand() % 40, stream.size() - start);
+    processSpan(&stream[start], count);
+    start += count;
+    ASSERT_EQ(states[start-1], multiStreamState()) << "at byte " << start;
+  }
+}
+
+TEST(Spektrum, processSpans)
+{
+  std::vector<uint8_t> stream;
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  telemetryRxBufferCount = 0;
+
+  // telemetry and bind packets, with start bytes in their content
+  srand(42);
+  for (int n=0; n<200; n++) {
+    appendMultiGarbage(stream, n, 18);
+    stream.push_back(0xAA);
+    if (n % 20 == 19) {
+      stream.push_back(0x80);
+      for (int i=0; i<10; i++) {
+        stream.push_back(rand());
+      }
+    }
+    else {
+      stream.push_back(rand() % 0x80);
+      stream.push_back(0x10 + rand() % 4);
+      stream.push_back(0);
+      for (int i=0; i<14; i++) {
+        stream.push_back(rand() % 4 == 0 ? 0xAA : rand());
+      }
+    }
+  }
+  // the TX RSSI
+  stream.push_back(0xAA);
+  stream.push_back(42);
+  stream.insert(stream.end(), 16, 0x00);
+
+  checkMultiSpans(stream, processSpektrumTelemetryData, processSpektrumTelemetrySpan);
+  EXPECT_EQ(42, telemetryItems[0].value);
+}
+
+TEST(FlySky, processSpans)
+{
+  std::vector<uint8_t> stream;
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  telemetryRxBufferCount = 0;
+
+  // the TX RSSI and 7 sensors, with start bytes in their values
+  srand(42);
+  for (int n=0; n<200; n++) {
+    appendMultiGarbage(stream, n, 30);
+    stream.push_back(0xAA);
+    stream.push_back(rand());
+    for (int i=0; i<7; i++) {
+      stream.push_back(i < 4 ? i : 0xFF);
+      stream.push_back(0);
+      stream.push_back(rand() % 4 == 0 ? 0xAA : rand());
+      stream.push_back(rand() % 4 == 0 ? 0xAA : rand());
+    }
+  }
+  stream.push_back(0xAA);
+  stream.push_back(42);
+  stream.insert(stream.end(), 7 * 4, 0xFF);
+
+  checkMultiSpans(stream, processFlySkyTelemetryData, processFlySkyTelemetrySpan);
+  EXPECT_EQ(42, telemetryItems[0].value);
+}
+#endif
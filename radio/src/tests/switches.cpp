@@ -368,3 +368,104 @@ TEST(getSwitch, edgeRelease)
 
 }
 #endif // defined(PCBTARANIS)
+
+#if defined(CPUARM) && defined(VIRTUAL_INPUTS)
+TEST(evalLogicalSwitches, dependencyOrder)
+{
+  MODEL_RESET();
+  MIXER_RESET();
+
+  // L1 uses L2 which is evaluated first
+  setLogicalSwitch(0, LS_FUNC_OR, SWSRC_SW2, SWSRC_OFF);
+  setLogicalSwitch(1, LS_FUNC_OR, SWSRC_SA0, SWSRC_OFF);
+
+  simuSetSwitch(0, 0);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+
+  simuSetSwitch(0, -1);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), true);
+
+  // in a loop L1 is evaluated first and sees the previous state of L2
+  setLogicalSwitch(1, LS_FUNC_AND, SWSRC_SA0, SWSRC_SW1);
+  storageDirty(EE_MODEL);
+  simuSetSwitch(0, 0);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+
+  // an unused switch is off
+  setLogicalSwitch(1, LS_FUNC_OR, SWSRC_SA0, SWSRC_OFF);
+  storageDirty(EE_MODEL);
+  simuSetSwitch(0, -1);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), true);
+  g_model.logicalSw[1].func = LS_FUNC_NONE;
+  storageDirty(EE_MODEL);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+}
+
+TEST(evalLogicalSwitches, telemetryAndTimers)
+{
+  MODEL_RESET();
+  MIXER_RESET();
+  TELEMETRY_RESET();
+
+  setLogicalSwitch(0, LS_FUNC_VPOS, MIXSRC_FIRST_TELEM, 100);
+  setLogicalSwitch(1, LS_FUNC_VNEG, MIXSRC_FIRST_TELEM+1, 0);   // min
+  setLogicalSwitch(2, LS_FUNC_GREATER, MIXSRC_FIRST_TIMER, MIXSRC_FIRST_TELEM);
+  setLogicalSwitch(3, LS_FUNC_AND, SWSRC_SW1, SWSRC_SW3);
+
+  telemetryItems[0].value = 50;
+  timersStates[0].val = 60;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), false);
+
+  telemetryItems[0].value = 150;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), false);
+
+  timersStates[0].val = 200;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW3), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), true);
+
+  telemetryItems[0].valueMin = -10;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW2), true);
+
+  // the telemetry switches are off without telemetry
+  TELEMETRY_RSSI() = 0;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), false);
+
+  TELEMETRY_RSSI() = 100;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), true);
+
+  // each flight mode has its own states
+  mixerCurrentFlightMode = 1;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), true);
+  mixerCurrentFlightMode = 0;
+}
+#endif